@@ -3,7 +3,20 @@
 #include "CoffeeEngine/Core/SystemInfo.h"
 #include "CoffeeEngine/Core/Application.h"
 #include "CoffeeEngine/Core/Timer.h"
+#include "CoffeeEngine/IO/ResourceLoader.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
+#include "CoffeeEngine/Renderer/TextureStreamer.h"
+#include "CoffeeEngine/Scene/Scene.h"
+#include "CoffeeEngine/Scene/WorldPartition.h"
+#include "CoffeeEngine/Scripting/Lua/LuaMemory.h"
+#include "CoffeeEngine/Scripting/Lua/LuaScheduler.h"
+#include "CoffeeEngine/Scripting/Lua/LuaWorkerPool.h"
+#include "CoffeeEngine/Scripting/ScriptSystem.h"
+#include "src/SceneBenchmark.h"
+#include "src/SpatialIndexCheck.h"
+#include <cmath>
 #include <cstdint>
+#include <filesystem>
 #include <imgui.h>
 #include <string>
 
@@ -56,6 +69,63 @@ namespace Coffee {
             ImGui::Checkbox("Frame Time", &m_ShowFrameTime);
             ImGui::TableNextColumn();
             ImGui::Text("%f", FrameTime);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Simulation Rate");
+            ImGui::TableNextColumn();
+            int simulationRate = (int)std::round(1.0 / Application::Get().GetFixedTimestep());
+            if (ImGui::DragInt("##SimulationRate", &simulationRate, 1.0f, 10, 240, "%d Hz"))
+            {
+                Application::Get().SetFixedTimestep(1.0 / simulationRate);
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Max Substeps");
+            ImGui::TableNextColumn();
+            int maxSubsteps = (int)Application::Get().GetMaxSubsteps();
+            if (ImGui::DragInt("##MaxSubsteps", &maxSubsteps, 0.1f, 1, 16))
+            {
+                Application::Get().SetMaxSubsteps((uint32_t)maxSubsteps);
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Substeps / Alpha");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u / %.2f", Application::Get().GetSubstepCount(), Application::Get().GetInterpolationAlpha());
+            ImGui::EndTable();
+            ImGui::TreePop();
+        }
+        // Render Thread
+        if(ImGui::TreeNode("Render Thread")) {
+            const RenderThreadStats& stats = RenderThread::GetStats();
+
+            ImGui::BeginTable("RenderThreadTable", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_BordersOuterV | ImGuiTableFlags_RowBg);
+            ImGui::TableSetupColumn("RenderThreadColumn1", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("RenderThreadColumn2", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            bool enabled = RenderThread::IsEnabled();
+            if (ImGui::Checkbox("Enabled", &enabled))
+            {
+                RenderThread::SetEnabled(enabled);
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", stats.Threaded ? "Threaded" : "Inline");
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Execute Time");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", stats.ExecuteTime);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Main Thread Wait");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", stats.WaitTime);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Overlap");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms (%.0f%%)", stats.OverlapTime, stats.ExecuteTime > 0.0 ? stats.OverlapTime / stats.ExecuteTime * 100.0 : 0.0);
             ImGui::EndTable();
             ImGui::TreePop();
         }
@@ -72,6 +142,293 @@ namespace Coffee {
             ImGui::EndTable();
             ImGui::TreePop();
         }
+        // Texture Streaming
+        if(ImGui::TreeNode("Texture Streaming")) {
+            const TextureStreamingStats& stats = TextureStreamer::GetStats();
+
+            ImGui::BeginTable("TextureStreamingTable", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_BordersOuterV | ImGuiTableFlags_RowBg);
+            ImGui::TableSetupColumn("TextureStreamingColumn1", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("TextureStreamingColumn2", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Checkbox("Resident", &m_TextureStreaming);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f MB", stats.ResidentBytes / (1024.0f * 1024.0f));
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Requested");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f MB", stats.RequestedBytes / (1024.0f * 1024.0f));
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Budget");
+            ImGui::TableNextColumn();
+            int budget = (int)(TextureStreamer::GetBudget() / (1024 * 1024));
+            if (ImGui::DragInt("##TextureBudget", &budget, 1.0f, 16, 16384, "%d MB"))
+            {
+                TextureStreamer::SetBudget((uint64_t)budget * 1024 * 1024);
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Textures");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.StreamedTextures);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Pending Uploads");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.PendingUploads);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Mips In / Out");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u / %u", stats.MipsStreamedIn, stats.MipsStreamedOut);
+            ImGui::EndTable();
+            ImGui::TreePop();
+        }
+        // Texture Deduplication
+        if(ImGui::TreeNode("Texture Deduplication")) {
+            const ResourceDeduplicationStats& stats = ResourceLoader::GetDeduplicationStats();
+
+            ImGui::BeginTable("TextureDeduplicationTable", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_BordersOuterV | ImGuiTableFlags_RowBg);
+            ImGui::TableSetupColumn("TextureDeduplicationColumn1", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("TextureDeduplicationColumn2", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Duplicates");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.DuplicateTextures);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Saved");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f MB", stats.BytesSaved / (1024.0f * 1024.0f));
+            ImGui::EndTable();
+            ImGui::TreePop();
+        }
+        // Scripts
+        if(ImGui::TreeNode("Scripts")) {
+            const ScriptSystemStats& stats = ScriptSystem::GetStats();
+
+            ImGui::BeginTable("ScriptsTable", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_BordersOuterV | ImGuiTableFlags_RowBg);
+            ImGui::TableSetupColumn("ScriptsColumn1", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("ScriptsColumn2", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Updated Scripts");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u / %u", stats.UpdatedCount, stats.ScriptCount);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Skipped Scripts");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.SkippedCount);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Disabled By Errors");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.ErrorCount);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Update Time");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", stats.UpdateTime);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Slowest Script");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms (entity %u)", stats.SlowestTime, (uint32_t)stats.SlowestEntity);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Coroutines");
+            ImGui::TableNextColumn();
+            const LuaSchedulerStats& coroutineStats = LuaScheduler::GetStats();
+            ImGui::Text("%u (%u resumed, %.3f ms)", coroutineStats.CoroutineCount, coroutineStats.ResumedCount, coroutineStats.ResumeTime);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Parallel Scripts");
+            ImGui::TableNextColumn();
+            const LuaWorkerStats& workerStats = LuaWorkerPool::GetStats();
+            ImGui::Text("%u (%.3f ms, slowest worker %.3f ms, %u writes in %.3f ms)", workerStats.ScriptCount, workerStats.UpdateTime,
+                        workerStats.SlowestWorkerTime, workerStats.WriteCount, workerStats.ApplyTime);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Workers");
+            ImGui::TableNextColumn();
+            int workerCount = (int)LuaWorkerPool::GetWorkerCount();
+            if (ImGui::DragInt("##ScriptWorkers", &workerCount, 0.1f, 1, (int)LuaWorkerPool::GetMaxWorkerCount()))
+            {
+                LuaWorkerPool::SetWorkerCount((uint32_t)workerCount);
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Budget (ms)");
+            ImGui::TableNextColumn();
+            float budget = (float)ScriptSystem::GetBudget();
+            if (ImGui::DragFloat("##ScriptBudget", &budget, 0.1f, 0.0f, 100.0f, "%.1f"))
+            {
+                ScriptSystem::SetBudget(budget);
+            }
+            ImGui::EndTable();
+
+            if (ImGui::Button("Run Benchmark (10k scripts)"))
+            {
+                ScriptSystem::Benchmark();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Run Transform Benchmark (1k scripts)"))
+            {
+                ScriptSystem::BenchmarkTransforms();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Run Coroutine Benchmark (10k scripts)"))
+            {
+                ScriptSystem::BenchmarkCoroutines();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Run Parallel Benchmark (20k scripts)"))
+            {
+                ScriptSystem::BenchmarkParallel();
+            }
+            ImGui::TreePop();
+        }
+        // Lua Memory
+        if(ImGui::TreeNode("Lua Memory")) {
+            const LuaMemoryStats& stats = LuaMemory::GetStats();
+            LuaGCSettings settings = LuaMemory::GetSettings();
+            bool settingsChanged = false;
+
+            ImGui::BeginTable("LuaMemoryTable", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_BordersOuterV | ImGuiTableFlags_RowBg);
+            ImGui::TableSetupColumn("LuaMemoryColumn1", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("LuaMemoryColumn2", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Checkbox("Heap", &m_LuaMemory);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f KB (peak %.1f KB)", stats.HeapBytes / 1024.0f, stats.PeakBytes / 1024.0f);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Allocations / Frame");
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)stats.FrameAllocations);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("GC Time");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", stats.GCTime);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Cycles / Forced");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u / %u", stats.CompletedCycles, stats.ForcedCollections);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("GC Mode");
+            ImGui::TableNextColumn();
+            const char* modes[] = { "Incremental", "Generational" };
+            int mode = (int)settings.Mode;
+            if (ImGui::Combo("##LuaGCMode", &mode, modes, IM_ARRAYSIZE(modes)))
+            {
+                settings.Mode = (LuaGCMode)mode;
+                settingsChanged = true;
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("GC Budget (ms)");
+            ImGui::TableNextColumn();
+            float budget = (float)settings.Budget;
+            if (ImGui::DragFloat("##LuaGCBudget", &budget, 0.05f, 0.0f, 16.0f, "%.2f"))
+            {
+                settings.Budget = budget;
+                settingsChanged = true;
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Step Size (KB)");
+            ImGui::TableNextColumn();
+            settingsChanged |= ImGui::DragInt("##LuaGCStepSize", &settings.StepSize, 1.0f, 1, 1024);
+            ImGui::EndTable();
+
+            if (settingsChanged)
+            {
+                LuaMemory::SetSettings(settings);
+            }
+
+            if (ImGui::TreeNode("Scripts"))
+            {
+                ImGui::BeginTable("LuaOwnersTable", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_BordersOuterV | ImGuiTableFlags_RowBg);
+                ImGui::TableSetupColumn("LuaOwnersColumn1", ImGuiTableColumnFlags_WidthStretch);
+                ImGui::TableSetupColumn("LuaOwnersColumn2", ImGuiTableColumnFlags_WidthStretch);
+                for (const LuaMemoryOwner& owner : LuaMemory::GetOwners())
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", std::filesystem::path(owner.Name).filename().string().c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f KB (peak %.1f KB)", owner.Bytes / 1024.0f, owner.PeakBytes / 1024.0f);
+                }
+                ImGui::EndTable();
+                ImGui::TreePop();
+            }
+            ImGui::TreePop();
+        }
+        // World Partition
+        if(ImGui::TreeNode("World Partition")) {
+            const WorldPartitionStats& stats = WorldPartition::GetStats();
+
+            ImGui::BeginTable("WorldPartitionTable", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_BordersOuterV | ImGuiTableFlags_RowBg);
+            ImGui::TableSetupColumn("WorldPartitionColumn1", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("WorldPartitionColumn2", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Resident Cells");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u / %u", stats.ResidentCells, stats.TotalCells);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Loading Cells");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.LoadingCells);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Resident Entities");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.ResidentEntities);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Resident Memory");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f MB", stats.ResidentBytes / (1024.0f * 1024.0f));
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Load Latency");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f / %.1f / %.1f ms", stats.LastLoadLatency, stats.AverageLoadLatency, stats.MaxLoadLatency);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Cells In / Out");
+            ImGui::TableNextColumn();
+            ImGui::Text("%u / %u", stats.CellsLoaded, stats.CellsUnloaded);
+            ImGui::EndTable();
+            ImGui::TreePop();
+        }
+        // Scene
+        if(ImGui::TreeNode("Scene")) {
+            if (ImGui::Button("Run Hierarchy Benchmark (50k nodes)"))
+            {
+                SceneBenchmark::Hierarchy();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Run Extraction Benchmark (100k objects)"))
+            {
+                SceneBenchmark::RenderExtraction();
+            }
+            if (ImGui::Button("Run Spatial Index Check (10k objects)"))
+            {
+                SpatialIndexCheck::Run();
+            }
+            ImGui::TreePop();
+        }
         ImGui::EndChild();
 
         ImGui::NextColumn();
@@ -123,6 +480,41 @@ namespace Coffee {
                 return mu;
             }, &memoryUsage, memoryUsage.size(), 0, MemoryUsageOverlay.c_str(), yMin, yMax, ImVec2(0, 80)); // Minimum height of 80
         }
+
+        if (m_LuaMemory)
+        {
+            ImGui::Text("Lua Heap");
+
+            static CircularBuffer<float> luaHeap(10000);
+
+            static Timer timer(0.5f, true, false, [&]() {
+                luaHeap.push_back(LuaMemory::GetStats().HeapBytes / 1024.0f);
+            });
+
+            static float yMax = 0.0f;
+
+            std::string LuaHeapOverlay = "";
+            if(luaHeap.size() > 0)
+            {
+                LuaHeapOverlay = "Lua Heap: " + std::to_string((int)luaHeap.back()) + " KB";
+            }
+            ImGui::PlotLines("##LuaHeap", [](void* data, int idx) -> float {
+                auto& luaHeap = *(CircularBuffer<float>*)data;
+                float heap = luaHeap[idx];
+                if (heap > yMax) yMax = heap * 1.25f;
+                return heap;
+            }, &luaHeap, luaHeap.size(), 0, LuaHeapOverlay.c_str(), 0.0f, yMax, ImVec2(0, 80)); // Minimum height of 80
+        }
+
+        if (m_TextureStreaming)
+        {
+            const TextureStreamingStats& stats = TextureStreamer::GetStats();
+
+            ImGui::Text("Texture Memory");
+            float usage = stats.BudgetBytes > 0 ? (float)stats.ResidentBytes / stats.BudgetBytes : 0.0f;
+            std::string TextureMemoryOverlay = std::to_string(stats.ResidentBytes / (1024 * 1024)) + " / " + std::to_string(stats.BudgetBytes / (1024 * 1024)) + " MB";
+            ImGui::ProgressBar(usage, ImVec2(-1, 0), TextureMemoryOverlay.c_str());
+        }
         ImGui::EndChild();
 
         ImGui::End();
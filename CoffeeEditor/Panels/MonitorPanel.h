@@ -12,5 +12,7 @@ namespace Coffee {
         bool m_ShowFPS = true;
         bool m_ShowFrameTime = true;
         bool m_MemoryUsage = true;
+        bool m_TextureStreaming = true;
+        bool m_LuaMemory = true;
     };
 }
\ No newline at end of file
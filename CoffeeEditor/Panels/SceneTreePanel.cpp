@@ -7,6 +7,7 @@
 #include "CoffeeEngine/Renderer/Camera.h"
 #include "CoffeeEngine/Renderer/Material.h"
 #include "CoffeeEngine/Renderer/Texture.h"
+#include "CoffeeEngine/Scene/ComponentRegistry.h"
 #include "CoffeeEngine/Scene/Components.h"
 #include "CoffeeEngine/Scene/Entity.h"
 #include "CoffeeEngine/Scene/PrimitiveMesh.h"
@@ -14,6 +15,7 @@
 #include "CoffeeEngine/Scene/SceneCamera.h"
 #include "CoffeeEngine/Scene/SceneTree.h"
 #include "CoffeeEngine/Scripting/Lua/LuaBackend.h"
+#include "CoffeeEngine/Scripting/ScriptSystem.h"
 #include "entt/entity/entity.hpp"
 #include "entt/entity/fwd.hpp"
 #include "imgui_internal.h"
@@ -422,6 +424,15 @@ namespace Coffee {
                         case ImageFormat::SRGBA8: return "SRGBA8";
                         case ImageFormat::RGBA32F: return "RGBA32F";
                         case ImageFormat::DEPTH24STENCIL8: return "DEPTH24STENCIL8";
+                        case ImageFormat::BC1: return "BC1";
+                        case ImageFormat::SRGB_BC1: return "SRGB_BC1";
+                        case ImageFormat::BC3: return "BC3";
+                        case ImageFormat::SRGB_BC3: return "SRGB_BC3";
+                        case ImageFormat::BC4: return "BC4";
+                        case ImageFormat::BC5: return "BC5";
+                        case ImageFormat::BC7: return "BC7";
+                        case ImageFormat::SRGB_BC7: return "SRGB_BC7";
+                        default: return "Unknown";
                     }
                 };
 
@@ -575,47 +586,56 @@ namespace Coffee {
                 ImGui::Text(scriptComponent.script.GetPath().string().c_str());
                 */
 
-                // Get the exposed variables
-                std::vector<LuaVariable> exposedVariables = LuaBackend::MapVariables(scriptComponent.script.GetPath().string());
+                // Get the exposed variables, parsed when the script was executed
+                const std::string scriptPath = scriptComponent.script.GetPath().string();
+                const std::vector<LuaVariable>& exposedVariables = LuaBackend::MapVariables(scriptPath);
+
+                // The values of the entity are in its instance table, the ones it did not set fall back to the script defaults
+                sol::table values;
+                if (entity.HasComponent<ScriptInstance>() && entity.GetComponent<ScriptInstance>().Self.valid())
+                {
+                    values = entity.GetComponent<ScriptInstance>().Self;
+                }
+                else if (auto it = LuaBackend::scriptEnvironments.find(scriptPath); it != LuaBackend::scriptEnvironments.end())
+                {
+                    values = it->second;
+                }
 
                 // print the exposed variables
                 for (auto& variable : exposedVariables)
                 {
-                    auto it = LuaBackend::scriptEnvironments.find(scriptComponent.script.GetPath().string());
-                    if (it == LuaBackend::scriptEnvironments.end()) {
-                        COFFEE_CORE_ERROR("Script environment for {0} not found", scriptComponent.script.GetPath().string());
-                        continue;
+                    if (!values.valid()) {
+                        COFFEE_CORE_ERROR("Script environment for {0} not found", scriptPath);
+                        break;
                     }
 
-                    sol::environment& env = it->second;
-
                     switch (variable.type)
                     {
                     case sol::type::boolean: {
-                        bool value = env[variable.name];
+                        bool value = values[variable.name];
                         if (ImGui::Checkbox(variable.name.c_str(), &value))
                         {
-                            env[variable.name] = value;
+                            values[variable.name] = value;
                         }
                         break;
                     }
                     case sol::type::number: {
-                        float number = env[variable.name];
+                        float number = values[variable.name];
                         if (ImGui::InputFloat(variable.name.c_str(), &number))
                         {
-                            env[variable.name] = number;
+                            values[variable.name] = number;
                         }
                         break;
                     }
                     case sol::type::string: {
-                        std::string str = env[variable.name];
+                        std::string str = values[variable.name];
                         char buffer[256];
                         memset(buffer, 0, sizeof(buffer));
                         strcpy(buffer, str.c_str());
 
                         if (ImGui::InputText(variable.name.c_str(), buffer, sizeof(buffer)))
                         {
-                            env[variable.name] = std::string(buffer);
+                            values[variable.name] = std::string(buffer);
                         }
                         break;
                     }
@@ -650,21 +670,22 @@ namespace Coffee {
             static char buffer[256] = "";
             ImGui::InputTextWithHint("##Search Component", "Search Component:",buffer, 256);
 
-            std::string items[] = { "Tag Component", "Transform Component", "Mesh Component", "Material Component", "Light Component", "Camera Component", "Lua Script Component" };
-            static int item_current = 1;
+            static uint64_t item_current = ComponentInfo<TransformComponent>::Hash;
 
             if (ImGui::BeginListBox("##listbox 2", ImVec2(-FLT_MIN, ImGui::GetContentRegionAvail().y - 200)))
             {
-                for (int n = 0; n < IM_ARRAYSIZE(items); n++)
-                {
-                    const bool is_selected = (item_current == n);
-                    if (ImGui::Selectable(items[n].c_str(), is_selected))
-                        item_current = n;
+                ComponentRegistry::ForEach([]<typename Component>() {
+                    if constexpr (ComponentInfo<Component>::Flags & ComponentFlags::Addable)
+                    {
+                        const bool is_selected = (item_current == ComponentInfo<Component>::Hash);
+                        if (ImGui::Selectable(ComponentInfo<Component>::DisplayName.data(), is_selected))
+                            item_current = ComponentInfo<Component>::Hash;
 
-                    // Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
-                    if (is_selected)
-                        ImGui::SetItemDefaultFocus();
-                }
+                        // Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
+                        if (is_selected)
+                            ImGui::SetItemDefaultFocus();
+                    }
+                });
                 ImGui::EndListBox();
             }
 
@@ -678,53 +699,14 @@ namespace Coffee {
             ImGui::SameLine();
             if(ImGui::Button("Add Component"))
             {
-                if(items[item_current] == "Tag Component")
-                {
-                    if(!entity.HasComponent<TagComponent>())
-                        entity.AddComponent<TagComponent>();
-                    ImGui::CloseCurrentPopup();
-                }
-                else if(items[item_current] == "Transform Component")
-                {
-                    if(!entity.HasComponent<TransformComponent>())
-                        entity.AddComponent<TransformComponent>();
-                    ImGui::CloseCurrentPopup();
-                }
-                else if(items[item_current] == "Mesh Component")
-                {
-                    if(!entity.HasComponent<MeshComponent>())
-                        entity.AddComponent<MeshComponent>();
-                    ImGui::CloseCurrentPopup();
-                }
-                else if(items[item_current] == "Material Component")
-                {
-                    if(!entity.HasComponent<MaterialComponent>())
-                        entity.AddComponent<MaterialComponent>();
-                    ImGui::CloseCurrentPopup();
-                }
-                else if(items[item_current] == "Light Component")
-                {
-                    if(!entity.HasComponent<LightComponent>())
-                        entity.AddComponent<LightComponent>();
-                    ImGui::CloseCurrentPopup();
-                }
-                else if(items[item_current] == "Camera Component")
-                {
-                    if(!entity.HasComponent<CameraComponent>())
-                        entity.AddComponent<CameraComponent>();
-                    ImGui::CloseCurrentPopup();
-                }
-                else if(items[item_current] == "Script Component")
-                {
-                    if(!entity.HasComponent<ScriptComponent>())
-                        //entity.AddComponent<ScriptComponent>();
-                        // TODO add script component
-                    ImGui::CloseCurrentPopup();
-                }
-                else
-                {
-                    ImGui::CloseCurrentPopup();
-                }
+                ComponentRegistry::Visit(item_current, [&entity]<typename Component>() {
+                    if constexpr (ComponentInfo<Component>::Flags & ComponentFlags::Addable)
+                    {
+                        if(!entity.HasComponent<Component>())
+                            entity.AddComponent<Component>();
+                    }
+                });
+                ImGui::CloseCurrentPopup();
             }
 
             ImGui::EndPopup();
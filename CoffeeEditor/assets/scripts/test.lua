@@ -6,7 +6,7 @@
 --[[export]] exampleString = "Hello, ImGui!"
 --[[export]] exampleBool = true
 
-function OnCreate()
+function OnCreate(self)
     print("OnCreate()")
     log("OnCreate()")
     log_error("OnCreate()")
@@ -15,10 +15,10 @@ function OnCreate()
     return 1
 end
 
-function OnUpdate()
+function OnUpdate(self, dt)
     --log("OnUpdate()")
 
-    local entityTag = entity:GetComponent(entity)
+    local entityTag = self.entity:GetComponent(Component.TagComponent)
     --print("Entity tag: " .. entityTag)
 
     if input.is_key_pressed(input.keycode.Space) then
@@ -31,14 +31,14 @@ function OnUpdate()
         log("Mouse position: (" .. x .. ", " .. y .. ")")
     end
 
-    log("BOOL: " .. tostring(exampleBool))
-    log("INT: " .. exampleInt)
-    log("FLOAT: " .. exampleFloat)
-    log("STRING: " .. exampleString)
+    log("BOOL: " .. tostring(self.exampleBool))
+    log("INT: " .. self.exampleInt)
+    log("FLOAT: " .. self.exampleFloat)
+    log("STRING: " .. self.exampleString)
     return 1
 end
 
-function on_destroy()
+function OnDestroy(self)
     -- print("OnDestroy()")
     return 1
 end
\ No newline at end of file
@@ -6,7 +6,7 @@
 --[[export]] exampleString = "Hello, ImGui!"
 --[[export]] exampleBool = true
 
-function OnCreate()
+function OnCreate(self)
     print("OnCreate()")
     log("OnCreate()")
     log_error("OnCreate()")
@@ -15,7 +15,7 @@ function OnCreate()
     return 1
 end
 
-function OnUpdate()
+function OnUpdate(self, dt)
     --log("OnUpdate()")
     if input.is_key_pressed(input.keycode.Space) then
         log("SPACE")
@@ -27,14 +27,14 @@ function OnUpdate()
         log("Mouse position: (" .. x .. ", " .. y .. ")")
     end
 
-    log("BOOL 2: " .. tostring(exampleBool))
-    log("INT 2: " .. exampleInt)
-    log("FLOAT 2: " .. exampleFloat)
-    log("STRING 2: " .. exampleString)
+    log("BOOL 2: " .. tostring(self.exampleBool))
+    log("INT 2: " .. self.exampleInt)
+    log("FLOAT 2: " .. self.exampleFloat)
+    log("STRING 2: " .. self.exampleString)
     return 1
 end
 
-function on_destroy()
+function OnDestroy(self)
     -- print("OnDestroy()")
     return 1
 end
\ No newline at end of file
@@ -7,11 +7,14 @@
 #include "CoffeeEngine/Core/Input.h"
 #include "CoffeeEngine/Core/Log.h"
 #include "CoffeeEngine/Core/MouseCodes.h"
+#include "CoffeeEngine/Core/Stopwatch.h"
 #include "CoffeeEngine/Events/ApplicationEvent.h"
 #include "CoffeeEngine/Events/KeyEvent.h"
+#include "CoffeeEngine/IO/CacheManager.h"
 #include "CoffeeEngine/IO/ResourceLoader.h"
 #include "CoffeeEngine/IO/ResourceRegistry.h"
 #include "CoffeeEngine/IO/ResourceUtils.h"
+#include "CoffeeEngine/Math/Ray.h"
 #include "CoffeeEngine/Project/Project.h"
 #include "CoffeeEngine/Renderer/DebugRenderer.h"
 #include "CoffeeEngine/Renderer/EditorCamera.h"
@@ -21,6 +24,7 @@
 #include "CoffeeEngine/Scene/Scene.h"
 #include "CoffeeEngine/Scene/SceneCamera.h"
 #include "CoffeeEngine/Scene/SceneTree.h"
+#include "CoffeeEngine/Scene/WorldPartition.h"
 #include "Panels/SceneTreePanel.h"
 #include "entt/entity/entity.hpp"
 #include "imgui_internal.h"
@@ -62,6 +66,14 @@ namespace Coffee {
         m_ImportPanel.SetContext(m_ActiveScene);
     }
 
+    void EditorLayer::OnFixedUpdate(float dt)
+    {
+        ZoneScoped;
+
+        if (m_SceneState == SceneState::Play)
+            m_ActiveScene->OnFixedUpdateRuntime(dt);
+    }
+
     void EditorLayer::OnUpdate(float dt)
     {
         ZoneScoped;
@@ -74,7 +86,7 @@ namespace Coffee {
                 OnOverlayRender();
             break;
             case SceneState::Play:
-                m_ActiveScene->OnUpdateRuntime(dt);
+                m_ActiveScene->OnUpdateRuntime(dt, Application::Get().GetInterpolationAlpha());
             break;
 
         }
@@ -140,16 +152,23 @@ namespace Coffee {
 
                 if (mouseX >= 0 && mouseY >= 0 && mouseX < (int)viewportSize.x && mouseY < (int)viewportSize.y)
                 {
-                    const glm::vec4& pixelData = Renderer::GetEntityIDAtPixel(mouseX, mouseY);
-
-                    /// Convert the vec3 back to uint32_t
-                    uint32_t r = static_cast<uint32_t>(pixelData.r * 255.0f);
-                    uint32_t g = static_cast<uint32_t>(pixelData.g * 255.0f);
-                    uint32_t b = static_cast<uint32_t>(pixelData.b * 255.0f);
+                    // Picking is a ray cast on the CPU, reading the entity ID attachment back would stall on the GPU
+                    glm::mat4 viewProjection = m_EditorCamera.GetProjection() * m_EditorCamera.GetViewMatrix();
+                    if (m_SceneState == SceneState::Play)
+                    {
+                        // Same camera as Scene::OnUpdateRuntime, the last one found
+                        auto cameraView = m_ActiveScene->GetAllEntitiesWithComponents<TransformComponent, CameraComponent>();
+                        for (auto entity : cameraView)
+                        {
+                            auto [transform, cameraComponent] = cameraView.get<TransformComponent, CameraComponent>(entity);
+                            viewProjection = cameraComponent.Camera.GetProjection() * glm::inverse(transform.GetWorldTransform());
+                        }
+                    }
 
-                    uint32_t entityID = (r << 0) | (g << 8) | (b << 16);
+                    glm::vec2 ndc = (mousePos / viewportSize) * 2.0f - 1.0f;
+                    Ray ray = Ray::FromNDC(ndc, glm::inverse(viewProjection));
 
-                    Entity hoveredEntity = entityID == 16777215 ? Entity() : Entity((entt::entity)entityID, m_ActiveScene.get());
+                    Entity hoveredEntity = m_ActiveScene->Raycast(ray);
 
                     m_SceneTreePanel.SetSelectedEntity(hoveredEntity);
                 }
@@ -200,6 +219,10 @@ namespace Coffee {
                 if (ImGui::MenuItem(ICON_LC_FOLDER_OPEN " Open Scene...", "Ctrl+O")) { OpenScene(); }
                 if (ImGui::MenuItem(ICON_LC_SAVE " Save Scene", "Ctrl+S")) { SaveScene(); }
                 if (ImGui::MenuItem(ICON_LC_SAVE " Save Scene As...", "Ctrl+Shift+S")) { SaveSceneAs(); }
+                ImGui::Separator();
+                if (ImGui::MenuItem(ICON_LC_FOLDER_OPEN " Open World...")) { OpenWorld(); }
+                if (ImGui::MenuItem(ICON_LC_FILE_PLUS_2 " Generate Test World")) { GenerateTestWorld(); }
+                ImGui::Separator();
                 if (ImGui::MenuItem(ICON_LC_X " Exit")) { Application::Get().Close(); }
                 ImGui::EndMenu();
             }
@@ -208,6 +231,7 @@ namespace Coffee {
                 if (ImGui::MenuItem(ICON_LC_FILE_PLUS_2 " New Project...", "Ctrl+N")) { NewProject(); }
                 if (ImGui::MenuItem(ICON_LC_FOLDER_OPEN " Open Project...", "Ctrl+O")) { OpenProject(); }
                 if (ImGui::MenuItem(ICON_LC_SAVE " Save Project", "Ctrl+S")) { SaveProject(); }
+                if (ImGui::MenuItem(ICON_LC_PACKAGE " Pack Resources")) { PackProject(); }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("Editor"))
@@ -479,6 +503,8 @@ namespace Coffee {
 
         ImGui::DragFloat("Exposure", &Renderer::GetRenderSettings().Exposure, 0.001f, 100.0f);
 
+        ImGui::Checkbox("Entity ID Pass", &Renderer::GetRenderSettings().EntityIDPass);
+
         ImGui::End();
 
         // Debug Window for testing the ResourceRegistry
@@ -528,13 +554,48 @@ namespace Coffee {
 
         //Debug Scene Octree
         ImGui::Begin("Octree Debug");
+        Octree<entt::entity>& octree = m_ActiveScene->GetOctree();
         if(ImGui::Button("Clear Octree"))
         {
-            m_ActiveScene->m_Octree.Clear();
+            octree.Clear();
+        }
+
+        const char* spatialIndexTypes[] = {"Octree", "BVH"};
+        int spatialIndexType = (int)m_ActiveScene->GetSpatialIndexType();
+        if (ImGui::Combo("Static Index", &spatialIndexType, spatialIndexTypes, IM_ARRAYSIZE(spatialIndexTypes)))
+        {
+            m_ActiveScene->SetSpatialIndexType((SpatialIndexType)spatialIndexType);
         }
-        if(ImGui::Button("Add Point"))
+
+        OctreeSettings octreeSettings = octree.GetSettings();
+        bool settingsChanged = ImGui::DragInt("Max Depth", &octreeSettings.MaxDepth, 0.1f, 0, 16);
+        settingsChanged |= ImGui::DragInt("Max Objects Per Leaf", &octreeSettings.MaxObjectsPerNode, 0.1f, 1, 256);
+        if (settingsChanged)
+        {
+            octree.SetSettings(octreeSettings);
+        }
+
+        if(ImGui::TreeNode("Stats"))
         {
-            //m_ActiveScene->m_Octree.Insert({{rand() % 20 - 10, rand() % 20 - 10, rand() % 20 - 10}});
+            OctreeStats octreeStats = octree.GetStats();
+            const AABB& bounds = octree.GetBounds();
+            ImGui::Text("Bounds: (%.1f, %.1f, %.1f) - (%.1f, %.1f, %.1f)", bounds.min.x, bounds.min.y, bounds.min.z, bounds.max.x, bounds.max.y, bounds.max.z);
+            ImGui::Text("Objects: %u (%u in inner nodes)", octreeStats.ObjectCount, octreeStats.InnerObjectCount);
+            ImGui::Text("Nodes: %u (%u leaves)", octreeStats.NodeCount, octreeStats.LeafCount);
+            ImGui::Text("Depth: %u", octreeStats.Depth);
+            ImGui::Text("Objects Per Leaf: %.2f avg, %u max", octreeStats.AverageObjectsPerLeaf, octreeStats.MaxObjectsPerLeaf);
+            ImGui::Text("Root Growths: %u", octreeStats.RootGrowths);
+            ImGui::TreePop();
+        }
+        if(!m_ActiveScene->GetBVH().IsEmpty() && ImGui::TreeNode("BVH Stats"))
+        {
+            BVHStats bvhStats = m_ActiveScene->GetBVH().GetStats();
+            ImGui::Text("Objects: %u", bvhStats.ObjectCount);
+            ImGui::Text("Nodes: %u (%u leaves)", bvhStats.NodeCount, bvhStats.LeafCount);
+            ImGui::Text("Depth: %u", bvhStats.Depth);
+            ImGui::Text("Objects Per Leaf: %.2f avg, %u max", bvhStats.AverageObjectsPerLeaf, bvhStats.MaxObjectsPerLeaf);
+            ImGui::Text("SAH Cost: %.1f", bvhStats.Cost);
+            ImGui::TreePop();
         }
         ImGui::End();
     }
@@ -640,19 +701,19 @@ namespace Coffee {
 
     void EditorLayer::OnScenePlay()
     {
-        if(m_ActiveScene->m_FilePath.empty())
-        {
-            COFFEE_ERROR("Scene is not saved! Please save the scene before playing.");
-            return;
-        }
+        ZoneScoped;
 
         m_SceneState = SceneState::Play;
 
-        Scene::Save(m_EditorScene->m_FilePath, m_EditorScene);
+        Stopwatch stopwatch;
+        stopwatch.Start();
 
-        m_ActiveScene = Scene::Load(m_ActiveScene->m_FilePath);
+        m_ActiveScene = Scene::Copy(m_EditorScene);
         m_ActiveScene->OnInitRuntime();
 
+        stopwatch.Stop();
+        COFFEE_INFO("Entered play mode in {0:.2f} ms", stopwatch.GetPreciseElapsedTime() * 1000.0);
+
         m_SceneTreePanel.SetContext(m_ActiveScene);
         m_SceneTreePanel.SetSelectedEntity(Entity());
         m_ContentBrowserPanel.SetContext(m_ActiveScene);
@@ -716,6 +777,11 @@ namespace Coffee {
         Project::SaveActive();
     }
 
+    void EditorLayer::PackProject()
+    {
+        CacheManager::PackCache(CacheManager::GetArchivePath());
+    }
+
     void EditorLayer::NewScene()
     {
         m_EditorScene = CreateRef<Scene>();
@@ -771,4 +837,53 @@ namespace Coffee {
     }
     void EditorLayer::SaveSceneAs() {}
 
+    void EditorLayer::OpenWorld()
+    {
+        FileDialogArgs args;
+        args.Filters = {{"Coffee World", "cworld"}};
+        const std::filesystem::path& path = FileDialog::OpenFile(args);
+
+        if (path.empty() or path.extension() != ".cworld")
+        {
+            COFFEE_CORE_WARN("Open World: No file selected");
+            return;
+        }
+
+        Ref<Scene> scene = Scene::LoadWorld(path.parent_path());
+        if (!scene)
+            return;
+
+        m_EditorScene = scene;
+        m_ActiveScene = m_EditorScene;
+        m_ActiveScene->OnInitEditor();
+
+        m_SceneTreePanel = SceneTreePanel();
+
+        m_SceneTreePanel.SetContext(m_ActiveScene);
+        m_ContentBrowserPanel.SetContext(m_ActiveScene);
+        m_ImportPanel.SetContext(m_ActiveScene);
+    }
+
+    void EditorLayer::GenerateTestWorld()
+    {
+        std::filesystem::path directory = CacheManager::GetCachePath() / "Worlds" / "TestWorld";
+
+        if (!WorldPartition::GenerateTestWorld(directory))
+            return;
+
+        Ref<Scene> scene = Scene::LoadWorld(directory);
+        if (!scene)
+            return;
+
+        m_EditorScene = scene;
+        m_ActiveScene = m_EditorScene;
+        m_ActiveScene->OnInitEditor();
+
+        m_SceneTreePanel = SceneTreePanel();
+
+        m_SceneTreePanel.SetContext(m_ActiveScene);
+        m_ContentBrowserPanel.SetContext(m_ActiveScene);
+        m_ImportPanel.SetContext(m_ActiveScene);
+    }
+
 }
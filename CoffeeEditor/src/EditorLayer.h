@@ -23,6 +23,7 @@ namespace Coffee {
 
         void OnAttach() override;
 
+        void OnFixedUpdate(float dt) override;
         void OnUpdate(float dt) override;
 
         void OnEvent(Event& event) override;
@@ -47,12 +48,15 @@ namespace Coffee {
         void NewProject();
         void OpenProject();
         void SaveProject();
+        void PackProject();
 
         //Scene Management
         void NewScene();
         void OpenScene();
         void SaveScene();
         void SaveSceneAs();
+        void OpenWorld();
+        void GenerateTestWorld();
     private:
         Ref<Scene> m_EditorScene;
         Ref<Scene> m_ActiveScene;
@@ -0,0 +1,75 @@
+#include "HeadlessLayer.h"
+#include "SpatialIndexCheck.h"
+
+#include "CoffeeEngine/Core/Application.h"
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/Core/Stopwatch.h"
+#include "CoffeeEngine/Renderer/Renderer.h"
+
+#include <tracy/Tracy.hpp>
+
+namespace Coffee {
+
+    HeadlessLayer::HeadlessLayer(const std::filesystem::path& scenePath, bool runChecks) : Layer("Headless"), m_ScenePath(scenePath), m_RunChecks(runChecks)
+    {
+
+    }
+
+    void HeadlessLayer::OnAttach()
+    {
+        ZoneScoped;
+
+        if (m_RunChecks)
+        {
+            bool passed = SpatialIndexCheck::Run();
+
+            Application::Get().SetExitCode(passed ? 0 : 1);
+            Application::Get().Close();
+            return;
+        }
+
+        if (m_ScenePath.empty() || !std::filesystem::exists(m_ScenePath))
+        {
+            COFFEE_ERROR("Headless: No scene to run, pass one with --scene <path>");
+            Application::Get().Close();
+            return;
+        }
+
+        Stopwatch stopwatch;
+        stopwatch.Start();
+
+        m_Scene = Scene::Load(m_ScenePath);
+        m_Scene->OnInitRuntime();
+
+        stopwatch.Stop();
+        COFFEE_INFO("Headless: Loaded {0} in {1:.2f} ms", m_ScenePath.string(), stopwatch.GetPreciseElapsedTime() * 1000.0);
+    }
+
+    void HeadlessLayer::OnFixedUpdate(float dt)
+    {
+        ZoneScoped;
+
+        if (m_Scene)
+            m_Scene->OnFixedUpdateRuntime(dt);
+    }
+
+    void HeadlessLayer::OnUpdate(float dt)
+    {
+        ZoneScoped;
+
+        if (m_Scene)
+            m_Scene->OnUpdateRuntime(dt, Application::Get().GetInterpolationAlpha());
+    }
+
+    void HeadlessLayer::OnDetach()
+    {
+        ZoneScoped;
+
+        if (m_Scene)
+        {
+            m_Scene->OnExitRuntime();
+            m_Scene.reset();
+        }
+    }
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Core/Layer.h"
+#include "CoffeeEngine/Scene/Scene.h"
+
+#include <filesystem>
+
+namespace Coffee {
+
+    /**
+     * @brief Layer run instead of the editor by a headless application, it plays a scene in runtime mode without
+     * any UI so the benchmarks and soak tests can run the whole update on machines without a display.
+     *
+     * With the checks enabled it runs the engine self checks instead and closes, failing the process if one fails.
+     */
+    class HeadlessLayer : public Coffee::Layer
+    {
+    public:
+        HeadlessLayer(const std::filesystem::path& scenePath, bool runChecks = false);
+        virtual ~HeadlessLayer() = default;
+
+        void OnAttach() override;
+
+        void OnFixedUpdate(float dt) override;
+        void OnUpdate(float dt) override;
+
+        void OnDetach() override;
+    private:
+        std::filesystem::path m_ScenePath;
+        bool m_RunChecks;
+        Ref<Scene> m_Scene;
+    };
+
+}
@@ -0,0 +1,171 @@
+#include "SceneBenchmark.h"
+
+#include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/Core/Stopwatch.h"
+#include "CoffeeEngine/Renderer/Material.h"
+#include "CoffeeEngine/Renderer/Mesh.h"
+#include "CoffeeEngine/Renderer/Model.h"
+#include "CoffeeEngine/Renderer/Renderer.h"
+#include "CoffeeEngine/Scene/Components.h"
+#include "CoffeeEngine/Scene/Entity.h"
+#include "CoffeeEngine/Scene/PrimitiveMesh.h"
+#include "CoffeeEngine/Scene/Scene.h"
+#include "CoffeeEngine/Scene/SceneTree.h"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <string>
+#include <tracy/Tracy.hpp>
+#include <vector>
+
+namespace Coffee {
+
+    double SceneBenchmark::Hierarchy(uint32_t nodeCount)
+    {
+        ZoneScoped;
+
+        // Two levels, like an architectural model: groups under the root, four meshes' nodes under each group
+        constexpr uint32_t ChildrenPerGroup = 4;
+        uint32_t groupCount = std::max(1u, (nodeCount - 1) / (ChildrenPerGroup + 1));
+
+        Ref<Model> model = CreateRef<Model>();
+        model->SetName("Hierarchy Benchmark");
+        model->SetTransform(glm::mat4(1.0f));
+
+        uint32_t createdNodes = 1;
+        for (uint32_t i = 0; i < groupCount && createdNodes < nodeCount; ++i)
+        {
+            Ref<Model> group = CreateRef<Model>();
+            group->SetName("Group " + std::to_string(i));
+            group->SetTransform(glm::mat4(1.0f));
+            model->AddChild(group);
+            createdNodes++;
+
+            for (uint32_t j = 0; j < ChildrenPerGroup && createdNodes < nodeCount; ++j)
+            {
+                Ref<Model> node = CreateRef<Model>();
+                node->SetName("Node " + std::to_string(j));
+                node->SetTransform(glm::mat4(1.0f));
+                group->AddChild(node);
+                createdNodes++;
+            }
+        }
+
+        Ref<Scene> scene = CreateRef<Scene>();
+
+        Stopwatch stopwatch;
+        stopwatch.Start();
+        AddModelToTheSceneTree(scene.get(), model);
+        stopwatch.Stop();
+        double importTime = stopwatch.GetPreciseElapsedTime() * 1000.0;
+
+        // The groups move under a new parent in one call
+        auto& registry = scene->m_Registry;
+        entt::entity root = entt::null;
+        for (auto entity : registry.view<HierarchyComponent>())
+        {
+            if (registry.get<HierarchyComponent>(entity).m_Parent == entt::null)
+                root = entity;
+        }
+
+        std::vector<entt::entity> groups;
+        for (auto child = registry.get<HierarchyComponent>(root).m_First; child != entt::null; child = registry.get<HierarchyComponent>(child).m_Next)
+            groups.push_back(child);
+
+        Entity newRoot = scene->CreateEntity("New Root");
+
+        stopwatch.Reset();
+        stopwatch.Start();
+        HierarchyComponent::ReparentMany(registry, groups, newRoot);
+        stopwatch.Stop();
+        double reparentTime = stopwatch.GetPreciseElapsedTime() * 1000.0;
+
+        stopwatch.Reset();
+        stopwatch.Start();
+        scene->DestroyEntity(newRoot);
+        stopwatch.Stop();
+        double destroyTime = stopwatch.GetPreciseElapsedTime() * 1000.0;
+
+        COFFEE_INFO("Hierarchy benchmark ({0} nodes): import {1:.2f} ms, reparent {2} groups {3:.2f} ms, destroy subtree {4:.2f} ms",
+                    createdNodes, importTime, groups.size(), reparentTime, destroyTime);
+
+        return importTime;
+    }
+
+    double SceneBenchmark::RenderExtraction(uint32_t objectCount, uint32_t frameCount)
+    {
+        ZoneScoped;
+
+        Ref<Mesh> mesh = PrimitiveMesh::CreateCube();
+        Ref<Material> material = Material::Create("Extraction Benchmark Material");
+
+        Ref<Scene> scene = CreateRef<Scene>();
+        auto& registry = scene->m_Registry;
+
+        std::vector<entt::entity> entities = scene->CreateEntities(objectCount, "Extraction Benchmark");
+        registry.insert<MeshComponent>(entities.begin(), entities.end(), MeshComponent(mesh));
+        registry.insert<MaterialComponent>(entities.begin(), entities.end(), MaterialComponent(material));
+
+        for (uint32_t i = 0; i < objectCount; ++i)
+        {
+            registry.get<TransformComponent>(entities[i]).SetWorldTransform(glm::translate(glm::mat4(1.0f), glm::vec3(i % 100, (i / 100) % 100, i / 10000)));
+        }
+
+        // The extraction as it was, a view with a lookup of the material and the references copied into the commands
+        struct ReferenceCommand
+        {
+            glm::mat4 transform;
+            Ref<Mesh> mesh;
+            Ref<Material> material;
+            uint32_t entityID;
+        };
+
+        std::vector<ReferenceCommand> referenceCommands;
+        referenceCommands.reserve(objectCount);
+
+        Stopwatch stopwatch;
+        stopwatch.Start();
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            referenceCommands.clear();
+
+            auto view = registry.view<MeshComponent, TransformComponent>();
+            for (auto entity : view)
+            {
+                auto& meshComponent = view.get<MeshComponent>(entity);
+                auto& transformComponent = view.get<TransformComponent>(entity);
+                auto materialComponent = registry.try_get<MaterialComponent>(entity);
+
+                Ref<Material> entityMaterial = materialComponent ? materialComponent->material : nullptr;
+                referenceCommands.push_back({transformComponent.GetWorldTransform(), meshComponent.GetMesh(), entityMaterial, (uint32_t)entity});
+            }
+        }
+        stopwatch.Stop();
+        double viewTime = stopwatch.GetPreciseElapsedTime() * 1000.0 / std::max(frameCount, 1u);
+        referenceCommands.clear();
+
+        std::vector<RenderCommand> commands;
+        commands.reserve(objectCount);
+
+        // The first extraction creates the group and sorts the storages, it is not timed
+        scene->ExtractRenderCommands(commands);
+
+        stopwatch.Reset();
+        stopwatch.Start();
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            commands.clear();
+            scene->ExtractRenderCommands(commands);
+        }
+        stopwatch.Stop();
+        double groupTime = stopwatch.GetPreciseElapsedTime() * 1000.0 / std::max(frameCount, 1u);
+
+        COFFEE_INFO("Render extraction benchmark ({0} objects): view {1:.3f} ms, group {2:.3f} ms ({3:.2f}x)",
+                    objectCount, viewTime, groupTime, groupTime > 0.0 ? viewTime / groupTime : 0.0);
+
+        return groupTime;
+    }
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Coffee {
+
+    /**
+     * @brief Benchmarks of the scene run from the monitor panel, each one builds its own scene and logs its timings.
+     */
+    class SceneBenchmark
+    {
+    public:
+        /**
+         * @brief Import a generated model into an empty scene, two levels of nodes under the root, then reparent
+         * and destroy its nodes in bulk, and log the time of each step.
+         * @param nodeCount The number of nodes of the model.
+         * @return The time to build the hierarchy of the model, in milliseconds.
+         */
+        static double Hierarchy(uint32_t nodeCount = 50000);
+
+        /**
+         * @brief Extract the render commands of a scene of meshes, once through the mesh group and once
+         * through a view copying the mesh and material references like the extraction did before, and log both.
+         * @param objectCount The number of mesh entities.
+         * @param frameCount The number of extractions timed.
+         * @return The average time of an extraction through the group, in milliseconds.
+         */
+        static double RenderExtraction(uint32_t objectCount = 100000, uint32_t frameCount = 100);
+    };
+
+}
@@ -0,0 +1,219 @@
+#include "SpatialIndexCheck.h"
+
+#include "CoffeeEngine/Core/DataStructures/BVH.h"
+#include "CoffeeEngine/Core/DataStructures/Octree.h"
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/Math/Frustum.h"
+#include "CoffeeEngine/Renderer/Mesh.h"
+#include "CoffeeEngine/Scene/Components.h"
+#include "CoffeeEngine/Scene/Entity.h"
+#include "CoffeeEngine/Scene/PrimitiveMesh.h"
+#include "CoffeeEngine/Scene/Scene.h"
+#include "CoffeeEngine/Scene/SceneTree.h"
+
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <string>
+#include <tracy/Tracy.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace Coffee {
+
+    // Compares the objects found in a spatial index with the expected ones, each must be there exactly once and with
+    // its current transform
+    static bool CheckSpatialIndexObjects(const std::vector<ObjectContainer<entt::entity>>& found, const std::unordered_map<entt::entity, glm::mat4>& expected, const std::string& step)
+    {
+        std::unordered_map<entt::entity, uint32_t> counts;
+        uint32_t unexpected = 0, stale = 0;
+
+        for (const auto& object : found)
+        {
+            counts[object.object]++;
+
+            auto it = expected.find(object.object);
+            if (it == expected.end())
+                unexpected++;
+            else if (it->second != object.transform)
+                stale++;
+        }
+
+        uint32_t lost = 0, duplicated = 0;
+        for (const auto& [entity, transform] : expected)
+        {
+            auto it = counts.find(entity);
+            if (it == counts.end())
+                lost++;
+            else if (it->second > 1)
+                duplicated++;
+        }
+
+        if (lost == 0 && duplicated == 0 && unexpected == 0 && stale == 0)
+            return true;
+
+        COFFEE_ERROR("Spatial index check ({0}): {1} objects lost, {2} duplicated, {3} removed ones left, {4} with a stale transform",
+                     step, lost, duplicated, unexpected, stale);
+        return false;
+    }
+
+    static bool CheckOctree(const Octree<entt::entity>& octree, const std::unordered_map<entt::entity, glm::mat4>& expected, const std::string& step)
+    {
+        std::vector<ObjectContainer<entt::entity>> found;
+        octree.ForEach([&found](const ObjectContainer<entt::entity>& object) { found.push_back(object); });
+
+        bool passed = CheckSpatialIndexObjects(found, expected, step);
+
+        if (octree.GetObjectCount() != expected.size())
+        {
+            COFFEE_ERROR("Spatial index check ({0}): the octree counts {1} objects, {2} expected", step, octree.GetObjectCount(), expected.size());
+            passed = false;
+        }
+
+        // A frustum around the whole root has to return every object, none may sit outside the tree bounds
+        const AABB& bounds = octree.GetBounds();
+        glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        glm::vec3 size = bounds.max - bounds.min;
+        float extent = std::max({size.x, size.y, size.z});
+        Frustum frustum(glm::ortho(-extent, extent, -extent, extent, -extent, extent) * glm::translate(glm::mat4(1.0f), -center));
+
+        size_t queried = octree.Query(frustum).size();
+        if (queried != expected.size())
+        {
+            COFFEE_ERROR("Spatial index check ({0}): a frustum around the octree returns {1} objects, {2} expected", step, queried, expected.size());
+            passed = false;
+        }
+
+        return passed;
+    }
+
+    bool SpatialIndexCheck::Run(uint32_t objectCount)
+    {
+        ZoneScoped;
+
+        bool passed = true;
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> nearPosition(-50.0f, 50.0f);
+        std::uniform_real_distribution<float> farPosition(-100000.0f, 100000.0f);
+
+        // Most objects around the origin, every eighth one far away and a pile of coincident ones deeper than the
+        // max depth can split
+        auto makePosition = [&](uint32_t i) {
+            if (i % 8 == 0)
+                return glm::vec3(farPosition(random), farPosition(random), farPosition(random));
+            if (i % 8 == 1)
+                return glm::vec3(1.0f);
+            return glm::vec3(nearPosition(random), nearPosition(random), nearPosition(random));
+        };
+
+        AABB unitBounds(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+        std::vector<ObjectContainer<entt::entity>> objects(objectCount);
+        std::unordered_map<entt::entity, glm::mat4> expected;
+        for (uint32_t i = 0; i < objectCount; ++i)
+        {
+            objects[i] = {glm::translate(glm::mat4(1.0f), makePosition(i)), unitBounds, (entt::entity)i};
+            expected[objects[i].object] = objects[i].transform;
+        }
+
+        Octree<entt::entity> built;
+        built.Build(objects);
+        passed &= CheckOctree(built, expected, "build");
+
+        // Inserted one by one, the root starts around the first object and has to grow for the far ones
+        Octree<entt::entity> octree;
+        for (const auto& object : objects)
+        {
+            octree.Insert(object);
+        }
+        passed &= CheckOctree(octree, expected, "insert");
+
+        uint32_t failedRemovals = 0;
+        for (uint32_t i = 0; i < objectCount; i += 2)
+        {
+            if (!octree.Remove(objects[i]))
+                failedRemovals++;
+            expected.erase(objects[i].object);
+        }
+        if (failedRemovals > 0)
+        {
+            COFFEE_ERROR("Spatial index check (remove): {0} objects were not found to be removed", failedRemovals);
+            passed = false;
+        }
+        passed &= CheckOctree(octree, expected, "remove");
+
+        // Moved like the scene moves them, removed with the transform they were inserted with
+        for (uint32_t i = 1; i < objectCount; i += 2)
+        {
+            octree.Remove(objects[i]);
+            objects[i].transform = glm::translate(glm::mat4(1.0f), makePosition(i + 1) * 2.0f);
+            octree.Insert(objects[i]);
+            expected[objects[i].object] = objects[i].transform;
+        }
+        passed &= CheckOctree(octree, expected, "move");
+
+        octree.SetSettings({2, 4});
+        passed &= CheckOctree(octree, expected, "settings");
+
+        // The index of a runtime scene, its meshes destroyed, moved and added after it was built
+        Ref<Mesh> mesh = PrimitiveMesh::CreateCube();
+        uint32_t sceneObjectCount = std::max(objectCount / 10, 3u);
+
+        for (SpatialIndexType type : {SpatialIndexType::Octree, SpatialIndexType::BVH})
+        {
+            std::string step = type == SpatialIndexType::BVH ? "scene BVH" : "scene octree";
+
+            Ref<Scene> scene = CreateRef<Scene>();
+            scene->SetSpatialIndexType(type);
+            auto& registry = scene->m_Registry;
+
+            std::vector<entt::entity> entities = scene->CreateEntities(sceneObjectCount, "Spatial Index Check");
+            registry.insert<MeshComponent>(entities.begin(), entities.end(), MeshComponent(mesh));
+            for (uint32_t i = 0; i < sceneObjectCount; ++i)
+            {
+                registry.get<TransformComponent>(entities[i]).Position = makePosition(i);
+            }
+
+            scene->OnInitRuntime();
+
+            for (uint32_t i = 0; i < sceneObjectCount; ++i)
+            {
+                if (i % 3 == 0)
+                    scene->DestroyEntity(Entity(entities[i], scene.get()));
+                else if (i % 3 == 1)
+                    registry.get<TransformComponent>(entities[i]).Position = makePosition(i + 1) * 2.0f;
+            }
+
+            std::vector<entt::entity> added = scene->CreateEntities(sceneObjectCount / 3, "Spatial Index Check");
+            registry.insert<MeshComponent>(added.begin(), added.end(), MeshComponent(mesh));
+            for (uint32_t i = 0; i < added.size(); ++i)
+            {
+                registry.get<TransformComponent>(added[i]).Position = makePosition(i);
+            }
+
+            scene->m_SceneTree->Update();
+            scene->UpdateSpatialIndex();
+
+            std::unordered_map<entt::entity, glm::mat4> sceneExpected;
+            auto view = registry.view<MeshComponent, TransformComponent>();
+            for (auto entity : view)
+            {
+                sceneExpected[entity] = view.get<TransformComponent>(entity).GetWorldTransform();
+            }
+
+            std::vector<ObjectContainer<entt::entity>> found = scene->m_BVH.GetObjects();
+            scene->m_Octree.ForEach([&found](const ObjectContainer<entt::entity>& object) { found.push_back(object); });
+
+            passed &= CheckSpatialIndexObjects(found, sceneExpected, step);
+        }
+
+        if (passed)
+            COFFEE_INFO("Spatial index check passed ({0} objects)", objectCount);
+        else
+            COFFEE_ERROR("Spatial index check failed ({0} objects)", objectCount);
+
+        return passed;
+    }
+
+}
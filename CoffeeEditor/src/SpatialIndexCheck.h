@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Coffee {
+
+    /**
+     * @brief Self check of the spatial index, run by the monitor panel and by the headless application with --check.
+     *
+     * An octree is built, grown by insertions, has objects removed, moved and reinserted with other settings, then the
+     * index of a runtime scene has its meshes destroyed, moved and added. Each step is compared with the expected
+     * objects and the failures are logged.
+     */
+    class SpatialIndexCheck
+    {
+    public:
+        /**
+         * @brief Run the check.
+         * @param objectCount The number of objects.
+         * @return True if every step holds exactly the expected objects.
+         */
+        static bool Run(uint32_t objectCount = 10000);
+    };
+
+}
@@ -2,6 +2,7 @@
 #include <CoffeeEngine/Core/EntryPoint.h>
 
 #include "EditorLayer.h"
+#include "HeadlessLayer.h"
 
 namespace Coffee {
 
@@ -10,7 +11,26 @@ namespace Coffee {
     public:
         CoffeeEditor()
         {
-            PushLayer(new EditorLayer());
+            if (!IsHeadless())
+            {
+                PushLayer(new EditorLayer());
+                return;
+            }
+
+            // Without a display the editor only plays the scene passed with --scene, or runs the engine checks
+            // with --check
+            std::filesystem::path scenePath;
+            bool runChecks = false;
+            const std::vector<std::string>& arguments = GetSpecification().Arguments;
+            for (size_t i = 0; i < arguments.size(); ++i)
+            {
+                if (arguments[i] == "--scene" && i + 1 < arguments.size())
+                    scenePath = arguments[i + 1];
+                else if (arguments[i] == "--check")
+                    runChecks = true;
+            }
+
+            PushLayer(new HeadlessLayer(scenePath, runChecks));
         }
 
         ~CoffeeEditor()
@@ -2,8 +2,15 @@
 #include "CoffeeEngine/Core/Layer.h"
 #include "CoffeeEngine/Core/Stopwatch.h"
 #include "CoffeeEngine/Events/KeyEvent.h"
+#include "CoffeeEngine/IO/CacheManager.h"
 #include "CoffeeEngine/Renderer/Renderer.h"
+#include "CoffeeEngine/Renderer/RendererAPI.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string_view>
 #include <SDL3/SDL_timer.h>
 #include <SDL3/SDL.h>
 #include <tracy/Tracy.hpp>
@@ -11,25 +18,48 @@
 namespace Coffee
 {
     Application* Application::s_Instance = nullptr;
+    ApplicationSpecification Application::s_Specification;
 
-    Application::Application()
+    Application::Application() : m_Specification(s_Specification)
     {
         ZoneScoped;
 
         COFFEE_CORE_ASSERT(!s_Instance, "Application already exists!");
 		s_Instance = this;
 
-        m_Window = Window::Create(WindowProps("Coffee Engine"));
+        if (m_Specification.Headless)
+        {
+            // Without a GL context the renderer only records and counts the frames, executed inline
+            RendererAPI::SetAPI(RendererAPI::API::None);
+            RenderThread::SetEnabled(false);
+            COFFEE_CORE_INFO("Application: Running headless");
+        }
+        else
+        {
+            m_Window = Window::Create(WindowProps("Coffee Engine"));
+        }
         SetEventCallback(COFFEE_BIND_EVENT_FN(OnEvent));
 
+        if (std::filesystem::exists(CacheManager::GetArchivePath()))
+        {
+            CacheManager::MountArchive(CacheManager::GetArchivePath());
+        }
+
         Renderer::Init();
 
-        m_ImGuiLayer = new ImGuiLayer();
-		PushOverlay(m_ImGuiLayer);
+        if (!m_Specification.Headless)
+        {
+            m_ImGuiLayer = new ImGuiLayer();
+            PushOverlay(m_ImGuiLayer);
+
+            RenderThread::Init(*m_Window);
+        }
     }
 
     Application::~Application()
     {
+        RenderThread::Shutdown();
+        Renderer::Shutdown();
     }
 
     void Application::PushLayer(Layer* layer)
@@ -53,6 +83,41 @@ namespace Coffee
         m_Running = false;
     }
 
+    void Application::ParseCommandLine(int argc, const char** argv)
+    {
+        if (argc > 1)
+            s_Specification.Arguments.assign(argv + 1, argv + argc);
+
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string_view argument = argv[i];
+            if (argument == "--headless")
+            {
+                s_Specification.Headless = true;
+            }
+            else if (argument == "--frames" && i + 1 < argc)
+            {
+                s_Specification.FrameLimit = std::strtoull(argv[++i], nullptr, 10);
+            }
+        }
+    }
+
+    void Application::SetFixedTimestep(double timestep)
+    {
+        if (timestep <= 0.0)
+        {
+            COFFEE_CORE_ERROR("Application: The fixed timestep must be positive, got {0}", timestep);
+            return;
+        }
+
+        m_FixedTimestep = timestep;
+    }
+
+    void Application::SetMaxSubsteps(uint32_t count)
+    {
+        m_MaxSubsteps = std::max(count, 1u);
+    }
+
     void Application::OnEvent(Event& e)
     {
         ZoneScoped;
@@ -75,6 +140,9 @@ namespace Coffee
 
         static Stopwatch frameTimeStopwatch;
 
+        Stopwatch runStopwatch;
+        runStopwatch.Start();
+
         while (m_Running)
         {   
             ZoneScopedN("RunLoop");
@@ -83,10 +151,26 @@ namespace Coffee
             frameTimeStopwatch.Reset();
             frameTimeStopwatch.Start();
 
-            float deltaTime = m_LastFrameTime;
+            // Headless frames advance the simulation by exactly one step however long they take, so runs are reproducible
+            double elapsed = m_Specification.Headless ? m_FixedTimestep : m_LastFrameTime;
+            float deltaTime = elapsed;
+
+            // With the render thread the simulation runs while the previous frame is submitted, and the events polled
+            // after it are seen by the next steps. A step creating a GPU object, a script adding a mesh for instance,
+            // takes the context back early through RenderThread::AcquireContext. Everything from the events on may
+            // use GL on the main thread.
+            bool pipelined = RenderThread::IsEnabled();
+            if (pipelined)
+                FixedUpdate(elapsed);
+
+            RenderThread::WaitIdle();
 
             //Poll and handle events
-            ProcessEvents();
+            if (!m_Specification.Headless)
+                ProcessEvents();
+
+            if (!pipelined)
+                FixedUpdate(elapsed);
 
             //Update and render
             {
@@ -97,17 +181,61 @@ namespace Coffee
             }
 
             //Render ImGui
-            m_ImGuiLayer->Begin();
+            if (m_ImGuiLayer)
             {
-                ZoneScopedN("LayerStack ImGuiRender");
+                m_ImGuiLayer->Begin();
+                {
+                    ZoneScopedN("LayerStack ImGuiRender");
 
-                for(Layer* layer : m_LayerStack)
-                    layer->OnImGuiRender();
+                    for(Layer* layer : m_LayerStack)
+                        layer->OnImGuiRender();
+                }
+                m_ImGuiLayer->End();
             }
-            m_ImGuiLayer->End();
 
-            m_Window->OnUpdate();
+            // Executes the frame packet and swaps the buffers, on the render thread or right away
+            RenderThread::Submit();
+
+            // Without a window there is no buffer swap to mark the end of the frame
+            if (m_Specification.Headless)
+                FrameMark;
+
+            m_FrameCount++;
+            if (m_Specification.FrameLimit > 0 && m_FrameCount >= m_Specification.FrameLimit)
+                m_Running = false;
         }
+
+        if (m_Specification.Headless)
+        {
+            double runTime = runStopwatch.GetPreciseElapsedTime() * 1000.0;
+            const RendererStats& stats = Renderer::GetStats();
+            COFFEE_CORE_INFO("Application: Ran {0} headless frames in {1:.2f} ms ({2:.3f} ms per frame), {3} draws in the last one",
+                             m_FrameCount, runTime, m_FrameCount > 0 ? runTime / m_FrameCount : 0.0, stats.DrawCalls);
+        }
+    }
+
+    void Application::FixedUpdate(double elapsed)
+    {
+        ZoneScopedN("LayerStack FixedUpdate");
+
+        m_Accumulator += elapsed;
+        m_SubstepCount = 0;
+        while (m_Accumulator >= m_FixedTimestep && m_SubstepCount < m_MaxSubsteps)
+        {
+            for(Layer* layer : m_LayerStack)
+                layer->OnFixedUpdate((float)m_FixedTimestep);
+
+            m_Accumulator -= m_FixedTimestep;
+            m_SubstepCount++;
+        }
+
+        // Past the substep limit the time is dropped, catching up would only make the next frame longer
+        if (m_Accumulator >= m_FixedTimestep)
+            m_Accumulator = std::fmod(m_Accumulator, m_FixedTimestep);
+
+        m_InterpolationAlpha = (float)(m_Accumulator / m_FixedTimestep);
+
+        TracyPlot("Simulation Substeps", (int64_t)m_SubstepCount);
     }
 
     void Application::ProcessEvents()
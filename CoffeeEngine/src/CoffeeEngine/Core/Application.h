@@ -6,6 +6,9 @@
 #include "CoffeeEngine/Events/ApplicationEvent.h"
 #include "CoffeeEngine/ImGui/ImGuiLayer.h"
 
+#include <string>
+#include <vector>
+
 namespace Coffee
 {
     /**
@@ -14,6 +17,16 @@ namespace Coffee
      * @{
      */
 
+    /**
+     * @brief Options of the application, set before it is created, from the command line by the entry point.
+     */
+    struct ApplicationSpecification
+    {
+        bool Headless = false; ///< Run without a window, GL context nor ImGui, with the null renderer backend, one simulation step per frame.
+        uint64_t FrameLimit = 0; ///< Close the application after this many frames, 0 runs until it is closed.
+        std::vector<std::string> Arguments; ///< The command line arguments, the executable excluded, for the client to parse.
+    };
+
     /**
      * @brief The Application class is responsible for managing the main application loop,
      * handling events, and managing layers and overlays.
@@ -56,7 +69,7 @@ namespace Coffee
         void PushOverlay(Layer* layer);
 
         /**
-         * @brief Gets the main application window.
+         * @brief Gets the main application window, headless applications have none.
          * @return A reference to the main application window.
          */
         Window& GetWindow() { return *m_Window; }
@@ -72,16 +85,83 @@ namespace Coffee
          */
         void Close();
 
+        /**
+         * @brief Sets the code returned by the process when the application exits, so the headless checks can fail
+         * a script running them.
+         * @param exitCode The exit code, 0 for success.
+         */
+        void SetExitCode(int exitCode) { m_ExitCode = exitCode; }
+        int GetExitCode() const { return m_ExitCode; }
+
         /**
          * @brief Gets the ImGui layer.
-         * @return A pointer to the ImGui layer.
+         * @return A pointer to the ImGui layer, nullptr for headless applications.
          */
         ImGuiLayer* GetImGuiLayer() { return m_ImGuiLayer; }
 
+        /**
+         * @brief Gets the options the application was created with.
+         * @return The options.
+         */
+        const ApplicationSpecification& GetSpecification() const { return m_Specification; }
+
+        /**
+         * @brief Whether the application runs without a window, see ApplicationSpecification::Headless.
+         * @return True if the application is headless.
+         */
+        bool IsHeadless() const { return m_Specification.Headless; }
+
+        /**
+         * @brief Gets the number of frames run since the application started.
+         * @return The count.
+         */
+        uint64_t GetFrameCount() const { return m_FrameCount; }
+
         // Temporary until we have a proper way to get the FPS and FrameTime
         float GetFrameTime() const { return m_LastFrameTime * 1000.0f; }
         float GetFPS() const { return 1.0f / m_LastFrameTime; }
 
+        /**
+         * @brief Sets the length of a simulation step, the layers receive OnFixedUpdate that many times per second.
+         * @param timestep The step length, in seconds.
+         */
+        void SetFixedTimestep(double timestep);
+        double GetFixedTimestep() const { return m_FixedTimestep; }
+
+        /**
+         * @brief Sets the most simulation steps run in a frame. The time past them is dropped, so a slow frame
+         * slows the simulation down instead of making the next frames slower still.
+         * @param count The count, at least 1.
+         */
+        void SetMaxSubsteps(uint32_t count);
+        uint32_t GetMaxSubsteps() const { return m_MaxSubsteps; }
+
+        /**
+         * @brief Gets the position of the current frame between the last two simulation steps.
+         * @return From 0, the previous step, to 1, the last one.
+         */
+        float GetInterpolationAlpha() const { return m_InterpolationAlpha; }
+
+        /**
+         * @brief Gets the number of simulation steps run by the current frame.
+         * @return The count.
+         */
+        uint32_t GetSubstepCount() const { return m_SubstepCount; }
+
+        /**
+         * @brief Sets the options of the next application created.
+         * @param specification The options.
+         */
+        static void SetSpecification(const ApplicationSpecification& specification) { s_Specification = specification; }
+
+        /**
+         * @brief Sets the options of the next application created from the command line: --headless and
+         * --frames <count>. Every argument is also kept in ApplicationSpecification::Arguments.
+         * @param argc The number of arguments.
+         * @param argv The arguments, the first one being the executable.
+         */
+        static void ParseCommandLine(int argc, const char** argv);
+
         /**
          * @brief Gets the singleton instance of the Application.
          * @return A reference to the singleton instance.
@@ -98,6 +178,12 @@ namespace Coffee
          */
         void ProcessEvents();
 
+        /**
+         * @brief Runs the fixed updates of the layers for the time accumulated since the previous frame.
+         * @param elapsed The time to accumulate, in seconds.
+         */
+        void FixedUpdate(double elapsed);
+
         /**
          * @brief Handles the window close event.
          * @param e The window close event.
@@ -107,15 +193,24 @@ namespace Coffee
 
       private:
 
+        ApplicationSpecification m_Specification; ///< The options the application was created with.
         Scope<Window> m_Window; ///< The main application window.
-        ImGuiLayer* m_ImGuiLayer; ///< The ImGui layer.
+        ImGuiLayer* m_ImGuiLayer = nullptr; ///< The ImGui layer.
         bool m_Running = true; ///< Indicates whether the application is running.
         LayerStack m_LayerStack; ///< The stack of layers.
         double m_LastFrameTime = 0.0f; ///< The time of the last frame.
+        double m_FixedTimestep = 1.0 / 60.0; ///< The length of a simulation step, in seconds.
+        uint32_t m_MaxSubsteps = 5; ///< The most simulation steps run in a frame.
+        double m_Accumulator = 0.0; ///< The frame time not simulated yet, in seconds.
+        float m_InterpolationAlpha = 1.0f; ///< The position of the frame between the last two simulation steps.
+        uint32_t m_SubstepCount = 0; ///< The simulation steps run by the current frame.
+        uint64_t m_FrameCount = 0; ///< The frames run since the application started.
+        int m_ExitCode = 0; ///< The code returned by the process.
         EventCallbackFn m_EventCallback; ///< The event callback function.
 
       private:
         static Application* s_Instance; ///< The singleton instance of the Application.
+        static ApplicationSpecification s_Specification; ///< The options of the next application created.
     };
 
     /**
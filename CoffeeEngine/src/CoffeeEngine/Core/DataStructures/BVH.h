@@ -0,0 +1,594 @@
+#pragma once
+
+#include "CoffeeEngine/Core/DataStructures/Octree.h"
+#include "CoffeeEngine/Math/BoundingBox.h"
+#include "CoffeeEngine/Math/Frustum.h"
+#include "CoffeeEngine/Math/Ray.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @brief Node of a flattened BVH, 32 bytes so two nodes share a cache line.
+     *
+     * Inner nodes have a count of 0 and their two children stored next to each other at firstIndex,
+     * leaves hold count objects starting at firstIndex.
+     */
+    struct BVHNode
+    {
+        glm::vec3 min = glm::vec3(0.0f);
+        uint32_t firstIndex = 0;
+        glm::vec3 max = glm::vec3(0.0f);
+        uint32_t count = 0;
+
+        bool IsLeaf() const { return count > 0; }
+    };
+
+    static_assert(sizeof(BVHNode) == 32, "BVHNode must stay 32 bytes");
+
+    /**
+     * @brief Shape statistics of a BVH.
+     */
+    struct BVHStats
+    {
+        uint32_t NodeCount = 0; ///< Number of nodes, the root included.
+        uint32_t LeafCount = 0; ///< Number of leaf nodes.
+        uint32_t ObjectCount = 0; ///< Number of objects.
+        uint32_t Depth = 0; ///< Depth of the deepest node.
+        uint32_t MaxObjectsPerLeaf = 0; ///< Number of objects of the most crowded leaf.
+        float AverageObjectsPerLeaf = 0.0f; ///< Average number of objects of the leaves.
+        float Cost = 0.0f; ///< SAH cost of the tree relative to the root area, it grows as refits loosen the nodes.
+    };
+
+    /**
+     * @brief Bounding volume hierarchy for static objects, built with the binned surface area heuristic.
+     *
+     * The tree is stored as a flat array of nodes and the objects are reordered so every leaf references a
+     * contiguous range. Subtrees with many objects are built in parallel. Objects that move a little can be
+     * refitted in place, large movements degrade the tree and call for a rebuild.
+     */
+    template <typename T>
+    class BVH
+    {
+    public:
+        static constexpr uint32_t BinCount = 16; ///< Number of bins the SAH split candidates are evaluated at, per axis.
+        static constexpr uint32_t MinObjectsToSplit = 3; ///< Nodes with fewer objects are always leaves.
+        static constexpr uint32_t MaxObjectsPerLeaf = 16; ///< Nodes with more objects are split even if the SAH prefers a leaf.
+        static constexpr uint32_t ParallelThreshold = 4096; ///< Subtrees with fewer objects are built on the current thread.
+
+        /**
+         * @brief Rebuilds the BVH from a set of objects.
+         * @param objects The objects to insert.
+         */
+        void Build(const std::vector<ObjectContainer<T>>& objects);
+
+        void Clear();
+
+        /**
+         * @brief Recomputes the node bounds from the current transforms of the objects, keeping the topology.
+         */
+        void Refit();
+
+        /**
+         * @brief Gets the objects whose bounds intersect a frustum.
+         * @param frustum The frustum.
+         * @return The visible objects.
+         */
+        std::vector<ObjectContainer<T>> Query(const Frustum& frustum) const;
+
+        /**
+         * @brief Gets the objects whose bounds are hit by a ray.
+         * @param ray The ray.
+         * @param maxDistance The length of the ray, in multiples of its direction.
+         * @return The objects hit, in no particular order.
+         */
+        std::vector<ObjectContainer<T>> Query(const Ray& ray, float maxDistance = std::numeric_limits<float>::max()) const;
+
+        /**
+         * @brief Finds the closest object hit by a ray, visiting the nodes front to back.
+         * @param ray The ray.
+         * @param distance The length of the ray on input, the distance of the hit on output.
+         * @param object The object hit.
+         * @param intersect Called as bool(const ObjectContainer<T>&, const Ray&, float& distance) for the objects
+         *                  whose bounds are closer than the current hit, it refines the test (against the triangles...).
+         * @return True if an object was hit.
+         */
+        template <typename Intersector>
+        bool Raycast(const Ray& ray, float& distance, T& object, Intersector&& intersect) const;
+
+        /**
+         * @brief Finds the closest object whose bounds are hit by a ray.
+         * @param ray The ray.
+         * @param distance The length of the ray on input, the distance of the hit on output.
+         * @param object The object hit.
+         * @return True if an object was hit.
+         */
+        bool Raycast(const Ray& ray, float& distance, T& object) const;
+
+        bool IsEmpty() const { return m_Nodes.empty(); }
+        const std::vector<BVHNode>& GetNodes() const { return m_Nodes; }
+
+        /**
+         * @brief Gets the objects in tree order, their transforms can be changed before a Refit.
+         * @return The objects.
+         */
+        std::vector<ObjectContainer<T>>& GetObjects() { return m_Objects; }
+        const std::vector<ObjectContainer<T>>& GetObjects() const { return m_Objects; }
+
+        /**
+         * @brief Walks the tree to gather its shape statistics.
+         * @return The statistics.
+         */
+        BVHStats GetStats() const;
+
+    private:
+        struct Bin
+        {
+            AABB bounds;
+            uint32_t count = 0;
+        };
+
+        struct BuildContext
+        {
+            std::vector<AABB> bounds; ///< World bounds of each object.
+            std::vector<glm::vec3> centroids; ///< Center of the world bounds of each object.
+            std::vector<uint32_t> indices; ///< Object indices, partitioned in place while building.
+            std::atomic<uint32_t> nodeCount = 0;
+            uint32_t parallelDepth = 0; ///< Depth below which the subtrees are not spawned on other threads.
+        };
+
+        void BuildNode(BuildContext& context, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth);
+        void MakeLeaf(BVHNode& node, uint32_t first, uint32_t count);
+
+        static void Grow(AABB& bounds, const AABB& other, bool& empty);
+        static float GetArea(const AABB& bounds);
+        static AABB GetBounds(const BVHNode& node) { return AABB(node.min, node.max); }
+
+    private:
+        std::vector<BVHNode> m_Nodes;
+        std::vector<ObjectContainer<T>> m_Objects;
+    };
+
+    template <typename T>
+    void BVH<T>::Grow(AABB& bounds, const AABB& other, bool& empty)
+    {
+        bounds.min = empty ? other.min : glm::min(bounds.min, other.min);
+        bounds.max = empty ? other.max : glm::max(bounds.max, other.max);
+        empty = false;
+    }
+
+    template <typename T>
+    float BVH<T>::GetArea(const AABB& bounds)
+    {
+        glm::vec3 size = bounds.max - bounds.min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    template <typename T>
+    void BVH<T>::Build(const std::vector<ObjectContainer<T>>& objects)
+    {
+        Clear();
+
+        uint32_t count = (uint32_t)objects.size();
+        if (count == 0)
+            return;
+
+        BuildContext context;
+        context.bounds.resize(count);
+        context.centroids.resize(count);
+        context.indices.resize(count);
+        std::iota(context.indices.begin(), context.indices.end(), 0u);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            context.bounds[i] = objects[i].aabb.CalculateTransformedAABB(objects[i].transform);
+            context.centroids[i] = context.bounds[i].GetCenter();
+        }
+
+        // Each level doubles the subtrees built at the same time, stop spawning once every core has one
+        uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        while ((1u << context.parallelDepth) < threadCount)
+            context.parallelDepth++;
+
+        // A binary tree with a leaf per object is the largest the build can produce
+        m_Nodes.resize(2 * count - 1);
+        context.nodeCount = 1;
+        BuildNode(context, 0, 0, count, 0);
+        m_Nodes.resize(context.nodeCount);
+
+        m_Objects.reserve(count);
+        for (uint32_t index : context.indices)
+            m_Objects.push_back(objects[index]);
+    }
+
+    template <typename T>
+    void BVH<T>::MakeLeaf(BVHNode& node, uint32_t first, uint32_t count)
+    {
+        node.firstIndex = first;
+        node.count = count;
+    }
+
+    template <typename T>
+    void BVH<T>::BuildNode(BuildContext& context, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+    {
+        BVHNode& node = m_Nodes[nodeIndex];
+
+        AABB bounds, centroidBounds;
+        bool empty = true, centroidEmpty = true;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            uint32_t index = context.indices[i];
+            Grow(bounds, context.bounds[index], empty);
+            Grow(centroidBounds, AABB(context.centroids[index], context.centroids[index]), centroidEmpty);
+        }
+        node.min = bounds.min;
+        node.max = bounds.max;
+
+        if (count < MinObjectsToSplit)
+        {
+            MakeLeaf(node, first, count);
+            return;
+        }
+
+        // Evaluate the split planes between the bins of every axis, the cost being the area weighted object count of the children
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        uint32_t bestSplit = 0;
+        glm::vec3 centroidExtent = centroidBounds.max - centroidBounds.min;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (centroidExtent[axis] <= 0.0f)
+                continue;
+
+            std::array<Bin, BinCount> bins;
+            std::array<bool, BinCount> binEmpty;
+            binEmpty.fill(true);
+
+            float scale = BinCount / centroidExtent[axis];
+            for (uint32_t i = first; i < first + count; ++i)
+            {
+                uint32_t index = context.indices[i];
+                uint32_t bin = std::min(BinCount - 1, (uint32_t)((context.centroids[index][axis] - centroidBounds.min[axis]) * scale));
+                Grow(bins[bin].bounds, context.bounds[index], binEmpty[bin]);
+                bins[bin].count++;
+            }
+
+            // Sweep from both sides to get the area and count of each side of every plane
+            std::array<float, BinCount - 1> leftArea, rightArea;
+            std::array<uint32_t, BinCount - 1> leftCount, rightCount;
+            AABB leftBounds, rightBounds;
+            bool leftEmpty = true, rightEmpty = true;
+            uint32_t leftSum = 0, rightSum = 0;
+            for (uint32_t i = 0; i < BinCount - 1; ++i)
+            {
+                if (bins[i].count > 0)
+                    Grow(leftBounds, bins[i].bounds, leftEmpty);
+                leftSum += bins[i].count;
+                leftCount[i] = leftSum;
+                leftArea[i] = leftEmpty ? 0.0f : GetArea(leftBounds);
+
+                uint32_t j = BinCount - 1 - i;
+                if (bins[j].count > 0)
+                    Grow(rightBounds, bins[j].bounds, rightEmpty);
+                rightSum += bins[j].count;
+                rightCount[j - 1] = rightSum;
+                rightArea[j - 1] = rightEmpty ? 0.0f : GetArea(rightBounds);
+            }
+
+            for (uint32_t i = 0; i < BinCount - 1; ++i)
+            {
+                if (leftCount[i] == 0 || rightCount[i] == 0)
+                    continue;
+
+                float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        uint32_t* begin = context.indices.data() + first;
+        uint32_t* end = begin + count;
+        uint32_t* middle = nullptr;
+
+        if (bestAxis >= 0)
+        {
+            float leafCost = count * GetArea(bounds);
+            if (bestCost >= leafCost && count <= MaxObjectsPerLeaf)
+            {
+                MakeLeaf(node, first, count);
+                return;
+            }
+
+            float scale = BinCount / centroidExtent[bestAxis];
+            float minCentroid = centroidBounds.min[bestAxis];
+            middle = std::partition(begin, end, [&](uint32_t index) {
+                uint32_t bin = std::min(BinCount - 1, (uint32_t)((context.centroids[index][bestAxis] - minCentroid) * scale));
+                return bin <= bestSplit;
+            });
+        }
+        else
+        {
+            // Every centroid is at the same point, the SAH cannot separate them
+            if (count <= MaxObjectsPerLeaf)
+            {
+                MakeLeaf(node, first, count);
+                return;
+            }
+            middle = begin + count / 2;
+        }
+
+        uint32_t leftCountTotal = (uint32_t)(middle - begin);
+        uint32_t rightCountTotal = count - leftCountTotal;
+
+        // Children are allocated as a pair, always after their parent, so a reverse walk of the array visits them first
+        uint32_t leftIndex = context.nodeCount.fetch_add(2);
+        node.firstIndex = leftIndex;
+        node.count = 0;
+
+        if (count >= ParallelThreshold && depth < context.parallelDepth)
+        {
+            std::future<void> left = std::async(std::launch::async, [&, leftIndex, first, leftCountTotal, depth]() {
+                BuildNode(context, leftIndex, first, leftCountTotal, depth + 1);
+            });
+            BuildNode(context, leftIndex + 1, first + leftCountTotal, rightCountTotal, depth + 1);
+            left.get();
+        }
+        else
+        {
+            BuildNode(context, leftIndex, first, leftCountTotal, depth + 1);
+            BuildNode(context, leftIndex + 1, first + leftCountTotal, rightCountTotal, depth + 1);
+        }
+    }
+
+    template <typename T>
+    void BVH<T>::Clear()
+    {
+        m_Nodes.clear();
+        m_Objects.clear();
+    }
+
+    template <typename T>
+    void BVH<T>::Refit()
+    {
+        for (size_t i = m_Nodes.size(); i-- > 0;)
+        {
+            BVHNode& node = m_Nodes[i];
+
+            AABB bounds;
+            bool empty = true;
+            if (node.IsLeaf())
+            {
+                for (uint32_t j = node.firstIndex; j < node.firstIndex + node.count; ++j)
+                    Grow(bounds, m_Objects[j].aabb.CalculateTransformedAABB(m_Objects[j].transform), empty);
+            }
+            else
+            {
+                Grow(bounds, GetBounds(m_Nodes[node.firstIndex]), empty);
+                Grow(bounds, GetBounds(m_Nodes[node.firstIndex + 1]), empty);
+            }
+
+            node.min = bounds.min;
+            node.max = bounds.max;
+        }
+    }
+
+    template <typename T>
+    std::vector<ObjectContainer<T>> BVH<T>::Query(const Frustum& frustum) const
+    {
+        std::vector<ObjectContainer<T>> results;
+        if (m_Nodes.empty())
+            return results;
+
+        std::vector<uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(0);
+
+        while (!stack.empty())
+        {
+            const BVHNode& node = m_Nodes[stack.back()];
+            stack.pop_back();
+
+            if (!frustum.Contains(GetBounds(node)))
+                continue;
+
+            if (node.IsLeaf())
+            {
+                for (uint32_t i = node.firstIndex; i < node.firstIndex + node.count; ++i)
+                {
+                    const ObjectContainer<T>& object = m_Objects[i];
+                    if (node.count == 1 || frustum.Contains(object.aabb.CalculateTransformedAABB(object.transform)))
+                        results.push_back(object);
+                }
+            }
+            else
+            {
+                stack.push_back(node.firstIndex + 1);
+                stack.push_back(node.firstIndex);
+            }
+        }
+
+        return results;
+    }
+
+    template <typename T>
+    std::vector<ObjectContainer<T>> BVH<T>::Query(const Ray& ray, float maxDistance) const
+    {
+        std::vector<ObjectContainer<T>> results;
+        if (m_Nodes.empty())
+            return results;
+
+        std::vector<uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(0);
+
+        float tNear, tFar;
+        while (!stack.empty())
+        {
+            const BVHNode& node = m_Nodes[stack.back()];
+            stack.pop_back();
+
+            if (!ray.Intersect(GetBounds(node), tNear, tFar) || tNear > maxDistance)
+                continue;
+
+            if (node.IsLeaf())
+            {
+                for (uint32_t i = node.firstIndex; i < node.firstIndex + node.count; ++i)
+                {
+                    const ObjectContainer<T>& object = m_Objects[i];
+                    if (ray.Intersect(object.aabb.CalculateTransformedAABB(object.transform), tNear, tFar) && tNear <= maxDistance)
+                        results.push_back(object);
+                }
+            }
+            else
+            {
+                stack.push_back(node.firstIndex + 1);
+                stack.push_back(node.firstIndex);
+            }
+        }
+
+        return results;
+    }
+
+    template <typename T>
+    template <typename Intersector>
+    bool BVH<T>::Raycast(const Ray& ray, float& distance, T& object, Intersector&& intersect) const
+    {
+        if (m_Nodes.empty())
+            return false;
+
+        bool hit = false;
+        float tNear, tFar;
+
+        // Pairs of node index and entry distance, nodes entered past the closest hit are skipped when popped
+        std::vector<std::pair<uint32_t, float>> stack;
+        stack.reserve(64);
+        if (ray.Intersect(GetBounds(m_Nodes[0]), tNear, tFar) && tNear <= distance)
+            stack.push_back({0, tNear});
+
+        while (!stack.empty())
+        {
+            auto [nodeIndex, entry] = stack.back();
+            stack.pop_back();
+
+            if (entry > distance)
+                continue;
+
+            const BVHNode& node = m_Nodes[nodeIndex];
+            if (node.IsLeaf())
+            {
+                for (uint32_t i = node.firstIndex; i < node.firstIndex + node.count; ++i)
+                {
+                    const ObjectContainer<T>& candidate = m_Objects[i];
+                    if (!ray.Intersect(candidate.aabb.CalculateTransformedAABB(candidate.transform), tNear, tFar) || tNear > distance)
+                        continue;
+
+                    float candidateDistance = distance;
+                    if (intersect(candidate, ray, candidateDistance) && candidateDistance < distance)
+                    {
+                        distance = candidateDistance;
+                        object = candidate.object;
+                        hit = true;
+                    }
+                }
+                continue;
+            }
+
+            // Push the farther child first so the nearer one is visited first and tightens the distance
+            float leftNear, rightNear;
+            bool leftHit = ray.Intersect(GetBounds(m_Nodes[node.firstIndex]), leftNear, tFar) && leftNear <= distance;
+            bool rightHit = ray.Intersect(GetBounds(m_Nodes[node.firstIndex + 1]), rightNear, tFar) && rightNear <= distance;
+
+            if (leftHit && rightHit)
+            {
+                if (leftNear <= rightNear)
+                {
+                    stack.push_back({node.firstIndex + 1, rightNear});
+                    stack.push_back({node.firstIndex, leftNear});
+                }
+                else
+                {
+                    stack.push_back({node.firstIndex, leftNear});
+                    stack.push_back({node.firstIndex + 1, rightNear});
+                }
+            }
+            else if (leftHit)
+            {
+                stack.push_back({node.firstIndex, leftNear});
+            }
+            else if (rightHit)
+            {
+                stack.push_back({node.firstIndex + 1, rightNear});
+            }
+        }
+
+        return hit;
+    }
+
+    template <typename T>
+    bool BVH<T>::Raycast(const Ray& ray, float& distance, T& object) const
+    {
+        return Raycast(ray, distance, object, [](const ObjectContainer<T>& candidate, const Ray& ray, float& candidateDistance) {
+            float tNear, tFar;
+            ray.Intersect(candidate.aabb.CalculateTransformedAABB(candidate.transform), tNear, tFar);
+            candidateDistance = tNear;
+            return true;
+        });
+    }
+
+    template <typename T>
+    BVHStats BVH<T>::GetStats() const
+    {
+        BVHStats stats;
+        if (m_Nodes.empty())
+            return stats;
+
+        stats.NodeCount = (uint32_t)m_Nodes.size();
+        stats.ObjectCount = (uint32_t)m_Objects.size();
+
+        float rootArea = GetArea(GetBounds(m_Nodes[0]));
+        float cost = 0.0f;
+
+        std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, 0}};
+        while (!stack.empty())
+        {
+            auto [nodeIndex, depth] = stack.back();
+            stack.pop_back();
+
+            const BVHNode& node = m_Nodes[nodeIndex];
+            stats.Depth = std::max(stats.Depth, depth);
+
+            float area = GetArea(GetBounds(node));
+            if (node.IsLeaf())
+            {
+                stats.LeafCount++;
+                stats.MaxObjectsPerLeaf = std::max(stats.MaxObjectsPerLeaf, node.count);
+                cost += area * node.count;
+            }
+            else
+            {
+                cost += area;
+                stack.push_back({node.firstIndex, depth + 1});
+                stack.push_back({node.firstIndex + 1, depth + 1});
+            }
+        }
+
+        stats.AverageObjectsPerLeaf = stats.LeafCount > 0 ? (float)stats.ObjectCount / stats.LeafCount : 0.0f;
+        stats.Cost = rootArea > 0.0f ? cost / rootArea : 0.0f;
+        return stats;
+    }
+
+}
@@ -3,19 +3,51 @@
 #include "CoffeeEngine/Core/Base.h"
 #include "CoffeeEngine/Math/BoundingBox.h"
 #include "CoffeeEngine/Math/Frustum.h"
+#include "CoffeeEngine/Math/Ray.h"
 #include "CoffeeEngine/Renderer/Mesh.h"
 #include "CoffeeEngine/Renderer/DebugRenderer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <vector>
 #include <memory>
 
 namespace Coffee {
 
+    /**
+     * @brief An object stored in the octree, held by value so it does not dangle when its source is destroyed.
+     */
     template <typename T>
     struct ObjectContainer
     {
-        const glm::mat4& transform;
-        const AABB& aabb;
-        const T& object;
+        glm::mat4 transform;
+        AABB aabb;
+        T object;
+    };
+
+    /**
+     * @brief Tunable parameters of an octree.
+     */
+    struct OctreeSettings
+    {
+        int MaxObjectsPerNode = 8; ///< A leaf holding more objects than this is subdivided.
+        int MaxDepth = 8; ///< Nodes at this depth are never subdivided, the root being at depth 0.
+    };
+
+    /**
+     * @brief Shape statistics of an octree.
+     */
+    struct OctreeStats
+    {
+        uint32_t NodeCount = 0; ///< Number of nodes, the root included.
+        uint32_t LeafCount = 0; ///< Number of leaf nodes.
+        uint32_t ObjectCount = 0; ///< Number of objects in the whole tree.
+        uint32_t InnerObjectCount = 0; ///< Number of objects kept in inner nodes because they straddle their children.
+        uint32_t Depth = 0; ///< Depth of the deepest node.
+        uint32_t MaxObjectsPerLeaf = 0; ///< Number of objects of the most crowded leaf.
+        float AverageObjectsPerLeaf = 0.0f; ///< Average number of objects of the leaves.
+        uint32_t RootGrowths = 0; ///< Number of times the root was grown to fit an object since the last build.
     };
 
     template <typename T>
@@ -35,81 +67,311 @@ namespace Coffee {
     class Octree
     {
     public:
-        Octree();
+        /**
+         * @brief Constructs an empty octree, its bounds are fitted to the first object inserted.
+         * @param settings The subdivision settings.
+         */
+        Octree(const OctreeSettings& settings = OctreeSettings());
         Octree(const AABB& bounds, int maxObjectsPerNode = 8, int maxDepth = 5);
         ~Octree();
 
+        /**
+         * @brief Rebuilds the octree with the bounds fitted to a set of objects.
+         * @param objects The objects to insert.
+         */
+        void Build(const std::vector<ObjectContainer<T>>& objects);
+
+        /**
+         * @brief Inserts an object, growing the root until it fits so no object is ever dropped.
+         *
+         * Objects with non finite bounds are kept in the root node.
+         *
+         * @param object The object to insert.
+         */
         void Insert(const ObjectContainer<T>& object);
+
+        /**
+         * @brief Removes an object, looked up from its position first and compared by value.
+         * @param object The object to remove, with the transform it was inserted with.
+         * @return True if the object was found and removed.
+         */
+        bool Remove(const ObjectContainer<T>& object);
+
         void DebugDraw();
         void Clear();
 
+        /**
+         * @brief Clears the octree and changes its bounds.
+         * @param bounds The new bounds of the root node.
+         */
+        void Reset(const AABB& bounds);
+
         std::vector<ObjectContainer<T>> Query(const Frustum& frustum) const;
 
+        /**
+         * @brief Finds the closest object hit by a ray, visiting the children front to back.
+         * @param ray The ray.
+         * @param distance The length of the ray on input, the distance of the hit on output.
+         * @param object The object hit.
+         * @param intersect Called as bool(const ObjectContainer<T>&, const Ray&, float& distance) for the objects
+         *                  whose bounds are closer than the current hit, it refines the test (against the triangles...).
+         * @return True if an object was hit.
+         */
+        template <typename Intersector>
+        bool Raycast(const Ray& ray, float& distance, T& object, Intersector&& intersect) const;
+
+        const AABB& GetBounds() const { return rootNode.aabb; }
+        size_t GetObjectCount() const { return objectCount; }
+
+        const OctreeSettings& GetSettings() const { return settings; }
+
+        /**
+         * @brief Changes the subdivision settings, the objects are reinserted with the new ones.
+         * @param settings The subdivision settings.
+         */
+        void SetSettings(const OctreeSettings& settings);
+
+        /**
+         * @brief Walks the tree to gather its shape statistics.
+         * @return The statistics.
+         */
+        OctreeStats GetStats() const;
+
+        /**
+         * @brief Calls a function for every object in the tree, whatever its bounds.
+         * @param function Called as void(const ObjectContainer<T>&).
+         */
+        template <typename Function>
+        void ForEach(Function&& function) const { ForEach(rootNode, function); }
+
     private:
-        void Insert(OctreeNode<T>& node, const ObjectContainer<T>& object);
-        void InsertIntoLeaf(OctreeNode<T>& node, const ObjectContainer<T>& object);
-        void InsertIntoChild(OctreeNode<T>& node, const ObjectContainer<T>& object);
-        void RedistributeObjects(OctreeNode<T>& node);
+        static constexpr int MaxRootGrowths = 32; ///< Each growth doubles the root size, past this the object is considered unbounded.
+
+        void Insert(OctreeNode<T>& node, const ObjectContainer<T>& object, const AABB& bounds, int depth);
+        void RedistributeObjects(OctreeNode<T>& node, int depth);
         void Subdivide(OctreeNode<T>& node);
         void CreateChildren(OctreeNode<T>& node, const glm::vec3& center);
+        int GetContainingChild(const OctreeNode<T>& node, const AABB& bounds) const;
+        void Grow(const AABB& bounds);
+
+        static bool Contains(const AABB& outer, const AABB& inner);
+        static bool IsFinite(const AABB& bounds);
+        static AABB FitBounds(const AABB& bounds);
 
         void Query(const OctreeNode<T>& node, const Frustum& frustum, std::vector<ObjectContainer<T>>& results) const;
+        template <typename Intersector>
+        bool Raycast(const OctreeNode<T>& node, const Ray& ray, float& distance, T& object, Intersector& intersect) const;
+        bool Remove(OctreeNode<T>& node, const ObjectContainer<T>& object, const AABB& bounds);
+        void GatherObjects(OctreeNode<T>& node, std::vector<ObjectContainer<T>>& objects);
+        template <typename Function>
+        void ForEach(const OctreeNode<T>& node, Function& function) const;
+        void GetStats(const OctreeNode<T>& node, uint32_t depth, OctreeStats& stats, uint32_t& leafObjects) const;
 
         OctreeNode<T> rootNode;
-        int maxObjectsPerNode;
-        int maxDepth;
+        OctreeSettings settings;
+        size_t objectCount = 0;
+        uint32_t rootGrowths = 0;
     };
 
     template <typename T>
-    void Octree<T>::Insert(OctreeNode<T>& node, const ObjectContainer<T>& object)
+    void Octree<T>::Insert(OctreeNode<T>& node, const ObjectContainer<T>& object, const AABB& bounds, int depth)
+    {
+        if (node.isLeaf)
+        {
+            node.objectList.push_back(object);
+            if ((int)node.objectList.size() > settings.MaxObjectsPerNode && depth < settings.MaxDepth)
+            {
+                Subdivide(node);
+                RedistributeObjects(node, depth);
+            }
+            return;
+        }
+
+        // Objects straddling the children stay in this node, so a child is only culled when none of its objects can be visible
+        int childIndex = GetContainingChild(node, bounds);
+        if (childIndex < 0)
+        {
+            node.objectList.push_back(object);
+            return;
+        }
+
+        Insert(*node.children[childIndex], object, bounds, depth + 1);
+    }
+
+    template <typename T>
+    void Octree<T>::RedistributeObjects(OctreeNode<T>& node, int depth) {
+        std::vector<ObjectContainer<T>> objects = std::move(node.objectList);
+        node.objectList.clear();
+        for (const auto& obj : objects) {
+            Insert(node, obj, obj.aabb.CalculateTransformedAABB(obj.transform), depth);
+        }
+    }
+
+    template <typename T>
+    int Octree<T>::GetContainingChild(const OctreeNode<T>& node, const AABB& bounds) const
+    {
+        int childIndex = node.GetChildIndex(node.aabb, bounds.GetCenter());
+        return Contains(node.children[childIndex]->aabb, bounds) ? childIndex : -1;
+    }
+
+    template <typename T>
+    void Octree<T>::Insert(const ObjectContainer<T>& object) {
+        AABB bounds = object.aabb.CalculateTransformedAABB(object.transform);
+        objectCount++;
+
+        if (!IsFinite(bounds)) {
+            rootNode.objectList.push_back(object);
+            return;
+        }
+
+        if (!rootNode.aabb.IsValid()) {
+            rootNode.aabb = FitBounds(bounds);
+        } else if (!Contains(rootNode.aabb, bounds)) {
+            Grow(bounds);
+        }
+
+        if (!Contains(rootNode.aabb, bounds)) {
+            rootNode.objectList.push_back(object);
+            return;
+        }
+
+        Insert(rootNode, object, bounds, 0);
+    }
+
+    template <typename T>
+    void Octree<T>::Build(const std::vector<ObjectContainer<T>>& objects)
     {
-        AABB objectTransformedAABB = object.aabb.CalculateTransformedAABB(object.transform);
+        Clear();
+        rootNode.aabb = AABB();
+        rootGrowths = 0;
 
-        switch (node.aabb.Intersect(objectTransformedAABB))
+        bool empty = true;
+        AABB bounds;
+        for (const auto& object : objects)
         {
-            using enum IntersectionType;
-            case Outside:
+            AABB objectBounds = object.aabb.CalculateTransformedAABB(object.transform);
+            if (!IsFinite(objectBounds))
+                continue;
+
+            bounds.min = empty ? objectBounds.min : glm::min(bounds.min, objectBounds.min);
+            bounds.max = empty ? objectBounds.max : glm::max(bounds.max, objectBounds.max);
+            empty = false;
+        }
+
+        if (!empty)
+            rootNode.aabb = FitBounds(bounds);
+
+        for (const auto& object : objects)
+            Insert(object);
+    }
+
+    template <typename T>
+    void Octree<T>::Grow(const AABB& bounds)
+    {
+        for (int i = 0; i < MaxRootGrowths && !Contains(rootNode.aabb, bounds); ++i)
+        {
+            if (objectCount == 1 && rootNode.isLeaf && rootNode.objectList.empty())
+            {
+                rootNode.aabb = FitBounds(bounds);
                 return;
-            case Inside:
-            case Intersect:
-                if (node.isLeaf)
+            }
+
+            // Double the root towards the object, the old root becomes the child on the opposite side
+            glm::vec3 size = rootNode.aabb.max - rootNode.aabb.min;
+            glm::vec3 center = rootNode.aabb.GetCenter();
+            glm::vec3 target = bounds.GetCenter();
+
+            AABB grown = rootNode.aabb;
+            int oldRootIndex = 0;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (target[axis] < center[axis])
                 {
-                    InsertIntoLeaf(node, object);
+                    grown.min[axis] -= size[axis];
+                    oldRootIndex |= 1 << axis;
                 }
                 else
                 {
-                    InsertIntoChild(node, object);
+                    grown.max[axis] += size[axis];
                 }
+            }
+
+            Scope<OctreeNode<T>> oldRoot = CreateScope<OctreeNode<T>>(std::move(rootNode));
+            rootNode = OctreeNode<T>();
+            rootNode.aabb = grown;
+            Subdivide(rootNode);
+            rootNode.children[oldRootIndex] = std::move(oldRoot);
+
+            rootGrowths++;
         }
     }
 
     template <typename T>
-    void Octree<T>::InsertIntoLeaf(OctreeNode<T>& node, const ObjectContainer<T>& object) {
-        node.objectList.push_back(object);
-        if (node.objectList.size() > maxObjectsPerNode && maxDepth > 0) {
-            Subdivide(node);
-            RedistributeObjects(node);
+    bool Octree<T>::Contains(const AABB& outer, const AABB& inner)
+    {
+        return inner.min.x >= outer.min.x && inner.max.x <= outer.max.x &&
+               inner.min.y >= outer.min.y && inner.max.y <= outer.max.y &&
+               inner.min.z >= outer.min.z && inner.max.z <= outer.max.z;
+    }
+
+    template <typename T>
+    bool Octree<T>::IsFinite(const AABB& bounds)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (!std::isfinite(bounds.min[axis]) || !std::isfinite(bounds.max[axis]))
+                return false;
         }
+        return true;
     }
 
     template <typename T>
-    void Octree<T>::InsertIntoChild(OctreeNode<T>& node, const ObjectContainer<T>& object) {
-        int childIndex = node.GetChildIndex(node.aabb, object.transform[3]);
-        Insert(*node.children[childIndex], object);
+    AABB Octree<T>::FitBounds(const AABB& bounds)
+    {
+        // Cubic nodes keep the subdivision balanced whatever the shape of the content
+        glm::vec3 halfSize = bounds.GetHalfSize();
+        float halfExtent = std::max({halfSize.x, halfSize.y, halfSize.z, 0.5f}) * 1.01f;
+        glm::vec3 center = bounds.GetCenter();
+        return AABB(center - glm::vec3(halfExtent), center + glm::vec3(halfExtent));
     }
 
     template <typename T>
-    void Octree<T>::RedistributeObjects(OctreeNode<T>& node) {
-        for (const auto& obj : node.objectList) {
-            int childIndex = node.GetChildIndex(node.aabb, obj.transform[3]);
-            Insert(*node.children[childIndex], obj);
+    bool Octree<T>::Remove(OctreeNode<T>& node, const ObjectContainer<T>& object, const AABB& bounds)
+    {
+        auto it = std::find_if(node.objectList.begin(), node.objectList.end(), [&object](const ObjectContainer<T>& other) { return other.object == object.object; });
+        if (it != node.objectList.end())
+        {
+            // The order of the objects in a node does not matter
+            *it = std::move(node.objectList.back());
+            node.objectList.pop_back();
+            return true;
         }
-        node.objectList.clear();
+
+        if (node.isLeaf)
+            return false;
+
+        // The object is looked for where its bounds lead first, it may have moved since it was inserted
+        int childIndex = node.GetChildIndex(node.aabb, bounds.GetCenter());
+        if (Remove(*node.children[childIndex], object, bounds))
+            return true;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            if (i != childIndex && node.children[i] && Remove(*node.children[i], object, bounds))
+                return true;
+        }
+
+        return false;
     }
 
     template <typename T>
-    void Octree<T>::Insert(const ObjectContainer<T>& object) {
-        Insert(rootNode, object);
+    bool Octree<T>::Remove(const ObjectContainer<T>& object)
+    {
+        if (!Remove(rootNode, object, object.aabb.CalculateTransformedAABB(object.transform)))
+            return false;
+
+        objectCount--;
+        return true;
     }
 
     template <typename T>
@@ -162,6 +424,58 @@ namespace Coffee {
         }
     }
 
+    template <typename T>
+    template <typename Intersector>
+    bool Octree<T>::Raycast(const OctreeNode<T>& node, const Ray& ray, float& distance, T& object, Intersector& intersect) const
+    {
+        bool hit = false;
+        float tNear, tFar;
+
+        // The objects of the node are tested without checking the node bounds, the root keeps the ones that do not fit it
+        for (const auto& candidate : node.objectList)
+        {
+            if (!ray.Intersect(candidate.aabb.CalculateTransformedAABB(candidate.transform), tNear, tFar) || tNear > distance)
+                continue;
+
+            float candidateDistance = distance;
+            if (intersect(candidate, ray, candidateDistance) && candidateDistance < distance)
+            {
+                distance = candidateDistance;
+                object = candidate.object;
+                hit = true;
+            }
+        }
+
+        if (node.isLeaf)
+            return hit;
+
+        std::array<std::pair<float, int>, 8> children;
+        int childCount = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            if (node.children[i] && ray.Intersect(node.children[i]->aabb, tNear, tFar) && tNear <= distance)
+                children[childCount++] = {tNear, i};
+        }
+        std::sort(children.begin(), children.begin() + childCount);
+
+        for (int i = 0; i < childCount; ++i)
+        {
+            if (children[i].first > distance)
+                break;
+
+            hit |= Raycast(*node.children[children[i].second], ray, distance, object, intersect);
+        }
+
+        return hit;
+    }
+
+    template <typename T>
+    template <typename Intersector>
+    bool Octree<T>::Raycast(const Ray& ray, float& distance, T& object, Intersector&& intersect) const
+    {
+        return Raycast(rootNode, ray, distance, object, intersect);
+    }
+
     template <typename T>
     void OctreeNode<T>::DebugDrawAABB()
     {
@@ -205,7 +519,12 @@ namespace Coffee {
     }
 
     template <typename T>
-    Octree<T>::Octree(const AABB& bounds, int maxObjectsPerNode, int maxDepth) : maxObjectsPerNode(maxObjectsPerNode), maxDepth(maxDepth)
+    Octree<T>::Octree(const OctreeSettings& settings) : settings(settings)
+    {
+    }
+
+    template <typename T>
+    Octree<T>::Octree(const AABB& bounds, int maxObjectsPerNode, int maxDepth) : settings({maxObjectsPerNode, maxDepth})
     {
         rootNode.aabb = bounds;
     }
@@ -233,6 +552,31 @@ namespace Coffee {
             }
         }
         rootNode.isLeaf = true;
+        objectCount = 0;
+    }
+
+    template <typename T>
+    void Octree<T>::Reset(const AABB& bounds)
+    {
+        Clear();
+        rootNode.aabb = bounds;
+    }
+
+    template <typename T>
+    template <typename Function>
+    void Octree<T>::ForEach(const OctreeNode<T>& node, Function& function) const
+    {
+        for (const auto& object : node.objectList)
+            function(object);
+
+        if (node.isLeaf)
+            return;
+
+        for (const auto& child : node.children)
+        {
+            if (child)
+                ForEach(*child, function);
+        }
     }
 
     template <typename T>
@@ -243,4 +587,65 @@ namespace Coffee {
         return results;
     }
 
+    template <typename T>
+    void Octree<T>::GatherObjects(OctreeNode<T>& node, std::vector<ObjectContainer<T>>& objects)
+    {
+        objects.insert(objects.end(), std::make_move_iterator(node.objectList.begin()), std::make_move_iterator(node.objectList.end()));
+        for (auto& child : node.children)
+        {
+            if (child)
+                GatherObjects(*child, objects);
+        }
+    }
+
+    template <typename T>
+    void Octree<T>::SetSettings(const OctreeSettings& newSettings)
+    {
+        settings = newSettings;
+
+        if (objectCount == 0)
+            return;
+
+        std::vector<ObjectContainer<T>> objects;
+        objects.reserve(objectCount);
+        GatherObjects(rootNode, objects);
+        Build(objects);
+    }
+
+    template <typename T>
+    void Octree<T>::GetStats(const OctreeNode<T>& node, uint32_t depth, OctreeStats& stats, uint32_t& leafObjects) const
+    {
+        uint32_t nodeObjects = (uint32_t)node.objectList.size();
+
+        stats.NodeCount++;
+        stats.ObjectCount += nodeObjects;
+        stats.Depth = std::max(stats.Depth, depth);
+
+        if (node.isLeaf)
+        {
+            stats.LeafCount++;
+            stats.MaxObjectsPerLeaf = std::max(stats.MaxObjectsPerLeaf, nodeObjects);
+            leafObjects += nodeObjects;
+            return;
+        }
+
+        stats.InnerObjectCount += nodeObjects;
+        for (const auto& child : node.children)
+        {
+            if (child)
+                GetStats(*child, depth + 1, stats, leafObjects);
+        }
+    }
+
+    template <typename T>
+    OctreeStats Octree<T>::GetStats() const
+    {
+        OctreeStats stats;
+        uint32_t leafObjects = 0;
+        GetStats(rootNode, 0, stats, leafObjects);
+        stats.AverageObjectsPerLeaf = stats.LeafCount > 0 ? (float)leafObjects / stats.LeafCount : 0.0f;
+        stats.RootGrowths = rootGrowths;
+        return stats;
+    }
+
 } // namespace Coffee
\ No newline at end of file
@@ -7,9 +7,12 @@ int main(int argc, const char** argv)
     Coffee::Log::Init();
     COFFEE_CORE_WARN("Initialized Log!");
 
+    Coffee::Application::ParseCommandLine(argc, argv);
+
     auto app = Coffee::CreateApplication();
     app->Run();
+    int exitCode = app->GetExitCode();
     delete app;
 
-    return 0;
+    return exitCode;
 }
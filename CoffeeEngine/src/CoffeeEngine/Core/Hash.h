@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace Coffee {
+
+    /**
+     * @brief 64-bit FNV-1a hashing, used for content hashes and compile time name hashes, and a second independent
+     * hash to confirm a content match.
+     */
+    class Hash
+    {
+    public:
+        static constexpr uint64_t OffsetBasis = 0xcbf29ce484222325ull; ///< The FNV-1a 64-bit offset basis, the seed of a new hash.
+        static constexpr uint64_t Prime = 0x100000001b3ull; ///< The FNV-1a 64-bit prime.
+
+        /**
+         * @brief Hashes a block of memory.
+         * @param data The data to hash.
+         * @param size The size of the data in bytes.
+         * @param seed The hash to continue from, so several blocks can be hashed as one.
+         * @return The hash of the data.
+         */
+        static uint64_t Bytes(const void* data, size_t size, uint64_t seed = OffsetBasis)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            uint64_t hash = seed;
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash ^= bytes[i];
+                hash *= Prime;
+            }
+            return hash;
+        }
+
+        /**
+         * @brief Hashes a block of memory with a function independent from FNV-1a, 8 bytes at a time.
+         *
+         * Two blocks are taken for equal only when both their FNV-1a hash and this one match, a 128-bit key.
+         *
+         * @param data The data to hash.
+         * @param size The size of the data in bytes.
+         * @return The hash of the data.
+         */
+        static uint64_t Digest(const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            uint64_t hash = Mix(size ^ 0x9e3779b97f4a7c15ull);
+
+            size_t i = 0;
+            for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+            {
+                uint64_t word;
+                std::memcpy(&word, bytes + i, sizeof(uint64_t));
+                hash = Mix(hash ^ Mix(word));
+            }
+
+            uint64_t tail = 0;
+            std::memcpy(&tail, bytes + i, size - i);
+            return Mix(hash ^ Mix(tail));
+        }
+
+        /**
+         * @brief Hashes a string, usable at compile time.
+         * @param string The string to hash.
+         * @param seed The hash to continue from.
+         * @return The hash of the string.
+         */
+        static constexpr uint64_t String(std::string_view string, uint64_t seed = OffsetBasis)
+        {
+            uint64_t hash = seed;
+            for (char c : string)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= Prime;
+            }
+            return hash;
+        }
+
+        /**
+         * @brief Hashes a trivially copyable value.
+         * @param value The value to hash.
+         * @param seed The hash to continue from.
+         * @return The hash of the value bytes.
+         */
+        template<typename T>
+        static uint64_t Value(const T& value, uint64_t seed = OffsetBasis)
+        {
+            return Bytes(&value, sizeof(T), seed);
+        }
+
+    private:
+        // The 64-bit finalizer of MurmurHash3, every input bit affects every output bit
+        static constexpr uint64_t Mix(uint64_t x)
+        {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdull;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ull;
+            x ^= x >> 33;
+            return x;
+        }
+    };
+
+}
@@ -32,6 +32,12 @@ public:
      */
     virtual void OnDetach() {}
 
+    /**
+     * Called at a fixed rate to advance the simulation of the layer, zero or more times per frame before OnUpdate.
+     * @param dt The fixed timestep, see Application::SetFixedTimestep.
+     */
+    virtual void OnFixedUpdate(float dt) {}
+
     /**
      * Called every frame to update the layer.
      * @param dt Delta time since the last frame.
@@ -107,6 +107,12 @@ namespace Coffee {
          */
         virtual void* GetNativeWindow() const { return m_Window; }
 
+        /**
+         * @brief Gets the graphics context of the window.
+         * @return A reference to the graphics context.
+         */
+        GraphicsContext& GetContext() { return *m_Context; }
+
         /**
          * @brief Creates a window with the specified properties.
          * @param props The properties of the window.
@@ -176,7 +176,9 @@ void main()
     // Revise this type of conditional assignment (the commented one) because i think can lead to some undefined behavior in the shader!!!!!
     vec3 normal/*  = material.hasNormal * (VertexInput.TBN * (texture(material.normalMap, VertexInput.TexCoords).rgb * 2.0 - 1.0)) + (1 - material.hasNormal) * VertexInput.Normal */;
     if (material.hasNormal == 1) {
-        normal = VertexInput.TBN * (texture(material.normalMap, VertexInput.TexCoords).rgb * 2.0 - 1.0);
+        // Only the XY components are sampled so BC5 compressed normal maps work, Z is reconstructed.
+        vec2 normalXY = texture(material.normalMap, VertexInput.TexCoords).rg * 2.0 - 1.0;
+        normal = VertexInput.TBN * vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
     } else {
         normal = VertexInput.Normal;
     }
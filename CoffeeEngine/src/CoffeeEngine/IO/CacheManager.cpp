@@ -1,5 +1,102 @@
 #include "CacheManager.h"
+#include "CoffeeEngine/Core/Hash.h"
+
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_stdinc.h>
+#include <cstdio>
 
 namespace Coffee {
     std::filesystem::path CacheManager::m_cachePath = ".CoffeeEngine/Cache";
+    bool CacheManager::m_IsCachePathSet = false;
+    Scope<ResourceArchive> CacheManager::m_Archive;
+    std::filesystem::file_time_type CacheManager::m_ArchiveWriteTime;
+    std::filesystem::path CacheManager::m_EngineCachePath;
+
+    std::filesystem::path CacheManager::GetShaderCachePath()
+    {
+        if (m_IsCachePathSet)
+        {
+            return m_cachePath / "Shaders";
+        }
+
+        const std::filesystem::path& engineCachePath = GetEngineCachePath();
+        return engineCachePath.empty() ? std::filesystem::path() : engineCachePath / "Shaders";
+    }
+
+    const std::filesystem::path& CacheManager::GetEngineCachePath()
+    {
+        if (m_EngineCachePath.empty())
+        {
+            if (char* prefPath = SDL_GetPrefPath("CoffeeEngine", "Cache"))
+            {
+                m_EngineCachePath = prefPath;
+                SDL_free(prefPath);
+            }
+        }
+
+        return m_EngineCachePath;
+    }
+
+    std::filesystem::path CacheManager::GetCookedScenePath(const std::filesystem::path& scenePath)
+    {
+        // Scenes with the same name in different folders must not share the cooked file
+        uint64_t pathHash = Hash::String(std::filesystem::absolute(scenePath).lexically_normal().generic_string());
+
+        char suffix[18];
+        std::snprintf(suffix, sizeof(suffix), "_%016llx", static_cast<unsigned long long>(pathHash));
+        return m_cachePath / "Scenes" / (scenePath.stem().string() + suffix + ".cscene");
+    }
+
+    bool CacheManager::MountArchive(const std::filesystem::path& path)
+    {
+        Scope<ResourceArchive> archive = CreateScope<ResourceArchive>();
+
+        if (!archive->Open(path))
+        {
+            return false;
+        }
+
+        m_Archive = std::move(archive);
+
+        std::error_code error;
+        m_ArchiveWriteTime = std::filesystem::last_write_time(path, error);
+        return true;
+    }
+
+    bool CacheManager::IsInArchive(const std::string& filename)
+    {
+        if (!m_Archive || !m_Archive->Contains(filename))
+        {
+            return false;
+        }
+
+        // The loose files are only written after packing when a resource is imported again
+        std::error_code error;
+        std::filesystem::file_time_type looseWriteTime = std::filesystem::last_write_time(GetCachedFilePath(filename), error);
+        return error || looseWriteTime <= m_ArchiveWriteTime;
+    }
+
+    void CacheManager::UnmountArchive()
+    {
+        m_Archive.reset();
+    }
+
+    bool CacheManager::PackCache(const std::filesystem::path& archivePath)
+    {
+        // Release the current mapping first, the archive may be the one being rewritten.
+        bool remount = m_Archive && m_Archive->GetPath() == archivePath;
+        if (remount)
+        {
+            UnmountArchive();
+        }
+
+        bool packed = ResourceArchive::Pack(m_cachePath, archivePath);
+
+        if (remount)
+        {
+            MountArchive(archivePath);
+        }
+
+        return packed;
+    }
 }
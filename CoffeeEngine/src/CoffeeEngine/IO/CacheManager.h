@@ -6,7 +6,11 @@
 
 #pragma once
 
+#include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/IO/ResourceArchive.h"
+
 #include <filesystem>
+#include <string>
 
 namespace Coffee {
 
@@ -24,6 +28,17 @@ namespace Coffee {
         static void SetCachePath(const std::filesystem::path& path)
         {
             m_cachePath = path;
+            m_IsCachePathSet = true;
+        }
+
+        /**
+         * @brief Checks if the cache path was set, by loading a project. Until then the cache path is the default one
+         * relative to the working directory.
+         * @return True if the cache path was set.
+         */
+        static bool IsCachePathSet()
+        {
+            return m_IsCachePathSet;
         }
 
         /**
@@ -53,17 +68,104 @@ namespace Coffee {
 
         /**
          * @brief Gets the file path for a cached file.
+         * @note The cache directory is not created here, it is created when something is written to it.
          * @param filename The name of the file to be cached.
          * @return The full path to the cached file.
          */
         static std::filesystem::path GetCachedFilePath(const std::string& filename)
         {
-            std::filesystem::create_directories(m_cachePath);
             return m_cachePath / (filename + ".res");
         }
 
+        /**
+         * @brief Gets the default path of the packed archive of the cache.
+         * @return The path to the .cpak file inside the cache directory.
+         */
+        static std::filesystem::path GetArchivePath()
+        {
+            return m_cachePath / "Resources.cpak";
+        }
+
+        /**
+         * @brief Gets the directory of the program binary cache.
+         *
+         * Until a project sets the cache path, the binaries go to the engine cache in the user data directory, so the
+         * shaders built when the renderer starts are cached too. The binaries are keyed by the source and the driver,
+         * the projects can share them.
+         *
+         * @note Program binaries are driver specific, so they are kept loose and never packed into the archive.
+         * @return The path to the shader cache directory, or an empty path if there is no engine cache directory.
+         */
+        static std::filesystem::path GetShaderCachePath();
+
+        /**
+         * @brief Gets the engine cache directory, shared by every project.
+         * @return The path to the directory in the user data directory, or an empty path if it is not available.
+         */
+        static const std::filesystem::path& GetEngineCachePath();
+
+        /**
+         * @brief Gets the directory of the compiled script cache.
+         * @note The bytecode depends on the Lua version, it is kept loose like the program binaries.
+         * @return The path to the script cache directory inside the cache directory.
+         */
+        static std::filesystem::path GetScriptCachePath()
+        {
+            return m_cachePath / "Scripts";
+        }
+
+        /**
+         * @brief Gets the path of the cooked binary version of a scene.
+         * @param scenePath The path to the JSON scene file.
+         * @return The path to the .cscene file inside the cache directory.
+         */
+        static std::filesystem::path GetCookedScenePath(const std::filesystem::path& scenePath);
+
+        /**
+         * @brief Mounts a packed archive, cached resources are looked up in it before the loose files.
+         * @param path The path to the .cpak file.
+         * @return True if the archive was mounted.
+         */
+        static bool MountArchive(const std::filesystem::path& path);
+
+        /**
+         * @brief Unmounts the current packed archive, if any.
+         */
+        static void UnmountArchive();
+
+        /**
+         * @brief Gets the mounted packed archive.
+         * @return The mounted archive or nullptr if there is none.
+         */
+        static const Scope<ResourceArchive>& GetArchive()
+        {
+            return m_Archive;
+        }
+
+        /**
+         * @brief Checks if a cached resource is read from the mounted archive.
+         *
+         * A loose file written after the archive was packed is preferred, so a stale archive never shadows the
+         * resources imported again since.
+         *
+         * @param filename The name of the cached file, without extension.
+         * @return True if the resource is read from the archive, false if it is read from its loose file.
+         */
+        static bool IsInArchive(const std::string& filename);
+
+        /**
+         * @brief Packs every loose cache file into a packed archive.
+         * @param archivePath The path of the archive to write.
+         * @return True if the archive was written.
+         */
+        static bool PackCache(const std::filesystem::path& archivePath);
+
     private:
         static std::filesystem::path m_cachePath; ///< The path to the cache directory.
+        static std::filesystem::path m_EngineCachePath; ///< The engine cache directory, queried on first use.
+        static bool m_IsCachePathSet; ///< Whether the cache path was set by a project.
+        static Scope<ResourceArchive> m_Archive; ///< The mounted packed archive.
+        static std::filesystem::file_time_type m_ArchiveWriteTime; ///< When the mounted archive was packed.
     };
 
 }
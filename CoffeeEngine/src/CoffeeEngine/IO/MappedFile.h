@@ -0,0 +1,65 @@
+/**
+ * @defgroup io IO
+ * @brief IO components of the CoffeeEngine.
+ * @{
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace Coffee {
+
+    /**
+     * @brief Read only memory mapping of a whole file.
+     *
+     * The mapping outlives the file handle, so no handle stays open while the file is mapped.
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * @brief Maps a file, releasing the previous mapping.
+         * @param path The path to the file.
+         * @return True if the file was mapped, empty files can not be mapped.
+         */
+        bool Open(const std::filesystem::path& path);
+
+        /**
+         * @brief Releases the mapping.
+         */
+        void Close();
+
+        /**
+         * @brief Checks if a file is mapped.
+         * @return True if a file is mapped.
+         */
+        bool IsOpen() const { return m_Data != nullptr; }
+
+        /**
+         * @brief Gets the start of the mapping.
+         * @return The mapped bytes or nullptr if no file is mapped.
+         */
+        const char* GetData() const { return m_Data; }
+
+        /**
+         * @brief Gets the size of the mapping.
+         * @return The size of the mapped file in bytes.
+         */
+        uint64_t GetSize() const { return m_Size; }
+
+    private:
+        const char* m_Data = nullptr; ///< The start of the memory mapping.
+        uint64_t m_Size = 0; ///< The size of the memory mapping.
+    };
+
+}
+
+/** @} */
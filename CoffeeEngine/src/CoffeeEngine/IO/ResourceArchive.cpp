@@ -0,0 +1,355 @@
+#include "ResourceArchive.h"
+#include "CoffeeEngine/Core/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <lz4.h>
+#include <tracy/Tracy.hpp>
+
+namespace Coffee {
+
+    namespace
+    {
+        struct ArchiveHeader
+        {
+            uint32_t Magic;
+            uint32_t Version;
+            uint32_t EntryCount;
+            uint32_t Reserved;
+            uint64_t TocOffset;
+            uint64_t TocSize;
+        };
+
+        static_assert(sizeof(ArchiveHeader) == 32, "ArchiveHeader must be 32 bytes");
+
+        template<typename T>
+        void WriteValue(std::ofstream& file, const T& value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        bool ReadValue(const char*& cursor, const char* end, T& value)
+        {
+            if (end - cursor < (std::ptrdiff_t)sizeof(T))
+                return false;
+
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return true;
+        }
+
+        void WritePadding(std::ofstream& file, uint64_t alignment)
+        {
+            static const char zeros[ResourceArchive::Alignment] = {};
+            uint64_t position = (uint64_t)file.tellp();
+            uint64_t padding = (alignment - (position % alignment)) % alignment;
+            file.write(zeros, padding);
+        }
+    }
+
+    ArchiveEntryStream::ArchiveEntryStream(const char* data, size_t size) : std::istream(nullptr)
+    {
+        m_Buffer.Set(data, size);
+        rdbuf(&m_Buffer);
+    }
+
+    ArchiveEntryStream::ArchiveEntryStream(std::vector<char>&& data) : std::istream(nullptr), m_Storage(std::move(data))
+    {
+        m_Buffer.Set(m_Storage.data(), m_Storage.size());
+        rdbuf(&m_Buffer);
+    }
+
+    void ArchiveEntryStream::MemoryBuffer::Set(const char* data, size_t size)
+    {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+
+    std::streambuf::pos_type ArchiveEntryStream::MemoryBuffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+    {
+        char* target = nullptr;
+        switch (direction)
+        {
+            case std::ios_base::beg: target = eback() + offset; break;
+            case std::ios_base::cur: target = gptr() + offset; break;
+            case std::ios_base::end: target = egptr() + offset; break;
+            default: return pos_type(off_type(-1));
+        }
+
+        if (target < eback() || target > egptr())
+            return pos_type(off_type(-1));
+
+        setg(eback(), target, egptr());
+        return pos_type(target - eback());
+    }
+
+    std::streambuf::pos_type ArchiveEntryStream::MemoryBuffer::seekpos(pos_type position, std::ios_base::openmode which)
+    {
+        return seekoff(off_type(position), std::ios_base::beg, which);
+    }
+
+    ResourceArchive::~ResourceArchive()
+    {
+        Close();
+    }
+
+    bool ResourceArchive::Open(const std::filesystem::path& path)
+    {
+        ZoneScoped;
+
+        Close();
+
+        if (!m_File.Open(path))
+        {
+            COFFEE_CORE_ERROR("ResourceArchive::Open: Could not map archive {0}", path.string());
+            return false;
+        }
+
+        const char* data = m_File.GetData();
+        uint64_t size = m_File.GetSize();
+
+        const char* cursor = data;
+        const char* end = data + size;
+
+        ArchiveHeader header;
+        if (!ReadValue(cursor, end, header) || header.Magic != Magic)
+        {
+            COFFEE_CORE_ERROR("ResourceArchive::Open: {0} is not a resource archive", path.string());
+            Close();
+            return false;
+        }
+
+        if (header.Version != Version)
+        {
+            COFFEE_CORE_ERROR("ResourceArchive::Open: {0} has version {1}, expected {2}. Repack the cache.", path.string(), header.Version, Version);
+            Close();
+            return false;
+        }
+
+        if (header.TocOffset > size || header.TocSize > size - header.TocOffset)
+        {
+            COFFEE_CORE_ERROR("ResourceArchive::Open: {0} has a corrupt table of contents", path.string());
+            Close();
+            return false;
+        }
+
+        cursor = data + header.TocOffset;
+        end = cursor + header.TocSize;
+
+        m_Entries.reserve(header.EntryCount);
+        for (uint32_t i = 0; i < header.EntryCount; ++i)
+        {
+            ArchiveEntry entry;
+            uint32_t nameLength = 0;
+            uint32_t compression = 0;
+
+            bool valid = ReadValue(cursor, end, nameLength) &&
+                         ReadValue(cursor, end, compression) &&
+                         ReadValue(cursor, end, entry.Offset) &&
+                         ReadValue(cursor, end, entry.Size) &&
+                         ReadValue(cursor, end, entry.UncompressedSize) &&
+                         end - cursor >= (std::ptrdiff_t)nameLength;
+
+            if (!valid || entry.Offset > size || entry.Size > size - entry.Offset)
+            {
+                COFFEE_CORE_ERROR("ResourceArchive::Open: {0} has a corrupt entry at index {1}", path.string(), i);
+                Close();
+                return false;
+            }
+
+            entry.Name.assign(cursor, nameLength);
+            entry.Compression = static_cast<ArchiveCompression>(compression);
+            cursor += nameLength;
+
+            m_Entries.push_back(std::move(entry));
+        }
+
+        m_Path = path;
+
+        COFFEE_CORE_INFO("ResourceArchive: Mounted {0} ({1} entries, {2} bytes)", path.string(), m_Entries.size(), size);
+
+        return true;
+    }
+
+    void ResourceArchive::Close()
+    {
+        m_File.Close();
+        m_Entries.clear();
+        m_Path.clear();
+    }
+
+    const ArchiveEntry* ResourceArchive::Find(const std::string& name) const
+    {
+        auto it = std::lower_bound(m_Entries.begin(), m_Entries.end(), name,
+                                   [](const ArchiveEntry& entry, const std::string& value) { return entry.Name < value; });
+
+        if (it == m_Entries.end() || it->Name != name)
+            return nullptr;
+
+        return &(*it);
+    }
+
+    Scope<ArchiveEntryStream> ResourceArchive::OpenEntry(const std::string& name) const
+    {
+        ZoneScoped;
+
+        const ArchiveEntry* entry = Find(name);
+        if (!entry)
+            return nullptr;
+
+        const char* payload = m_File.GetData() + entry->Offset;
+
+        switch (entry->Compression)
+        {
+            using enum ArchiveCompression;
+        case None:
+            return CreateScope<ArchiveEntryStream>(payload, (size_t)entry->Size);
+        case LZ4:
+        {
+            std::vector<char> data(entry->UncompressedSize);
+            int decompressed = LZ4_decompress_safe(payload, data.data(), (int)entry->Size, (int)data.size());
+            if (decompressed < 0 || (uint64_t)decompressed != entry->UncompressedSize)
+            {
+                COFFEE_CORE_ERROR("ResourceArchive::OpenEntry: Failed to decompress {0} from {1}", name, m_Path.string());
+                return nullptr;
+            }
+            return CreateScope<ArchiveEntryStream>(std::move(data));
+        }
+        default:
+            COFFEE_CORE_ERROR("ResourceArchive::OpenEntry: Unknown compression for {0} in {1}", name, m_Path.string());
+            return nullptr;
+        }
+    }
+
+    bool ResourceArchive::Pack(const std::filesystem::path& sourceDirectory, const std::filesystem::path& archivePath, ArchiveCompression compression)
+    {
+        ZoneScoped;
+
+        if (!std::filesystem::is_directory(sourceDirectory))
+        {
+            COFFEE_CORE_ERROR("ResourceArchive::Pack: {0} is not a directory", sourceDirectory.string());
+            return false;
+        }
+
+        std::vector<std::filesystem::path> files;
+        for (const auto& directoryEntry : std::filesystem::recursive_directory_iterator(sourceDirectory))
+        {
+            if (directoryEntry.is_regular_file() && directoryEntry.path().extension() == ".res")
+            {
+                files.push_back(directoryEntry.path());
+            }
+        }
+
+        std::vector<ArchiveEntry> entries;
+        entries.reserve(files.size());
+
+        std::ofstream archive(archivePath, std::ios::binary | std::ios::trunc);
+        if (!archive)
+        {
+            COFFEE_CORE_ERROR("ResourceArchive::Pack: Could not create {0}", archivePath.string());
+            return false;
+        }
+
+        ArchiveHeader header{};
+        WriteValue(archive, header);
+
+        uint64_t rawBytes = 0;
+        std::vector<char> data;
+        std::vector<char> compressed;
+
+        for (const std::filesystem::path& file : files)
+        {
+            std::ifstream input(file, std::ios::binary | std::ios::ate);
+            std::streamoff size = input ? (std::streamoff)input.tellg() : -1;
+            if (size < 0)
+            {
+                COFFEE_CORE_WARN("ResourceArchive::Pack: Could not read {0}, it is left out of the archive", file.string());
+                continue;
+            }
+
+            data.resize((size_t)size);
+            input.seekg(0);
+            if (!input.read(data.data(), (std::streamsize)data.size()))
+            {
+                COFFEE_CORE_WARN("ResourceArchive::Pack: Could not read {0}, it is left out of the archive", file.string());
+                continue;
+            }
+
+            ArchiveEntry entry;
+            entry.Name = file.stem().string();
+            entry.UncompressedSize = data.size();
+            rawBytes += data.size();
+
+            const char* payload = data.data();
+            uint64_t payloadSize = data.size();
+
+            if (compression == ArchiveCompression::LZ4 && !data.empty())
+            {
+                compressed.resize(LZ4_compressBound((int)data.size()));
+                int compressedSize = LZ4_compress_default(data.data(), compressed.data(), (int)data.size(), (int)compressed.size());
+
+                // Only keep the compressed payload when it is worth the decompression on load.
+                if (compressedSize > 0 && (uint64_t)compressedSize < data.size() - data.size() / 8)
+                {
+                    entry.Compression = ArchiveCompression::LZ4;
+                    payload = compressed.data();
+                    payloadSize = (uint64_t)compressedSize;
+                }
+            }
+
+            if (entry.Compression == ArchiveCompression::None)
+            {
+                WritePadding(archive, Alignment);
+            }
+
+            entry.Offset = (uint64_t)archive.tellp();
+            entry.Size = payloadSize;
+            archive.write(payload, (std::streamsize)payloadSize);
+
+            entries.push_back(std::move(entry));
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const ArchiveEntry& a, const ArchiveEntry& b) { return a.Name < b.Name; });
+
+        auto duplicate = std::adjacent_find(entries.begin(), entries.end(), [](const ArchiveEntry& a, const ArchiveEntry& b) { return a.Name == b.Name; });
+        if (duplicate != entries.end())
+        {
+            COFFEE_CORE_WARN("ResourceArchive::Pack: Duplicate entry {0}, only the first one will be reachable", duplicate->Name);
+        }
+
+        header.Magic = Magic;
+        header.Version = Version;
+        header.EntryCount = (uint32_t)entries.size();
+        header.TocOffset = (uint64_t)archive.tellp();
+
+        for (const ArchiveEntry& entry : entries)
+        {
+            WriteValue(archive, (uint32_t)entry.Name.size());
+            WriteValue(archive, (uint32_t)entry.Compression);
+            WriteValue(archive, entry.Offset);
+            WriteValue(archive, entry.Size);
+            WriteValue(archive, entry.UncompressedSize);
+            archive.write(entry.Name.data(), (std::streamsize)entry.Name.size());
+        }
+
+        uint64_t archiveSize = (uint64_t)archive.tellp();
+        header.TocSize = archiveSize - header.TocOffset;
+
+        archive.seekp(0);
+        WriteValue(archive, header);
+        archive.close();
+
+        if (!archive)
+        {
+            COFFEE_CORE_ERROR("ResourceArchive::Pack: Failed writing {0}", archivePath.string());
+            return false;
+        }
+
+        COFFEE_CORE_INFO("ResourceArchive: Packed {0} resources into {1} ({2} bytes -> {3} bytes)", entries.size(), archivePath.string(), rawBytes, archiveSize);
+
+        return true;
+    }
+
+}
@@ -0,0 +1,158 @@
+/**
+ * @defgroup io IO
+ * @brief IO components of the CoffeeEngine.
+ * @{
+ */
+
+#pragma once
+
+#include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/IO/MappedFile.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @brief Compression applied to a single entry of a resource archive.
+     */
+    enum class ArchiveCompression : uint32_t
+    {
+        None = 0, ///< The payload is stored raw and 4K aligned so it can be read straight from the mapping.
+        LZ4 = 1   ///< The payload is LZ4 compressed and has to be decompressed before use.
+    };
+
+    /**
+     * @brief Entry of the table of contents of a resource archive.
+     */
+    struct ArchiveEntry
+    {
+        std::string Name; ///< The cache name of the resource (the same name used for the loose .res file).
+        uint64_t Offset = 0; ///< The offset of the payload from the start of the archive.
+        uint64_t Size = 0; ///< The size of the stored payload.
+        uint64_t UncompressedSize = 0; ///< The size of the payload once decompressed.
+        ArchiveCompression Compression = ArchiveCompression::None; ///< The compression of the payload.
+    };
+
+    /**
+     * @brief Read only view of an archive entry, exposed as a std::istream.
+     *
+     * Uncompressed entries point straight into the memory mapping of the archive,
+     * compressed entries own the decompressed bytes.
+     */
+    class ArchiveEntryStream : public std::istream
+    {
+    public:
+        ArchiveEntryStream(const char* data, size_t size);
+        ArchiveEntryStream(std::vector<char>&& data);
+
+    private:
+        struct MemoryBuffer : public std::streambuf
+        {
+            void Set(const char* data, size_t size);
+        protected:
+            pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+            pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+        };
+
+        std::vector<char> m_Storage; ///< The decompressed payload, empty for mapped entries.
+        MemoryBuffer m_Buffer;
+    };
+
+    /**
+     * @brief Packed resource archive (.cpak) used by shipping builds instead of the loose cache files.
+     *
+     * Layout: a fixed header, the payloads (uncompressed ones aligned to 4K) and a table of
+     * contents sorted by name at the end of the file. The whole archive is memory mapped when
+     * opened, so looking up and reading a resource does not open any file.
+     */
+    class ResourceArchive
+    {
+    public:
+        static constexpr uint32_t Magic = 0x4B415043; ///< "CPAK" in little endian.
+        static constexpr uint32_t Version = 1; ///< The current version of the archive format.
+        static constexpr uint64_t Alignment = 4096; ///< Alignment of the uncompressed payloads.
+
+        ResourceArchive() = default;
+        ~ResourceArchive();
+
+        ResourceArchive(const ResourceArchive&) = delete;
+        ResourceArchive& operator=(const ResourceArchive&) = delete;
+
+        /**
+         * @brief Opens and maps an archive.
+         * @param path The path to the .cpak file.
+         * @return True if the archive was opened successfully.
+         */
+        bool Open(const std::filesystem::path& path);
+
+        /**
+         * @brief Closes the archive and releases the mapping.
+         */
+        void Close();
+
+        /**
+         * @brief Checks if the archive is open.
+         * @return True if the archive is open.
+         */
+        bool IsOpen() const { return m_File.IsOpen(); }
+
+        /**
+         * @brief Checks if the archive contains an entry.
+         * @param name The cache name of the resource.
+         * @return True if the entry exists.
+         */
+        bool Contains(const std::string& name) const { return Find(name) != nullptr; }
+
+        /**
+         * @brief Finds an entry by name using a binary search over the sorted table of contents.
+         * @param name The cache name of the resource.
+         * @return A pointer to the entry or nullptr if it does not exist.
+         */
+        const ArchiveEntry* Find(const std::string& name) const;
+
+        /**
+         * @brief Opens an entry for reading.
+         * @param name The cache name of the resource.
+         * @return A stream over the entry payload or nullptr if the entry does not exist or is corrupt.
+         */
+        Scope<ArchiveEntryStream> OpenEntry(const std::string& name) const;
+
+        /**
+         * @brief Gets the table of contents of the archive.
+         * @return The entries sorted by name.
+         */
+        const std::vector<ArchiveEntry>& GetEntries() const { return m_Entries; }
+
+        /**
+         * @brief Gets the path of the opened archive.
+         * @return The path of the archive.
+         */
+        const std::filesystem::path& GetPath() const { return m_Path; }
+
+        /**
+         * @brief Packs every .res file of a directory into an archive.
+         *
+         * Each entry is LZ4 compressed when it saves space, otherwise it is stored raw and aligned.
+         *
+         * @param sourceDirectory The directory to walk, usually CacheManager::GetCachePath().
+         * @param archivePath The path of the archive to write.
+         * @param compression The compression to try on each entry.
+         * @return True if the archive was written successfully.
+         */
+        static bool Pack(const std::filesystem::path& sourceDirectory, const std::filesystem::path& archivePath, ArchiveCompression compression = ArchiveCompression::LZ4);
+
+    private:
+        std::filesystem::path m_Path; ///< The path of the opened archive.
+        std::vector<ArchiveEntry> m_Entries; ///< The table of contents sorted by name.
+
+        MappedFile m_File; ///< The memory mapping of the archive.
+    };
+
+}
+
+/** @} */
@@ -3,6 +3,9 @@
 #include "CoffeeEngine/Renderer/Texture.h"
 #include "ResourceSaver.h"
 #include "CoffeeEngine/IO/CacheManager.h"
+#include "CoffeeEngine/IO/ResourceArchive.h"
+#include "CoffeeEngine/IO/ResourceRegistry.h"
+#include "CoffeeEngine/Renderer/TextureCompressor.h"
 #include "CoffeeEngine/Renderer/Model.h"
 #include "CoffeeEngine/Renderer/Mesh.h"
 #include "CoffeeEngine/Renderer/Material.h"
@@ -11,41 +14,90 @@
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <tracy/Tracy.hpp>
 
 namespace Coffee {
 
-    Ref<Texture2D> ResourceImporter::ImportTexture2D(const std::filesystem::path& path, const UUID& uuid, bool srgb, bool cache)
+    Ref<Texture2D> ResourceImporter::ImportTexture2D(const std::filesystem::path& path, const UUID& uuid, bool srgb, bool cache, TextureUsage usage)
     {
         if (!cache)
         {
             return CreateRef<Texture2D>(path, srgb);
         }
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(std::to_string(uuid));
+        std::string uuidString = std::to_string(uuid);
 
-        if (std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Texture2D>(resource);
         }
         else
         {
             COFFEE_WARN("ResourceImporter::ImportTexture2D: Texture2D {0} not found in cache. Creating new texture.", path.string());
-            Ref<Texture2D> texture = CreateRef<Texture2D>(path, srgb);
-            ResourceSaver::SaveToCache(std::to_string(uuid), texture); //TODO: Add the UUID to the cache filename
+
+            TextureImage image;
+            if (!TextureCompressor::DecodeImage(path, image))
+            {
+                return nullptr;
+            }
+
+            // The same image imported from another path reuses the loaded texture and its cache payload, once the
+            // size and the pixel digest confirm the content hash match
+            uint64_t contentHash = TextureCompressor::GetContentHash(image, srgb, usage);
+            if (ResourceRegistry::ExistsContentHash(contentHash))
+            {
+                Ref<Texture2D> duplicate = ResourceRegistry::Get<Texture2D>(ResourceRegistry::GetUUIDByContentHash(contentHash));
+                if (duplicate->IsSameContent(image))
+                {
+                    // Cached for this UUID too, so the next sessions load it instead of decoding the image again
+                    ResourceSaver::SaveToCache(uuidString, duplicate);
+                    return duplicate;
+                }
+
+                COFFEE_CORE_WARN("ResourceImporter::ImportTexture2D: {0} has the content hash of {1} but other pixels, it is imported on its own.", path.string(), duplicate->GetName());
+            }
+
+            Ref<Texture2D> texture = CreateRef<Texture2D>(path, image, srgb, usage);
+            ResourceSaver::SaveToCache(uuidString, texture); //TODO: Add the UUID to the cache filename
             return texture;
         }
     }
 
-    Ref<Texture2D> ResourceImporter::ImportTexture2D(const UUID& uuid)
+    Ref<Texture2D> ResourceImporter::ImportTexture2D(const std::string& name, const UUID& uuid, const TextureImage& image, bool srgb, TextureUsage usage)
     {
         std::string uuidString = std::to_string(uuid);
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(uuidString);
+        if (IsCached(uuidString))
+        {
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
+            Ref<Texture2D> texture = std::static_pointer_cast<Texture2D>(resource);
+
+            // The UUID comes from the content hash, the payload of another image with the same hash is not reused
+            if (texture && texture->IsSameContent(image))
+            {
+                return texture;
+            }
+
+            COFFEE_CORE_WARN("ResourceImporter::ImportTexture2D: The cached texture {0} has other pixels than {1}, it is not cached.", uuidString, name);
+            return CreateRef<Texture2D>(name, image, srgb, usage);
+        }
+        else
+        {
+            COFFEE_WARN("ResourceImporter::ImportTexture2D: Texture2D {0} not found in cache. Creating new texture.", name);
+            Ref<Texture2D> texture = CreateRef<Texture2D>(name, image, srgb, usage);
+            ResourceSaver::SaveToCache(uuidString, texture);
+            return texture;
+        }
+    }
+
+    Ref<Texture2D> ResourceImporter::ImportTexture2D(const UUID& uuid)
+    {
+        std::string uuidString = std::to_string(uuid);
 
-        if(std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Texture2D>(resource);
         }
         else
@@ -57,18 +109,18 @@ namespace Coffee {
 
     Ref<Cubemap> ResourceImporter::ImportCubemap(const std::filesystem::path& path, const UUID& uuid)
     {
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(std::to_string(uuid));
+        std::string uuidString = std::to_string(uuid);
 
-        if (std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Cubemap>(resource);
         }
         else
         {
             COFFEE_WARN("ResourceImporter::ImportCubemap: Cubemap {0} not found in cache. Creating new cubemap.", path.string());
             Ref<Cubemap> cubemap = CreateRef<Cubemap>(path);
-            ResourceSaver::SaveToCache(std::to_string(uuid), cubemap);
+            ResourceSaver::SaveToCache(uuidString, cubemap);
             return cubemap;
         }
     }
@@ -76,11 +128,9 @@ namespace Coffee {
     {
         std::string uuidString = std::to_string(uuid);
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(uuidString);
-
-        if(std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Cubemap>(resource);
         }
         else
@@ -97,11 +147,11 @@ namespace Coffee {
             return CreateRef<Model>(path);
         }
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(path.filename().string());
+        std::string cacheName = path.filename().string();
 
-        if (std::filesystem::exists(cachedFilePath))
+        if (IsCached(cacheName))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(cacheName, ResourceFormat::Binary);
             return std::static_pointer_cast<Model>(resource);
         }
         else
@@ -119,11 +169,9 @@ namespace Coffee {
 
         std::string uuidString = std::to_string(uuid);
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(uuidString);
-
-        if(std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Mesh>(resource);
         }
         else
@@ -143,11 +191,9 @@ namespace Coffee {
     {
         std::string uuidString = std::to_string(uuid);
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(uuidString);
-
-        if(std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Mesh>(resource);
         }
         else
@@ -161,11 +207,9 @@ namespace Coffee {
     {
         std::string uuidString = std::to_string(uuid);
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(uuidString);
-
-        if(std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Material>(resource);
         }
         else
@@ -183,11 +227,9 @@ namespace Coffee {
     {
         std::string uuidString = std::to_string(uuid);
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(uuidString);
-
-        if(std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Material>(resource);
         }
         else
@@ -205,11 +247,9 @@ namespace Coffee {
     {
         std::string uuidString = std::to_string(uuid);
 
-        std::filesystem::path cachedFilePath = CacheManager::GetCachedFilePath(uuidString);
-
-        if(std::filesystem::exists(cachedFilePath))
+        if (IsCached(uuidString))
         {
-            const Ref<Resource>& resource = LoadFromCache(cachedFilePath, ResourceFormat::Binary);
+            const Ref<Resource>& resource = LoadFromCache(uuidString, ResourceFormat::Binary);
             return std::static_pointer_cast<Material>(resource);
         }
         else
@@ -219,33 +259,59 @@ namespace Coffee {
         }
     }
 
-    Ref<Resource> ResourceImporter::LoadFromCache(const std::filesystem::path& path, ResourceFormat format)
+    bool ResourceImporter::IsCached(const std::string& name)
+    {
+        if (CacheManager::IsInArchive(name))
         {
-            COFFEE_INFO("Loading resource from cache: {0}", path.string());
-            switch (format)
+            return true;
+        }
+
+        return std::filesystem::exists(CacheManager::GetCachedFilePath(name));
+    }
+
+    Ref<Resource> ResourceImporter::LoadFromCache(const std::string& name, ResourceFormat format)
+    {
+        ZoneScoped;
+
+        if (CacheManager::IsInArchive(name))
+        {
+            Scope<ArchiveEntryStream> stream = CacheManager::GetArchive()->OpenEntry(name);
+            if (stream)
             {
-                case ResourceFormat::Binary:
-                    return BinaryDeserialization(path);
-                    break;
-                case ResourceFormat::JSON:
-                    return JSONDeserialization(path);
-                    break;
+                return Deserialize(*stream, format);
             }
         }
 
-    Ref<Resource> ResourceImporter::BinaryDeserialization(const std::filesystem::path& path)
+        std::filesystem::path path = CacheManager::GetCachedFilePath(name);
+        COFFEE_INFO("Loading resource from cache: {0}", path.string());
+
+        std::ifstream file(path, format == ResourceFormat::Binary ? std::ios::binary : std::ios::in);
+        return Deserialize(file, format);
+    }
+
+    Ref<Resource> ResourceImporter::Deserialize(std::istream& stream, ResourceFormat format)
+    {
+        switch (format)
+        {
+            case ResourceFormat::Binary:
+                return BinaryDeserialization(stream);
+            case ResourceFormat::JSON:
+                return JSONDeserialization(stream);
+        }
+        return nullptr;
+    }
+
+    Ref<Resource> ResourceImporter::BinaryDeserialization(std::istream& stream)
     {
-        std::ifstream file(path, std::ios::binary);
-        cereal::BinaryInputArchive archive(file);
+        cereal::BinaryInputArchive archive(stream);
         Ref<Resource> resource;
         archive(resource);
         return resource;
     }
 
-    Ref<Resource> ResourceImporter::JSONDeserialization(const std::filesystem::path& path)
+    Ref<Resource> ResourceImporter::JSONDeserialization(std::istream& stream)
     {
-        std::ifstream file(path);
-        cereal::JSONInputArchive archive(file);
+        cereal::JSONInputArchive archive(stream);
         Ref<Resource> resource;
         archive(resource);
         return resource;
@@ -13,6 +13,7 @@
 #include "CoffeeEngine/Renderer/Texture.h"
 #include <cereal/archives/binary.hpp>
 #include <cereal/archives/json.hpp>
+#include <istream>
 #include <string>
 
 namespace Coffee {
@@ -25,6 +26,7 @@ namespace Coffee {
     struct MaterialTextures;
     class Texture;
     class Texture2D;
+    struct TextureImage;
 
     /**
      * @class ResourceImporter
@@ -37,10 +39,21 @@ namespace Coffee {
          * @brief Imports a texture from a given file path.
          * @param path The file path of the texture to import.
          * @param srgb Whether the texture should be imported in sRGB format.
-         * @param cache Whether the texture should be cached.
+         * @param cache Whether the texture should be cached. Cached textures are block compressed with a precomputed mip chain.
+         * @param usage How the material uses the texture channels, it selects the block compression.
+         * @return A reference to the imported texture, or the already loaded texture with the same content. nullptr if the image could not be decoded.
+         */
+        Ref<Texture2D> ImportTexture2D(const std::filesystem::path& path, const UUID& uuid, bool srgb, bool cache, TextureUsage usage = TextureUsage::Color);
+        /**
+         * @brief Imports a texture from an already decoded image, used for the textures embedded in models.
+         * @param name The name of the texture.
+         * @param uuid The UUID of the texture.
+         * @param image The decoded image.
+         * @param srgb Whether the texture should be imported in sRGB format.
+         * @param usage How the material uses the texture channels, it selects the block compression.
          * @return A reference to the imported texture.
          */
-        Ref<Texture2D> ImportTexture2D(const std::filesystem::path& path, const UUID& uuid, bool srgb, bool cache);
+        Ref<Texture2D> ImportTexture2D(const std::string& name, const UUID& uuid, const TextureImage& image, bool srgb, TextureUsage usage);
         Ref<Texture2D> ImportTexture2D(const UUID& uuid);
         Ref<Cubemap> ImportCubemap(const std::filesystem::path& path, const UUID& uuid);
         Ref<Cubemap> ImportCubemap(const UUID& uuid);
@@ -52,27 +65,45 @@ namespace Coffee {
         Ref<Material> ImportMaterial(const std::string& name, const UUID& uuid, MaterialTextures& materialTextures);
         Ref<Material> ImportMaterial(const UUID& uuid);
     private:
+        /**
+         * @brief Checks if a resource is cached, either in the mounted archive or as a loose file.
+         * @param name The cache name of the resource.
+         * @return True if the resource can be loaded from the cache.
+         */
+        bool IsCached(const std::string& name);
+
         /**
          * @brief Loads a resource from the cache.
-         * @param path The file path of the resource to load.
+         *
+         * The mounted archive is used when it contains the resource, otherwise the loose .res file is read.
+         *
+         * @param name The cache name of the resource.
          * @param format The format of the resource.
          * @return A reference to the loaded resource.
          */
-        Ref<Resource> LoadFromCache(const std::filesystem::path& path, ResourceFormat format);
+        Ref<Resource> LoadFromCache(const std::string& name, ResourceFormat format);
+
+        /**
+         * @brief Deserializes a resource from a stream.
+         * @param stream The stream to read from.
+         * @param format The format of the resource.
+         * @return A reference to the deserialized resource.
+         */
+        Ref<Resource> Deserialize(std::istream& stream, ResourceFormat format);
 
         /**
-         * @brief Deserializes a resource from a binary file.
-         * @param path The file path of the binary file.
+         * @brief Deserializes a resource from a binary stream.
+         * @param stream The binary stream.
          * @return A reference to the deserialized resource.
          */
-        Ref<Resource> BinaryDeserialization(const std::filesystem::path& path);
+        Ref<Resource> BinaryDeserialization(std::istream& stream);
 
         /**
-         * @brief Deserializes a resource from a JSON file.
-         * @param path The file path of the JSON file.
+         * @brief Deserializes a resource from a JSON stream.
+         * @param stream The JSON stream.
          * @return A reference to the deserialized resource.
          */
-        Ref<Resource> JSONDeserialization(const std::filesystem::path& path);
+        Ref<Resource> JSONDeserialization(std::istream& stream);
     };
 }
 
@@ -1,12 +1,14 @@
 #include "ResourceLoader.h"
 #include "CoffeeEngine/Core/Base.h"
 #include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/Core/Hash.h"
 #include "CoffeeEngine/IO/CacheManager.h"
 #include "CoffeeEngine/IO/Resource.h"
 #include "CoffeeEngine/Renderer/Material.h"
 #include "CoffeeEngine/Renderer/Model.h"
 #include "CoffeeEngine/Renderer/Shader.h"
 #include "CoffeeEngine/Renderer/Texture.h"
+#include "CoffeeEngine/Renderer/TextureCompressor.h"
 #include "CoffeeEngine/IO/ResourceRegistry.h"
 #include "CoffeeEngine/IO/ResourceImporter.h"
 #include "CoffeeEngine/IO/ResourceUtils.h"
@@ -18,6 +20,7 @@ namespace Coffee {
 
     std::filesystem::path ResourceLoader::s_WorkingDirectory = std::filesystem::current_path();
     ResourceImporter ResourceLoader::s_Importer = ResourceImporter();
+    ResourceDeduplicationStats ResourceLoader::s_DeduplicationStats;
 
     void ResourceLoader::LoadFile(const std::filesystem::path& path)
     {
@@ -98,7 +101,7 @@ namespace Coffee {
         }
     }
 
-    Ref<Texture2D> ResourceLoader::LoadTexture2D(const std::filesystem::path& path, bool srgb, bool cache)
+    Ref<Texture2D> ResourceLoader::LoadTexture2D(const std::filesystem::path& path, bool srgb, bool cache, TextureUsage usage)
     {
         if(GetResourceTypeFromExtension(path) != ResourceType::Texture2D)
         {
@@ -113,10 +116,58 @@ namespace Coffee {
             return ResourceRegistry::Get<Texture2D>(uuid);
         }
 
-        const Ref<Texture2D>& texture = s_Importer.ImportTexture2D(path, uuid, srgb, cache);
+        const Ref<Texture2D>& texture = s_Importer.ImportTexture2D(path, uuid, srgb, cache, usage);
+
+        if (!texture)
+        {
+            return nullptr;
+        }
+
+        if (Ref<Texture2D> shared = FindSharedTexture(uuid, texture))
+        {
+            // The import file keeps its UUID, registered as an alias of the shared texture so the next loads of the
+            // path find it in the registry
+            ResourceRegistry::Add(uuid, shared);
+            AddDuplicate(path.string(), shared);
+            return shared;
+        }
+
+        texture->SetUUID(uuid);
+
+        ResourceRegistry::Add(uuid, texture);
+        if (texture->GetContentHash() != 0)
+        {
+            ResourceRegistry::AddContentHash(texture->GetContentHash(), uuid);
+        }
+        return texture;
+    }
+
+    Ref<Texture2D> ResourceLoader::LoadTexture2D(const std::string& name, const TextureImage& image, bool srgb, TextureUsage usage)
+    {
+        uint64_t contentHash = TextureCompressor::GetContentHash(image, srgb, usage);
+
+        // Embedded textures have no import file, the UUID comes from the content so every model embedding the image shares the cache payload
+        UUID uuid = contentHash;
+
+        if (ResourceRegistry::ExistsContentHash(contentHash))
+        {
+            const Ref<Texture2D>& texture = ResourceRegistry::Get<Texture2D>(ResourceRegistry::GetUUIDByContentHash(contentHash));
+            if (texture->IsSameContent(image))
+            {
+                AddDuplicate(name, texture);
+                return texture;
+            }
+
+            // Another image with the same content hash, the digest tells the two apart in the cache too
+            COFFEE_CORE_WARN("ResourceLoader::LoadTexture2D: {0} has the content hash of {1} but other pixels, it is imported on its own.", name, texture->GetName());
+            uuid = Hash::Value(image.PixelDigest, contentHash);
+        }
+
+        const Ref<Texture2D>& texture = s_Importer.ImportTexture2D(name, uuid, image, srgb, usage);
         texture->SetUUID(uuid);
 
         ResourceRegistry::Add(uuid, texture);
+        ResourceRegistry::AddContentHash(contentHash, uuid);
         return texture;
     }
 
@@ -132,7 +183,23 @@ namespace Coffee {
 
         const Ref<Texture2D>& texture = s_Importer.ImportTexture2D(uuid);
 
+        if (!texture)
+        {
+            return nullptr;
+        }
+
+        if (Ref<Texture2D> shared = FindSharedTexture(uuid, texture))
+        {
+            ResourceRegistry::Add(uuid, shared);
+            AddDuplicate(std::to_string(uuid), shared);
+            return shared;
+        }
+
         ResourceRegistry::Add(uuid, texture);
+        if (texture->GetContentHash() != 0)
+        {
+            ResourceRegistry::AddContentHash(texture->GetContentHash(), uuid);
+        }
         return texture;
     }
 
@@ -409,6 +476,36 @@ namespace Coffee {
         return importData;
     }
 
+    Ref<Texture2D> ResourceLoader::FindSharedTexture(UUID uuid, const Ref<Texture2D>& texture)
+    {
+        // The importer returned the texture registered for the same pixels
+        if (texture->GetUUID() != uuid && ResourceRegistry::Exists(texture->GetUUID()))
+        {
+            return ResourceRegistry::Get<Texture2D>(texture->GetUUID());
+        }
+
+        // A duplicate cached in an earlier session, its payload is dropped for the one already loaded
+        if (texture->GetContentHash() != 0 && ResourceRegistry::ExistsContentHash(texture->GetContentHash()))
+        {
+            Ref<Texture2D> candidate = ResourceRegistry::Get<Texture2D>(ResourceRegistry::GetUUIDByContentHash(texture->GetContentHash()));
+            if (candidate != texture && candidate->IsSameContent(*texture))
+            {
+                return candidate;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void ResourceLoader::AddDuplicate(const std::string& name, const Ref<Texture2D>& texture)
+    {
+        s_DeduplicationStats.DuplicateTextures++;
+        s_DeduplicationStats.BytesSaved += texture->GetDataSize();
+
+        COFFEE_CORE_INFO("ResourceLoader::LoadTexture2D: {0} has the same content as {1}, reusing it ({2} KB saved, {3} KB in total)",
+                         name, texture->GetName(), texture->GetDataSize() / 1024, s_DeduplicationStats.BytesSaved / 1024);
+    }
+
     UUID ResourceLoader::GetUUIDFromImportFile(const std::filesystem::path& path)
     {
         ImportData importData = GetImportData(path);
@@ -20,6 +20,16 @@ namespace Coffee {
     class Material;
     class Texture;
     class Texture2D;
+    struct TextureImage;
+
+    /**
+     * @brief Structure containing the statistics of the texture deduplication of the current project.
+     */
+    struct ResourceDeduplicationStats
+    {
+        uint32_t DuplicateTextures = 0; ///< Number of texture loads served by a texture with the same content.
+        uint64_t BytesSaved = 0; ///< Texture data not imported, cached nor uploaded thanks to the deduplication.
+    };
 
     /**
      * @class ResourceLoader
@@ -44,10 +54,21 @@ namespace Coffee {
          * @brief Loads a texture from a file.
          * @param path The file path of the texture to load.
          * @param srgb Whether the texture should be loaded in sRGB format.
-         * @param cache Whether the texture should be cached.
-         * @return A reference to the loaded texture.
+         * @param cache Whether the texture should be cached. Cached textures are imported as a block compressed mip chain.
+         * @param usage How the material uses the texture channels, it selects the block compression.
+         * @return A reference to the loaded texture. Images with the same content as a loaded texture return that texture.
+         */
+        static Ref<Texture2D> LoadTexture2D(const std::filesystem::path& path, bool srgb = true, bool cache = true, TextureUsage usage = TextureUsage::Color);
+
+        /**
+         * @brief Loads a texture from a decoded image, used for the textures embedded in models.
+         * @param name The name of the texture.
+         * @param image The decoded image.
+         * @param srgb Whether the texture should be loaded in sRGB format.
+         * @param usage How the material uses the texture channels, it selects the block compression.
+         * @return A reference to the loaded texture, shared with any texture of the same content.
          */
-        static Ref<Texture2D> LoadTexture2D(const std::filesystem::path& path, bool srgb = true, bool cache = true);
+        static Ref<Texture2D> LoadTexture2D(const std::string& name, const TextureImage& image, bool srgb, TextureUsage usage);
         static Ref<Texture2D> LoadTexture2D(UUID uuid);
 
         static Ref<Cubemap> LoadCubemap(const std::filesystem::path& path);
@@ -75,6 +96,17 @@ namespace Coffee {
         static void RemoveResource(const std::filesystem::path& path);
 
         static void SetWorkingDirectory(const std::filesystem::path& path) { s_WorkingDirectory = path; }
+
+        /**
+         * @brief Gets the texture deduplication statistics of the current project.
+         * @return A reference to the statistics.
+         */
+        static const ResourceDeduplicationStats& GetDeduplicationStats() { return s_DeduplicationStats; }
+
+        /**
+         * @brief Resets the texture deduplication statistics, called when a project is opened.
+         */
+        static void ResetDeduplicationStats() { s_DeduplicationStats = {}; }
     private:
         struct ImportData
         {
@@ -93,9 +125,18 @@ namespace Coffee {
 
         static UUID GetUUIDFromImportFile(const std::filesystem::path& path);
         static std::filesystem::path GetPathFromImportFile(const std::filesystem::path& path);
+
+        /**
+         * @brief Finds the texture already loaded with the same content as a texture loaded under another UUID,
+         * imported from another path or cached for it in an earlier session.
+         * @return The shared texture, or nullptr if the texture is not a duplicate.
+         */
+        static Ref<Texture2D> FindSharedTexture(UUID uuid, const Ref<Texture2D>& texture);
+        static void AddDuplicate(const std::string& name, const Ref<Texture2D>& texture);
     private:
         static std::filesystem::path s_WorkingDirectory; ///< The working directory of the resource loader.
         static ResourceImporter s_Importer; ///< The importer used to load resources.
+        static ResourceDeduplicationStats s_DeduplicationStats; ///< The texture deduplication statistics of the current project.
     };
 
 }
@@ -5,5 +5,6 @@ namespace Coffee {
 
     std::unordered_map<UUID, Ref<Resource>> ResourceRegistry::m_Resources;
     std::unordered_map<std::string, UUID> ResourceRegistry::m_NameToUUID;
+    std::unordered_map<uint64_t, UUID> ResourceRegistry::m_ContentHashToUUID;
 
 } // namespace Coffee
\ No newline at end of file
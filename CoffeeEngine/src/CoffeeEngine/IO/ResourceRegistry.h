@@ -88,9 +88,30 @@ namespace Coffee {
             {
                 m_NameToUUID.erase(m_Resources[uuid]->GetName());
                 m_Resources.erase(uuid);
+                std::erase_if(m_ContentHashToUUID, [uuid](const auto& entry) { return entry.second == uuid; });
             }
         }
 
+        /**
+         * @brief Registers the content hash of a resource, so imports with the same content reuse it.
+         * @param contentHash The content hash of the resource.
+         * @param uuid The UUID of the resource.
+         */
+        static void AddContentHash(uint64_t contentHash, UUID uuid) { m_ContentHashToUUID.try_emplace(contentHash, uuid); }
+
+        /**
+         * @brief Checks if a resource with the given content is registered.
+         * @param contentHash The content hash of the resource.
+         * @return True if a resource with the same content exists, false otherwise.
+         */
+        static bool ExistsContentHash(uint64_t contentHash)
+        {
+            auto it = m_ContentHashToUUID.find(contentHash);
+            return it != m_ContentHashToUUID.end() && Exists(it->second);
+        }
+
+        static UUID GetUUIDByContentHash(uint64_t contentHash) { return m_ContentHashToUUID[contentHash]; }
+
         /**
          * @brief Clears all resources from the registry.
          */
@@ -98,6 +119,7 @@ namespace Coffee {
         {
             m_Resources.clear();
             m_NameToUUID.clear();
+            m_ContentHashToUUID.clear();
         }
 
         static UUID GetUUIDByName(const std::string& name) { return m_NameToUUID[name]; }
@@ -111,6 +133,7 @@ namespace Coffee {
     private:
         static std::unordered_map<UUID, Ref<Resource>> m_Resources; ///< The resource registry.
         static std::unordered_map<std::string, UUID> m_NameToUUID; ///< The mapping of resource names to UUIDs.
+        static std::unordered_map<uint64_t, UUID> m_ContentHashToUUID; ///< The mapping of content hashes to the UUID of the first resource imported with that content.
     };
 
 }
@@ -52,6 +52,7 @@ namespace Coffee
     }
     void ResourceSaver::SaveToCache(const std::string& filename, const Ref<Resource>& resource)
     {
+        CacheManager::CreateCacheDirectory();
         std::filesystem::path cacheFilePath = CacheManager::GetCachedFilePath(filename);
 
         Save(cacheFilePath, resource);
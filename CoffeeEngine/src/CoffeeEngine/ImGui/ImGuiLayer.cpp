@@ -2,6 +2,8 @@
 
 #include "CoffeeEngine/Core/Application.h"
 #include "CoffeeEngine/Core/Window.h"
+#include "CoffeeEngine/Renderer/Renderer.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 #include "SDL3/SDL_video.h"
 
 #include <imgui.h>
@@ -98,9 +100,9 @@ namespace Coffee {
 		Application& app = Application::Get();
 		io.DisplaySize = ImVec2((float)app.GetWindow().GetWidth(), (float)app.GetWindow().GetHeight());
 
-		// Rendering
+		// Rendering, the draw data is left untouched until the next frame begins
 		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		RenderThread::GetPacket().ImGuiDrawData = ImGui::GetDrawData();
 
       	/* if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) //Comment this for disable the detached imgui windows from the main window
 		{
@@ -112,6 +114,14 @@ namespace Coffee {
 		} */
 	}
 
+    void ImGuiLayer::RenderDrawData(ImDrawData* drawData)
+    {
+        ZoneScoped;
+
+        if (drawData != nullptr)
+            ImGui_ImplOpenGL3_RenderDrawData(drawData);
+    }
+
     void ImGuiLayer::OnImGuiRender()
     {
         static bool show = true;
@@ -3,6 +3,8 @@
 #include "CoffeeEngine/Core/Layer.h"
 #include <SDL3/SDL_events.h>
 
+struct ImDrawData;
+
 namespace Coffee {
 
     /**
@@ -49,10 +51,16 @@ namespace Coffee {
         void Begin();
 
         /**
-         * @brief Ends the current ImGui frame.
+         * @brief Ends the current ImGui frame, its draw data goes to the frame packet.
          */
         void End();
 
+        /**
+         * @brief Renders the draw data of a frame, on the thread that has the GL context.
+         * @param drawData The draw data, nothing is drawn if it is nullptr.
+         */
+        static void RenderDrawData(ImDrawData* drawData);
+
         /**
          * @brief Renders ImGui elements.
          */
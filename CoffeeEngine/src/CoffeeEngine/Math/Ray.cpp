@@ -0,0 +1,155 @@
+#include "Ray.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define COFFEE_RAY_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace Coffee {
+
+    static constexpr float IntersectionEpsilon = 1e-7f;
+
+    static const glm::vec3& GetPosition(const glm::vec3* positions, size_t stride, uint32_t index)
+    {
+        return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const char*>(positions) + index * stride);
+    }
+
+    // Moller-Trumbore
+    bool Ray::Intersect(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& distance) const
+    {
+        glm::vec3 edge1 = v1 - v0;
+        glm::vec3 edge2 = v2 - v0;
+        glm::vec3 p = glm::cross(direction, edge2);
+        float determinant = glm::dot(edge1, p);
+
+        if (std::abs(determinant) < IntersectionEpsilon)
+            return false;
+
+        float inverseDeterminant = 1.0f / determinant;
+        glm::vec3 s = origin - v0;
+        float u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f)
+            return false;
+
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f)
+            return false;
+
+        float t = glm::dot(edge2, q) * inverseDeterminant;
+        if (t <= IntersectionEpsilon)
+            return false;
+
+        distance = t;
+        return true;
+    }
+
+#ifdef COFFEE_RAY_SSE
+
+    // Same test as Ray::Intersect on four triangles stored as structures of arrays, the lanes that miss are masked out
+    bool Ray::IntersectTriangles(const glm::vec3* positions, size_t stride, const uint32_t* indices, size_t indexCount, float& distance) const
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 epsilon = _mm_set1_ps(IntersectionEpsilon);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+
+        const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+        const __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+
+        size_t triangleCount = indexCount / 3;
+        bool hit = false;
+
+        for (size_t first = 0; first < triangleCount; first += 4)
+        {
+            // Gather the vertices of the batch, the missing triangles of the last one are left degenerate
+            alignas(16) float v0[3][4] = {}, v1[3][4] = {}, v2[3][4] = {};
+            size_t batchCount = std::min<size_t>(4, triangleCount - first);
+            for (size_t lane = 0; lane < batchCount; ++lane)
+            {
+                const uint32_t* triangle = indices + (first + lane) * 3;
+                const glm::vec3& a = GetPosition(positions, stride, triangle[0]);
+                const glm::vec3& b = GetPosition(positions, stride, triangle[1]);
+                const glm::vec3& c = GetPosition(positions, stride, triangle[2]);
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    v0[axis][lane] = a[axis];
+                    v1[axis][lane] = b[axis];
+                    v2[axis][lane] = c[axis];
+                }
+            }
+
+            __m128 v0x = _mm_load_ps(v0[0]), v0y = _mm_load_ps(v0[1]), v0z = _mm_load_ps(v0[2]);
+            __m128 e1x = _mm_sub_ps(_mm_load_ps(v1[0]), v0x), e1y = _mm_sub_ps(_mm_load_ps(v1[1]), v0y), e1z = _mm_sub_ps(_mm_load_ps(v1[2]), v0z);
+            __m128 e2x = _mm_sub_ps(_mm_load_ps(v2[0]), v0x), e2y = _mm_sub_ps(_mm_load_ps(v2[1]), v0y), e2z = _mm_sub_ps(_mm_load_ps(v2[2]), v0z);
+
+            // p = direction x edge2
+            __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+            __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+            __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+            __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+            __m128 mask = _mm_cmpge_ps(_mm_andnot_ps(signMask, determinant), epsilon);
+            if (_mm_movemask_ps(mask) == 0)
+                continue;
+
+            __m128 inverseDeterminant = _mm_div_ps(one, determinant);
+
+            __m128 sx = _mm_sub_ps(ox, v0x), sy = _mm_sub_ps(oy, v0y), sz = _mm_sub_ps(oz, v0z);
+            __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDeterminant);
+
+            // q = s x edge1
+            __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+            __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+            __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+            __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDeterminant);
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDeterminant);
+
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+            mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+            mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, epsilon));
+            mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(distance)));
+
+            int laneMask = _mm_movemask_ps(mask);
+            if (laneMask == 0)
+                continue;
+
+            alignas(16) float distances[4];
+            _mm_store_ps(distances, t);
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                if ((laneMask & (1 << lane)) && distances[lane] < distance)
+                {
+                    distance = distances[lane];
+                    hit = true;
+                }
+            }
+        }
+
+        return hit;
+    }
+
+#else
+
+    bool Ray::IntersectTriangles(const glm::vec3* positions, size_t stride, const uint32_t* indices, size_t indexCount, float& distance) const
+    {
+        bool hit = false;
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            float t;
+            if (Intersect(GetPosition(positions, stride, indices[i]), GetPosition(positions, stride, indices[i + 1]), GetPosition(positions, stride, indices[i + 2]), t) && t < distance)
+            {
+                distance = t;
+                hit = true;
+            }
+        }
+        return hit;
+    }
+
+#endif
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CoffeeEngine/Math/BoundingBox.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Coffee {
+
+    /**
+     * @brief Structure representing a ray, a half line starting at an origin.
+     */
+    struct Ray {
+
+        glm::vec3 origin = glm::vec3(0.0f); ///< The origin of the ray.
+        glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f); ///< The direction of the ray, not required to be normalized.
+        glm::vec3 inverseDirection = glm::vec3(0.0f, 0.0f, -1.0f); ///< The inverse of the direction, precomputed for the slab test.
+
+        Ray() = default;
+
+        /**
+         * @brief Constructs a ray from an origin and a direction.
+         * @param origin The origin of the ray.
+         * @param direction The direction of the ray, distances along the ray are measured in multiples of it.
+         */
+        Ray(const glm::vec3& origin, const glm::vec3& direction)
+            : origin(origin), direction(direction), inverseDirection(1.0f / direction) {}
+
+        /**
+         * @brief Constructs the ray going through a point of the screen.
+         * @param ndc The point in normalized device coordinates, from -1 to 1 with Y up.
+         * @param inverseViewProjection The inverse of the projection matrix times the view matrix of the camera.
+         * @return The ray from the near plane, with a normalized direction so distances are in world units.
+         */
+        static Ray FromNDC(const glm::vec2& ndc, const glm::mat4& inverseViewProjection)
+        {
+            glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+            glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+            glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+            glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+            return Ray(origin, glm::normalize(target - origin));
+        }
+
+        glm::vec3 GetPoint(float distance) const
+        {
+            return origin + direction * distance;
+        }
+
+        /**
+         * @brief Intersects the ray with a world space AABB using the slab test.
+         * @param aabb The bounding box.
+         * @param tNear The distance the ray enters the box at, 0 if the origin is inside.
+         * @param tFar The distance the ray leaves the box at.
+         * @return True if the ray hits the box.
+         */
+        bool Intersect(const AABB& aabb, float& tNear, float& tFar) const
+        {
+            glm::vec3 t0 = (aabb.min - origin) * inverseDirection;
+            glm::vec3 t1 = (aabb.max - origin) * inverseDirection;
+            glm::vec3 tMin = glm::min(t0, t1);
+            glm::vec3 tMax = glm::max(t0, t1);
+
+            tNear = std::max({tMin.x, tMin.y, tMin.z, 0.0f});
+            tFar = std::min({tMax.x, tMax.y, tMax.z});
+            return tNear <= tFar;
+        }
+
+        /**
+         * @brief Intersects the ray with a triangle, both faces are hit.
+         * @param v0 The first vertex of the triangle.
+         * @param v1 The second vertex of the triangle.
+         * @param v2 The third vertex of the triangle.
+         * @param distance The distance of the hit along the ray.
+         * @return True if the triangle is hit in front of the origin.
+         */
+        bool Intersect(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& distance) const;
+
+        /**
+         * @brief Intersects the ray with an indexed triangle list, four triangles at a time with SSE when available.
+         * @param positions The position of the first vertex.
+         * @param stride The distance in bytes between the positions of two consecutive vertices.
+         * @param indices The indices of the triangles, three per triangle.
+         * @param indexCount The number of indices.
+         * @param distance The length of the ray on input, the distance of the closest hit on output.
+         * @return True if a triangle was hit closer than the input distance.
+         */
+        bool IntersectTriangles(const glm::vec3* positions, size_t stride, const uint32_t* indices, size_t indexCount, float& distance) const;
+    };
+
+}
@@ -24,7 +24,9 @@ namespace Coffee {
         }
 
         CacheManager::SetCachePath(s_ActiveProject->m_ProjectDirectory / s_ActiveProject->m_CacheDirectory);
+        CacheManager::UnmountArchive();
         ResourceLoader::SetWorkingDirectory(s_ActiveProject->m_ProjectDirectory);
+        ResourceLoader::ResetDeduplicationStats();
 
         return s_ActiveProject;
     }
@@ -45,9 +47,25 @@ namespace Coffee {
         ResourceRegistry::Clear();
 
         CacheManager::SetCachePath(project->m_ProjectDirectory / project->m_CacheDirectory);
+
+        // Shipping builds read the cache from a single packed archive instead of the loose files. In the editor the
+        // loose files reimported after the archive was packed are read instead of its stale entries.
+        CacheManager::UnmountArchive();
+        if (std::filesystem::exists(CacheManager::GetArchivePath()))
+        {
+            CacheManager::MountArchive(CacheManager::GetArchivePath());
+        }
+
         ResourceLoader::SetWorkingDirectory(s_ActiveProject->m_ProjectDirectory);
+        ResourceLoader::ResetDeduplicationStats();
         ResourceLoader::LoadDirectory(project->m_ProjectDirectory);
 
+        const ResourceDeduplicationStats& deduplicationStats = ResourceLoader::GetDeduplicationStats();
+        if (deduplicationStats.DuplicateTextures > 0)
+        {
+            COFFEE_CORE_INFO("Project::Load: {0} duplicated textures reused, {1} KB saved", deduplicationStats.DuplicateTextures, deduplicationStats.BytesSaved / 1024);
+        }
+
         return project;
     }
 
@@ -1,4 +1,5 @@
 #include "CoffeeEngine/Renderer/Buffer.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 
 #include <glad/glad.h>
 #include <tracy/Tracy.hpp>
@@ -9,6 +10,7 @@ namespace Coffee {
     {
         ZoneScoped;
 
+        RenderThread::AcquireContext();
         glGenBuffers(1, &m_vboID);
         glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
         glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
@@ -18,6 +20,7 @@ namespace Coffee {
     {
         ZoneScoped;
 
+        RenderThread::AcquireContext();
         glGenBuffers(1, &m_vboID);
         glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
         glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
@@ -27,7 +30,7 @@ namespace Coffee {
     {
         ZoneScoped;
 
-        glDeleteBuffers(1, &m_vboID);
+        RenderThread::Release([vbo = m_vboID]() { glDeleteBuffers(1, &vbo); });
     }
 
     void VertexBuffer::Bind()
@@ -44,7 +47,7 @@ namespace Coffee {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
-    void VertexBuffer::SetData(void* data, uint32_t size)
+    void VertexBuffer::SetData(const void* data, uint32_t size)
     {
         glBindBuffer(GL_ARRAY_BUFFER, m_vboID);
         glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
@@ -64,6 +67,7 @@ namespace Coffee {
     {
         ZoneScoped;
 
+        RenderThread::AcquireContext();
         glGenBuffers(1, &m_eboID);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_eboID);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(uint32_t), indices, GL_STATIC_DRAW);
@@ -71,7 +75,7 @@ namespace Coffee {
 
     IndexBuffer::~IndexBuffer()
     {
-        glDeleteBuffers(1, &m_eboID);
+        RenderThread::Release([ebo = m_eboID]() { glDeleteBuffers(1, &ebo); });
     }
 
     void IndexBuffer::Bind()
@@ -211,7 +211,7 @@ namespace Coffee {
          * @param data The data to set.
          * @param size The size of the data.
          */
-        void SetData(void* data, uint32_t size);
+        void SetData(const void* data, uint32_t size);
 
         /**
          * @brief Returns the layout of the vertex buffer.
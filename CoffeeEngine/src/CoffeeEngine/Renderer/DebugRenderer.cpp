@@ -57,26 +57,29 @@ namespace Coffee {
     {
     }
 
-    void DebugRenderer::Flush()
+    void DebugRenderer::Capture(std::vector<DebugVertex>& lines, std::vector<DebugVertex>& circles)
     {
-        // Get the current Framebuffer and store it
-        // Bind the framebuffer to render the debug lines
-        // Restore the previous framebuffer
+        lines.assign(m_LineVertices, m_LineVertices + m_LineVertexCount);
+        circles.assign(m_CircleVertices, m_CircleVertices + m_CircleVertexCount);
 
-        if (m_LineVertexCount > 0)
+        m_LineVertexCount = 0;
+        m_CircleVertexCount = 0;
+    }
+
+    void DebugRenderer::Flush(const std::vector<DebugVertex>& lines, const std::vector<DebugVertex>& circles)
+    {
+        if (!lines.empty())
         {
-            m_LineVertexBuffer->SetData(m_LineVertices, m_LineVertexCount * sizeof(DebugVertex));
+            m_LineVertexBuffer->SetData(lines.data(), (uint32_t)(lines.size() * sizeof(DebugVertex)));
             m_DebugShader->Bind();
-            RendererAPI::DrawLines(m_LineVertexArray, m_LineVertexCount, 1.0f);
-            m_LineVertexCount = 0;
+            RendererAPI::DrawLines(m_LineVertexArray, (uint32_t)lines.size(), 1.0f);
         }
 
-        if (m_CircleVertexCount > 0)
+        if (!circles.empty())
         {
-            m_CircleVertexBuffer->SetData(m_CircleVertices, m_CircleVertexCount * sizeof(DebugVertex));
+            m_CircleVertexBuffer->SetData(circles.data(), (uint32_t)(circles.size() * sizeof(DebugVertex)));
             m_DebugShader->Bind();
-            RendererAPI::DrawLines(m_CircleVertexArray, m_CircleVertexCount, 1.0f);
-            m_CircleVertexCount = 0;
+            RendererAPI::DrawLines(m_CircleVertexArray, (uint32_t)circles.size(), 1.0f);
         }
     }
 
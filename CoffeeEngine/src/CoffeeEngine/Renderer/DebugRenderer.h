@@ -51,9 +51,18 @@ namespace Coffee {
         static void NextBatch();
 
         /**
-         * @brief Flushes the batched vertices to the GPU and renders them.
+         * @brief Moves the batched vertices out, for the frame packet, and starts a new batch.
+         * @param lines Receives the vertices of the lines.
+         * @param circles Receives the vertices of the circles.
          */
-        static void Flush();
+        static void Capture(std::vector<DebugVertex>& lines, std::vector<DebugVertex>& circles);
+
+        /**
+         * @brief Uploads captured vertices to the GPU and renders them.
+         * @param lines The vertices of the lines.
+         * @param circles The vertices of the circles.
+         */
+        static void Flush(const std::vector<DebugVertex>& lines, const std::vector<DebugVertex>& circles);
 
         /**
          * @brief Draws a line between two points.
@@ -1,5 +1,6 @@
 #include "Framebuffer.h"
 #include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 #include "CoffeeEngine/Renderer/Texture.h"
 
 #include <cstdint>
@@ -24,7 +25,7 @@ namespace Coffee {
 
     Framebuffer::~Framebuffer()
     {
-        glDeleteFramebuffers(1, &m_fboID);
+        RenderThread::Release([fbo = m_fboID]() { glDeleteFramebuffers(1, &fbo); });
     }
 
     void Framebuffer::Resize(uint32_t width, uint32_t height)
@@ -54,6 +55,8 @@ namespace Coffee {
     {
         ZoneScoped;
 
+        RenderThread::AcquireContext();
+
         if(m_fboID)
         {
             glDeleteFramebuffers(1, &m_fboID);
@@ -56,6 +56,25 @@ namespace Coffee {
         return SDL_GL_SetSwapInterval(interval);
     }
 
+    void GraphicsContext::MakeCurrent()
+    {
+        ZoneScoped;
+
+        SDL_GL_MakeCurrent(m_WindowHandle, m_Context);
+    }
+
+    void GraphicsContext::ReleaseCurrent()
+    {
+        ZoneScoped;
+
+        SDL_GL_MakeCurrent(m_WindowHandle, nullptr);
+    }
+
+    bool GraphicsContext::IsCurrent() const
+    {
+        return SDL_GL_GetCurrentContext() == m_Context;
+    }
+
     Scope<GraphicsContext> GraphicsContext::Create(SDL_Window* window)
     {
         return CreateScope<GraphicsContext>(window);
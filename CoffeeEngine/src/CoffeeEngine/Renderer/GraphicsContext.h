@@ -42,6 +42,22 @@ namespace Coffee {
 
         bool SwapInterval(int interval);
 
+        /**
+         * @brief Makes the context current on the calling thread, only one thread may have it current at a time.
+         */
+        void MakeCurrent();
+
+        /**
+         * @brief Detaches the context from the calling thread, so another thread can make it current.
+         */
+        void ReleaseCurrent();
+
+        /**
+         * @brief Checks if the context is current on the calling thread.
+         * @return True if the calling thread can issue GL calls.
+         */
+        bool IsCurrent() const;
+
         /**
          * @brief Creates a graphics context for the specified window.
          * @param window The handle to the SDL window.
@@ -3,6 +3,8 @@
 #include "CoffeeEngine/IO/Resource.h"
 #include "CoffeeEngine/IO/ResourceLoader.h"
 #include "CoffeeEngine/IO/ResourceRegistry.h"
+#include "CoffeeEngine/Renderer/RendererAPI.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 #include "CoffeeEngine/Renderer/Texture.h"
 #include "CoffeeEngine/Embedded/StandardShader.inl"
 #include <cstdint>
@@ -36,6 +38,11 @@ namespace Coffee {
 
         m_Shader = s_StandardShader;
 
+        // The samplers are program state, which the null backend does not have
+        if (RendererAPI::GetAPI() == RendererAPI::API::None)
+            return;
+
+        RenderThread::AcquireContext();
         m_Shader->Bind();
         m_MaterialTextures.albedo->Bind(0);
         m_Shader->setInt("material.albedoMap", 0);
@@ -72,6 +79,10 @@ namespace Coffee {
 
         m_Shader = s_StandardShader;
 
+        if (RendererAPI::GetAPI() == RendererAPI::API::None)
+            return;
+
+        RenderThread::AcquireContext();
         m_Shader->Bind();
         m_Shader->setInt("material.albedoMap", 0);
         m_Shader->setInt("material.normalMap", 1);
@@ -123,7 +123,7 @@ namespace Coffee {
     /**
      * @brief Class representing a material.
      */
-    class Material : public Resource
+    class Material : public Resource, public std::enable_shared_from_this<Material>
     {
     public:
 
@@ -1,5 +1,6 @@
 #include "CoffeeEngine/Renderer/Mesh.h"
 #include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Renderer/RendererAPI.h"
 #include "CoffeeEngine/Renderer/VertexArray.h"
 #include <tracy/Tracy.hpp>
 
@@ -13,6 +14,10 @@ namespace Coffee {
         m_Vertices = vertices;
         m_Indices = indices;
 
+        // The null backend only needs the vertices and indices, for the bounds and the draw statistics
+        if (RendererAPI::GetAPI() == RendererAPI::API::None)
+            return;
+
         m_VertexBuffer = VertexBuffer::Create((float*)m_Vertices.data(), m_Vertices.size() * sizeof(Vertex));
         m_IndexBuffer = IndexBuffer::Create(m_Indices.data(), m_Indices.size());
 
@@ -50,7 +50,7 @@ namespace Coffee {
     /**
      * @brief Class representing a mesh.
      */
-    class Mesh : public Resource
+    class Mesh : public Resource, public std::enable_shared_from_this<Mesh>
     {
     public:
         /**
@@ -62,7 +62,7 @@ namespace Coffee {
 
         /**
          * @brief Gets the vertex array of the mesh.
-         * @return A reference to the vertex array.
+         * @return A reference to the vertex array, null with the null renderer backend.
          */
         const Ref<VertexArray>& GetVertexArray() const { return m_VertexArray; }
 
@@ -4,6 +4,7 @@
 #include "CoffeeEngine/Renderer/Material.h"
 #include "CoffeeEngine/Renderer/Mesh.h"
 #include "CoffeeEngine/Renderer/Texture.h"
+#include "CoffeeEngine/Renderer/TextureCompressor.h"
 #include "CoffeeEngine/IO/ResourceLoader.h"
 
 #include <assimp/Importer.hpp>
@@ -129,7 +130,7 @@ namespace Coffee {
         //The next code is rushed, please Hugo of the future refactor this ;_;
         if(material)
         {
-            MaterialTextures matTextures = LoadMaterialTextures(material);
+            MaterialTextures matTextures = LoadMaterialTextures(scene, material);
             std::string materialName = (material->GetName().length > 0) ? material->GetName().C_Str() : m_Name;
             std::string referenceName = materialName + "_Mat" + std::to_string(mesh->mMaterialIndex);
             meshMaterial = Material::Create(referenceName, &matTextures);
@@ -182,7 +183,7 @@ namespace Coffee {
         }
     }
 
-    Ref<Texture2D> Model::LoadTexture2D(aiMaterial* material, aiTextureType type)
+    Ref<Texture2D> Model::LoadTexture2D(const aiScene* scene, aiMaterial* material, aiTextureType type)
     {
         aiString textureName;
         material->GetTexture(type, 0, &textureName);
@@ -192,27 +193,52 @@ namespace Coffee {
             return nullptr;
         }
 
-        std::string directory = m_FilePath.parent_path().string();
-        std::string texturePath = directory + "/" + std::string(textureName.C_Str());
-
         bool srgb = (type == aiTextureType_DIFFUSE || type == aiTextureType_EMISSIVE);
 
-        return Texture2D::Load(texturePath, srgb);
+        TextureUsage usage = TextureUsage::Data;
+        if (srgb)
+            usage = TextureUsage::Color;
+        else if (type == aiTextureType_NORMALS)
+            usage = TextureUsage::Normal;
+
+        // Embedded textures are shared by content, so the same image embedded in several models is imported once
+        if(const aiTexture* embeddedTexture = scene->GetEmbeddedTexture(textureName.C_Str()))
+        {
+            if(embeddedTexture->mHeight != 0)
+            {
+                COFFEE_CORE_WARN("Model::LoadTexture2D: Uncompressed embedded texture {0} in {1} is not supported", textureName.C_Str(), m_Name);
+                return nullptr;
+            }
+
+            TextureImage image;
+            if(!TextureCompressor::DecodeImage(reinterpret_cast<const unsigned char*>(embeddedTexture->pcData), embeddedTexture->mWidth, image))
+            {
+                return nullptr;
+            }
+
+            std::string name = m_FilePath.stem().string() + "_" + (embeddedTexture->mFilename.length > 0 ? embeddedTexture->mFilename.C_Str() : textureName.C_Str());
+            return ResourceLoader::LoadTexture2D(name, image, srgb, usage);
+        }
+
+        // Normalized so the same file referenced with different relative paths maps to the same import file
+        std::filesystem::path texturePath = (m_FilePath.parent_path() / textureName.C_Str()).lexically_normal();
+
+        return Texture2D::Load(texturePath, srgb, usage);
     }
 
-    MaterialTextures Model::LoadMaterialTextures(aiMaterial* material)
+    MaterialTextures Model::LoadMaterialTextures(const aiScene* scene, aiMaterial* material)
     {
         MaterialTextures matTextures;
 
-        matTextures.albedo = LoadTexture2D(material, aiTextureType_DIFFUSE);
-        matTextures.normal = LoadTexture2D(material, aiTextureType_NORMALS);
-        matTextures.metallic = LoadTexture2D(material, aiTextureType_METALNESS);
-        matTextures.roughness = LoadTexture2D(material, aiTextureType_DIFFUSE_ROUGHNESS);
-        matTextures.ao = LoadTexture2D(material, aiTextureType_AMBIENT);
+        matTextures.albedo = LoadTexture2D(scene, material, aiTextureType_DIFFUSE);
+        matTextures.normal = LoadTexture2D(scene, material, aiTextureType_NORMALS);
+        matTextures.metallic = LoadTexture2D(scene, material, aiTextureType_METALNESS);
+        matTextures.roughness = LoadTexture2D(scene, material, aiTextureType_DIFFUSE_ROUGHNESS);
+        matTextures.ao = LoadTexture2D(scene, material, aiTextureType_AMBIENT);
 
-        if(matTextures.ao == nullptr) matTextures.ao = LoadTexture2D(material, aiTextureType_LIGHTMAP);
+        if(matTextures.ao == nullptr) matTextures.ao = LoadTexture2D(scene, material, aiTextureType_LIGHTMAP);
 
-        matTextures.emissive = LoadTexture2D(material, aiTextureType_EMISSIVE);
+        matTextures.emissive = LoadTexture2D(scene, material, aiTextureType_EMISSIVE);
 
         return matTextures;
     }
@@ -67,7 +67,17 @@ namespace Coffee {
          * @brief Gets the children models.
          * @return A reference to the vector of children models.
          */
-        const std::vector<Ref<Model>> GetChildren() const { return m_Children; }
+        const std::vector<Ref<Model>>& GetChildren() const { return m_Children; }
+
+        /**
+         * @brief Adds a child model, for the models built in code instead of loaded from a file.
+         * @param child The child model.
+         */
+        void AddChild(const Ref<Model>& child)
+        {
+            child->m_Parent = weak_from_this();
+            m_Children.push_back(child);
+        }
 
         /**
          * @brief Gets the transformation matrix of the model.
@@ -75,6 +85,12 @@ namespace Coffee {
          */
         const glm::mat4 GetTransform() const { return m_Transform; }
 
+        /**
+         * @brief Sets the transformation matrix of the model.
+         * @param transform The transformation matrix.
+         */
+        void SetTransform(const glm::mat4& transform) { m_Transform = transform; }
+
         /**
         * Loads a model from the specified file path.
         *
@@ -100,18 +116,20 @@ namespace Coffee {
 
         /**
          * @brief Loads a texture from the Assimp material and texture type.
+         * @param scene The Assimp scene, holding the embedded textures.
          * @param material The Assimp material.
          * @param type The Assimp texture type.
          * @return A reference to the loaded texture.
          */
-        Ref<Texture2D> LoadTexture2D(aiMaterial* material, aiTextureType type);
+        Ref<Texture2D> LoadTexture2D(const aiScene* scene, aiMaterial* material, aiTextureType type);
 
         /**
          * @brief Loads material textures from the Assimp material.
+         * @param scene The Assimp scene, holding the embedded textures.
          * @param material The Assimp material.
          * @return The loaded material textures.
          */
-        MaterialTextures LoadMaterialTextures(aiMaterial* material);
+        MaterialTextures LoadMaterialTextures(const aiScene* scene, aiMaterial* material);
         
         friend class cereal::access;
         template<class Archive>
@@ -0,0 +1,251 @@
+#include "RenderThread.h"
+
+#include "CoffeeEngine/Core/Assert.h"
+#include "CoffeeEngine/Core/Window.h"
+#include "CoffeeEngine/ImGui/ImGuiLayer.h"
+#include "CoffeeEngine/Renderer/GraphicsContext.h"
+#include "CoffeeEngine/Renderer/Renderer.h"
+#include "CoffeeEngine/Renderer/RendererAPI.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <tracy/Tracy.hpp>
+
+namespace Coffee {
+
+    bool RenderThread::s_Enabled = true;
+    RenderThreadStats RenderThread::s_Stats;
+
+    static Window* s_Window = nullptr;
+    static std::thread::id s_MainThread;
+    static std::thread s_Thread;
+    static std::mutex s_Mutex;
+    static std::condition_variable s_Condition;
+    static bool s_Stop = false;
+
+    static FramePacket s_Packets[2];
+    static uint32_t s_Recording = 0; ///< Index of the packet recorded by the main thread.
+    static FramePacket* s_Pending = nullptr; ///< The packet handed to the render thread, until it is executed.
+    static FramePacket* s_InFlight = nullptr; ///< The last packet submitted, recycled by the main thread in WaitIdle.
+    static double s_ExecuteTime = 0.0;
+
+    static std::mutex s_ReleaseMutex;
+    static std::vector<std::function<void()>> s_Releases;
+
+    static double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static void ExecutePacket(FramePacket& packet)
+    {
+        Renderer::ExecutePacket(packet);
+        ImGuiLayer::RenderDrawData(packet.ImGuiDrawData);
+
+        // Headless applications have no window to present to
+        if (s_Window)
+            s_Window->OnUpdate();
+    }
+
+    static void DrainReleases()
+    {
+        std::vector<std::function<void()>> releases;
+        {
+            std::lock_guard lock(s_ReleaseMutex);
+            releases.swap(s_Releases);
+        }
+
+        for (auto& release : releases)
+            release();
+    }
+
+    static void RenderThreadMain()
+    {
+        tracy::SetThreadName("Render Thread");
+
+        GraphicsContext& context = s_Window->GetContext();
+        while (true)
+        {
+            FramePacket* packet;
+            {
+                std::unique_lock lock(s_Mutex);
+                s_Condition.wait(lock, [] { return s_Pending != nullptr || s_Stop; });
+                if (s_Pending == nullptr)
+                    break;
+
+                packet = s_Pending;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            {
+                ZoneScopedN("Execute Frame Packet");
+
+                context.MakeCurrent();
+                ExecutePacket(*packet);
+                context.ReleaseCurrent();
+            }
+            double executeTime = ElapsedMilliseconds(start);
+
+            {
+                std::lock_guard lock(s_Mutex);
+                s_Pending = nullptr;
+                s_ExecuteTime = executeTime;
+            }
+            s_Condition.notify_all();
+        }
+    }
+
+    static void StartThread()
+    {
+        s_Stop = false;
+        s_Thread = std::thread(RenderThreadMain);
+    }
+
+    void RenderThread::Init(Window& window)
+    {
+        ZoneScoped;
+
+        s_Window = &window;
+        s_MainThread = std::this_thread::get_id();
+
+        if (s_Enabled)
+            StartThread();
+    }
+
+    static void StopThread()
+    {
+        RenderThread::WaitIdle();
+
+        {
+            std::lock_guard lock(s_Mutex);
+            s_Stop = true;
+        }
+        s_Condition.notify_all();
+        s_Thread.join();
+    }
+
+    void RenderThread::Shutdown()
+    {
+        ZoneScoped;
+
+        if (s_Thread.joinable())
+            StopThread();
+
+        DrainReleases();
+        s_Window = nullptr;
+    }
+
+    void RenderThread::SetEnabled(bool enabled)
+    {
+        if (enabled == s_Enabled)
+            return;
+
+        s_Enabled = enabled;
+        if (s_Window == nullptr)
+            return;
+
+        if (enabled)
+            StartThread();
+        else if (s_Thread.joinable())
+            StopThread();
+    }
+
+    FramePacket& RenderThread::GetPacket()
+    {
+        return s_Packets[s_Recording];
+    }
+
+    void RenderThread::Submit()
+    {
+        ZoneScoped;
+
+        FramePacket& packet = s_Packets[s_Recording];
+
+        if (!s_Thread.joinable())
+        {
+            auto start = std::chrono::steady_clock::now();
+            ExecutePacket(packet);
+            Renderer::RecyclePacket(packet);
+
+            s_Stats.Threaded = false;
+            s_Stats.ExecuteTime = ElapsedMilliseconds(start);
+            s_Stats.WaitTime = s_Stats.ExecuteTime;
+            s_Stats.OverlapTime = 0.0;
+            return;
+        }
+
+        s_Window->GetContext().ReleaseCurrent();
+        {
+            std::lock_guard lock(s_Mutex);
+            s_Pending = &packet;
+        }
+        s_Condition.notify_all();
+
+        s_InFlight = &packet;
+        s_Recording = 1 - s_Recording;
+    }
+
+    void RenderThread::WaitIdle()
+    {
+        if (s_InFlight == nullptr)
+            return;
+
+        auto start = std::chrono::steady_clock::now();
+        double executeTime;
+        {
+            ZoneScopedN("Wait For Render Thread");
+
+            std::unique_lock lock(s_Mutex);
+            s_Condition.wait(lock, [] { return s_Pending == nullptr; });
+            executeTime = s_ExecuteTime;
+        }
+        double waitTime = ElapsedMilliseconds(start);
+
+        s_Window->GetContext().MakeCurrent();
+        DrainReleases();
+
+        Renderer::RecyclePacket(*s_InFlight);
+        s_InFlight = nullptr;
+
+        // Whatever the main thread did not spend waiting ran alongside the execution
+        s_Stats.Threaded = true;
+        s_Stats.ExecuteTime = executeTime;
+        s_Stats.WaitTime = waitTime;
+        s_Stats.OverlapTime = std::max(executeTime - waitTime, 0.0);
+
+        TracyPlot("Render Thread Overlap", s_Stats.OverlapTime);
+    }
+
+    void RenderThread::AcquireContext()
+    {
+        if (s_Window == nullptr)
+            return;
+
+        // Only the main thread records packets, so only it may read s_InFlight
+        if (std::this_thread::get_id() == s_MainThread && s_InFlight != nullptr)
+            WaitIdle();
+
+        COFFEE_CORE_ASSERT(s_Window->GetContext().IsCurrent(), "RenderThread: A GPU object is created on a thread without the GL context");
+    }
+
+    void RenderThread::Release(std::function<void()> release)
+    {
+        // The null backend never created the object
+        if (RendererAPI::GetAPI() == RendererAPI::API::None)
+            return;
+
+        if (s_Window == nullptr || s_Window->GetContext().IsCurrent())
+        {
+            release();
+            return;
+        }
+
+        std::lock_guard lock(s_ReleaseMutex);
+        s_Releases.push_back(std::move(release));
+    }
+
+}
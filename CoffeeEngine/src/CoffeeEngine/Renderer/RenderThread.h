@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace Coffee {
+
+    /**
+     * @defgroup renderer Renderer
+     * @brief Renderer components of the CoffeeEngine.
+     * @{
+     */
+
+    class Window;
+    struct FramePacket;
+
+    /**
+     * @brief Structure containing the timings of the last frame packet.
+     */
+    struct RenderThreadStats
+    {
+        bool Threaded = false; ///< Whether the packet was executed by the render thread or inline by the main thread.
+        double ExecuteTime = 0.0; ///< Time spent executing the packet, the buffer swap included, in milliseconds.
+        double WaitTime = 0.0; ///< Time the main thread waited for the packet to be executed, in milliseconds.
+        double OverlapTime = 0.0; ///< Part of the execution that ran while the main thread simulated the next frame, in milliseconds.
+    };
+
+    /**
+     * @brief Thread submitting the frames to the GPU while the main thread simulates the next one.
+     *
+     * The main thread records the frame into a FramePacket through the Renderer, then Submit hands the packet and
+     * the GL context over to the render thread, which executes the packet, renders the ImGui draw data and swaps
+     * the buffers. The packets are double buffered: the main thread records one while the other is in flight.
+     *
+     * The GL context is only current on one thread at a time. The main thread gets it back in WaitIdle, which the
+     * application calls after the fixed updates of the next frame, so the simulation overlaps the submission and
+     * everything after it, the events, the layers update and the ImGui frame, may use GL as before. The GPU
+     * objects created meanwhile take the context back early through AcquireContext, the ones released meanwhile are
+     * deleted by Release once the context is back.
+     *
+     * When disabled the packets are executed inline by Submit, on the main thread. Headless applications never call
+     * Init, their packets are always executed inline by the null backend and nothing is presented.
+     */
+    class RenderThread
+    {
+    public:
+        /**
+         * @brief Starts the render thread if it is enabled, the main thread has the context until the first Submit.
+         * @param window The window whose context and buffers the render thread uses.
+         */
+        static void Init(Window& window);
+
+        /**
+         * @brief Waits for the packet in flight and stops the render thread, the main thread keeps the context.
+         */
+        static void Shutdown();
+
+        /**
+         * @brief Enables or disables the render thread, from the main thread outside of the fixed updates.
+         * @param enabled Whether the packets are executed by the render thread.
+         */
+        static void SetEnabled(bool enabled);
+        static bool IsEnabled() { return s_Enabled; }
+
+        /**
+         * @brief Gets the packet the main thread is recording.
+         * @return The packet.
+         */
+        static FramePacket& GetPacket();
+
+        /**
+         * @brief Hands the recorded packet and the GL context over to the render thread, or executes the packet
+         * right away if the render thread is disabled.
+         */
+        static void Submit();
+
+        /**
+         * @brief Waits until the packet in flight is executed and makes the GL context current on the main thread
+         * again. Does nothing if no packet is in flight.
+         */
+        static void WaitIdle();
+
+        /**
+         * @brief Makes sure the calling thread has the GL context before it creates a GPU object. On the main thread,
+         * while a packet is in flight, it waits for the packet like WaitIdle, so a script creating a mesh in a fixed
+         * update only ends the overlap early. Reports an error if the context is still not current.
+         */
+        static void AcquireContext();
+
+        /**
+         * @brief Releases a GPU object, right away if the calling thread has the context, otherwise once the main
+         * thread gets it back.
+         * @param release The function deleting the object, it must not reference the owner of the object.
+         */
+        static void Release(std::function<void()> release);
+
+        static const RenderThreadStats& GetStats() { return s_Stats; }
+
+    private:
+        static bool s_Enabled;
+        static RenderThreadStats s_Stats;
+    };
+
+    /** @} */
+}
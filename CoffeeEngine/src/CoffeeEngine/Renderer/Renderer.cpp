@@ -6,15 +6,20 @@
 #include "CoffeeEngine/Renderer/Framebuffer.h"
 #include "CoffeeEngine/Renderer/Mesh.h"
 #include "CoffeeEngine/Renderer/RendererAPI.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 #include "CoffeeEngine/Renderer/Shader.h"
 #include "CoffeeEngine/Renderer/Texture.h"
+#include "CoffeeEngine/Renderer/TextureStreamer.h"
 #include "CoffeeEngine/Renderer/UniformBuffer.h"
 
 #include "CoffeeEngine/Embedded/ToneMappingShader.inl"
 #include "CoffeeEngine/Embedded/FinalPassShader.inl"
 #include "CoffeeEngine/Embedded/MissingShader.inl"
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <glm/fwd.hpp>
 #include <glm/matrix.hpp>
 #include <tracy/Tracy.hpp>
@@ -46,6 +51,20 @@ namespace Coffee {
 
     void Renderer::Init()
     {
+        // The null backend records, sorts and counts the commands, it only needs the CPU side of the renderer
+        if (RendererAPI::GetAPI() == RendererAPI::API::None)
+        {
+            Ref<Shader> missingShader = CreateRef<Shader>("MissingShader", std::string(missingShaderSource));
+            s_RendererData.DefaultMaterial = CreateRef<Material>("Missing Material", missingShader);
+
+            // The size of the framebuffers it would render to, for the aspect ratio of the cameras
+            s_viewportWidth = 1280;
+            s_viewportHeight = 720;
+
+            COFFEE_CORE_INFO("Renderer: Using the null backend, nothing is drawn");
+            return;
+        }
+
         /*std::vector<std::filesystem::path> paths = {
             "assets/textures/skybox/right.jpg",
             "assets/textures/skybox/left.jpg",
@@ -66,6 +85,7 @@ namespace Coffee {
 
         RendererAPI::Init();
         DebugRenderer::Init();
+        TextureStreamer::Init();
 
         s_RendererData.CameraUniformBuffer = UniformBuffer::Create(sizeof(RendererData::CameraData), 0);
         s_RendererData.RenderDataUniformBuffer = UniformBuffer::Create(sizeof(RendererData::RenderData), 1);
@@ -86,149 +106,314 @@ namespace Coffee {
 
         s_ToneMappingShader = CreateRef<Shader>("ToneMappingShader", std::string(toneMappingShaderSource));
         s_FinalPassShader = CreateRef<Shader>("FinalPassShader", std::string(finalPassShaderSource));
+
+        const ShaderCompileStats& shaderStats = Shader::GetCompileStats();
+        COFFEE_CORE_INFO("Renderer: Built {0} shader programs in {1:.2f} ms ({2} compiled, {3} from the program binary cache)",
+                         shaderStats.CompiledPrograms + shaderStats.CachedPrograms, shaderStats.CompileTime,
+                         shaderStats.CompiledPrograms, shaderStats.CachedPrograms);
     }
 
     void Renderer::Shutdown()
     {
+        TextureStreamer::Shutdown();
     }
 
-    void Renderer::BeginScene(EditorCamera& camera)
+    // Size in pixels of the bounding sphere of a mesh on screen
+    static float GetScreenSize(const AABB& aabb, const glm::mat4& transform, const RendererData::CameraData& camera, float viewportHeight)
     {
-        s_Stats.DrawCalls = 0;
-        s_Stats.VertexCount = 0;
-        s_Stats.IndexCount = 0;
+        AABB bounds = aabb.CalculateTransformedAABB(transform);
+        glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        float radius = glm::length(bounds.max - bounds.min) * 0.5f;
 
-        //I think if a render queue is implemented this is not necessary. The OnResize would work.
-        if(s_viewportResized)
+        float size = radius * camera.projection[1][1] * viewportHeight;
+
+        // Orthographic projections do not shrink with the distance
+        if (camera.projection[2][3] == 0.0f)
+            return size;
+
+        float distance = glm::length(center - camera.position);
+        return distance > radius ? size / distance : std::numeric_limits<float>::max();
+    }
+
+    static void RequestTextureMips(Material* material, float screenSize)
+    {
+        MaterialTextures& textures = material->GetMaterialTextures();
+
+        for (Texture2D* texture : { textures.albedo.get(), textures.normal.get(), textures.metallic.get(),
+                                    textures.roughness.get(), textures.ao.get(), textures.emissive.get() })
         {
-            ResizeFramebuffers();
-            s_viewportResized = false;
+            if (texture && texture->IsCompressed())
+                TextureStreamer::Request(texture, screenSize);
         }
+    }
 
+    void Renderer::BeginScene(EditorCamera& camera)
+    {
         s_RendererData.cameraData.view = camera.GetViewMatrix();
         s_RendererData.cameraData.projection = camera.GetProjection();
         s_RendererData.cameraData.position = camera.GetPosition();
-        s_RendererData.CameraUniformBuffer->SetData(&s_RendererData.cameraData, sizeof(RendererData::CameraData));
 
         s_RendererData.renderData.lightCount = 0;
     }
 
     void Renderer::BeginScene(Camera& camera, const glm::mat4& transform)
     {
-        s_Stats.DrawCalls = 0;
-        s_Stats.VertexCount = 0;
-        s_Stats.IndexCount = 0;
-
         // This resize the camera to the viewport size. Think how to manage this in a better way :p
         camera.SetViewportSize(s_viewportWidth, s_viewportHeight);
 
         s_RendererData.cameraData.view = glm::inverse(transform);
         s_RendererData.cameraData.projection = camera.GetProjection();
         s_RendererData.cameraData.position = transform[3];
-        s_RendererData.CameraUniformBuffer->SetData(&s_RendererData.cameraData, sizeof(RendererData::CameraData));
 
         s_RendererData.renderData.lightCount = 0;
     }
 
     void Renderer::EndScene()
     {
-        s_MainFramebuffer->Bind();
-        s_MainFramebuffer->SetDrawBuffers({0, 1});
+        ZoneScoped;
 
-        RendererAPI::SetClearColor({0.03f,0.03f,0.03f,1.0});
-        RendererAPI::Clear();
+        FramePacket& packet = RenderThread::GetPacket();
 
-        // Currently this is done also in the runtime, this should be done only in editor mode
-        s_EntityIDTexture->Clear({-1.0f,0.0f,0.0f,0.0f});
+        //I think if a render queue is implemented this is not necessary. The OnResize would work.
+        if(s_viewportResized)
+        {
+            packet.Resize = true;
+            packet.Width = s_viewportWidth;
+            packet.Height = s_viewportHeight;
+            s_viewportResized = false;
+        }
+
+        packet.HasScene = true;
+        packet.SceneCamera = s_RendererData.cameraData;
+        packet.Lights = s_RendererData.renderData;
+        packet.Settings = s_RenderSettings;
+
+        // The packet gives back the cleared queue of the previous frame, so neither allocates once they have grown
+        packet.Commands.swap(s_RendererData.renderQueue);
+        s_RendererData.renderQueue.clear();
 
-        s_RendererData.RenderDataUniformBuffer->SetData(&s_RendererData.renderData, sizeof(RendererData::RenderData));
+        // A command without a mesh has nothing to draw
+        std::erase_if(packet.Commands, [](const RenderCommand& command) { return command.mesh == nullptr; });
 
         // Sort the render queue to minimize state changes
+        std::sort(packet.Commands.begin(), packet.Commands.end(), [](const RenderCommand& a, const RenderCommand& b) {
+            return a.material != b.material ? std::less<Material*>()(a.material, b.material) : std::less<Mesh*>()(a.mesh, b.mesh);
+        });
+
+        // The texture streaming stays on the main thread, only the draws are left to the packet execution
+        bool streamTextures = RendererAPI::GetAPI() != RendererAPI::API::None;
+        float viewportHeight = 0.0f;
+        if(streamTextures)
+        {
+            uint32_t height = s_viewportHeight > 0 ? s_viewportHeight : s_MainFramebuffer->GetHeight();
+            viewportHeight = (float)(packet.Resize ? packet.Height : height);
+        }
 
-        for(const auto& command : s_RendererData.renderQueue)
+        Material* lastMaterial = nullptr;
+        Mesh* lastMesh = nullptr;
+        for(const auto& command : packet.Commands)
         {
-            Material* material = command.material.get();
+            // The commands are sorted, so each mesh and material is retained once per run. The default material
+            // (nullptr) is owned by the renderer
+            if(command.material != lastMaterial && command.material != nullptr)
+            {
+                packet.Retained.push_back(command.material->weak_from_this().lock());
+                lastMaterial = command.material;
+            }
 
-            if(material == nullptr)
+            if(command.mesh != lastMesh)
             {
-                material = s_RendererData.DefaultMaterial.get();
+                packet.Retained.push_back(command.mesh->weak_from_this().lock());
+                lastMesh = command.mesh;
             }
-            
-            material->Use();
 
-            const Ref<Shader>& shader = material->GetShader();
+            if(streamTextures && command.material != nullptr)
+            {
+                float screenSize = GetScreenSize(command.mesh->GetAABB(), command.transform, packet.SceneCamera, viewportHeight);
+                RequestTextureMips(command.material, screenSize);
+            }
+        }
 
-            shader->Bind();
-            shader->setMat4("model", command.transform);
-            shader->setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(command.transform))));
+        DebugRenderer::Capture(packet.DebugLines, packet.DebugCircles);
 
-            //REMOVE: This is for the first release of the engine it should be handled differently
-            shader->setBool("showNormals", s_RenderSettings.showNormals);
+        s_RendererData.RenderTexture = s_MainRenderTexture;
 
-            // Convert entityID to vec3
-            uint32_t r = (command.entityID & 0x000000FF) >> 0;
-            uint32_t g = (command.entityID & 0x0000FF00) >> 8;
-            uint32_t b = (command.entityID & 0x00FF0000) >> 16;
-            glm::vec3 entityIDVec3 = glm::vec3(r / 255.0f, g / 255.0f, b / 255.0f);
+        if(streamTextures)
+            TextureStreamer::Update();
+    }
 
-            shader->setVec3("entityID", entityIDVec3);
+    void Renderer::ExecutePacket(FramePacket& packet)
+    {
+        ZoneScoped;
 
-            RendererAPI::DrawIndexed(command.mesh->GetVertexArray());
+        RendererStats& stats = packet.Stats;
+        stats = RendererStats();
 
-            s_Stats.DrawCalls++;
+        // The null backend counts the draws the packet would issue, the scene ones and the overlay ones
+        if(RendererAPI::GetAPI() == RendererAPI::API::None)
+        {
+            for(const auto& command : packet.Commands)
+            {
+                stats.VertexCount += command.mesh->GetVertices().size();
+                stats.IndexCount += command.mesh->GetIndices().size();
+            }
 
-            s_Stats.VertexCount += command.mesh->GetVertices().size();
-            s_Stats.IndexCount += command.mesh->GetIndices().size();
+            stats.DrawCalls = (uint32_t)(packet.Commands.size() + packet.OverlayDraws.size());
+            return;
         }
 
-        // Test drawing the skybox
-        RendererAPI::SetDepthMask(false);
-        s_SkyboxShader->Bind();
-        RendererAPI::DrawIndexed(s_SkyboxMesh->GetVertexArray());
-        RendererAPI::SetDepthMask(true);
+        if(packet.Resize)
+        {
+            s_MainFramebuffer->Resize(packet.Width, packet.Height);
+            s_PostProcessingFramebuffer->Resize(packet.Width, packet.Height);
+        }
 
-        if(s_RenderSettings.PostProcessing)
+        if(packet.HasScene)
         {
-            //Render All the fancy effects :D
+            ZoneScopedN("Scene");
+
+            s_RendererData.CameraUniformBuffer->SetData(&packet.SceneCamera, sizeof(RendererData::CameraData));
 
-            //ToneMapping
-            s_PostProcessingFramebuffer->Bind();
+            s_MainFramebuffer->Bind();
 
-            s_ToneMappingShader->Bind();
-            s_ToneMappingShader->setInt("screenTexture", 0);
-            s_ToneMappingShader->setFloat("exposure", s_RenderSettings.Exposure);
-            s_MainRenderTexture->Bind(0);
+            // Without the entity ID pass the second attachment is not a draw buffer, the shader output to it is discarded
+            if (packet.Settings.EntityIDPass)
+                s_MainFramebuffer->SetDrawBuffers({0, 1});
+            else
+                s_MainFramebuffer->SetDrawBuffers({0});
 
-            RendererAPI::DrawIndexed(s_ScreenQuad->GetVertexArray());
+            RendererAPI::SetClearColor({0.03f,0.03f,0.03f,1.0});
+            RendererAPI::Clear();
 
-            s_ToneMappingShader->Unbind();
+            if (packet.Settings.EntityIDPass)
+                s_EntityIDTexture->Clear({-1.0f,0.0f,0.0f,0.0f});
 
-            //This has to be set because the s_ScreenQuad overwrites the depth buffer
-            RendererAPI::SetDepthMask(false);
+            s_RendererData.RenderDataUniformBuffer->SetData(&packet.Lights, sizeof(RendererData::RenderData));
 
-            //Final Pass
-            s_MainFramebuffer->Bind();
-            s_MainFramebuffer->SetDrawBuffers({0});
-            
-            s_FinalPassShader->Bind();
-            s_FinalPassShader->setInt("screenTexture", 0);
-            s_PostProcessingTexture->Bind(0);
+            for(const auto& command : packet.Commands)
+            {
+                Material* material = command.material != nullptr ? command.material : s_RendererData.DefaultMaterial.get();
+
+                material->Use();
+
+                const Ref<Shader>& shader = material->GetShader();
+
+                shader->Bind();
+                shader->setMat4("model", command.transform);
+                shader->setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(command.transform))));
+
+                //REMOVE: This is for the first release of the engine it should be handled differently
+                shader->setBool("showNormals", packet.Settings.showNormals);
+
+                // Convert entityID to vec3
+                uint32_t r = (command.entityID & 0x000000FF) >> 0;
+                uint32_t g = (command.entityID & 0x0000FF00) >> 8;
+                uint32_t b = (command.entityID & 0x00FF0000) >> 16;
+                glm::vec3 entityIDVec3 = glm::vec3(r / 255.0f, g / 255.0f, b / 255.0f);
+
+                shader->setVec3("entityID", entityIDVec3);
 
-            RendererAPI::DrawIndexed(s_ScreenQuad->GetVertexArray());
+                RendererAPI::DrawIndexed(command.mesh->GetVertexArray());
 
-            s_FinalPassShader->Unbind();
+                stats.DrawCalls++;
 
+                stats.VertexCount += command.mesh->GetVertices().size();
+                stats.IndexCount += command.mesh->GetIndices().size();
+            }
+
+            // Test drawing the skybox
+            RendererAPI::SetDepthMask(false);
+            s_SkyboxShader->Bind();
+            RendererAPI::DrawIndexed(s_SkyboxMesh->GetVertexArray());
             RendererAPI::SetDepthMask(true);
+
+            if(packet.Settings.PostProcessing)
+            {
+                //Render All the fancy effects :D
+
+                //ToneMapping
+                s_PostProcessingFramebuffer->Bind();
+
+                s_ToneMappingShader->Bind();
+                s_ToneMappingShader->setInt("screenTexture", 0);
+                s_ToneMappingShader->setFloat("exposure", packet.Settings.Exposure);
+                s_MainRenderTexture->Bind(0);
+
+                RendererAPI::DrawIndexed(s_ScreenQuad->GetVertexArray());
+
+                s_ToneMappingShader->Unbind();
+
+                //This has to be set because the s_ScreenQuad overwrites the depth buffer
+                RendererAPI::SetDepthMask(false);
+
+                //Final Pass
+                s_MainFramebuffer->Bind();
+                s_MainFramebuffer->SetDrawBuffers({0});
+
+                s_FinalPassShader->Bind();
+                s_FinalPassShader->setInt("screenTexture", 0);
+                s_PostProcessingTexture->Bind(0);
+
+                RendererAPI::DrawIndexed(s_ScreenQuad->GetVertexArray());
+
+                s_FinalPassShader->Unbind();
+
+                RendererAPI::SetDepthMask(true);
+            }
+
+            DebugRenderer::Flush(packet.DebugLines, packet.DebugCircles);
+
+            s_MainFramebuffer->UnBind();
         }
 
-        DebugRenderer::Flush();
+        if(packet.HasOverlay || !packet.OverlayDraws.empty())
+        {
+            ZoneScopedN("Overlay");
 
-        //Final Pass
-        s_RendererData.RenderTexture = s_MainRenderTexture;
+            if(packet.HasOverlay)
+                s_RendererData.CameraUniformBuffer->SetData(&packet.OverlayCamera, sizeof(RendererData::CameraData));
+
+            s_MainFramebuffer->Bind();
 
-        s_MainFramebuffer->UnBind();
+            for(const auto& draw : packet.OverlayDraws)
+            {
+                draw.shader->Bind();
+                draw.shader->setMat4("model", draw.transform);
+                draw.shader->setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(draw.transform))));
 
-        s_RendererData.renderQueue.clear();
+                //REMOVE: This is for the first release of the engine it should be handled differently
+                draw.shader->setBool("showNormals", packet.Settings.showNormals);
+
+                // Convert entityID to vec3
+                uint32_t r = (draw.entityID & 0x000000FF) >> 0;
+                uint32_t g = (draw.entityID & 0x0000FF00) >> 8;
+                uint32_t b = (draw.entityID & 0x00FF0000) >> 16;
+                glm::vec3 entityIDVec3 = glm::vec3(r / 255.0f, g / 255.0f, b / 255.0f);
+
+                draw.shader->setVec3("entityID", entityIDVec3);
+
+                RendererAPI::DrawIndexed(draw.vertexArray);
+
+                stats.DrawCalls++;
+            }
+
+            s_MainFramebuffer->UnBind();
+        }
+    }
+
+    void Renderer::RecyclePacket(FramePacket& packet)
+    {
+        s_Stats = packet.Stats;
+
+        packet.Resize = false;
+        packet.HasScene = false;
+        packet.HasOverlay = false;
+        packet.Commands.clear();
+        packet.DebugLines.clear();
+        packet.DebugCircles.clear();
+        packet.OverlayDraws.clear();
+        packet.Retained.clear();
+        packet.ImGuiDrawData = nullptr;
     }
 
     //TEMPORAL
@@ -237,14 +422,15 @@ namespace Coffee {
         s_RendererData.cameraData.view = camera.GetViewMatrix();
         s_RendererData.cameraData.projection = camera.GetProjection();
         s_RendererData.cameraData.position = camera.GetPosition();
-        s_RendererData.CameraUniformBuffer->SetData(&s_RendererData.cameraData, sizeof(RendererData::CameraData));
 
-        s_MainFramebuffer->Bind();
+        FramePacket& packet = RenderThread::GetPacket();
+        packet.HasOverlay = true;
+        packet.OverlayCamera = s_RendererData.cameraData;
     }
 
     void Renderer::EndOverlay()
     {
-        s_MainFramebuffer->UnBind();
+        // The overlay draws are executed with the packet, after the scene
     }
 
     void Renderer::Submit(const LightComponent& light)
@@ -261,24 +447,7 @@ namespace Coffee {
     // Temporal, this should be removed because this is rendering immediately.
     void Renderer::Submit(const Ref<Shader>& shader, const Ref<VertexArray>& vertexArray, const glm::mat4& transform, uint32_t entityID)
     {
-        shader->Bind();
-        shader->setMat4("model", transform);
-        shader->setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(transform))));
-
-        //REMOVE: This is for the first release of the engine it should be handled differently
-        shader->setBool("showNormals", s_RenderSettings.showNormals);
-
-        // Convert entityID to vec3
-        uint32_t r = (entityID & 0x000000FF) >> 0;
-        uint32_t g = (entityID & 0x0000FF00) >> 8;
-        uint32_t b = (entityID & 0x00FF0000) >> 16;
-        glm::vec3 entityIDVec3 = glm::vec3(r / 255.0f, g / 255.0f, b / 255.0f);
-
-        shader->setVec3("entityID", entityIDVec3);
-
-        RendererAPI::DrawIndexed(vertexArray);
-
-        s_Stats.DrawCalls++;
+        RenderThread::GetPacket().OverlayDraws.push_back({shader, vertexArray, transform, entityID});
     }
 
     void Renderer::OnResize(uint32_t width, uint32_t height)
@@ -288,10 +457,4 @@ namespace Coffee {
 
         s_viewportResized = true;
     }
-
-    void Renderer::ResizeFramebuffers()
-    {
-        s_MainFramebuffer->Resize(s_viewportWidth, s_viewportHeight);
-        s_PostProcessingFramebuffer->Resize(s_viewportWidth, s_viewportHeight);
-    }
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/IO/Resource.h"
+#include "CoffeeEngine/Renderer/DebugRenderer.h"
 #include "CoffeeEngine/Renderer/EditorCamera.h"
 #include "CoffeeEngine/Renderer/Framebuffer.h"
 #include "CoffeeEngine/Renderer/Material.h"
@@ -11,6 +13,9 @@
 #include "CoffeeEngine/Renderer/VertexArray.h"
 #include "CoffeeEngine/Scene/Components.h"
 #include <glm/fwd.hpp>
+#include <vector>
+
+struct ImDrawData;
 
 namespace Coffee {
 
@@ -20,12 +25,18 @@ namespace Coffee {
      * @{
      */
 
+    /**
+     * @brief Structure describing a mesh draw.
+     *
+     * The mesh and material are borrowed from the components and resources that own them, which outlive the
+     * frame, so submitting a command does not touch their reference counts.
+     */
     struct RenderCommand
     {
-        glm::mat4 transform;
-        Ref<Mesh> mesh;
-        Ref<Material> material;
-        uint32_t entityID;
+        glm::mat4 transform; ///< The world transform.
+        Mesh* mesh; ///< The mesh to draw.
+        Material* material; ///< The material, nullptr for the default material.
+        uint32_t entityID; ///< The entity written to the entity ID attachment.
     };
 
     /**
@@ -62,7 +73,7 @@ namespace Coffee {
 
         Ref<Texture2D> RenderTexture; ///< Render texture.
 
-        std::vector<RenderCommand> renderQueue; ///< Render queue.
+        std::vector<RenderCommand> renderQueue; ///< Render queue, moved to the frame packet by EndScene.
     };
 
     /**
@@ -85,11 +96,54 @@ namespace Coffee {
         bool Bloom = false; ///< Enable or disable bloom.
         bool FXAA = false; ///< Enable or disable FXAA.
         float Exposure = 1.0f; ///< Exposure value.
+        bool EntityIDPass = false; ///< Write the entity ID attachment, only needed to debug it since picking is a CPU ray cast.
 
         // REMOVE: This is for the first release of the engine it should be handled differently
         bool showNormals = false;
     };
 
+    /**
+     * @brief Structure describing an immediate draw of a vertex array, drawn after the scene like the editor overlays.
+     */
+    struct OverlayDraw
+    {
+        Ref<Shader> shader; ///< The shader.
+        Ref<VertexArray> vertexArray; ///< The vertex array.
+        glm::mat4 transform; ///< The model matrix.
+        uint32_t entityID; ///< The entity written to the entity ID attachment.
+    };
+
+    /**
+     * @brief Structure containing everything the GPU submission of a frame needs.
+     *
+     * The main thread records it through the Renderer and the RenderThread executes it, so nothing in it may point to
+     * data the main thread changes meanwhile. The meshes and materials borrowed by the commands are kept alive by
+     * Retained until the packet is recycled.
+     */
+    struct FramePacket
+    {
+        bool Resize = false; ///< Whether the framebuffers are resized to Width and Height first.
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+
+        bool HasScene = false; ///< Whether EndScene was called this frame.
+        RendererData::CameraData SceneCamera; ///< The camera of the scene.
+        RendererData::RenderData Lights; ///< The lights of the scene.
+        RenderSettings Settings; ///< The settings when the scene ended.
+        std::vector<RenderCommand> Commands; ///< The mesh draws, sorted by material then mesh.
+        std::vector<DebugVertex> DebugLines; ///< The debug lines batched since the previous scene.
+        std::vector<DebugVertex> DebugCircles; ///< The debug circles batched since the previous scene.
+
+        bool HasOverlay = false; ///< Whether BeginOverlay was called this frame.
+        RendererData::CameraData OverlayCamera; ///< The camera of the overlay.
+        std::vector<OverlayDraw> OverlayDraws; ///< The immediate draws, in submission order.
+
+        std::vector<Ref<Resource>> Retained; ///< Keeps the meshes and materials of the commands alive until the packet is recycled.
+        ImDrawData* ImGuiDrawData = nullptr; ///< Valid until the next ImGui frame, which starts once the packet is executed.
+
+        RendererStats Stats; ///< Written by the execution.
+    };
+
     /**
      * @brief Class representing the 3D renderer.
      */
@@ -97,7 +151,7 @@ namespace Coffee {
     {
     public:
         /**
-         * @brief Initializes the renderer.
+         * @brief Initializes the renderer, only its CPU side with the null backend of RendererAPI.
          */
         static void Init();
 
@@ -120,7 +174,7 @@ namespace Coffee {
         static void BeginScene(Camera& camera, const glm::mat4& transform);
 
         /**
-         * @brief Ends the current scene.
+         * @brief Ends the current scene, moving its commands, lights and debug lines to the frame packet.
          */
         static void EndScene();
 
@@ -137,6 +191,13 @@ namespace Coffee {
 
         static void Submit(const RenderCommand& command);
 
+        /**
+         * @brief Submits an immediate draw, drawn after the scene with the overlay camera if there is one.
+         * @param shader The shader.
+         * @param vertexArray The vertex array.
+         * @param transform The model matrix.
+         * @param entityID The entity written to the entity ID attachment.
+         */
         static void Submit(const Ref<Shader>& shader, const Ref<VertexArray>& vertexArray, const glm::mat4& transform = glm::mat4(1.0f), uint32_t entityID = 4294967295);
 
         /**
@@ -147,6 +208,19 @@ namespace Coffee {
          //Todo change this to a light class and not a component
         static void Submit(const LightComponent& light);
 
+        /**
+         * @brief Executes the GL calls of a frame packet, on the thread that has the context. The null backend only
+         * counts the draws in the packet statistics.
+         * @param packet The packet.
+         */
+        static void ExecutePacket(FramePacket& packet);
+
+        /**
+         * @brief Publishes the statistics of an executed packet and clears it for the next frame, on the main thread.
+         * @param packet The packet.
+         */
+        static void RecyclePacket(FramePacket& packet);
+
         /**
          * @brief Resizes the renderer to the specified width and height.
          * @param width The new width.
@@ -171,6 +245,9 @@ namespace Coffee {
          */
         static const Ref<Texture2D>& GetEntityIDTexture() { return s_EntityIDTexture; }
 
+        /**
+         * @brief Reads the entity ID attachment back, a synchronous GPU stall only valid with RenderSettings::EntityIDPass.
+         */
         static glm::vec4 GetEntityIDAtPixel(int x, int y) { return s_MainFramebuffer->GetPixelColor(x, y, 1); }
 
         /**
@@ -180,7 +257,7 @@ namespace Coffee {
         static const RendererData& GetData() { return s_RendererData; }
 
         /**
-         * @brief Gets the renderer statistics.
+         * @brief Gets the renderer statistics of the last executed packet, the previous frame with the render thread.
          * @return A reference to the renderer statistics.
          */
         static const RendererStats& GetStats() { return s_Stats; }
@@ -191,10 +268,6 @@ namespace Coffee {
          */
         static RenderSettings& GetRenderSettings() { return s_RenderSettings; }
 
-    private:
-
-        static void ResizeFramebuffers();
-
     private:
         static RendererData s_RendererData; ///< Renderer data.
         static RendererStats s_Stats; ///< Renderer statistics.
@@ -6,6 +6,7 @@
 namespace Coffee {
 
 	Scope<RendererAPI> RendererAPI::s_RendererAPI = RendererAPI::Create();
+	RendererAPI::API RendererAPI::s_API = RendererAPI::API::OpenGL;
 
     void OpenGLMessageCallback(
 		unsigned source,
@@ -31,6 +32,9 @@ namespace Coffee {
     {
         ZoneScoped;
 
+        if (s_API == API::None)
+            return;
+
 	#ifdef COFFEE_DEBUG
 			glEnable(GL_DEBUG_OUTPUT);
 			glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);//can slow down the program
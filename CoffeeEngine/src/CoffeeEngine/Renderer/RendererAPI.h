@@ -18,11 +18,32 @@ namespace Coffee {
      */
     class RendererAPI {
     public:
+        /**
+         * @brief Enum representing the graphics backends.
+         */
+        enum class API
+        {
+            None, ///< Null backend, no GPU objects are created and nothing is drawn.
+            OpenGL ///< OpenGL 4.5 backend.
+        };
+
         /**
          * @brief Initializes the Renderer API.
          */
         static void Init();
 
+        /**
+         * @brief Sets the graphics backend, before the renderer and any GPU resource are created.
+         * @param api The backend.
+         */
+        static void SetAPI(API api) { s_API = api; }
+
+        /**
+         * @brief Gets the graphics backend.
+         * @return The backend.
+         */
+        static API GetAPI() { return s_API; }
+
         /**
          * @brief Sets the clear color for the renderer.
          * @param color The clear color as a glm::vec4.
@@ -62,6 +83,7 @@ namespace Coffee {
 
     private:
         static Scope<RendererAPI> s_RendererAPI; ///< The Renderer API instance.
+        static API s_API; ///< The graphics backend.
     };
 
     /** @} */
@@ -1,14 +1,63 @@
 #include "CoffeeEngine/Renderer/Shader.h"
+#include "CoffeeEngine/Core/Hash.h"
+#include "CoffeeEngine/Core/Stopwatch.h"
+#include "CoffeeEngine/IO/CacheManager.h"
 #include "CoffeeEngine/IO/ResourceLoader.h"
 #include "CoffeeEngine/IO/ResourceRegistry.h"
+#include "CoffeeEngine/Renderer/RendererAPI.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include <tracy/Tracy.hpp>
 
 namespace Coffee {
 
+    ShaderCompileStats Shader::s_CompileStats;
+
+    /**
+     * @brief Header of a program binary cache file.
+     */
+    struct ProgramBinaryHeader
+    {
+        static constexpr uint32_t Magic = 0x42534843; ///< "CHSB" in little endian.
+        static constexpr uint32_t Version = 1;
+
+        uint32_t magic = Magic;
+        uint32_t version = Version;
+        uint64_t key = 0; ///< The source and driver hash, checked against the file name to detect collisions.
+        uint32_t binaryFormat = 0; ///< The driver specific format returned by glGetProgramBinary.
+        uint32_t binarySize = 0;
+    };
+
+    // Program binaries are only valid for the driver that produced them
+    static uint64_t GetDriverHash()
+    {
+        static const uint64_t driverHash = []() {
+            uint64_t hash = Hash::OffsetBasis;
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+            {
+                const char* string = reinterpret_cast<const char*>(glGetString(name));
+                hash = Hash::String(string ? string : "", hash);
+            }
+            return hash;
+        }();
+        return driverHash;
+    }
+
+    static bool IsProgramBinarySupported()
+    {
+        static const bool supported = []() {
+            GLint formatCount = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+            return formatCount > 0;
+        }();
+        return supported;
+    }
+
     Shader::Shader(const std::filesystem::path& shaderPath)
     {
         ZoneScoped;
@@ -47,7 +96,7 @@ namespace Coffee {
     {
         ZoneScoped;
 
-        glDeleteProgram(m_ShaderID);
+        RenderThread::Release([program = m_ShaderID]() { glDeleteProgram(program); });
     }
 
     void Shader::Bind()
@@ -176,44 +225,163 @@ namespace Coffee {
 
     void Shader::CompileShader(const std::string& shaderSource)
     {
-        const std::string vertexDelimiter = "#[vertex]";
-        const std::string fragmentDelimiter = "#[fragment]";
+        ZoneScoped;
+
+        // The null backend has no program, the shader only keeps its name
+        if (RendererAPI::GetAPI() == RendererAPI::API::None)
+            return;
+
+        RenderThread::AcquireContext();
+
+        Stopwatch stopwatch;
+        stopwatch.Start();
+
+        uint64_t key = Hash::String(shaderSource, GetDriverHash());
+
+        // The embedded shaders compile when the renderer starts, before a project sets the cache path, their
+        // binaries go to the engine cache
+        bool binaryCache = IsProgramBinarySupported() && !CacheManager::GetShaderCachePath().empty();
+
+        if (binaryCache && LoadProgramBinary(key))
+        {
+            s_CompileStats.CachedPrograms++;
+        }
+        else
+        {
+            const std::string vertexDelimiter = "#[vertex]";
+            const std::string fragmentDelimiter = "#[fragment]";
+
+            size_t vertexPos = shaderSource.find(vertexDelimiter);
+            size_t fragmentPos = shaderSource.find(fragmentDelimiter);
+
+            if(vertexPos == std::string::npos || fragmentPos == std::string::npos)
+            {
+                COFFEE_CORE_ERROR("ERROR::SHADER::DELIMITER_NOT_FOUND: Delimiter not found in shader file!");
+                return;
+            }
+
+            std::string vertexCode = shaderSource.substr(vertexPos + vertexDelimiter.length(), fragmentPos - vertexPos - vertexDelimiter.length());
+            std::string fragmentCode = shaderSource.substr(fragmentPos + fragmentDelimiter.length(), shaderSource.length() - fragmentPos - fragmentDelimiter.length());
+
+            const char* vShaderCode = vertexCode.c_str();
+            const char * fShaderCode = fragmentCode.c_str();
+            // 2. compile shaders
+            unsigned int vertex, fragment;
+            // vertex shader
+            vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(vertex, 1, &vShaderCode, NULL);
+            glCompileShader(vertex);
+            checkCompileErrors(vertex, "VERTEX");
+            // fragment Shader
+            fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragment, 1, &fShaderCode, NULL);
+            glCompileShader(fragment);
+            checkCompileErrors(fragment, "FRAGMENT");
+            // shader Program
+            m_ShaderID = glCreateProgram();
+            glAttachShader(m_ShaderID, vertex);
+            glAttachShader(m_ShaderID, fragment);
+            glProgramParameteri(m_ShaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            glLinkProgram(m_ShaderID);
+            checkCompileErrors(m_ShaderID, "PROGRAM");
+            // delete the shaders as they're linked into our program now and no longer necessary
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+
+            if (binaryCache)
+            {
+                SaveProgramBinary(key);
+            }
+
+            s_CompileStats.CompiledPrograms++;
+        }
+
+        stopwatch.Stop();
+        s_CompileStats.CompileTime += stopwatch.GetPreciseElapsedTime() * 1000.0;
+        TracyPlot("Shader Compile Time (ms)", s_CompileStats.CompileTime);
+    }
+
+    std::filesystem::path Shader::GetProgramBinaryPath(uint64_t key)
+    {
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+        return CacheManager::GetShaderCachePath() / (std::string(name) + ".bin");
+    }
+
+    bool Shader::LoadProgramBinary(uint64_t key)
+    {
+        ZoneScoped;
+
+        std::ifstream file(GetProgramBinaryPath(key), std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        ProgramBinaryHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != ProgramBinaryHeader::Magic || header.version != ProgramBinaryHeader::Version ||
+            header.key != key || header.binarySize == 0)
+        {
+            return false;
+        }
+
+        std::vector<char> binary(header.binarySize);
+        file.read(binary.data(), binary.size());
+        if (!file)
+            return false;
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, header.binaryFormat, binary.data(), header.binarySize);
+
+        // The driver rejects binaries it can no longer use (e.g. after an update), fall back to the source
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            COFFEE_CORE_WARN("Shader: Program binary {0} was rejected by the driver, compiling from source", GetProgramBinaryPath(key).filename().string());
+            glDeleteProgram(program);
+            return false;
+        }
+
+        m_ShaderID = program;
+        return true;
+    }
+
+    void Shader::SaveProgramBinary(uint64_t key)
+    {
+        ZoneScoped;
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(m_ShaderID, GL_LINK_STATUS, &linked);
+        GLint length = 0;
+        glGetProgramiv(m_ShaderID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!linked || length <= 0)
+            return;
+
+        ProgramBinaryHeader header;
+        header.key = key;
+
+        std::vector<char> binary(length);
+        GLsizei binarySize = 0;
+        GLenum binaryFormat = 0;
+        glGetProgramBinary(m_ShaderID, length, &binarySize, &binaryFormat, binary.data());
+        if (binarySize <= 0)
+            return;
+
+        header.binaryFormat = binaryFormat;
+        header.binarySize = static_cast<uint32_t>(binarySize);
 
-        size_t vertexPos = shaderSource.find(vertexDelimiter);
-        size_t fragmentPos = shaderSource.find(fragmentDelimiter);
+        std::error_code error;
+        std::filesystem::create_directories(CacheManager::GetShaderCachePath(), error);
 
-        if(vertexPos == std::string::npos || fragmentPos == std::string::npos)
+        std::ofstream file(GetProgramBinaryPath(key), std::ios::binary);
+        if (!file.is_open())
         {
-            COFFEE_CORE_ERROR("ERROR::SHADER::DELIMITER_NOT_FOUND: Delimiter not found in shader file!");
+            COFFEE_CORE_WARN("Shader: Could not write the program binary to {0}", CacheManager::GetShaderCachePath().string());
             return;
         }
 
-        std::string vertexCode = shaderSource.substr(vertexPos + vertexDelimiter.length(), fragmentPos - vertexPos - vertexDelimiter.length());
-        std::string fragmentCode = shaderSource.substr(fragmentPos + fragmentDelimiter.length(), shaderSource.length() - fragmentPos - fragmentDelimiter.length());
-
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        m_ShaderID = glCreateProgram();
-        glAttachShader(m_ShaderID, vertex);
-        glAttachShader(m_ShaderID, fragment);
-        glLinkProgram(m_ShaderID);
-        checkCompileErrors(m_ShaderID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binarySize);
     }
 
 }
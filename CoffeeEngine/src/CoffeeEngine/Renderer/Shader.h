@@ -6,6 +6,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <filesystem>
 #include <string>
 #include <unordered_map>
 
@@ -17,8 +18,22 @@ namespace Coffee {
      * @{
      */
 
+    /**
+     * @brief Structure containing the shader compilation statistics.
+     */
+    struct ShaderCompileStats
+    {
+        uint32_t CompiledPrograms = 0; ///< Number of programs compiled and linked from source.
+        uint32_t CachedPrograms = 0; ///< Number of programs loaded from the program binary cache.
+        double CompileTime = 0.0; ///< Time spent building programs, from source or from the cache, in milliseconds.
+    };
+
     /**
      * @brief Class representing a shader program.
+     *
+     * Linked programs are stored in the program binary cache (CacheManager::GetShaderCachePath()) keyed by
+     * a hash of the source and the driver, so the next construction with the same source skips the compilation.
+     * The shaders built before a project sets the cache path, such as the embedded ones, use the engine cache.
      */
     class Shader : public Resource
     {
@@ -125,11 +140,34 @@ namespace Coffee {
          */
         void checkCompileErrors(GLuint shader, std::string type);
 
+        /**
+         * @brief Gets the shader compilation statistics since the start.
+         * @return A reference to the statistics.
+         */
+        static const ShaderCompileStats& GetCompileStats() { return s_CompileStats; }
+
     private:
         void CompileShader(const std::string& shaderSource);
 
+        /**
+         * @brief Creates the program from the program binary cache.
+         * @param key The cache key of the program.
+         * @return True if the binary was found and accepted by the driver.
+         */
+        bool LoadProgramBinary(uint64_t key);
+
+        /**
+         * @brief Stores the linked program in the program binary cache.
+         * @param key The cache key of the program.
+         */
+        void SaveProgramBinary(uint64_t key);
+
+        static std::filesystem::path GetProgramBinaryPath(uint64_t key);
+
     private:
         unsigned int m_ShaderID; ///< The ID of the shader program.
+
+        static ShaderCompileStats s_CompileStats; ///< The shader compilation statistics.
     };
 
     /** @} */
@@ -3,6 +3,10 @@
 #include "CoffeeEngine/Core/Log.h"
 #include "CoffeeEngine/IO/Resource.h"
 #include "CoffeeEngine/IO/ResourceLoader.h"
+#include "CoffeeEngine/Renderer/RendererAPI.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
+#include "CoffeeEngine/Renderer/TextureCompressor.h"
+#include "CoffeeEngine/Renderer/TextureStreamer.h"
 
 #include <cereal/archives/binary.hpp>
 #include <cereal/types/vector.hpp>
@@ -16,6 +20,16 @@
 #include <glm/vec4.hpp>
 #include <tracy/Tracy.hpp>
 
+// S3TC is not part of core OpenGL, but every desktop driver exposes it.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
 namespace Coffee {
 
     GLenum ImageFormatToOpenGLInternalFormat(ImageFormat format)
@@ -32,6 +46,14 @@ namespace Coffee {
             case ImageFormat::RGB32F: return GL_RGB32F; break;
             case ImageFormat::RGBA32F: return GL_RGBA32F; break;
             case ImageFormat::DEPTH24STENCIL8: return GL_DEPTH24_STENCIL8; break;
+            case ImageFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+            case ImageFormat::SRGB_BC1: return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT; break;
+            case ImageFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+            case ImageFormat::SRGB_BC3: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+            case ImageFormat::BC4: return GL_COMPRESSED_RED_RGTC1; break;
+            case ImageFormat::BC5: return GL_COMPRESSED_RG_RGTC2; break;
+            case ImageFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+            case ImageFormat::SRGB_BC7: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
         }
     }
 
@@ -49,6 +71,9 @@ namespace Coffee {
             case ImageFormat::RGB32F: return GL_RGB; break;
             case ImageFormat::RGBA32F: return GL_RGBA; break;
             case ImageFormat::DEPTH24STENCIL8: return GL_DEPTH_STENCIL; break;
+            case ImageFormat::BC4: return GL_RED; break;
+            case ImageFormat::BC5: return GL_RG; break;
+            default: return GL_RGBA; break;
         }
     }
 
@@ -66,15 +91,15 @@ namespace Coffee {
             case ImageFormat::RGB32F: return 3; break;
             case ImageFormat::RGBA32F: return 4; break;
             case ImageFormat::DEPTH24STENCIL8: return 1; break;
+            case ImageFormat::BC4: return 1; break;
+            case ImageFormat::BC5: return 2; break;
+            default: return 4; break;
         }
     }
 
     Texture2D::Texture2D(const TextureProperties& properties)
-        : m_Properties(properties), m_Width(properties.Width), m_Height(properties.Height)
+        : Texture(ResourceType::Texture2D), m_Properties(properties), m_Width(properties.Width), m_Height(properties.Height)
     {
-        ZoneScoped;
-
-        Texture2D(m_Width, m_Height, m_Properties.Format);
     }
 
     Texture2D::Texture2D(uint32_t width, uint32_t height, ImageFormat imageFormat)
@@ -82,6 +107,18 @@ namespace Coffee {
     {
         ZoneScoped;
 
+        CreateStorage();
+    }
+
+    void Texture2D::CreateStorage()
+    {
+        ZoneScoped;
+
+        if (RendererAPI::GetAPI() == RendererAPI::API::None)
+            return;
+
+        RenderThread::AcquireContext();
+
         int mipLevels = 1 + floor(log2(std::max(m_Width, m_Height)));
 
         GLenum internalFormat = ImageFormatToOpenGLInternalFormat(m_Properties.Format);
@@ -134,6 +171,12 @@ namespace Coffee {
                 break;
             }
 
+            // The null backend keeps the pixels on the CPU only
+            if (RendererAPI::GetAPI() == RendererAPI::API::None)
+                return;
+
+            RenderThread::AcquireContext();
+
             int mipLevels = 1 + floor(log2(std::max(m_Width, m_Height)));
 
             GLenum internalFormat = ImageFormatToOpenGLInternalFormat(m_Properties.Format);
@@ -162,11 +205,51 @@ namespace Coffee {
         }
     }
 
+    Texture2D::Texture2D(const std::filesystem::path& path, const TextureImage& image, bool srgb, TextureUsage usage)
+        : Texture(ResourceType::Texture2D)
+    {
+        ZoneScoped;
+
+        m_FilePath = path;
+        m_Name = path.filename().string();
+
+        m_Properties.srgb = srgb;
+
+        m_Width = image.Width;
+        m_Height = image.Height;
+        m_Properties.Width = m_Width, m_Properties.Height = m_Height;
+
+        m_ContentHash = TextureCompressor::GetContentHash(image, srgb, usage);
+        m_PixelDigest = image.PixelDigest;
+
+        bool hasAlpha = false;
+        if (image.Channels == 2 || image.Channels == 4)
+        {
+            for (size_t i = 3; i < image.Pixels.size() && !hasAlpha; i += 4)
+                hasAlpha = image.Pixels[i] < 255;
+        }
+
+        m_Properties.Format = TextureCompressor::SelectFormat(usage, image.Channels, hasAlpha, srgb);
+
+        // The color channels are only gamma encoded for color textures, the rest are filtered as they are.
+        bool gammaCorrect = srgb && usage == TextureUsage::Color;
+        m_Mips = TextureCompressor::Compress(TextureCompressor::GenerateMipChain(image.Pixels.data(), m_Width, m_Height, gammaCorrect, usage), m_Properties.Format);
+
+        // The storage is created by the streamer, only with the levels that have to be resident.
+        m_textureID = 0;
+        UploadMips();
+    }
+
     Texture2D::~Texture2D()
     {
         ZoneScoped;
 
-        glDeleteTextures(1, &m_textureID);
+        if (IsCompressed())
+        {
+            TextureStreamer::Unregister(this);
+        }
+
+        RenderThread::Release([texture = m_textureID]() { glDeleteTextures(1, &texture); });
 
         if(m_Data.size() > 0)
         {
@@ -230,9 +313,99 @@ namespace Coffee {
         glGenerateTextureMipmap(m_textureID);
     }
 
-    Ref<Texture2D> Texture2D::Load(const std::filesystem::path& path, bool srgb)
+    bool Texture2D::IsSameContent(const TextureImage& image) const
+    {
+        return (uint32_t)m_Width == image.Width && (uint32_t)m_Height == image.Height && m_PixelDigest == image.PixelDigest;
+    }
+
+    bool Texture2D::IsSameContent(const Texture2D& other) const
     {
-        return ResourceLoader::LoadTexture2D(path, srgb);
+        return m_ContentHash == other.m_ContentHash && m_Width == other.m_Width && m_Height == other.m_Height && m_PixelDigest == other.m_PixelDigest;
+    }
+
+    uint64_t Texture2D::GetDataSize() const
+    {
+        uint64_t size = m_Data.size();
+        for (const TextureMip& mip : m_Mips)
+        {
+            size += mip.Data.size();
+        }
+        return size;
+    }
+
+    void Texture2D::UploadMips()
+    {
+        ZoneScoped;
+
+        if (RendererAPI::GetAPI() == RendererAPI::API::None)
+            return;
+
+        TextureStreamer::Register(this);
+    }
+
+    void Texture2D::Reallocate(uint32_t firstMip, uint32_t uploadEnd, uint32_t stagingBuffer, const uint64_t* stagingOffsets)
+    {
+        ZoneScoped;
+
+        RenderThread::AcquireContext();
+
+        GLenum internalFormat = ImageFormatToOpenGLInternalFormat(m_Properties.Format);
+        const TextureMip& top = m_Mips[firstMip];
+
+        GLuint textureID;
+        glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+        glTextureStorage2D(textureID, (GLsizei)(m_Mips.size() - firstMip), internalFormat, top.Width, top.Height);
+
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+        glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        //Add an option to choose the anisotropic filtering level
+        glTextureParameterf(textureID, GL_TEXTURE_MAX_ANISOTROPY, 16.0f);
+
+        if (stagingBuffer)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+        }
+
+        for (uint32_t level = firstMip; level < m_Mips.size(); ++level)
+        {
+            const TextureMip& mip = m_Mips[level];
+
+            if (level < uploadEnd)
+            {
+                // With a pixel unpack buffer bound the data pointer is an offset into it
+                const void* data = stagingBuffer ? reinterpret_cast<const void*>(static_cast<uintptr_t>(stagingOffsets[level - firstMip])) : mip.Data.data();
+                glCompressedTextureSubImage2D(textureID, level - firstMip, 0, 0, mip.Width, mip.Height, internalFormat, (GLsizei)mip.Data.size(), data);
+            }
+            else
+            {
+                glCopyImageSubData(m_textureID, GL_TEXTURE_2D, level - m_ResidentMip, 0, 0, 0,
+                                   textureID, GL_TEXTURE_2D, level - firstMip, 0, 0, 0,
+                                   mip.Width, mip.Height, 1);
+            }
+        }
+
+        if (stagingBuffer)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        glDeleteTextures(1, &m_textureID);
+        m_textureID = textureID;
+        m_ResidentMip = firstMip;
+    }
+
+    void Texture2D::SetMinLod(float lod)
+    {
+        glTextureParameterf(m_textureID, GL_TEXTURE_MIN_LOD, lod);
+    }
+
+    Ref<Texture2D> Texture2D::Load(const std::filesystem::path& path, bool srgb, TextureUsage usage)
+    {
+        return ResourceLoader::LoadTexture2D(path, srgb, true, usage);
     }
 
     Ref<Texture2D> Texture2D::Create(uint32_t width, uint32_t height, ImageFormat format)
@@ -242,6 +415,7 @@ namespace Coffee {
 
     Cubemap::Cubemap(const std::vector<std::filesystem::path>& paths) : Texture(ResourceType::Cubemap)
     {
+        RenderThread::AcquireContext();
         ZoneScoped;
         glGenTextures(1, &m_textureID);
         glBindTexture(GL_TEXTURE_CUBE_MAP, m_textureID);
@@ -298,7 +472,7 @@ namespace Coffee {
     Cubemap::~Cubemap()
     {
         ZoneScoped;
-        glDeleteTextures(1, &m_textureID);
+        RenderThread::Release([texture = m_textureID]() { glDeleteTextures(1, &texture); });
     }
 
     void Cubemap::Bind(uint32_t slot)
@@ -365,6 +539,8 @@ namespace Coffee {
 
     void Cubemap::LoadStandardFromData(const std::vector<unsigned char>& data)
     {
+        RenderThread::AcquireContext();
+
         m_Data = data;
 
         int nrChannels = ImageFormatToChannelCount(m_Properties.Format);
@@ -434,6 +610,8 @@ namespace Coffee {
 
     void Cubemap::LoadHDRFromData(const std::vector<float>& data)
     {
+        RenderThread::AcquireContext();
+
         m_HDRData = data;
 
         int nrChannels = ImageFormatToChannelCount(m_Properties.Format);
@@ -27,7 +27,40 @@ namespace Coffee {
         R32F,
         RGB32F,
         RGBA32F,
-        DEPTH24STENCIL8
+        DEPTH24STENCIL8,
+        BC1,
+        SRGB_BC1,
+        BC3,
+        SRGB_BC3,
+        BC4,
+        BC5,
+        BC7,
+        SRGB_BC7
+    };
+
+    /**
+     * @brief How the channels of a texture are used by the materials, it selects the block compression at import.
+     */
+    enum class TextureUsage
+    {
+        Color,  ///< Albedo or emissive colors, BC1 when opaque and BC3 when it has alpha.
+        Normal, ///< Tangent space normal maps, BC5 with the Z component reconstructed in the shader.
+        Data    ///< Packed linear masks (ambient occlusion, roughness, metallic), BC7 or BC4 for a single channel.
+    };
+
+    /**
+     * @brief A single level of a precomputed mip chain.
+     */
+    struct TextureMip
+    {
+        uint32_t Width, Height;
+        std::vector<unsigned char> Data;
+
+        template<class Archive>
+        void serialize(Archive& archive)
+        {
+            archive(Width, Height, Data);
+        }
     };
 
     struct TextureProperties
@@ -74,13 +107,21 @@ namespace Coffee {
         }
     };
 
+    class TextureStreamer;
+    struct TextureImage;
+
     class Texture2D : public Texture
     {
     public:
         Texture2D() = default;
+        /**
+         * @brief Constructs a texture without GPU storage, it is created when the pixels or the mip chain are set.
+         * @param properties The properties of the texture.
+         */
         Texture2D(const TextureProperties& properties);
         Texture2D(uint32_t width, uint32_t height, ImageFormat imageFormat);
         Texture2D(const std::filesystem::path& path, bool srgb = true);
+        Texture2D(const std::filesystem::path& path, const TextureImage& image, bool srgb, TextureUsage usage);
         ~Texture2D();
 
         void Bind(uint32_t slot) override;
@@ -94,7 +135,38 @@ namespace Coffee {
         void Clear(glm::vec4 color);
         void SetData(void* data, uint32_t size);
 
-        static Ref<Texture2D> Load(const std::filesystem::path& path, bool srgb = true);
+        bool IsCompressed() const { return !m_Mips.empty(); }
+        uint32_t GetMipCount() const { return (uint32_t)m_Mips.size(); }
+        uint32_t GetResidentMip() const { return m_ResidentMip; }
+
+        /**
+         * @brief Gets the hash of the imported pixels and import settings, used to deduplicate textures.
+         * @return The content hash, 0 for textures that were not imported.
+         */
+        uint64_t GetContentHash() const { return m_ContentHash; }
+
+        /**
+         * @brief Checks that a texture with the same content hash was imported from the same pixels, comparing the
+         * size and the independent pixel digest.
+         * @param image The decoded image.
+         * @return True if the texture can be reused for the image.
+         */
+        bool IsSameContent(const TextureImage& image) const;
+
+        /**
+         * @brief Checks that a texture with the same content hash holds the same pixels as this one.
+         * @param other The other texture.
+         * @return True if one texture can be used for the other.
+         */
+        bool IsSameContent(const Texture2D& other) const;
+
+        /**
+         * @brief Gets the size of the texture data, the full mip chain for compressed textures.
+         * @return The size in bytes.
+         */
+        uint64_t GetDataSize() const;
+
+        static Ref<Texture2D> Load(const std::filesystem::path& path, bool srgb = true, TextureUsage usage = TextureUsage::Color);
         static Ref<Texture2D> Create(uint32_t width, uint32_t height, ImageFormat format);
 
     private:
@@ -103,13 +175,13 @@ namespace Coffee {
         template<class Archive>
         void save(Archive& archive) const
         {
-            archive(m_Properties, m_Data, m_Width, m_Height, cereal::base_class<Texture>(this));
+            archive(m_Properties, m_Data, m_Mips, m_ContentHash, m_PixelDigest, m_Width, m_Height, cereal::base_class<Texture>(this));
         }
 
         template <class Archive>
         void load(Archive& archive)
         {
-            archive(m_Properties, m_Data, m_Width, m_Height, cereal::base_class<Texture>(this));
+            archive(m_Properties, m_Data, m_Mips, m_ContentHash, m_PixelDigest, m_Width, m_Height, cereal::base_class<Texture>(this));
         }
 
         template <class Archive>
@@ -117,17 +189,49 @@ namespace Coffee {
         {
             TextureProperties properties;
             data(properties);
-            construct(properties.Width, properties.Height, properties.Format);
+            // The storage of the compressed textures is created by the streamer, only with the resident levels
+            construct(properties);
 
-            data(construct->m_Data, construct->m_Width, construct->m_Height,
+            data(construct->m_Data, construct->m_Mips, construct->m_ContentHash, construct->m_PixelDigest, construct->m_Width, construct->m_Height,
                  cereal::base_class<Texture>(construct.ptr()));
             construct->m_Properties = properties;
-            construct->SetData(construct->m_Data.data(), construct->m_Data.size());
+
+            if (construct->IsCompressed())
+            {
+                construct->UploadMips();
+            }
+            else
+            {
+                construct->CreateStorage();
+                construct->SetData(construct->m_Data.data(), construct->m_Data.size());
+            }
         }
+
+        void UploadMips();
+
+        /**
+         * @brief Creates the GPU storage of an uncompressed texture with the full mip chain.
+         */
+        void CreateStorage();
+
+        /**
+         * @brief Replaces the GPU storage with one holding the levels from firstMip to the end of the mip chain.
+         *
+         * Levels below uploadEnd are uploaded, from the staging buffer when given or from the mip chain otherwise,
+         * the rest are copied from the current storage on the GPU.
+         */
+        void Reallocate(uint32_t firstMip, uint32_t uploadEnd, uint32_t stagingBuffer = 0, const uint64_t* stagingOffsets = nullptr);
+        void SetMinLod(float lod);
+
+        friend class TextureStreamer;
     private:
         TextureProperties m_Properties;
         std::vector<unsigned char> m_Data;
-        uint32_t m_textureID;
+        std::vector<TextureMip> m_Mips; ///< Block compressed mip chain, empty for uncompressed textures.
+        uint32_t m_ResidentMip = 0; ///< First level of the mip chain resident on the GPU.
+        uint64_t m_ContentHash = 0; ///< Hash of the imported pixels and import settings.
+        uint64_t m_PixelDigest = 0; ///< Independent hash of the imported pixels, confirms a content hash match.
+        uint32_t m_textureID = 0;
         int m_Width, m_Height;
     };
 
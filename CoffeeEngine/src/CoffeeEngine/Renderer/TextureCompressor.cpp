@@ -0,0 +1,674 @@
+#include "CoffeeEngine/Renderer/TextureCompressor.h"
+#include "CoffeeEngine/Core/Hash.h"
+#include "CoffeeEngine/Core/Log.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stb_image.h>
+#include <thread>
+#include <tracy/Tracy.hpp>
+
+namespace Coffee {
+
+    namespace
+    {
+        template<typename Function>
+        void ParallelFor(uint32_t count, Function&& function)
+        {
+            uint32_t threadCount = std::min(std::max(1u, std::thread::hardware_concurrency()), count);
+
+            if (threadCount <= 1)
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                    function(i);
+                return;
+            }
+
+            std::atomic<uint32_t> next = 0;
+            auto worker = [&]() {
+                for (uint32_t i = next++; i < count; i = next++)
+                    function(i);
+            };
+
+            std::vector<std::thread> threads;
+            threads.reserve(threadCount - 1);
+            for (uint32_t i = 1; i < threadCount; ++i)
+                threads.emplace_back(worker);
+
+            worker();
+
+            for (std::thread& thread : threads)
+                thread.join();
+        }
+
+        const std::array<float, 256>& GetSRGBToLinearTable()
+        {
+            static const std::array<float, 256> table = []() {
+                std::array<float, 256> values;
+                for (int i = 0; i < 256; ++i)
+                {
+                    float c = i / 255.0f;
+                    values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return values;
+            }();
+            return table;
+        }
+
+        uint8_t LinearToSRGB(float c)
+        {
+            c = std::clamp(c, 0.0f, 1.0f);
+            float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            return (uint8_t)std::lround(s * 255.0f);
+        }
+
+        uint8_t ToByte(float c)
+        {
+            return (uint8_t)std::lround(std::clamp(c, 0.0f, 255.0f));
+        }
+
+        void FetchBlock(const TextureMip& mip, uint32_t blockX, uint32_t blockY, float pixels[16][4])
+        {
+            for (uint32_t y = 0; y < 4; ++y)
+            {
+                uint32_t sourceY = std::min(blockY * 4 + y, mip.Height - 1);
+                for (uint32_t x = 0; x < 4; ++x)
+                {
+                    uint32_t sourceX = std::min(blockX * 4 + x, mip.Width - 1);
+                    const unsigned char* texel = &mip.Data[((size_t)sourceY * mip.Width + sourceX) * 4];
+                    for (int c = 0; c < 4; ++c)
+                        pixels[y * 4 + x][c] = texel[c];
+                }
+            }
+        }
+
+        // Endpoints along the principal axis of the block, found with a few power iterations.
+        template<int N>
+        void FindEndpoints(const float pixels[16][4], float low[4], float high[4])
+        {
+            float mean[N] = {};
+            float minimum[N], maximum[N];
+            for (int c = 0; c < N; ++c)
+            {
+                minimum[c] = 255.0f;
+                maximum[c] = 0.0f;
+            }
+
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int c = 0; c < N; ++c)
+                {
+                    mean[c] += pixels[i][c];
+                    minimum[c] = std::min(minimum[c], pixels[i][c]);
+                    maximum[c] = std::max(maximum[c], pixels[i][c]);
+                }
+            }
+            for (int c = 0; c < N; ++c)
+                mean[c] /= 16.0f;
+
+            float covariance[N][N] = {};
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int a = 0; a < N; ++a)
+                    for (int b = 0; b < N; ++b)
+                        covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+            }
+
+            float axis[N];
+            for (int c = 0; c < N; ++c)
+                axis[c] = maximum[c] - minimum[c];
+
+            for (int iteration = 0; iteration < 8; ++iteration)
+            {
+                float next[N] = {};
+                float length = 0.0f;
+                for (int a = 0; a < N; ++a)
+                {
+                    for (int b = 0; b < N; ++b)
+                        next[a] += covariance[a][b] * axis[b];
+                    length += next[a] * next[a];
+                }
+
+                if (length < 1e-8f)
+                    break;
+
+                length = std::sqrt(length);
+                for (int c = 0; c < N; ++c)
+                    axis[c] = next[c] / length;
+            }
+
+            float axisLength = 0.0f;
+            for (int c = 0; c < N; ++c)
+                axisLength += axis[c] * axis[c];
+
+            if (axisLength < 1e-8f)
+            {
+                for (int c = 0; c < N; ++c)
+                    low[c] = high[c] = mean[c];
+                return;
+            }
+
+            axisLength = std::sqrt(axisLength);
+            for (int c = 0; c < N; ++c)
+                axis[c] /= axisLength;
+
+            float minimumT = 0.0f, maximumT = 0.0f;
+            for (int i = 0; i < 16; ++i)
+            {
+                float t = 0.0f;
+                for (int c = 0; c < N; ++c)
+                    t += (pixels[i][c] - mean[c]) * axis[c];
+                minimumT = std::min(minimumT, t);
+                maximumT = std::max(maximumT, t);
+            }
+
+            for (int c = 0; c < N; ++c)
+            {
+                low[c] = std::clamp(mean[c] + axis[c] * minimumT, 0.0f, 255.0f);
+                high[c] = std::clamp(mean[c] + axis[c] * maximumT, 0.0f, 255.0f);
+            }
+        }
+
+        uint16_t PackRGB565(const float color[4])
+        {
+            uint16_t r = (uint16_t)std::lround(color[0] * 31.0f / 255.0f);
+            uint16_t g = (uint16_t)std::lround(color[1] * 63.0f / 255.0f);
+            uint16_t b = (uint16_t)std::lround(color[2] * 31.0f / 255.0f);
+            return (uint16_t)((r << 11) | (g << 5) | b);
+        }
+
+        void UnpackRGB565(uint16_t packed, float color[3])
+        {
+            uint32_t r = (packed >> 11) & 31;
+            uint32_t g = (packed >> 5) & 63;
+            uint32_t b = packed & 31;
+            color[0] = (float)((r << 3) | (r >> 2));
+            color[1] = (float)((g << 2) | (g >> 4));
+            color[2] = (float)((b << 3) | (b >> 2));
+        }
+
+        void EncodeBC1(const float pixels[16][4], uint8_t* out)
+        {
+            float low[4], high[4];
+            FindEndpoints<3>(pixels, low, high);
+
+            uint16_t color0 = PackRGB565(high);
+            uint16_t color1 = PackRGB565(low);
+
+            // color0 > color1 selects the four color mode, which is also the only one BC3 uses.
+            if (color0 < color1)
+                std::swap(color0, color1);
+
+            float palette[4][3];
+            UnpackRGB565(color0, palette[0]);
+            UnpackRGB565(color1, palette[1]);
+            for (int c = 0; c < 3; ++c)
+            {
+                palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+            }
+
+            uint32_t indices = 0;
+            if (color0 != color1)
+            {
+                for (int i = 0; i < 16; ++i)
+                {
+                    uint32_t best = 0;
+                    float bestError = FLT_MAX;
+                    for (uint32_t p = 0; p < 4; ++p)
+                    {
+                        float error = 0.0f;
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            float d = pixels[i][c] - palette[p][c];
+                            error += d * d;
+                        }
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            best = p;
+                        }
+                    }
+                    indices |= best << (i * 2);
+                }
+            }
+
+            out[0] = (uint8_t)(color0 & 0xFF);
+            out[1] = (uint8_t)(color0 >> 8);
+            out[2] = (uint8_t)(color1 & 0xFF);
+            out[3] = (uint8_t)(color1 >> 8);
+            std::memcpy(out + 4, &indices, 4);
+        }
+
+        void EncodeBC4(const float values[16], uint8_t* out)
+        {
+            float minimum = 255.0f, maximum = 0.0f;
+            for (int i = 0; i < 16; ++i)
+            {
+                minimum = std::min(minimum, values[i]);
+                maximum = std::max(maximum, values[i]);
+            }
+
+            uint8_t alpha0 = ToByte(maximum);
+            uint8_t alpha1 = ToByte(minimum);
+
+            uint64_t indices = 0;
+            if (alpha0 != alpha1)
+            {
+                // alpha0 > alpha1 selects the eight value mode.
+                float palette[8];
+                palette[0] = alpha0;
+                palette[1] = alpha1;
+                for (int i = 1; i < 7; ++i)
+                    palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7.0f;
+
+                for (int i = 0; i < 16; ++i)
+                {
+                    uint64_t best = 0;
+                    float bestError = FLT_MAX;
+                    for (uint64_t p = 0; p < 8; ++p)
+                    {
+                        float error = std::abs(values[i] - palette[p]);
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            best = p;
+                        }
+                    }
+                    indices |= best << (i * 3);
+                }
+            }
+
+            out[0] = alpha0;
+            out[1] = alpha1;
+            for (int i = 0; i < 6; ++i)
+                out[2 + i] = (uint8_t)((indices >> (i * 8)) & 0xFF);
+        }
+
+        void EncodeBC4Channel(const float pixels[16][4], int channel, uint8_t* out)
+        {
+            float values[16];
+            for (int i = 0; i < 16; ++i)
+                values[i] = pixels[i][channel];
+            EncodeBC4(values, out);
+        }
+
+        struct BitWriter
+        {
+            uint8_t* Data;
+            uint32_t Position = 0;
+
+            void Write(uint32_t value, uint32_t bits)
+            {
+                for (uint32_t i = 0; i < bits; ++i, ++Position)
+                {
+                    if ((value >> i) & 1)
+                        Data[Position / 8] |= (uint8_t)(1 << (Position % 8));
+                }
+            }
+        };
+
+        // BC7 mode 6: a single RGBA subset with 7 bit endpoints, a p-bit per endpoint and 4 bit indices.
+        void EncodeBC7(const float pixels[16][4], uint8_t* out)
+        {
+            static constexpr int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+            float endpoints[2][4];
+            FindEndpoints<4>(pixels, endpoints[0], endpoints[1]);
+
+            uint32_t quantized[2][4];
+            uint32_t pBits[2];
+            int reconstructed[2][4];
+
+            for (int e = 0; e < 2; ++e)
+            {
+                float bestError = FLT_MAX;
+                for (uint32_t p = 0; p < 2; ++p)
+                {
+                    uint32_t candidate[4];
+                    float error = 0.0f;
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        candidate[c] = (uint32_t)std::clamp(std::lround((endpoints[e][c] - p) / 2.0f), 0l, 127l);
+                        float d = (float)((candidate[c] << 1) | p) - endpoints[e][c];
+                        error += d * d;
+                    }
+
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        pBits[e] = p;
+                        std::memcpy(quantized[e], candidate, sizeof(candidate));
+                    }
+                }
+
+                for (int c = 0; c < 4; ++c)
+                    reconstructed[e][c] = (int)((quantized[e][c] << 1) | pBits[e]);
+            }
+
+            int palette[16][4];
+            for (int w = 0; w < 16; ++w)
+                for (int c = 0; c < 4; ++c)
+                    palette[w][c] = ((64 - weights[w]) * reconstructed[0][c] + weights[w] * reconstructed[1][c] + 32) >> 6;
+
+            uint32_t indices[16];
+            for (int i = 0; i < 16; ++i)
+            {
+                uint32_t best = 0;
+                float bestError = FLT_MAX;
+                for (uint32_t w = 0; w < 16; ++w)
+                {
+                    float error = 0.0f;
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        float d = pixels[i][c] - (float)palette[w][c];
+                        error += d * d;
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = w;
+                    }
+                }
+                indices[i] = best;
+            }
+
+            // The most significant bit of the anchor index is implicit and has to be zero.
+            if (indices[0] & 8)
+            {
+                std::swap(quantized[0], quantized[1]);
+                std::swap(pBits[0], pBits[1]);
+                for (uint32_t& index : indices)
+                    index = 15 - index;
+            }
+
+            std::memset(out, 0, 16);
+            BitWriter writer{out};
+            writer.Write(1 << 6, 7);
+            for (int c = 0; c < 4; ++c)
+            {
+                writer.Write(quantized[0][c], 7);
+                writer.Write(quantized[1][c], 7);
+            }
+            writer.Write(pBits[0], 1);
+            writer.Write(pBits[1], 1);
+            writer.Write(indices[0], 3);
+            for (int i = 1; i < 16; ++i)
+                writer.Write(indices[i], 4);
+        }
+
+        void EncodeBlock(ImageFormat format, const float pixels[16][4], uint8_t* out)
+        {
+            switch (format)
+            {
+                using enum ImageFormat;
+            case BC1:
+            case SRGB_BC1:
+                EncodeBC1(pixels, out);
+                break;
+            case BC3:
+            case SRGB_BC3:
+                EncodeBC4Channel(pixels, 3, out);
+                EncodeBC1(pixels, out + 8);
+                break;
+            case BC4:
+                EncodeBC4Channel(pixels, 0, out);
+                break;
+            case BC5:
+                EncodeBC4Channel(pixels, 0, out);
+                EncodeBC4Channel(pixels, 1, out + 8);
+                break;
+            case BC7:
+            case SRGB_BC7:
+                EncodeBC7(pixels, out);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    static bool FillImage(unsigned char* data, int width, int height, int channels, TextureImage& image)
+    {
+        if (!data)
+            return false;
+
+        image.Width = (uint32_t)width;
+        image.Height = (uint32_t)height;
+        image.Channels = channels;
+        image.Pixels.assign(data, data + (size_t)width * height * 4);
+        stbi_image_free(data);
+
+        {
+            ZoneScopedN("TextureCompressor::HashPixels");
+
+            image.PixelHash = Hash::Value(image.Width);
+            image.PixelHash = Hash::Value(image.Height, image.PixelHash);
+            image.PixelHash = Hash::Bytes(image.Pixels.data(), image.Pixels.size(), image.PixelHash);
+            image.PixelDigest = Hash::Digest(image.Pixels.data(), image.Pixels.size());
+        }
+
+        return true;
+    }
+
+    bool TextureCompressor::DecodeImage(const std::filesystem::path& path, TextureImage& image)
+    {
+        ZoneScoped;
+
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char* data = stbi_load(path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+        if (!data)
+        {
+            COFFEE_CORE_ERROR("Failed to load texture: {0} (REASON: {1})", path.string(), stbi_failure_reason());
+            return false;
+        }
+
+        return FillImage(data, width, height, channels, image);
+    }
+
+    bool TextureCompressor::DecodeImage(const unsigned char* encoded, size_t size, TextureImage& image)
+    {
+        ZoneScoped;
+
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char* data = stbi_load_from_memory(encoded, (int)size, &width, &height, &channels, STBI_rgb_alpha);
+
+        if (!data)
+        {
+            COFFEE_CORE_ERROR("Failed to decode embedded texture (REASON: {0})", stbi_failure_reason());
+            return false;
+        }
+
+        return FillImage(data, width, height, channels, image);
+    }
+
+    uint64_t TextureCompressor::GetContentHash(const TextureImage& image, bool srgb, TextureUsage usage)
+    {
+        // The same pixels imported with other settings compress to another payload
+        uint64_t hash = Hash::Value(srgb, image.PixelHash);
+        return Hash::Value(usage, hash);
+    }
+
+    ImageFormat TextureCompressor::SelectFormat(TextureUsage usage, int channels, bool hasAlpha, bool srgb)
+    {
+        switch (usage)
+        {
+            using enum TextureUsage;
+        case Normal:
+            return ImageFormat::BC5;
+        case Data:
+            if (channels == 1)
+                return ImageFormat::BC4;
+            return srgb ? ImageFormat::SRGB_BC7 : ImageFormat::BC7;
+        case Color:
+        default:
+            if (hasAlpha)
+                return srgb ? ImageFormat::SRGB_BC3 : ImageFormat::BC3;
+            return srgb ? ImageFormat::SRGB_BC1 : ImageFormat::BC1;
+        }
+    }
+
+    std::vector<TextureMip> TextureCompressor::GenerateMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, bool srgb, TextureUsage usage)
+    {
+        ZoneScoped;
+
+        const std::array<float, 256>& toLinear = GetSRGBToLinearTable();
+
+        std::vector<TextureMip> mips;
+        mips.push_back({ width, height, std::vector<unsigned char>(pixels, pixels + (size_t)width * height * 4) });
+
+        while (mips.back().Width > 1 || mips.back().Height > 1)
+        {
+            const TextureMip& source = mips.back();
+
+            TextureMip mip;
+            mip.Width = std::max(1u, source.Width / 2);
+            mip.Height = std::max(1u, source.Height / 2);
+            mip.Data.resize((size_t)mip.Width * mip.Height * 4);
+
+            ParallelFor(mip.Height, [&](uint32_t y) {
+                for (uint32_t x = 0; x < mip.Width; ++x)
+                {
+                    float sum[4] = {};
+                    for (uint32_t sy = 0; sy < 2; ++sy)
+                    {
+                        uint32_t sourceY = std::min(y * 2 + sy, source.Height - 1);
+                        for (uint32_t sx = 0; sx < 2; ++sx)
+                        {
+                            uint32_t sourceX = std::min(x * 2 + sx, source.Width - 1);
+                            const unsigned char* texel = &source.Data[((size_t)sourceY * source.Width + sourceX) * 4];
+
+                            for (int c = 0; c < 3; ++c)
+                            {
+                                if (srgb)
+                                    sum[c] += toLinear[texel[c]];
+                                else if (usage == TextureUsage::Normal)
+                                    sum[c] += texel[c] / 127.5f - 1.0f;
+                                else
+                                    sum[c] += texel[c];
+                            }
+                            sum[3] += texel[3];
+                        }
+                    }
+
+                    unsigned char* texel = &mip.Data[((size_t)y * mip.Width + x) * 4];
+
+                    if (srgb)
+                    {
+                        for (int c = 0; c < 3; ++c)
+                            texel[c] = LinearToSRGB(sum[c] / 4.0f);
+                    }
+                    else if (usage == TextureUsage::Normal)
+                    {
+                        float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            float n = length > 1e-6f ? sum[c] / length : (c == 2 ? 1.0f : 0.0f);
+                            texel[c] = ToByte((n + 1.0f) * 127.5f);
+                        }
+                    }
+                    else
+                    {
+                        for (int c = 0; c < 3; ++c)
+                            texel[c] = ToByte(sum[c] / 4.0f);
+                    }
+                    texel[3] = ToByte(sum[3] / 4.0f);
+                }
+            });
+
+            mips.push_back(std::move(mip));
+        }
+
+        return mips;
+    }
+
+    std::vector<TextureMip> TextureCompressor::Compress(const std::vector<TextureMip>& mips, ImageFormat format)
+    {
+        ZoneScoped;
+
+        const uint32_t blockSize = GetBlockSize(format);
+
+        struct BlockRow
+        {
+            uint32_t Level;
+            uint32_t Row;
+        };
+
+        std::vector<TextureMip> compressed(mips.size());
+        std::vector<BlockRow> rows;
+
+        for (uint32_t level = 0; level < mips.size(); ++level)
+        {
+            const TextureMip& mip = mips[level];
+            compressed[level].Width = mip.Width;
+            compressed[level].Height = mip.Height;
+            compressed[level].Data.resize(GetCompressedSize(format, mip.Width, mip.Height));
+
+            uint32_t blockRows = (mip.Height + 3) / 4;
+            for (uint32_t row = 0; row < blockRows; ++row)
+                rows.push_back({ level, row });
+        }
+
+        ParallelFor((uint32_t)rows.size(), [&](uint32_t index) {
+            const BlockRow& row = rows[index];
+            const TextureMip& mip = mips[row.Level];
+            uint8_t* out = compressed[row.Level].Data.data();
+
+            uint32_t blocksWide = (mip.Width + 3) / 4;
+            for (uint32_t blockX = 0; blockX < blocksWide; ++blockX)
+            {
+                float pixels[16][4];
+                FetchBlock(mip, blockX, row.Row, pixels);
+                EncodeBlock(format, pixels, out + ((size_t)row.Row * blocksWide + blockX) * blockSize);
+            }
+        });
+
+        return compressed;
+    }
+
+    bool TextureCompressor::IsCompressedFormat(ImageFormat format)
+    {
+        switch (format)
+        {
+            using enum ImageFormat;
+        case BC1:
+        case SRGB_BC1:
+        case BC3:
+        case SRGB_BC3:
+        case BC4:
+        case BC5:
+        case BC7:
+        case SRGB_BC7:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    uint32_t TextureCompressor::GetBlockSize(ImageFormat format)
+    {
+        switch (format)
+        {
+            using enum ImageFormat;
+        case BC1:
+        case SRGB_BC1:
+        case BC4:
+            return 8;
+        default:
+            return 16;
+        }
+    }
+
+    uint64_t TextureCompressor::GetCompressedSize(ImageFormat format, uint32_t width, uint32_t height)
+    {
+        return (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+    }
+
+}
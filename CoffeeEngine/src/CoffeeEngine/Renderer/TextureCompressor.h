@@ -0,0 +1,121 @@
+#pragma once
+
+#include "CoffeeEngine/Renderer/Texture.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @defgroup renderer Renderer
+     * @brief Renderer components of the CoffeeEngine.
+     * @{
+     */
+
+    /**
+     * @brief A decoded RGBA8 image, the input of the texture import pipeline.
+     */
+    struct TextureImage
+    {
+        std::vector<unsigned char> Pixels; ///< The RGBA8 pixels, flipped vertically for OpenGL.
+        uint32_t Width = 0, Height = 0;
+        int Channels = 0; ///< The channel count of the source image.
+        uint64_t PixelHash = 0; ///< Hash of the size and the pixels of the image.
+        uint64_t PixelDigest = 0; ///< Independent hash of the pixels, confirms a PixelHash match.
+    };
+
+    /**
+     * @brief CPU side texture import pipeline: decoding, mip chain generation and BC block compression.
+     *
+     * Everything here runs at import time, the result is stored in the cache so loading a
+     * texture only has to upload the precomputed blocks.
+     */
+    class TextureCompressor
+    {
+    public:
+        /**
+         * @brief Decodes an image file to RGBA8.
+         * @param path The path of the image file.
+         * @param image The decoded image.
+         * @return True if the image was decoded successfully.
+         */
+        static bool DecodeImage(const std::filesystem::path& path, TextureImage& image);
+
+        /**
+         * @brief Decodes an encoded image (png, jpg...) held in memory to RGBA8.
+         * @param data The encoded image.
+         * @param size The size of the encoded image in bytes.
+         * @param image The decoded image.
+         * @return True if the image was decoded successfully.
+         */
+        static bool DecodeImage(const unsigned char* data, size_t size, TextureImage& image);
+
+        /**
+         * @brief Gets the content hash of a texture, two textures with the same hash import to the same payload.
+         * @param image The decoded image.
+         * @param srgb Whether the texture holds sRGB encoded colors.
+         * @param usage How the material uses the texture channels.
+         * @return The content hash.
+         */
+        static uint64_t GetContentHash(const TextureImage& image, bool srgb, TextureUsage usage);
+
+        /**
+         * @brief Selects the block compressed format for a texture.
+         * @param usage How the material uses the texture channels.
+         * @param channels The channel count of the source image.
+         * @param hasAlpha Whether the alpha channel has any non opaque texel.
+         * @param srgb Whether the texture holds sRGB encoded colors.
+         * @return The block compressed format.
+         */
+        static ImageFormat SelectFormat(TextureUsage usage, int channels, bool hasAlpha, bool srgb);
+
+        /**
+         * @brief Generates the full mip chain of an RGBA8 image with a box filter.
+         *
+         * sRGB images are filtered in linear space and normal maps are renormalized after filtering.
+         *
+         * @param pixels The RGBA8 pixels of the first level.
+         * @param width The width of the first level.
+         * @param height The height of the first level.
+         * @param srgb Whether the color channels are sRGB encoded.
+         * @param usage How the material uses the texture channels.
+         * @return Every level down to 1x1, the first one being a copy of the source.
+         */
+        static std::vector<TextureMip> GenerateMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, bool srgb, TextureUsage usage);
+
+        /**
+         * @brief Block compresses a mip chain, the blocks of all the levels are encoded in parallel.
+         * @param mips The RGBA8 mip chain.
+         * @param format The block compressed format to encode to.
+         * @return The compressed mip chain.
+         */
+        static std::vector<TextureMip> Compress(const std::vector<TextureMip>& mips, ImageFormat format);
+
+        /**
+         * @brief Checks if a format is block compressed.
+         * @param format The image format.
+         * @return True for the BC formats.
+         */
+        static bool IsCompressedFormat(ImageFormat format);
+
+        /**
+         * @brief Gets the size in bytes of a 4x4 block.
+         * @param format A block compressed image format.
+         * @return 8 for BC1 and BC4, 16 for the others.
+         */
+        static uint32_t GetBlockSize(ImageFormat format);
+
+        /**
+         * @brief Gets the size in bytes of a compressed level.
+         * @param format A block compressed image format.
+         * @param width The width of the level.
+         * @param height The height of the level.
+         * @return The size of the level in bytes.
+         */
+        static uint64_t GetCompressedSize(ImageFormat format, uint32_t width, uint32_t height);
+    };
+
+    /** @} */
+}
@@ -0,0 +1,453 @@
+#include "TextureStreamer.h"
+#include "CoffeeEngine/Core/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <glad/glad.h>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <tracy/Tracy.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @brief Streaming state of a registered texture.
+     */
+    struct StreamedTexture
+    {
+        uint32_t TailMip = 0; ///< First level of the always resident tail of the mip chain.
+        uint32_t RequestedMip = 0; ///< Finest level requested this frame.
+        uint32_t WantedMip = 0; ///< Finest level requested in the last EvictionDelay frames.
+        uint64_t WantedFrame = 0; ///< Frame in which WantedMip was last requested.
+        uint32_t TargetMip = 0; ///< Level the texture should be resident at once the requests are fitted in the budget.
+        float MinLod = 0.0f; ///< Min-LOD clamp fading in the last streamed levels.
+        bool Pending = false; ///< Whether levels of the texture are being staged.
+    };
+
+    /**
+     * @brief Levels of a texture copied into the staging buffer by a worker.
+     */
+    struct StagingJob
+    {
+        Texture2D* Texture = nullptr; ///< The texture the levels belong to.
+        const std::vector<TextureMip>* Mips = nullptr; ///< The mip chain of the texture.
+        uint32_t FirstMip = 0; ///< First staged level.
+        uint32_t EndMip = 0; ///< One past the last staged level, the resident level when the job was issued.
+        std::vector<uint64_t> Offsets; ///< Offset in the staging buffer of each staged level.
+    };
+
+    struct TextureStreamerData
+    {
+        std::unordered_map<Texture2D*, StreamedTexture> Textures; ///< Registered textures, only touched by the main thread.
+        uint64_t Frame = 0;
+
+        GLuint StagingBuffer = 0;
+        char* StagingData = nullptr; ///< Persistent and coherent mapping of the staging buffer.
+        GLsync StagingFence = nullptr; ///< Signaled when the GPU is done reading the last uploaded batch.
+
+        std::vector<std::thread> Workers;
+        std::mutex Mutex;
+        std::condition_variable WorkAvailable;
+        std::condition_variable WorkDone;
+        std::deque<StagingJob> Queue; ///< Jobs waiting for a worker.
+        std::vector<StagingJob> Staged; ///< Jobs whose levels are already in the staging buffer.
+        std::vector<Texture2D*> Active; ///< Texture each worker is staging, one slot per worker.
+        bool Running = false;
+    };
+
+    static TextureStreamerData* s_Data = nullptr;
+    static TextureStreamingStats s_Stats;
+    static uint64_t s_Budget = TextureStreamer::DefaultBudget;
+
+    static uint64_t GetMipChainSize(const std::vector<TextureMip>& mips, uint32_t firstMip)
+    {
+        uint64_t size = 0;
+        for (uint32_t level = firstMip; level < mips.size(); ++level)
+        {
+            size += mips[level].Data.size();
+        }
+        return size;
+    }
+
+    static void StagingWorker(uint32_t index)
+    {
+        std::unique_lock lock(s_Data->Mutex);
+
+        while (true)
+        {
+            s_Data->WorkAvailable.wait(lock, [] { return !s_Data->Running || !s_Data->Queue.empty(); });
+
+            if (!s_Data->Running)
+                return;
+
+            StagingJob job = std::move(s_Data->Queue.front());
+            s_Data->Queue.pop_front();
+            s_Data->Active[index] = job.Texture;
+
+            lock.unlock();
+            {
+                ZoneScopedN("TextureStreamer::Stage");
+
+                for (uint32_t level = job.FirstMip; level < job.EndMip; ++level)
+                {
+                    const TextureMip& mip = (*job.Mips)[level];
+                    std::memcpy(s_Data->StagingData + job.Offsets[level - job.FirstMip], mip.Data.data(), mip.Data.size());
+                }
+            }
+            lock.lock();
+
+            s_Data->Active[index] = nullptr;
+            s_Data->Staged.push_back(std::move(job));
+            s_Data->WorkDone.notify_all();
+        }
+    }
+
+    void TextureStreamer::Init()
+    {
+        ZoneScoped;
+
+        s_Data = new TextureStreamerData();
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &s_Data->StagingBuffer);
+        glNamedBufferStorage(s_Data->StagingBuffer, StagingBufferSize, nullptr, flags);
+        s_Data->StagingData = static_cast<char*>(glMapNamedBufferRange(s_Data->StagingBuffer, 0, StagingBufferSize, flags));
+
+        if (!s_Data->StagingData)
+        {
+            COFFEE_CORE_ERROR("TextureStreamer: Failed to map the staging buffer, textures will be fully resident.");
+            glDeleteBuffers(1, &s_Data->StagingBuffer);
+            delete s_Data;
+            s_Data = nullptr;
+            return;
+        }
+
+        uint32_t workerCount = std::clamp(std::thread::hardware_concurrency() / 4, 1u, 2u);
+
+        s_Data->Running = true;
+        s_Data->Active.resize(workerCount, nullptr);
+        for (uint32_t i = 0; i < workerCount; ++i)
+        {
+            s_Data->Workers.emplace_back(StagingWorker, i);
+        }
+    }
+
+    void TextureStreamer::Shutdown()
+    {
+        ZoneScoped;
+
+        if (!s_Data)
+            return;
+
+        {
+            std::lock_guard lock(s_Data->Mutex);
+            s_Data->Running = false;
+        }
+        s_Data->WorkAvailable.notify_all();
+
+        for (std::thread& worker : s_Data->Workers)
+        {
+            worker.join();
+        }
+
+        if (s_Data->StagingFence)
+        {
+            glDeleteSync(s_Data->StagingFence);
+        }
+
+        glUnmapNamedBuffer(s_Data->StagingBuffer);
+        glDeleteBuffers(1, &s_Data->StagingBuffer);
+
+        delete s_Data;
+        s_Data = nullptr;
+    }
+
+    void TextureStreamer::Register(Texture2D* texture)
+    {
+        ZoneScoped;
+
+        const std::vector<TextureMip>& mips = texture->m_Mips;
+        uint32_t mipCount = (uint32_t)mips.size();
+
+        if (!s_Data)
+        {
+            texture->Reallocate(0, mipCount);
+            return;
+        }
+
+        uint32_t tailMip = 0;
+        while (tailMip + 1 < mipCount && std::max(mips[tailMip].Width, mips[tailMip].Height) > MinResidentSize)
+        {
+            ++tailMip;
+        }
+
+        texture->Reallocate(tailMip, mipCount);
+
+        StreamedTexture& state = s_Data->Textures[texture];
+        state.TailMip = state.RequestedMip = state.WantedMip = state.TargetMip = tailMip;
+        state.WantedFrame = s_Data->Frame;
+    }
+
+    void TextureStreamer::Unregister(Texture2D* texture)
+    {
+        ZoneScoped;
+
+        if (!s_Data)
+            return;
+
+        {
+            std::unique_lock lock(s_Data->Mutex);
+
+            std::erase_if(s_Data->Queue, [texture](const StagingJob& job) { return job.Texture == texture; });
+            s_Data->WorkDone.wait(lock, [texture] {
+                return std::find(s_Data->Active.begin(), s_Data->Active.end(), texture) == s_Data->Active.end();
+            });
+            std::erase_if(s_Data->Staged, [texture](const StagingJob& job) { return job.Texture == texture; });
+        }
+
+        s_Data->Textures.erase(texture);
+    }
+
+    void TextureStreamer::Request(Texture2D* texture, float screenSize)
+    {
+        if (!s_Data)
+            return;
+
+        auto it = s_Data->Textures.find(texture);
+        if (it == s_Data->Textures.end())
+            return;
+
+        // Assumes the texture is mapped once over the mesh, so a texel per pixel is reached at this level
+        float texels = (float)std::max(texture->m_Width, texture->m_Height);
+        uint32_t mip = screenSize >= texels ? 0 : (uint32_t)std::log2(texels / std::max(screenSize, 1.0f));
+
+        StreamedTexture& state = it->second;
+        state.RequestedMip = std::min(state.RequestedMip, mip);
+    }
+
+    static bool IsStagingBufferFree()
+    {
+        if (!s_Data->StagingFence)
+            return true;
+
+        GLenum result = glClientWaitSync(s_Data->StagingFence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            return false;
+
+        glDeleteSync(s_Data->StagingFence);
+        s_Data->StagingFence = nullptr;
+        return true;
+    }
+
+    void TextureStreamer::Update()
+    {
+        ZoneScoped;
+
+        if (!s_Data)
+            return;
+
+        uint64_t frame = ++s_Data->Frame;
+
+        // Upload the last batch once the workers have staged all of it
+        std::vector<StagingJob> staged;
+        bool batchInFlight;
+        {
+            std::lock_guard lock(s_Data->Mutex);
+
+            bool idle = s_Data->Queue.empty() && std::all_of(s_Data->Active.begin(), s_Data->Active.end(), [](Texture2D* texture) { return texture == nullptr; });
+            if (idle)
+            {
+                staged.swap(s_Data->Staged);
+            }
+            batchInFlight = !idle;
+        }
+
+        for (StagingJob& job : staged)
+        {
+            ZoneScopedN("TextureStreamer::Upload");
+
+            StreamedTexture& state = s_Data->Textures[job.Texture];
+            state.Pending = false;
+
+            job.Texture->Reallocate(job.FirstMip, job.EndMip, s_Data->StagingBuffer, job.Offsets.data());
+
+            // Start sampling from the previous top level and fade the new ones in
+            state.MinLod = (float)(job.EndMip - job.FirstMip);
+            s_Stats.MipsStreamedIn += job.EndMip - job.FirstMip;
+        }
+
+        if (!staged.empty())
+        {
+            s_Data->StagingFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        // Keep the finest level requested lately, so a texture is not evicted as soon as it leaves the view
+        uint64_t requestedBytes = 0;
+        uint64_t targetBytes = 0;
+        for (auto& [texture, state] : s_Data->Textures)
+        {
+            if (state.RequestedMip <= state.WantedMip || frame - state.WantedFrame > EvictionDelay)
+            {
+                state.WantedMip = state.RequestedMip;
+                state.WantedFrame = frame;
+            }
+
+            state.TargetMip = state.WantedMip;
+
+            requestedBytes += GetMipChainSize(texture->m_Mips, state.RequestedMip);
+            targetBytes += GetMipChainSize(texture->m_Mips, state.TargetMip);
+
+            state.RequestedMip = state.TailMip;
+        }
+
+        // Fit the targets in the budget dropping the largest levels first
+        if (targetBytes > s_Budget)
+        {
+            using LevelSize = std::pair<uint64_t, Texture2D*>;
+            std::priority_queue<LevelSize> largest;
+
+            for (auto& [texture, state] : s_Data->Textures)
+            {
+                if (state.TargetMip < state.TailMip)
+                    largest.emplace(texture->m_Mips[state.TargetMip].Data.size(), texture);
+            }
+
+            while (targetBytes > s_Budget && !largest.empty())
+            {
+                auto [size, texture] = largest.top();
+                largest.pop();
+
+                StreamedTexture& state = s_Data->Textures[texture];
+                targetBytes -= size;
+                state.TargetMip++;
+
+                if (state.TargetMip < state.TailMip)
+                    largest.emplace(texture->m_Mips[state.TargetMip].Data.size(), texture);
+            }
+        }
+
+        // Evict the levels finer than the target
+        for (auto& [texture, state] : s_Data->Textures)
+        {
+            if (state.Pending || state.TargetMip <= texture->m_ResidentMip)
+                continue;
+
+            ZoneScopedN("TextureStreamer::Evict");
+
+            s_Stats.MipsStreamedOut += state.TargetMip - texture->m_ResidentMip;
+            texture->Reallocate(state.TargetMip, state.TargetMip);
+            state.MinLod = 0.0f;
+        }
+
+        // Issue the next batch, the textures missing the most levels first
+        if (!batchInFlight && IsStagingBufferFree())
+        {
+            std::vector<std::pair<uint32_t, Texture2D*>> candidates;
+            for (auto& [texture, state] : s_Data->Textures)
+            {
+                if (!state.Pending && state.TargetMip < texture->m_ResidentMip)
+                    candidates.emplace_back(texture->m_ResidentMip - state.TargetMip, texture);
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+            std::vector<StagingJob> jobs;
+            uint64_t offset = 0;
+
+            for (auto& [missing, texture] : candidates)
+            {
+                StreamedTexture& state = s_Data->Textures[texture];
+                const std::vector<TextureMip>& mips = texture->m_Mips;
+
+                // Stage from the coarsest missing level up, as many as fit in the staging buffer
+                StagingJob job;
+                job.Texture = texture;
+                job.Mips = &mips;
+                job.EndMip = texture->m_ResidentMip;
+                job.FirstMip = job.EndMip;
+
+                std::vector<uint64_t> offsets;
+                while (job.FirstMip > state.TargetMip)
+                {
+                    uint64_t levelOffset = (offset + 255) & ~uint64_t(255);
+                    uint64_t levelSize = mips[job.FirstMip - 1].Data.size();
+                    if (levelOffset + levelSize > StagingBufferSize)
+                        break;
+
+                    offsets.push_back(levelOffset);
+                    offset = levelOffset + levelSize;
+                    job.FirstMip--;
+                }
+
+                if (job.FirstMip == job.EndMip)
+                {
+                    // A level bigger than the whole staging buffer is uploaded straight from the mip chain
+                    if (mips[job.EndMip - 1].Data.size() > StagingBufferSize)
+                    {
+                        texture->Reallocate(job.EndMip - 1, job.EndMip);
+                        s_Stats.MipsStreamedIn++;
+                    }
+                    continue;
+                }
+
+                job.Offsets.assign(offsets.rbegin(), offsets.rend());
+                state.Pending = true;
+                jobs.push_back(std::move(job));
+            }
+
+            if (!jobs.empty())
+            {
+                {
+                    std::lock_guard lock(s_Data->Mutex);
+                    for (StagingJob& job : jobs)
+                    {
+                        s_Data->Queue.push_back(std::move(job));
+                    }
+                }
+                s_Data->WorkAvailable.notify_all();
+            }
+        }
+
+        // Fade in the streamed levels
+        uint64_t residentBytes = 0;
+        uint32_t pendingUploads = 0;
+        for (auto& [texture, state] : s_Data->Textures)
+        {
+            if (state.MinLod > 0.0f)
+            {
+                state.MinLod = std::max(state.MinLod - 0.1f, 0.0f);
+                texture->SetMinLod(state.MinLod);
+            }
+
+            residentBytes += GetMipChainSize(texture->m_Mips, texture->m_ResidentMip);
+            pendingUploads += state.Pending ? 1 : 0;
+        }
+
+        s_Stats.ResidentBytes = residentBytes;
+        s_Stats.RequestedBytes = requestedBytes;
+        s_Stats.BudgetBytes = s_Budget;
+        s_Stats.StreamedTextures = (uint32_t)s_Data->Textures.size();
+        s_Stats.PendingUploads = pendingUploads;
+    }
+
+    void TextureStreamer::SetBudget(uint64_t bytes)
+    {
+        s_Budget = bytes;
+        s_Stats.BudgetBytes = bytes;
+    }
+
+    uint64_t TextureStreamer::GetBudget()
+    {
+        return s_Budget;
+    }
+
+    const TextureStreamingStats& TextureStreamer::GetStats()
+    {
+        return s_Stats;
+    }
+}
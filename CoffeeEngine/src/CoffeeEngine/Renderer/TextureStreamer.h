@@ -0,0 +1,103 @@
+#pragma once
+
+#include "CoffeeEngine/Renderer/Texture.h"
+
+#include <cstdint>
+
+namespace Coffee {
+
+    /**
+     * @defgroup renderer Renderer
+     * @brief Renderer components of the CoffeeEngine.
+     * @{
+     */
+
+    /**
+     * @brief Structure containing the texture streaming statistics.
+     */
+    struct TextureStreamingStats
+    {
+        uint64_t ResidentBytes = 0; ///< GPU memory used by the resident mips of the streamed textures.
+        uint64_t RequestedBytes = 0; ///< GPU memory the streamed textures would use at the mips requested this frame.
+        uint64_t BudgetBytes = 0; ///< The GPU memory budget of the streamed textures.
+        uint32_t StreamedTextures = 0; ///< Number of textures managed by the streamer.
+        uint32_t PendingUploads = 0; ///< Number of mip uploads being staged by the workers.
+        uint32_t MipsStreamedIn = 0; ///< Number of mips streamed in since the start.
+        uint32_t MipsStreamedOut = 0; ///< Number of mips evicted since the start.
+    };
+
+    /**
+     * @brief Streams the mips of the block compressed textures in and out of GPU memory.
+     *
+     * Only the tail of the mip chain (levels up to MinResidentSize) is uploaded at load. Every frame the renderer
+     * requests the mip each texture needs from the screen size of the meshes using it, and the streamer fits the
+     * requests in the GPU memory budget by dropping the largest levels first. The level data is copied into a
+     * persistently mapped staging buffer by worker threads and uploaded from it on the main thread, and newly
+     * streamed levels are faded in with a min-LOD clamp to avoid popping.
+     */
+    class TextureStreamer
+    {
+    public:
+        static constexpr uint32_t MinResidentSize = 64; ///< Levels this size or smaller are always resident.
+        static constexpr uint64_t StagingBufferSize = 64ull * 1024 * 1024; ///< Size of the staging buffer, the upper bound of the bytes streamed per batch.
+        static constexpr uint32_t EvictionDelay = 120; ///< Frames a level stays resident after it was last requested.
+        static constexpr uint64_t DefaultBudget = 512ull * 1024 * 1024; ///< Default GPU memory budget of the streamed textures.
+
+        /**
+         * @brief Initializes the streamer: the staging buffer and the worker threads.
+         */
+        static void Init();
+
+        /**
+         * @brief Shuts down the streamer, the registered textures keep their resident mips.
+         */
+        static void Shutdown();
+
+        /**
+         * @brief Registers a compressed texture, replacing its storage with the always resident tail of the mip chain.
+         *
+         * If the streamer is not initialized the whole mip chain is uploaded.
+         *
+         * @param texture The texture to register, its mip chain has to be loaded.
+         */
+        static void Register(Texture2D* texture);
+
+        /**
+         * @brief Unregisters a texture, waiting for the workers to be done with its mips.
+         * @param texture The texture to unregister.
+         */
+        static void Unregister(Texture2D* texture);
+
+        /**
+         * @brief Requests the mip a texture needs to be displayed at a given size this frame.
+         * @param texture The texture sampled by the mesh.
+         * @param screenSize The size in pixels of the mesh on screen.
+         */
+        static void Request(Texture2D* texture, float screenSize);
+
+        /**
+         * @brief Fits the requests of this frame in the budget, evicts and streams mips and uploads the staged ones.
+         */
+        static void Update();
+
+        /**
+         * @brief Sets the GPU memory budget of the streamed textures.
+         * @param bytes The budget in bytes.
+         */
+        static void SetBudget(uint64_t bytes);
+
+        /**
+         * @brief Gets the GPU memory budget of the streamed textures.
+         * @return The budget in bytes.
+         */
+        static uint64_t GetBudget();
+
+        /**
+         * @brief Gets the texture streaming statistics.
+         * @return The statistics of the last update.
+         */
+        static const TextureStreamingStats& GetStats();
+    };
+
+    /** @} */
+}
@@ -1,5 +1,6 @@
 #include "UniformBuffer.h"
 #include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 
 #include <cstdint>
 #include <glad/glad.h>
@@ -8,6 +9,7 @@ namespace Coffee {
 
     UniformBuffer::UniformBuffer(uint32_t size, uint32_t binding)
     {
+        RenderThread::AcquireContext();
         glCreateBuffers(1, &m_uboID);
         glNamedBufferData(m_uboID, size, nullptr, GL_DYNAMIC_DRAW); //or GL_DYNAMIC_DRAW? Search what are the differences
         glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_uboID);
@@ -15,7 +17,7 @@ namespace Coffee {
 
     UniformBuffer::~UniformBuffer()
     {
-        glDeleteBuffers(1, &m_uboID);
+        RenderThread::Release([ubo = m_uboID]() { glDeleteBuffers(1, &ubo); });
     }
 
     void UniformBuffer::SetData(const void* data, uint32_t size, uint32_t offset)
@@ -1,4 +1,5 @@
 #include "CoffeeEngine/Renderer/VertexArray.h"
+#include "CoffeeEngine/Renderer/RenderThread.h"
 
 #include <glad/glad.h>
 #include <tracy/Tracy.hpp>
@@ -28,6 +29,7 @@ namespace Coffee {
     {
         ZoneScoped;
 
+        RenderThread::AcquireContext();
         glCreateVertexArrays(1, &m_vaoID);
     }
 
@@ -35,7 +37,7 @@ namespace Coffee {
     {
         ZoneScoped;
 
-        glDeleteVertexArrays(1, &m_vaoID);
+        RenderThread::Release([vao = m_vaoID]() { glDeleteVertexArrays(1, &vao); });
     }
 
     void VertexArray::Bind()
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "CoffeeEngine/Core/Hash.h"
+#include "CoffeeEngine/Scene/Components.h"
+#include "CoffeeEngine/Scene/SceneTree.h"
+#include "CoffeeEngine/Scripting/Script.h"
+
+#include <cstdint>
+#include <string_view>
+
+namespace Coffee {
+
+    /**
+     * @addtogroup scene
+     * @{
+     */
+
+    /**
+     * @brief What the generic component code does with a component type.
+     * @ingroup scene
+     */
+    struct ComponentFlags
+    {
+        static constexpr uint32_t None = 0;
+        static constexpr uint32_t Serialized = 1 << 0; ///< Saved in the scene files and the cooked scenes.
+        static constexpr uint32_t Scriptable = 1 << 1; ///< Reachable from the scripts through the Component identifiers.
+        static constexpr uint32_t Addable = 1 << 2; ///< Listed in the Add Component menu of the editor.
+    };
+
+    /**
+     * @brief Gets the identifier the scripts use for a component, the 64-bit hash of its name folded to 32 bits
+     * so it stays a plain Lua integer.
+     * @param name The name of the component type.
+     * @return The identifier.
+     * @ingroup scene
+     */
+    constexpr uint32_t GetComponentID(std::string_view name)
+    {
+        uint64_t hash = Hash::String(name);
+        return (uint32_t)(hash ^ (hash >> 32));
+    }
+
+    /**
+     * @brief Compile time description of a component type, specialized for every type of the ComponentRegistry.
+     * @tparam Component The component type.
+     * @ingroup scene
+     */
+    template<typename Component>
+    struct ComponentInfo;
+
+    /**
+     * @brief Compile time list of component types, visited with templated lambdas.
+     * @tparam Components The component types.
+     * @ingroup scene
+     */
+    template<typename... Components>
+    struct ComponentList
+    {
+        static constexpr size_t Count = sizeof...(Components);
+
+        /**
+         * @brief Calls a templated lambda, []<typename Component>() {}, once per component type in list order.
+         * @param function The lambda.
+         */
+        template<typename Function>
+        static void ForEach(Function&& function)
+        {
+            (function.template operator()<Components>(), ...);
+        }
+
+        /**
+         * @brief Calls a templated lambda with the component type of a hashed name.
+         * @param hash The hash of the component name, ComponentInfo::Hash.
+         * @param function The lambda.
+         * @return False if no component of the list has that hash.
+         */
+        template<typename Function>
+        static bool Visit(uint64_t hash, Function&& function)
+        {
+            return ((ComponentInfo<Components>::Hash == hash ? (function.template operator()<Components>(), true) : false) || ...);
+        }
+    };
+
+/**
+ * @brief Describes a component type: its name, the hashes of the name and the ComponentFlags.
+ * @ingroup scene
+ */
+#define COFFEE_COMPONENT_INFO(Type, Display, FlagBits)                                                          \
+    template<>                                                                                                   \
+    struct ComponentInfo<Type>                                                                                   \
+    {                                                                                                            \
+        static constexpr std::string_view Name = #Type;                                                          \
+        static constexpr std::string_view DisplayName = Display;                                                 \
+        static constexpr uint64_t Hash = Coffee::Hash::String(#Type);                                            \
+        static constexpr uint32_t ID = GetComponentID(#Type);                                                    \
+        static constexpr uint32_t Flags = FlagBits;                                                              \
+    }
+
+    COFFEE_COMPONENT_INFO(TagComponent, "Tag Component", ComponentFlags::Serialized | ComponentFlags::Scriptable | ComponentFlags::Addable);
+    COFFEE_COMPONENT_INFO(TransformComponent, "Transform Component", ComponentFlags::Serialized | ComponentFlags::Scriptable | ComponentFlags::Addable);
+    COFFEE_COMPONENT_INFO(HierarchyComponent, "Hierarchy Component", ComponentFlags::Serialized);
+    COFFEE_COMPONENT_INFO(CameraComponent, "Camera Component", ComponentFlags::Serialized | ComponentFlags::Scriptable | ComponentFlags::Addable);
+    COFFEE_COMPONENT_INFO(MeshComponent, "Mesh Component", ComponentFlags::Serialized | ComponentFlags::Scriptable | ComponentFlags::Addable);
+    COFFEE_COMPONENT_INFO(MaterialComponent, "Material Component", ComponentFlags::Serialized | ComponentFlags::Scriptable | ComponentFlags::Addable);
+    COFFEE_COMPONENT_INFO(LightComponent, "Light Component", ComponentFlags::Serialized | ComponentFlags::Scriptable | ComponentFlags::Addable);
+    COFFEE_COMPONENT_INFO(ScriptComponent, "Script Component", ComponentFlags::None);
+
+#undef COFFEE_COMPONENT_INFO
+
+    /**
+     * @brief Every component type of the engine, drives the Lua bindings, the serialization, the editor menu and
+     * the scene copy. The order is the order of the sections in the scene files, new types go last.
+     * @ingroup scene
+     */
+    using ComponentRegistry = ComponentList<TagComponent, TransformComponent, HierarchyComponent, CameraComponent,
+                                            MeshComponent, MaterialComponent, LightComponent, ScriptComponent>;
+
+    /** @} */
+}
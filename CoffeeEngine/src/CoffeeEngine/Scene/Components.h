@@ -115,6 +115,16 @@ namespace Coffee {
             worldMatrix = transform * GetLocalTransform();
         }
 
+        /**
+         * @brief Sets the world transformation matrix from a local one other than the current, an interpolated one.
+         * @param transform The world transformation matrix of the parent.
+         * @param local The local transformation matrix.
+         */
+        void SetWorldTransform(const glm::mat4& transform, const glm::mat4& local)
+        {
+            worldMatrix = transform * local;
+        }
+
         /**
          * @brief Serializes the TransformComponent.
          * @tparam Archive The type of the archive.
@@ -0,0 +1,287 @@
+#include "CookedScene.h"
+
+#include "CoffeeEngine/Core/Hash.h"
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/IO/ResourceArchive.h"
+#include "CoffeeEngine/Scene/ComponentRegistry.h"
+#include "CoffeeEngine/Scene/Components.h"
+#include "CoffeeEngine/Scene/SceneTree.h"
+
+#include <cereal/archives/binary.hpp>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <tracy/Tracy.hpp>
+#include <type_traits>
+#include <unordered_map>
+
+namespace Coffee {
+
+    static size_t AlignOffset(size_t offset)
+    {
+        return (offset + CookedScene::Alignment - 1) / CookedScene::Alignment * CookedScene::Alignment;
+    }
+
+    static void Append(std::vector<char>& buffer, const void* data, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    static void AppendPadding(std::vector<char>& buffer)
+    {
+        buffer.resize(AlignOffset(buffer.size()), 0);
+    }
+
+    // Trivially copyable components are stored as a raw array, the others are serialized with cereal
+    template<typename Component>
+    static void WriteComponents(std::vector<char>& buffer, entt::registry& registry, const std::vector<entt::entity>& entities, std::string_view name, uint32_t& sectionCount)
+    {
+        auto& storage = registry.storage<Component>();
+        if (storage.empty())
+            return;
+
+        std::vector<entt::entity> sectionEntities;
+        std::string data;
+
+        if constexpr (std::is_trivially_copyable_v<Component>)
+        {
+            for (auto entity : entities)
+            {
+                if (!storage.contains(entity))
+                    continue;
+
+                sectionEntities.push_back(entity);
+                data.append(reinterpret_cast<const char*>(&storage.get(entity)), sizeof(Component));
+            }
+        }
+        else
+        {
+            std::ostringstream stream;
+            {
+                cereal::BinaryOutputArchive archive(stream);
+                for (auto entity : entities)
+                {
+                    if (!storage.contains(entity))
+                        continue;
+
+                    sectionEntities.push_back(entity);
+                    archive(storage.get(entity));
+                }
+            }
+            data = std::move(stream).str();
+        }
+
+        if (sectionEntities.empty())
+            return;
+
+        CookedSceneSection section;
+        section.typeHash = Hash::String(name);
+        section.count = (uint32_t)sectionEntities.size();
+        section.elementSize = std::is_trivially_copyable_v<Component> ? (uint32_t)sizeof(Component) : 0;
+        section.dataSize = data.size();
+
+        Append(buffer, &section, sizeof(section));
+        AppendPadding(buffer);
+        Append(buffer, sectionEntities.data(), sectionEntities.size() * sizeof(entt::entity));
+        AppendPadding(buffer);
+        Append(buffer, data.data(), data.size());
+        AppendPadding(buffer);
+
+        sectionCount++;
+    }
+
+    template<typename Component>
+    static bool ReadComponents(entt::registry& registry, const CookedSceneSection& section, const entt::entity* entities, const char* data)
+    {
+        if constexpr (std::is_trivially_copyable_v<Component>)
+        {
+            // A different size means the component changed since the scene was cooked
+            if (section.elementSize != sizeof(Component) || section.dataSize != (uint64_t)section.count * sizeof(Component))
+                return false;
+
+            std::vector<Component> components(section.count);
+            std::memcpy(components.data(), data, section.dataSize);
+            registry.insert<Component>(entities, entities + section.count, components.begin());
+        }
+        else
+        {
+            if (section.elementSize != 0)
+                return false;
+
+            ArchiveEntryStream stream(data, section.dataSize);
+            cereal::BinaryInputArchive archive(stream);
+
+            for (uint32_t i = 0; i < section.count; ++i)
+            {
+                Component component;
+                archive(component);
+                registry.emplace<Component>(entities[i], std::move(component));
+            }
+        }
+
+        return true;
+    }
+
+    std::vector<char> CookedScene::Write(entt::registry& registry, const std::vector<entt::entity>& entities, int64_t sourceWriteTime)
+    {
+        ZoneScoped;
+
+        CookedSceneHeader header;
+        header.magic = Magic;
+        header.version = Version;
+        header.sourceWriteTime = sourceWriteTime;
+        header.entityCount = (uint32_t)entities.size();
+
+        std::vector<char> buffer;
+        Append(buffer, &header, sizeof(header));
+        AppendPadding(buffer);
+        Append(buffer, entities.data(), entities.size() * sizeof(entt::entity));
+        AppendPadding(buffer);
+
+        ComponentRegistry::ForEach([&]<typename Component>() {
+            if constexpr (ComponentInfo<Component>::Flags & ComponentFlags::Serialized)
+                WriteComponents<Component>(buffer, registry, entities, ComponentInfo<Component>::Name, header.sectionCount);
+        });
+
+        // The section count is only known once everything is written
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        return buffer;
+    }
+
+    bool CookedScene::ReadHeader(const char* data, uint64_t size, CookedSceneHeader& header)
+    {
+        if (size < sizeof(header))
+            return false;
+
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != Magic || header.version != Version)
+            return false;
+
+        return AlignOffset(sizeof(header)) + (uint64_t)header.entityCount * sizeof(entt::entity) <= size;
+    }
+
+    bool CookedScene::Instantiate(entt::registry& registry, const char* data, uint64_t size, bool keepIdentifiers, std::vector<entt::entity>* entities)
+    {
+        ZoneScoped;
+
+        CookedSceneHeader header;
+        if (!ReadHeader(data, size, header))
+            return false;
+
+        size_t offset = AlignOffset(sizeof(header));
+        const entt::entity* cookedEntities = reinterpret_cast<const entt::entity*>(data + offset);
+        offset = AlignOffset(offset + header.entityCount * sizeof(entt::entity));
+
+        std::vector<entt::entity> created;
+        created.reserve(header.entityCount);
+
+        std::unordered_map<entt::entity, entt::entity> entityMap;
+        if (!keepIdentifiers)
+            entityMap.reserve(header.entityCount);
+
+        for (uint32_t i = 0; i < header.entityCount; ++i)
+        {
+            if (keepIdentifiers)
+            {
+                created.push_back(registry.create(cookedEntities[i]));
+            }
+            else
+            {
+                created.push_back(registry.create());
+                entityMap.emplace(cookedEntities[i], created.back());
+            }
+        }
+
+        auto remap = [&](entt::entity entity) {
+            if (keepIdentifiers || entity == entt::null)
+                return entity;
+
+            auto it = entityMap.find(entity);
+            return it != entityMap.end() ? it->second : entt::entity(entt::null);
+        };
+
+        // The hierarchy links are loaded as they are, appending the entities to their parents again would duplicate them
+        registry.on_construct<HierarchyComponent>().disconnect<&HierarchyComponent::OnConstruct>();
+
+        bool valid = true;
+        std::vector<entt::entity> sectionEntities;
+        for (uint32_t i = 0; i < header.sectionCount && valid; ++i)
+        {
+            CookedSceneSection section;
+            if (offset + sizeof(section) > size)
+            {
+                valid = false;
+                break;
+            }
+            std::memcpy(&section, data + offset, sizeof(section));
+
+            size_t entitiesOffset = AlignOffset(offset + sizeof(section));
+            size_t dataOffset = AlignOffset(entitiesOffset + (size_t)section.count * sizeof(entt::entity));
+            if (dataOffset + section.dataSize > size)
+            {
+                valid = false;
+                break;
+            }
+            offset = AlignOffset(dataOffset + section.dataSize);
+
+            // The blocks are 16 bytes aligned, so the cooked identifiers are used in place when they are kept
+            const entt::entity* entityData = reinterpret_cast<const entt::entity*>(data + entitiesOffset);
+            if (!keepIdentifiers)
+            {
+                sectionEntities.resize(section.count);
+                for (uint32_t j = 0; j < section.count; ++j)
+                {
+                    sectionEntities[j] = remap(entityData[j]);
+                    valid = valid && sectionEntities[j] != entt::null;
+                }
+                entityData = sectionEntities.data();
+            }
+
+            if (!valid)
+                break;
+
+            const char* componentData = data + dataOffset;
+
+            bool known = ComponentRegistry::Visit(section.typeHash, [&]<typename Component>() {
+                if constexpr (ComponentInfo<Component>::Flags & ComponentFlags::Serialized)
+                    valid = ReadComponents<Component>(registry, section, entityData, componentData);
+            });
+
+            if (!known)
+                COFFEE_CORE_WARN("CookedScene: Unknown component section, skipping it");
+        }
+
+        registry.on_construct<HierarchyComponent>().connect<&HierarchyComponent::OnConstruct>();
+
+        if (!keepIdentifiers)
+        {
+            for (auto entity : created)
+            {
+                if (auto* hierarchy = registry.try_get<HierarchyComponent>(entity))
+                {
+                    hierarchy->m_Parent = remap(hierarchy->m_Parent);
+                    hierarchy->m_First = remap(hierarchy->m_First);
+                    hierarchy->m_Last = remap(hierarchy->m_Last);
+                    hierarchy->m_Next = remap(hierarchy->m_Next);
+                    hierarchy->m_Prev = remap(hierarchy->m_Prev);
+                }
+            }
+        }
+
+        if (!valid)
+        {
+            registry.destroy(created.begin(), created.end());
+            return false;
+        }
+
+        if (entities)
+        {
+            *entities = std::move(created);
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @defgroup scene Scene
+     * @{
+     */
+
+    /**
+     * @brief Header of a cooked binary scene.
+     * @ingroup scene
+     */
+    struct CookedSceneHeader
+    {
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        int64_t sourceWriteTime = 0; ///< Write time of the JSON file the scene was cooked from, 0 for generated scenes.
+        uint32_t entityCount = 0;
+        uint32_t sectionCount = 0;
+    };
+
+    /**
+     * @brief Header of the section of a component type, followed by the entity identifiers and the component data.
+     * @ingroup scene
+     */
+    struct CookedSceneSection
+    {
+        uint64_t typeHash = 0; ///< Hash of the component type name.
+        uint32_t count = 0; ///< Number of components.
+        uint32_t elementSize = 0; ///< Size of a component for the trivially copyable ones, 0 for the serialized ones.
+        uint64_t dataSize = 0; ///< Size of the component data in bytes, without padding.
+    };
+
+    /**
+     * @brief Binary scene format, the cooked artifact of the JSON scenes and the chunks of the world partition.
+     *
+     * Layout: the header, the entity identifiers and one section per component type. Every block starts
+     * 16 bytes aligned, so the arrays can be used in place from a memory mapping of the file. Trivially
+     * copyable components are stored as raw arrays and bulk copied into the registry, the others are
+     * serialized with cereal.
+     * @ingroup scene
+     */
+    class CookedScene
+    {
+    public:
+        static constexpr uint32_t Magic = 0x4E435343; ///< "CSCN" in little endian.
+        static constexpr uint32_t Version = 2; ///< Bumped on any layout change, older cooked scenes are cooked again from their source.
+        static constexpr size_t Alignment = 16; ///< Alignment of every block of the file.
+
+        /**
+         * @brief Cooks a set of entities.
+         * @param registry The registry the entities belong to.
+         * @param entities The entities to cook, with all their components.
+         * @param sourceWriteTime Write time of the source file, used to detect out of date cooked scenes.
+         * @return The cooked bytes.
+         */
+        static std::vector<char> Write(entt::registry& registry, const std::vector<entt::entity>& entities, int64_t sourceWriteTime);
+
+        /**
+         * @brief Reads and validates the header of a cooked scene.
+         * @param data The cooked bytes.
+         * @param size The size of the cooked bytes.
+         * @param header The header read.
+         * @return True if the data is a cooked scene of the current version.
+         */
+        static bool ReadHeader(const char* data, uint64_t size, CookedSceneHeader& header);
+
+        /**
+         * @brief Creates the entities of a cooked scene in a registry.
+         * @param registry The registry to create the entities in.
+         * @param data The cooked bytes.
+         * @param size The size of the cooked bytes.
+         * @param keepIdentifiers Whether to create the entities with their cooked identifiers, only valid for an empty registry.
+         *                        Otherwise new entities are created and the hierarchy links are remapped to them.
+         * @param entities If not null, receives the created entities.
+         * @return True on success, on failure the created entities are destroyed.
+         */
+        static bool Instantiate(entt::registry& registry, const char* data, uint64_t size, bool keepIdentifiers, std::vector<entt::entity>* entities = nullptr);
+    };
+
+    /** @} */ // end of scene group
+}
@@ -93,6 +93,12 @@ namespace Coffee {
             return m_Scene->m_Registry.valid(m_EntityHandle);
         }
 
+        /**
+         * @brief Get the scene the entity belongs to.
+         * @return The scene.
+         */
+        Scene* GetScene() const { return m_Scene; }
+
         /**
          * @brief Check if the entity is valid.
          * @return True if the entity is valid, false otherwise.
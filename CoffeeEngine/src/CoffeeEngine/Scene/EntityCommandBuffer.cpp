@@ -0,0 +1,399 @@
+#include "EntityCommandBuffer.h"
+
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/Scene/Entity.h"
+#include "CoffeeEngine/Scene/Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <tracy/Tracy.hpp>
+
+namespace Coffee {
+
+    std::atomic<uint64_t> EntityCommandBuffer::s_NextID = 1;
+
+    static constexpr size_t ArenaBlockSize = 64 * 1024;
+
+    static size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    /**
+     * @brief Linear arena of commands, in blocks that are kept between frames.
+     */
+    struct CommandArena
+    {
+        struct Block
+        {
+            Scope<std::byte[]> Data;
+            size_t Size = 0;
+            size_t Used = 0;
+        };
+
+        std::vector<Block> Blocks;
+        size_t Current = 0; ///< The block being filled, the following ones are empty.
+        uint32_t CommandCount = 0;
+        std::vector<std::string> Names; ///< Names of the entities created, by pending index.
+        std::vector<entt::entity> Created; ///< The entities created by the playback, by pending index.
+
+        void* Allocate(size_t size)
+        {
+            while (Current < Blocks.size() && Blocks[Current].Used + size > Blocks[Current].Size)
+                Current++;
+
+            if (Current == Blocks.size())
+            {
+                Block block;
+                block.Size = std::max(ArenaBlockSize, size);
+                block.Data = Scope<std::byte[]>(new std::byte[block.Size]);
+                Blocks.push_back(std::move(block));
+            }
+
+            Block& block = Blocks[Current];
+            void* memory = block.Data.get() + block.Used;
+            block.Used += size;
+            CommandCount++;
+            return memory;
+        }
+
+        template<typename Command, typename Function>
+        void ForEach(Function&& function)
+        {
+            for (Block& block : Blocks)
+            {
+                for (size_t offset = 0; offset < block.Used;)
+                {
+                    Command* command = reinterpret_cast<Command*>(block.Data.get() + offset);
+                    offset += command->Size;
+                    function(*command);
+                }
+            }
+        }
+
+        void Reset()
+        {
+            for (Block& block : Blocks)
+                block.Used = 0;
+
+            Current = 0;
+            CommandCount = 0;
+            Names.clear();
+            Created.clear();
+        }
+
+        uint64_t GetReservedBytes() const
+        {
+            uint64_t bytes = 0;
+            for (const Block& block : Blocks)
+                bytes += block.Size;
+            return bytes;
+        }
+    };
+
+    /**
+     * @brief The arenas of one thread. The commands recorded while the buffer plays back, by the hooks of the
+     * components added for instance, go to the other arena and wait for the next playback.
+     */
+    struct EntityCommandBuffer::Recorder
+    {
+        std::thread::id Thread;
+        CommandArena Recording;
+        CommandArena Playing;
+
+        entt::entity Resolve(entt::entity entity) const
+        {
+            if (!IsPending(entity))
+                return entity;
+
+            size_t index = entt::to_entity(entity);
+            return index < Playing.Created.size() ? Playing.Created[index] : entt::null;
+        }
+
+        // The added components were moved into the registry or never applied, either way they are destroyed here
+        static void Clear(CommandArena& arena)
+        {
+            arena.ForEach<Command>([](Command& command) {
+                if (command.Type == CommandType::AddComponent)
+                    command.Table->Destroy(command.GetPayload());
+            });
+            arena.Reset();
+        }
+    };
+
+    /**
+     * @brief The recorder of the calling thread for the last buffer it recorded into.
+     */
+    struct RecorderCache
+    {
+        uint64_t Buffer = 0;
+        void* Recorder = nullptr;
+    };
+
+    static thread_local RecorderCache s_RecorderCache;
+
+    EntityCommandBuffer::EntityCommandBuffer() : m_ID(s_NextID++)
+    {
+    }
+
+    EntityCommandBuffer::~EntityCommandBuffer()
+    {
+        Clear();
+    }
+
+    EntityCommandBuffer::Recorder& EntityCommandBuffer::GetRecorder()
+    {
+        if (s_RecorderCache.Buffer == m_ID)
+            return *static_cast<Recorder*>(s_RecorderCache.Recorder);
+
+        std::lock_guard lock(m_Mutex);
+
+        // The thread may have recorded into another buffer since it last recorded into this one
+        std::thread::id thread = std::this_thread::get_id();
+        auto it = std::find_if(m_Recorders.begin(), m_Recorders.end(), [thread](const Scope<Recorder>& recorder) {
+            return recorder->Thread == thread;
+        });
+
+        Recorder* recorder;
+        if (it != m_Recorders.end())
+        {
+            recorder = it->get();
+        }
+        else
+        {
+            m_Recorders.push_back(CreateScope<Recorder>());
+            recorder = m_Recorders.back().get();
+            recorder->Thread = thread;
+        }
+
+        s_RecorderCache = {m_ID, recorder};
+        return *recorder;
+    }
+
+    void* EntityCommandBuffer::Record(CommandType type, entt::entity entity, entt::entity parent, uint32_t componentID, const ComponentTable* table,
+                                      size_t payloadSize, size_t payloadAlignment)
+    {
+        size_t payloadOffset = AlignUp(sizeof(Command), payloadAlignment);
+        size_t size = AlignUp(payloadOffset + payloadSize, CommandAlignment);
+
+        Command* command = static_cast<Command*>(GetRecorder().Recording.Allocate(size));
+        command->Type = type;
+        command->Size = (uint32_t)size;
+        command->ComponentID = componentID;
+        command->PayloadOffset = (uint32_t)payloadOffset;
+        command->Entity = entity;
+        command->Parent = parent;
+        command->Table = table;
+        return command->GetPayload();
+    }
+
+    entt::entity EntityCommandBuffer::CreateEntity(const std::string& name)
+    {
+        using Traits = entt::entt_traits<entt::entity>;
+
+        Recorder& recorder = GetRecorder();
+
+        // The pending entities carry the tombstone version, which the registry never gives to a live entity
+        size_t index = recorder.Recording.Names.size();
+        if (index >= Traits::entity_mask)
+        {
+            COFFEE_CORE_ERROR("EntityCommandBuffer: Too many entities created by a thread in one frame");
+            return entt::null;
+        }
+
+        recorder.Recording.Names.push_back(name.empty() ? "Entity" : name);
+
+        entt::entity entity = Traits::construct((Traits::entity_type)index, Traits::version_mask);
+        Record(CommandType::CreateEntity, entity, entt::null, 0, nullptr, 0, 1);
+        return entity;
+    }
+
+    void EntityCommandBuffer::DestroyEntity(entt::entity entity)
+    {
+        Record(CommandType::DestroyEntity, entity, entt::null, 0, nullptr, 0, 1);
+    }
+
+    void EntityCommandBuffer::SetParent(entt::entity entity, entt::entity parent)
+    {
+        Record(CommandType::SetParent, entity, parent, 0, nullptr, 0, 1);
+    }
+
+    void EntityCommandBuffer::Playback(Scene& scene)
+    {
+        ZoneScoped;
+
+        auto start = std::chrono::steady_clock::now();
+
+        entt::registry& registry = scene.m_Registry;
+        EntityCommandBufferStats stats;
+
+        // Recorders added meanwhile, by a thread recording for the first time, only have commands for the next playback
+        size_t recorderCount = m_Recorders.size();
+        stats.RecorderCount = (uint32_t)recorderCount;
+
+        for (size_t i = 0; i < recorderCount; ++i)
+        {
+            Recorder& recorder = *m_Recorders[i];
+            std::swap(recorder.Recording, recorder.Playing);
+
+            stats.CommandCount += recorder.Playing.CommandCount;
+            stats.CreatedCount += (uint32_t)recorder.Playing.Names.size();
+            stats.ArenaBytes += recorder.Recording.GetReservedBytes() + recorder.Playing.GetReservedBytes();
+        }
+
+        if (stats.CommandCount == 0)
+        {
+            m_Stats = stats;
+            return;
+        }
+
+        // Creations first, in one batch, so every other command finds its pending entities
+        if (stats.CreatedCount > 0)
+        {
+            ZoneScopedN("Create Entities");
+
+            std::vector<entt::entity> created(stats.CreatedCount);
+            registry.create(created.begin(), created.end());
+
+            registry.insert<TransformComponent>(created.begin(), created.end());
+            registry.insert<HierarchyComponent>(created.begin(), created.end());
+
+            auto& tags = registry.storage<TagComponent>();
+            size_t next = 0;
+            for (size_t i = 0; i < recorderCount; ++i)
+            {
+                CommandArena& arena = m_Recorders[i]->Playing;
+                arena.Created.assign(created.begin() + next, created.begin() + next + arena.Names.size());
+                for (size_t j = 0; j < arena.Names.size(); ++j)
+                    tags.emplace(arena.Created[j], std::move(arena.Names[j]));
+
+                next += arena.Names.size();
+            }
+        }
+
+        // The commands are sorted by type then component, stable so each run keeps the recording order
+        struct SortedCommand
+        {
+            uint64_t Key;
+            Command* Target;
+        };
+
+        std::vector<SortedCommand> commands;
+        commands.reserve(stats.CommandCount - stats.CreatedCount);
+        for (size_t i = 0; i < recorderCount; ++i)
+        {
+            Recorder& recorder = *m_Recorders[i];
+            recorder.Playing.ForEach<Command>([&commands, &recorder](Command& command) {
+                if (command.Type == CommandType::CreateEntity)
+                    return;
+
+                command.Entity = recorder.Resolve(command.Entity);
+                command.Parent = recorder.Resolve(command.Parent);
+                commands.push_back({((uint64_t)command.Type << 32) | command.ComponentID, &command});
+            });
+        }
+
+        std::stable_sort(commands.begin(), commands.end(), [](const SortedCommand& a, const SortedCommand& b) {
+            return a.Key < b.Key;
+        });
+
+        std::vector<Command*> run;
+        std::vector<entt::entity> entities;
+        for (size_t begin = 0; begin < commands.size();)
+        {
+            size_t end = begin + 1;
+            while (end < commands.size() && commands[end].Key == commands[begin].Key)
+                end++;
+
+            Command& first = *commands[begin].Target;
+            switch (first.Type)
+            {
+            case CommandType::AddComponent: {
+                run.clear();
+                for (size_t i = begin; i < end; ++i)
+                    run.push_back(commands[i].Target);
+
+                first.Table->Add(registry, run.data(), run.size(), stats.SkippedCount);
+                break;
+            }
+            case CommandType::RemoveComponent: {
+                entities.clear();
+                for (size_t i = begin; i < end; ++i)
+                    entities.push_back(commands[i].Target->Entity);
+
+                first.Table->Remove(registry, entities.data(), entities.size());
+                break;
+            }
+            case CommandType::SetParent: {
+                // The consecutive commands to the same parent, the children spawned by a script for instance, move together
+                entities.clear();
+                entt::entity parent = entt::null;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    Command& command = *commands[i].Target;
+                    bool validParent = command.Parent == entt::null || registry.all_of<HierarchyComponent>(command.Parent);
+                    if (!registry.valid(command.Entity) || !registry.all_of<HierarchyComponent>(command.Entity) || !validParent)
+                    {
+                        stats.SkippedCount++;
+                        continue;
+                    }
+
+                    if (!entities.empty() && command.Parent != parent)
+                    {
+                        HierarchyComponent::ReparentMany(registry, entities, parent);
+                        entities.clear();
+                    }
+
+                    parent = command.Parent;
+                    entities.push_back(command.Entity);
+                }
+
+                if (!entities.empty())
+                    HierarchyComponent::ReparentMany(registry, entities, parent);
+                break;
+            }
+            case CommandType::DestroyEntity: {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    // Also skips the children of an entity destroyed earlier in the run
+                    entt::entity entity = commands[i].Target->Entity;
+                    if (!registry.valid(entity))
+                    {
+                        stats.SkippedCount++;
+                        continue;
+                    }
+
+                    if (registry.all_of<HierarchyComponent>(entity))
+                        scene.DestroyEntity(Entity(entity, &scene));
+                    else
+                        registry.destroy(entity);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+
+            begin = end;
+        }
+
+        for (size_t i = 0; i < recorderCount; ++i)
+            Recorder::Clear(m_Recorders[i]->Playing);
+
+        stats.PlaybackTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        m_Stats = stats;
+
+        TracyPlot("Entity Commands", (int64_t)stats.CommandCount);
+    }
+
+    void EntityCommandBuffer::Clear()
+    {
+        for (Scope<Recorder>& recorder : m_Recorders)
+        {
+            Recorder::Clear(recorder->Recording);
+            Recorder::Clear(recorder->Playing);
+        }
+    }
+
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Scene/ComponentRegistry.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @addtogroup scene
+     * @{
+     */
+
+    class Scene;
+
+    /**
+     * @brief Structure containing the statistics of the last command buffer playback.
+     * @ingroup scene
+     */
+    struct EntityCommandBufferStats
+    {
+        uint32_t CommandCount = 0; ///< Number of commands played back, the creations included.
+        uint32_t CreatedCount = 0; ///< Number of entities created.
+        uint32_t SkippedCount = 0; ///< Number of commands dropped because their entity was already destroyed.
+        uint32_t RecorderCount = 0; ///< Number of threads that recorded commands since the buffer was created.
+        uint64_t ArenaBytes = 0; ///< Bytes reserved by the arenas of every recorder.
+        double PlaybackTime = 0.0; ///< Time of the playback, in milliseconds.
+    };
+
+    /**
+     * @brief Records the structural changes of a scene, creating and destroying entities, adding and removing
+     * components and reparenting, and applies them all at once at a defined point of the frame.
+     *
+     * Every thread records into its own linear arena, so recording takes no lock once the thread has its recorder
+     * and works from the script workers. The entities created are pending until the playback, the handle returned
+     * by CreateEntity can only be used in the commands recorded by the same thread before the playback.
+     *
+     * The playback creates the pending entities in one batch, then runs the commands sorted by type: the component
+     * additions grouped by component, the reparents, the component removals grouped by component and the
+     * destructions last. The commands of a type keep their recording order, but a component added and removed in
+     * the same frame ends up removed whatever the order they were recorded in.
+     *
+     * @code
+     * EntityCommandBuffer& commands = scene->GetCommandBuffer();
+     * entt::entity bullet = commands.CreateEntity("Bullet");
+     * commands.AddComponent<MeshComponent>(bullet, mesh);
+     * commands.SetParent(bullet, weapon);
+     * commands.DestroyEntity(target);
+     * @endcode
+     * @ingroup scene
+     */
+    class EntityCommandBuffer
+    {
+    public:
+        EntityCommandBuffer();
+        ~EntityCommandBuffer();
+
+        EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+        EntityCommandBuffer& operator=(const EntityCommandBuffer&) = delete;
+
+        /**
+         * @brief Records the creation of an entity with a transform, a tag and a hierarchy, like Scene::CreateEntity.
+         * @param name The name of the entity.
+         * @return The pending entity, or entt::null if the thread recorded too many creations this frame.
+         */
+        entt::entity CreateEntity(const std::string& name = std::string());
+
+        /**
+         * @brief Records the destruction of an entity and its children.
+         * @param entity The entity, existing or pending.
+         */
+        void DestroyEntity(entt::entity entity);
+
+        /**
+         * @brief Records the addition of a component, replacing the one the entity has at the playback.
+         * @tparam T The component type, one of the ComponentRegistry.
+         * @param entity The entity, existing or pending.
+         * @param args The component constructor arguments, the component is built right away in the arena.
+         */
+        template<typename T, typename... Args>
+        void AddComponent(entt::entity entity, Args&&... args)
+        {
+            static_assert(alignof(T) <= CommandAlignment, "The component is over aligned for the command arena");
+
+            void* payload = Record(CommandType::AddComponent, entity, entt::null, ComponentInfo<T>::ID, &ComponentCommands<T>::Table,
+                                   sizeof(T), alignof(T));
+            new (payload) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Records the removal of a component, nothing happens if the entity does not have it at the playback.
+         * @tparam T The component type, one of the ComponentRegistry.
+         * @param entity The entity, existing or pending.
+         */
+        template<typename T>
+        void RemoveComponent(entt::entity entity)
+        {
+            Record(CommandType::RemoveComponent, entity, entt::null, ComponentInfo<T>::ID, &ComponentCommands<T>::Table, 0, 1);
+        }
+
+        /**
+         * @brief Records the change of the parent of an entity.
+         * @param entity The entity, existing or pending.
+         * @param parent The new parent, existing or pending, or entt::null to move the entity to the root.
+         */
+        void SetParent(entt::entity entity, entt::entity parent);
+
+        /**
+         * @brief Applies every recorded command to a scene and clears the arenas. No thread may record meanwhile.
+         * @param scene The scene.
+         */
+        void Playback(Scene& scene);
+
+        /**
+         * @brief Drops every recorded command without applying it.
+         */
+        void Clear();
+
+        /**
+         * @brief Checks if an entity is a pending one returned by CreateEntity, not created yet.
+         * @param entity The entity.
+         * @return True if the entity is pending.
+         */
+        static bool IsPending(entt::entity entity) { return entity != entt::null && entity == entt::tombstone; }
+
+        const EntityCommandBufferStats& GetStats() const { return m_Stats; }
+
+    private:
+        static constexpr size_t CommandAlignment = alignof(std::max_align_t);
+
+        /**
+         * @brief Command types in playback order.
+         */
+        enum class CommandType : uint32_t
+        {
+            CreateEntity,
+            AddComponent,
+            SetParent,
+            RemoveComponent,
+            DestroyEntity
+        };
+
+        struct Command;
+
+        /**
+         * @brief Typed functions of the component commands, one table per component type.
+         */
+        struct ComponentTable
+        {
+            void (*Add)(entt::registry& registry, Command* const* commands, size_t count, uint32_t& skipped);
+            void (*Remove)(entt::registry& registry, const entt::entity* entities, size_t count);
+            void (*Destroy)(void* payload);
+        };
+
+        /**
+         * @brief Header of a command in the arena, the payload follows it.
+         */
+        struct Command
+        {
+            CommandType Type;
+            uint32_t Size; ///< Bytes of the header, the payload and the padding up to the next command.
+            uint32_t ComponentID; ///< Sort key of the component commands, ComponentInfo::ID.
+            uint32_t PayloadOffset; ///< Offset of the payload from the header.
+            entt::entity Entity;
+            entt::entity Parent; ///< The new parent of a reparent.
+            const ComponentTable* Table; ///< Functions of the component commands, nullptr for the others.
+
+            void* GetPayload() { return reinterpret_cast<std::byte*>(this) + PayloadOffset; }
+        };
+
+        template<typename T>
+        struct ComponentCommands
+        {
+            static void Add(entt::registry& registry, Command* const* commands, size_t count, uint32_t& skipped)
+            {
+                // Looked up once for the whole run of the type
+                auto& storage = registry.storage<T>();
+                for (size_t i = 0; i < count; ++i)
+                {
+                    entt::entity entity = commands[i]->Entity;
+                    if (!registry.valid(entity))
+                    {
+                        skipped++;
+                        continue;
+                    }
+
+                    T& component = *static_cast<T*>(commands[i]->GetPayload());
+                    if (storage.contains(entity))
+                        storage.patch(entity, [&component](T& current) { current = std::move(component); });
+                    else
+                        storage.emplace(entity, std::move(component));
+                }
+            }
+
+            static void Remove(entt::registry& registry, const entt::entity* entities, size_t count)
+            {
+                // Entities without the component or destroyed are ignored by the storage
+                registry.storage<T>().remove(entities, entities + count);
+            }
+
+            static void Destroy(void* payload) { static_cast<T*>(payload)->~T(); }
+
+            static constexpr ComponentTable Table = {&Add, &Remove, &Destroy};
+        };
+
+        struct Recorder;
+
+        /**
+         * @brief Reserves a command in the arena of the calling thread.
+         * @return The payload of the command.
+         */
+        void* Record(CommandType type, entt::entity entity, entt::entity parent, uint32_t componentID, const ComponentTable* table,
+                     size_t payloadSize, size_t payloadAlignment);
+
+        Recorder& GetRecorder();
+
+    private:
+        uint64_t m_ID; ///< Unique among every buffer ever created, keys the recorder cached by each thread.
+        std::mutex m_Mutex; ///< Guards the recorder list, only taken the first time a thread records.
+        std::vector<Scope<Recorder>> m_Recorders;
+        EntityCommandBufferStats m_Stats;
+
+        static std::atomic<uint64_t> s_NextID;
+    };
+
+    /** @} */
+}
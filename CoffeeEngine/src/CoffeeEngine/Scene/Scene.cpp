@@ -1,30 +1,42 @@
 #include "Scene.h"
 
 #include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Core/DataStructures/BVH.h"
 #include "CoffeeEngine/Core/DataStructures/Octree.h"
+#include "CoffeeEngine/Core/Stopwatch.h"
+#include "CoffeeEngine/IO/CacheManager.h"
+#include "CoffeeEngine/IO/MappedFile.h"
 #include "CoffeeEngine/Math/Frustum.h"
 #include "CoffeeEngine/Renderer/DebugRenderer.h"
 #include "CoffeeEngine/Renderer/EditorCamera.h"
 #include "CoffeeEngine/Renderer/Material.h"
 #include "CoffeeEngine/Renderer/Mesh.h"
 #include "CoffeeEngine/Renderer/Renderer.h"
+#include "CoffeeEngine/Scene/ComponentRegistry.h"
 #include "CoffeeEngine/Scene/Components.h"
+#include "CoffeeEngine/Scene/CookedScene.h"
 #include "CoffeeEngine/Scene/Entity.h"
+#include "CoffeeEngine/Scene/EntityCommandBuffer.h"
 #include "CoffeeEngine/Scene/PrimitiveMesh.h"
 #include "CoffeeEngine/Scene/SceneCamera.h"
 #include "CoffeeEngine/Scene/SceneTree.h"
 #include "CoffeeEngine/Scripting/Lua/LuaBackend.h"
 #include "CoffeeEngine/Scripting/ScriptManager.h"
+#include "CoffeeEngine/Scripting/Lua/LuaMemory.h"
+#include "CoffeeEngine/Scripting/ScriptSystem.h"
 #include "entt/entity/entity.hpp"
 #include "entt/entity/fwd.hpp"
 #include "entt/entity/snapshot.hpp"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <glm/detail/type_quat.hpp>
 #include <glm/fwd.hpp>
 #include <string>
 #include <tracy/Tracy.hpp>
+#include <utility>
+#include <vector>
 
 #include <CoffeeEngine/Scripting/Script.h>
 #include <cereal/archives/json.hpp>
@@ -32,19 +44,142 @@
 
 namespace Coffee {
 
-    Scene::Scene() : m_Octree({glm::vec3(-50.0f), glm::vec3(50.0f)}, 10, 5)
+    Scene::Scene()
     {
+        // Lets the component hooks, which only get the registry, find the scene of an entity
+        m_Registry.ctx().emplace<Scene*>(this);
+
         m_SceneTree = CreateScope<SceneTree>(this);
+        m_CommandBuffer = CreateScope<EntityCommandBuffer>();
+
+        // The destroyed meshes leave the spatial index, whoever destroys them (scripts, the editor, the streaming)
+        m_Registry.on_construct<MeshComponent>().connect<&Scene::OnMeshConstruct>(*this);
+        m_Registry.on_update<MeshComponent>().connect<&Scene::OnMeshConstruct>(*this);
+        m_Registry.on_destroy<MeshComponent>().connect<&Scene::OnMeshDestroy>(*this);
+        m_Registry.on_destroy<SpatialIndexEntry>().connect<&Scene::OnSpatialIndexEntryDestroy>(*this);
+
+        // The script instances are torn down however their entity is destroyed (scripts, the editor, the streaming)
+        m_Registry.on_destroy<ScriptComponent>().connect<&ScriptComponent::OnDestroy>();
+        m_Registry.on_destroy<ScriptInstance>().connect<&ScriptSystem::OnInstanceDestroy>();
     }
 
-/*     Scene::Scene(Ref<Scene> other)
+    Scene::~Scene()
     {
+        // The spatial index is destroyed before the registry
+        m_Registry.on_construct<MeshComponent>().disconnect(this);
+        m_Registry.on_update<MeshComponent>().disconnect(this);
+        m_Registry.on_destroy<MeshComponent>().disconnect(this);
+        m_Registry.on_destroy<SpatialIndexEntry>().disconnect(this);
+
+        ScriptSystem::DestroyInstances(m_Registry);
+    }
+
+    // Copies every component of a type, the destination entities are looked up by the index of the source ones
+    template<typename Component>
+    static void CopyComponent(entt::registry& dst, entt::registry& src, const std::vector<entt::entity>& entityMap)
+    {
+        auto& storage = src.storage<Component>();
+        if (storage.empty())
+            return;
+
+        std::vector<entt::entity> entities;
+        entities.reserve(storage.size());
+        for (auto entity : static_cast<const entt::sparse_set&>(storage))
+        {
+            entities.push_back(entityMap[entt::to_entity(entity)]);
+        }
+
+        // The sparse set and the storage are iterated in the same order, so the components line up with the entities
+        dst.insert<Component>(entities.begin(), entities.end(), storage.cbegin());
+    }
+
+    Ref<Scene> Scene::Copy(const Ref<Scene>& other)
+    {
+        ZoneScoped;
+
+        Ref<Scene> scene = CreateRef<Scene>();
+        scene->m_Octree.SetSettings(other->m_Octree.GetSettings());
+        scene->m_SpatialIndexType = other->m_SpatialIndexType;
+
         auto& srcRegistry = other->m_Registry;
-        auto& dstRegistry = m_Registry;
+        auto& dstRegistry = scene->m_Registry;
+
+        auto srcEntities = srcRegistry.view<entt::entity>();
+
+        // Create the entities with the source identifiers as hint, so the entity IDs stay the same in both scenes
+        std::vector<entt::entity> entityMap;
+        for (auto entity : srcEntities)
+        {
+            size_t index = entt::to_entity(entity);
+            if (index >= entityMap.size())
+                entityMap.resize(index + 1, entt::null);
+
+            entityMap[index] = dstRegistry.create(entity);
+        }
+
+        // The hierarchy links are copied as they are, appending the entities to their parents again would duplicate them
+        dstRegistry.on_construct<HierarchyComponent>().disconnect<&HierarchyComponent::OnConstruct>();
+
+        ComponentRegistry::ForEach([&]<typename Component>() {
+            CopyComponent<Component>(dstRegistry, srcRegistry, entityMap);
+        });
+
+        dstRegistry.on_construct<HierarchyComponent>().connect<&HierarchyComponent::OnConstruct>();
+
+        ScriptSystem::CopyInstances(scene.get(), dstRegistry, srcRegistry, entityMap);
+
+        auto remap = [&entityMap](entt::entity entity) {
+            return entity == entt::null ? entity : entityMap[entt::to_entity(entity)];
+        };
+
+        auto hierarchyView = dstRegistry.view<HierarchyComponent>();
+        for (auto entity : hierarchyView)
+        {
+            auto& hierarchy = hierarchyView.get<HierarchyComponent>(entity);
+            hierarchy.m_Parent = remap(hierarchy.m_Parent);
+            hierarchy.m_First = remap(hierarchy.m_First);
+            hierarchy.m_Last = remap(hierarchy.m_Last);
+            hierarchy.m_Next = remap(hierarchy.m_Next);
+            hierarchy.m_Prev = remap(hierarchy.m_Prev);
+        }
+
+        scene->m_FilePath = other->m_FilePath;
+
+        if (other->m_WorldPartition)
+        {
+            scene->m_WorldPartition = other->m_WorldPartition->Clone(scene.get());
+        }
+
+        return scene;
+    }
 
-        auto view = srcRegistry.view<entt::entity>();
-        dstRegistry.insert(view->data(), view->data() + view->size(), view->raw(), view->raw() + view.size());
-    } */
+    // The group owns the meshes and the materials, it packs the entities that have both at the front of the two
+    // storages in the same order so the extraction walks them linearly. Adding or removing one of them reorders
+    // these storages, a mesh or material reference taken before may then point to another entity. The transforms
+    // are not owned, they are looked up, so the references to them the scripts hold stay valid.
+    template<typename Function>
+    static void ExtractMeshes(entt::registry& registry, Function&& submit)
+    {
+        ZoneScoped;
+
+        auto group = registry.group<MeshComponent, MaterialComponent>(entt::get<TransformComponent>);
+        for (auto [entity, meshComponent, materialComponent, transformComponent] : group.each())
+        {
+            submit(RenderCommand{transformComponent.GetWorldTransform(), meshComponent.GetMesh().get(), materialComponent.material.get(), (uint32_t)entity});
+        }
+
+        // The meshes without a material are drawn with the default one
+        auto view = registry.view<MeshComponent, TransformComponent>(entt::exclude<MaterialComponent>);
+        for (auto [entity, meshComponent, transformComponent] : view.each())
+        {
+            submit(RenderCommand{transformComponent.GetWorldTransform(), meshComponent.GetMesh().get(), nullptr, (uint32_t)entity});
+        }
+    }
+
+    void Scene::ExtractRenderCommands(std::vector<RenderCommand>& commands)
+    {
+        ExtractMeshes(m_Registry, [&commands](const RenderCommand& command) { commands.push_back(command); });
+    }
 
     Entity Scene::CreateEntity(const std::string& name)
     {
@@ -58,19 +193,212 @@ namespace Coffee {
         return entity;
     }
 
+    std::vector<entt::entity> Scene::CreateEntities(uint32_t count, const std::string& name, entt::entity parent)
+    {
+        ZoneScoped;
+
+        std::vector<entt::entity> entities(count);
+        m_Registry.create(entities.begin(), entities.end());
+
+        m_Registry.insert<TransformComponent>(entities.begin(), entities.end());
+        m_Registry.insert<TagComponent>(entities.begin(), entities.end(), TagComponent(name.empty() ? "Entity" : name));
+        m_Registry.insert<HierarchyComponent>(entities.begin(), entities.end());
+
+        if (parent != entt::null)
+            HierarchyComponent::ReparentMany(m_Registry, entities, parent);
+
+        return entities;
+    }
+
     void Scene::DestroyEntity(Entity entity)
     {
-        auto& hierarchyComponent = m_Registry.get<HierarchyComponent>(entity);
-        auto curr = hierarchyComponent.m_First;
+        HierarchyComponent::DestroySubtree(m_Registry, entity);
+    }
+
+    void Scene::InsertIntoSpatialIndex(entt::entity entity)
+    {
+        const glm::mat4& transform = m_Registry.get<TransformComponent>(entity).GetWorldTransform();
+        const AABB& bounds = m_Registry.get<MeshComponent>(entity).GetMesh()->GetAABB();
+
+        m_Octree.Insert({transform, bounds, entity});
+        m_Registry.emplace_or_replace<SpatialIndexEntry>(entity, SpatialIndexEntry{transform, bounds});
+    }
+
+    void Scene::RebuildBVH()
+    {
+        ZoneScoped;
 
-        while(curr != entt::null)
+        std::vector<ObjectContainer<entt::entity>> objects;
+        objects.reserve(m_BVH.GetObjects().size());
+
+        for (const auto& object : m_BVH.GetObjects())
+        {
+            if (m_Registry.all_of<SpatialIndexEntry>(object.object))
+                objects.push_back(object);
+        }
+
+        m_BVH.Build(objects);
+
+        const auto& built = m_BVH.GetObjects();
+        for (int32_t i = 0; i < (int32_t)built.size(); ++i)
         {
-            Entity e{curr, this};
-            curr = m_Registry.get<HierarchyComponent>(curr).m_Next;
-            DestroyEntity(e);
+            m_Registry.get<SpatialIndexEntry>(built[i].object).BVHIndex = i;
         }
 
-        m_Registry.destroy((entt::entity)entity);
+        m_BVHDirty = false;
+    }
+
+    void Scene::UpdateSpatialIndex()
+    {
+        ZoneScoped;
+
+        if (m_BVHDirty)
+        {
+            RebuildBVH();
+        }
+
+        // The meshes added since the runtime started, by the scripts or the command buffer
+        std::vector<entt::entity> added;
+        auto addedView = m_Registry.view<MeshComponent, TransformComponent>(entt::exclude<SpatialIndexEntry>);
+        for (auto entity : addedView)
+        {
+            if (addedView.get<MeshComponent>(entity).GetMesh())
+                added.push_back(entity);
+        }
+
+        for (auto entity : added)
+        {
+            InsertIntoSpatialIndex(entity);
+        }
+
+        // The moved meshes are reinserted in the octree, the BVH keeps its topology and only refits its bounds
+        bool refit = false;
+        auto view = m_Registry.view<SpatialIndexEntry, TransformComponent>();
+        for (auto [entity, entry, transformComponent] : view.each())
+        {
+            const glm::mat4& transform = transformComponent.GetWorldTransform();
+            if (transform == entry.Transform)
+                continue;
+
+            if (entry.BVHIndex >= 0)
+            {
+                m_BVH.GetObjects()[entry.BVHIndex].transform = transform;
+                refit = true;
+            }
+            else
+            {
+                m_Octree.Remove({entry.Transform, entry.Bounds, entity});
+                m_Octree.Insert({transform, entry.Bounds, entity});
+            }
+
+            entry.Transform = transform;
+        }
+
+        if (refit)
+        {
+            m_BVH.Refit();
+        }
+    }
+
+    void Scene::OnMeshConstruct(entt::registry& registry, entt::entity entity)
+    {
+        m_PickingBVHDirty = true;
+    }
+
+    void Scene::OnMeshDestroy(entt::registry& registry, entt::entity entity)
+    {
+        m_PickingBVHDirty = true;
+
+        // Also called when only the mesh is removed, the entry may already be gone if the entity is destroyed
+        registry.remove<SpatialIndexEntry>(entity);
+    }
+
+    void Scene::OnSpatialIndexEntryDestroy(entt::registry& registry, entt::entity entity)
+    {
+        const SpatialIndexEntry& entry = registry.get<SpatialIndexEntry>(entity);
+
+        // The BVH has no removal, it is rebuilt once before the next query
+        if (entry.BVHIndex >= 0)
+            m_BVHDirty = true;
+        else
+            m_Octree.Remove({entry.Transform, entry.Bounds, entity});
+    }
+
+    // The ray is moved to the mesh space instead of the vertices to the world, an affine transform keeps the ray
+    // parameter so the distance stays in world units
+    static bool IntersectMesh(const Ray& ray, const glm::mat4& transform, const Mesh& mesh, float& distance)
+    {
+        const std::vector<Vertex>& vertices = mesh.GetVertices();
+        const std::vector<uint32_t>& indices = mesh.GetIndices();
+        if (vertices.empty() || indices.empty())
+            return false;
+
+        glm::mat4 inverseTransform = glm::inverse(transform);
+        Ray localRay(glm::vec3(inverseTransform * glm::vec4(ray.origin, 1.0f)), glm::vec3(inverseTransform * glm::vec4(ray.direction, 0.0f)));
+
+        return localRay.IntersectTriangles(&vertices[0].Position, sizeof(Vertex), indices.data(), indices.size(), distance);
+    }
+
+    Entity Scene::Raycast(const Ray& ray, float maxDistance, float* hitDistance)
+    {
+        ZoneScoped;
+
+        auto intersect = [this](const ObjectContainer<entt::entity>& candidate, const Ray& ray, float& distance) {
+            MeshComponent* meshComponent = m_Registry.try_get<MeshComponent>(candidate.object);
+            if (!meshComponent || !meshComponent->GetMesh())
+                return false;
+
+            return IntersectMesh(ray, candidate.transform, *meshComponent->GetMesh(), distance);
+        };
+
+        float distance = maxDistance;
+        entt::entity hit = entt::null;
+
+        if (m_IsRuntime)
+        {
+            if (m_BVHDirty)
+            {
+                RebuildBVH();
+            }
+
+            entt::entity candidate = entt::null;
+            if (m_BVH.Raycast(ray, distance, candidate, intersect))
+                hit = candidate;
+            if (m_Octree.Raycast(ray, distance, candidate, intersect))
+                hit = candidate;
+        }
+        else
+        {
+            if (m_PickingBVHDirty || m_PickingTransformVersion != m_SceneTree->GetTransformVersion())
+            {
+                ZoneScopedN("Build Picking BVH");
+
+                auto view = m_Registry.view<MeshComponent, TransformComponent>();
+
+                std::vector<ObjectContainer<entt::entity>> objects;
+                objects.reserve(view.size_hint());
+
+                for (auto entity : view)
+                {
+                    const Ref<Mesh>& mesh = view.get<MeshComponent>(entity).GetMesh();
+                    if (mesh)
+                        objects.push_back({view.get<TransformComponent>(entity).GetWorldTransform(), mesh->GetAABB(), entity});
+                }
+
+                m_PickingBVH.Build(objects);
+                m_PickingBVHDirty = false;
+                m_PickingTransformVersion = m_SceneTree->GetTransformVersion();
+            }
+
+            entt::entity candidate = entt::null;
+            if (m_PickingBVH.Raycast(ray, distance, candidate, intersect))
+                hit = candidate;
+        }
+
+        if (hitDistance && hit != entt::null)
+            *hitDistance = distance;
+
+        return hit != entt::null ? Entity(hit, this) : Entity();
     }
 
     void Scene::OnInitEditor()
@@ -97,16 +425,52 @@ namespace Coffee {
 
         m_SceneTree->Update();
 
+        m_Registry.clear<SpatialIndexEntry>();
+        m_IsRuntime = true;
+        m_PickingBVH.Clear();
+
         auto view = m_Registry.view<MeshComponent>();
 
+        std::vector<ObjectContainer<entt::entity>> objects;
+        objects.reserve(view.size());
+
         for (auto& entity : view)
         {
             auto& meshComponent = view.get<MeshComponent>(entity);
             auto& transformComponent = m_Registry.get<TransformComponent>(entity);
 
-            ObjectContainer<Ref<Mesh>> objectContainer = {transformComponent.GetWorldTransform(), meshComponent.GetMesh()->GetAABB(), meshComponent.GetMesh()};
+            objects.push_back({transformComponent.GetWorldTransform(), meshComponent.GetMesh()->GetAABB(), entity});
+            m_Registry.emplace<SpatialIndexEntry>(entity, SpatialIndexEntry{objects.back().transform, objects.back().aabb});
+        }
+
+        Stopwatch stopwatch;
+        stopwatch.Start();
+
+        if (m_SpatialIndexType == SpatialIndexType::BVH)
+        {
+            m_BVH.Build(objects);
+            m_Octree.Build({});
+
+            const auto& built = m_BVH.GetObjects();
+            for (int32_t i = 0; i < (int32_t)built.size(); ++i)
+            {
+                m_Registry.get<SpatialIndexEntry>(built[i].object).BVHIndex = i;
+            }
+            m_BVHDirty = false;
+
+            stopwatch.Stop();
+            BVHStats stats = m_BVH.GetStats();
+            COFFEE_CORE_INFO("Scene BVH built in {0:.2f} ms: {1} objects, {2} nodes, depth {3}, SAH cost {4:.1f}", stopwatch.GetPreciseElapsedTime() * 1000.0, stats.ObjectCount, stats.NodeCount, stats.Depth, stats.Cost);
+        }
+        else
+        {
+            // The root bounds are fitted to the content, objects added later grow the root instead of being dropped
+            m_Octree.Build(objects);
+            m_BVH.Clear();
 
-            m_Octree.Insert(objectContainer);
+            stopwatch.Stop();
+            OctreeStats stats = m_Octree.GetStats();
+            COFFEE_CORE_INFO("Scene octree built in {0:.2f} ms: {1} objects, {2} nodes, depth {3}, {4:.1f} objects per leaf", stopwatch.GetPreciseElapsedTime() * 1000.0, stats.ObjectCount, stats.NodeCount, stats.Depth, stats.AverageObjectsPerLeaf);
         }
     }
 
@@ -114,6 +478,11 @@ namespace Coffee {
     {
         ZoneScoped;
 
+        if (m_WorldPartition)
+        {
+            m_WorldPartition->Update(camera.GetPosition());
+        }
+
         m_SceneTree->Update();
 
         Renderer::BeginScene(camera);
@@ -121,23 +490,7 @@ namespace Coffee {
         // TEST ------------------------------
         m_Octree.DebugDraw();
 
-        // Get all entities with ModelComponent and TransformComponent
-        auto view = m_Registry.view<MeshComponent, TransformComponent>();
-
-        // Loop through each entity with the specified components
-        for (auto& entity : view)
-        {
-            // Get the ModelComponent and TransformComponent for the current entity
-            auto& meshComponent = view.get<MeshComponent>(entity);
-            auto& transformComponent = view.get<TransformComponent>(entity);
-            auto materialComponent = m_Registry.try_get<MaterialComponent>(entity);
-
-            Ref<Mesh> mesh = meshComponent.GetMesh();
-            Ref<Material> material = (materialComponent) ? materialComponent->material : nullptr;
-            
-            //Renderer::Submit(material, mesh, transformComponent.GetWorldTransform(), (uint32_t)entity);
-            Renderer::Submit(RenderCommand{transformComponent.GetWorldTransform(), mesh, material, (uint32_t)entity});
-        }
+        ExtractMeshes(m_Registry, [](const RenderCommand& command) { Renderer::Submit(command); });
 
         //Get all entities with LightComponent and TransformComponent
         auto lightView = m_Registry.view<LightComponent, TransformComponent>();
@@ -154,15 +507,34 @@ namespace Coffee {
             Renderer::Submit(lightComponent);
         }
 
+        m_CommandBuffer->Playback(*this);
+
+        // No script updates in the editor, but OnCreate and the inspector still allocate
+        LuaMemory::Step(LuaBackend::luaState.lua_state());
+
         Renderer::EndScene();
     }
 
-    void Scene::OnUpdateRuntime(float dt)
+    void Scene::OnFixedUpdateRuntime(float dt)
     {
         ZoneScoped;
 
+        // The rendered transforms may be interpolated, the scripts see the exact ones
+        m_SceneTree->SaveTransforms();
         m_SceneTree->Update();
 
+        ScriptSystem::OnUpdate(this, m_Registry, dt);
+
+        // The structural changes the scripts recorded while the views were iterated
+        m_CommandBuffer->Playback(*this);
+    }
+
+    void Scene::OnUpdateRuntime(float dt, float alpha)
+    {
+        ZoneScoped;
+
+        m_SceneTree->Update(alpha);
+
         Camera* camera = nullptr;
         glm::mat4 cameraTransform;
         auto cameraView = m_Registry.view<TransformComponent, CameraComponent>();
@@ -185,6 +557,11 @@ namespace Coffee {
             cameraTransform = glm::mat4(1.0f);
         }
 
+        if (m_WorldPartition)
+        {
+            m_WorldPartition->Update(cameraTransform[3]);
+        }
+
         //TODO: Add this to a function bc it is repeated in OnUpdateEditor
         Renderer::BeginScene(*camera, cameraTransform);
 
@@ -197,11 +574,31 @@ namespace Coffee {
         Frustum frustum = Frustum(camera->GetProjection() /* testProjection */ * glm::inverse(cameraTransform));
         DebugRenderer::DrawFrustum(frustum, glm::vec4(1.0f), 1.0f);
 
-        auto meshes = m_Octree.Query(frustum);
+        UpdateSpatialIndex();
+
+        std::vector<ObjectContainer<entt::entity>> objects;
+        {
+            ZoneScopedN("Spatial Query");
+
+            objects = m_Octree.Query(frustum);
+            if (m_SpatialIndexType == SpatialIndexType::BVH)
+            {
+                std::vector<ObjectContainer<entt::entity>> staticObjects = m_BVH.Query(frustum);
+                objects.insert(objects.end(), staticObjects.begin(), staticObjects.end());
+            }
+        }
 
-        for(auto& mesh : meshes)
+        for(auto& object : objects)
         {
-            Renderer::Submit(RenderCommand{mesh.transform, mesh.object, mesh.object->GetMaterial(), 0});
+            // Only what the index still holds is queried, but the mesh may have been cleared since
+            MeshComponent* meshComponent = m_Registry.valid(object.object) ? m_Registry.try_get<MeshComponent>(object.object) : nullptr;
+            if (!meshComponent || !meshComponent->GetMesh())
+                continue;
+
+            // The interpolated transform of this frame, not the one the object was indexed with
+            const glm::mat4& transform = m_Registry.get<TransformComponent>(object.object).GetWorldTransform();
+            const Ref<Mesh>& mesh = meshComponent->GetMesh();
+            Renderer::Submit(RenderCommand{transform, mesh.get(), mesh->GetMaterial().get(), (uint32_t)object.object});
         }
         
 /*         // Get all entities with ModelComponent and TransformComponent
@@ -236,18 +633,8 @@ namespace Coffee {
             Renderer::Submit(lightComponent);
         }
 
-        // Get all entities with ScriptComponent
-        auto scriptView = m_Registry.view<ScriptComponent>();
-
-        for (auto& entity : scriptView)
-        {
-            Entity scriptEntity{entity, this};
-            ScriptManager::RegisterVariable("entity", (void*)&scriptEntity);
-
-            auto& scriptComponent = scriptView.get<ScriptComponent>(entity);
-
-            scriptComponent.script.OnUpdate();
-        }
+        // The Lua collector only runs here, after every simulation step of the frame, under its own budget
+        LuaMemory::Step(LuaBackend::luaState.lua_state());
 
         Renderer::EndScene();
     }
@@ -271,32 +658,34 @@ namespace Coffee {
     {
         ZoneScoped;
 
-        Ref<Scene> scene = CreateRef<Scene>();
+        if (Ref<Scene> scene = LoadCooked(path))
+        {
+            return scene;
+        }
 
-        std::ifstream sceneFile(path);
-        cereal::JSONInputArchive archive(sceneFile);
-
-        entt::snapshot_loader{scene->m_Registry}
-            .get<entt::entity>(archive)
-            .get<TagComponent>(archive)
-            .get<TransformComponent>(archive)
-            .get<HierarchyComponent>(archive)
-            .get<CameraComponent>(archive)
-            .get<MeshComponent>(archive)
-            .get<MaterialComponent>(archive)
-            .get<LightComponent>(archive);
-        
-        scene->m_FilePath = path;
+        Ref<Scene> scene = CreateRef<Scene>();
 
-        auto view = scene->m_Registry.view<entt::entity>();
-        for (auto entity : view)
         {
-            auto& tag = scene->m_Registry.get<TagComponent>(entity);
-            auto& hierarchy = scene->m_Registry.get<HierarchyComponent>(entity);
+            std::ifstream sceneFile(path);
+            cereal::JSONInputArchive archive(sceneFile);
+
+            entt::snapshot_loader loader{scene->m_Registry};
+            loader.get<entt::entity>(archive);
 
-            COFFEE_INFO("Entity {0}, {1}", (uint32_t)entity, tag.Tag);
+            ComponentRegistry::ForEach([&]<typename Component>() {
+                if constexpr (ComponentInfo<Component>::Flags & ComponentFlags::Serialized)
+                    loader.get<Component>(archive);
+            });
         }
 
+        HierarchyComponent::RebuildLinks(scene->m_Registry);
+
+        scene->m_FilePath = path;
+
+        COFFEE_INFO("Scene {0} loaded from JSON ({1} entities)", path.filename().string(), scene->m_Registry.view<entt::entity>().size());
+
+        Cook(path, scene);
+
         return scene;
     }
 
@@ -304,68 +693,159 @@ namespace Coffee {
     {
         ZoneScoped;
 
-        std::ofstream sceneFile(path);
-        cereal::JSONOutputArchive archive(sceneFile);
-
-        //archive(*scene);
-
-        //TEMPORAL
-        entt::snapshot{scene->m_Registry}
-            .get<entt::entity>(archive)
-            .get<TagComponent>(archive)
-            .get<TransformComponent>(archive)
-            .get<HierarchyComponent>(archive)
-            .get<CameraComponent>(archive)
-            .get<MeshComponent>(archive)
-            .get<MaterialComponent>(archive)
-            .get<LightComponent>(archive);
-        
+        {
+            std::ofstream sceneFile(path);
+            cereal::JSONOutputArchive archive(sceneFile);
+
+            //archive(*scene);
+
+            entt::snapshot snapshot{scene->m_Registry};
+            snapshot.get<entt::entity>(archive);
+
+            ComponentRegistry::ForEach([&]<typename Component>() {
+                if constexpr (ComponentInfo<Component>::Flags & ComponentFlags::Serialized)
+                    snapshot.get<Component>(archive);
+            });
+        }
+
         scene->m_FilePath = path;
 
-        auto view = scene->m_Registry.view<entt::entity>();
-        for (auto entity : view)
+        // The JSON file has to be closed first, the cooked scene stores its write time
+        Cook(path, scene);
+    }
+
+    Ref<Scene> Scene::LoadWorld(const std::filesystem::path& directory)
+    {
+        ZoneScoped;
+
+        Ref<Scene> scene = CreateRef<Scene>();
+        scene->m_WorldPartition = CreateScope<WorldPartition>(scene.get());
+
+        if (!scene->m_WorldPartition->Open(directory))
         {
-            auto& tag = scene->m_Registry.get<TagComponent>(entity);
-            auto& hierarchy = scene->m_Registry.get<HierarchyComponent>(entity);
+            return nullptr;
+        }
+
+        return scene;
+    }
+
+    static int64_t GetSourceWriteTime(const std::filesystem::path& path)
+    {
+        std::error_code error;
+        auto writeTime = std::filesystem::last_write_time(path, error);
+        return error ? 0 : (int64_t)writeTime.time_since_epoch().count();
+    }
+
+    void Scene::Cook(const std::filesystem::path& path, const Ref<Scene>& scene)
+    {
+        ZoneScoped;
 
-            COFFEE_INFO("Entity {0}, {1}", (uint32_t)entity, tag.Tag);
+        auto& registry = scene->m_Registry;
+
+        std::vector<entt::entity> entities;
+        for (auto entity : registry.view<entt::entity>())
+        {
+            entities.push_back(entity);
         }
+
+        std::vector<char> buffer = CookedScene::Write(registry, entities, GetSourceWriteTime(path));
+
+        std::filesystem::path cookedPath = CacheManager::GetCookedScenePath(path);
+
+        std::error_code error;
+        std::filesystem::create_directories(cookedPath.parent_path(), error);
+
+        std::ofstream file(cookedPath, std::ios::binary);
+        if (!file.is_open())
+        {
+            COFFEE_CORE_WARN("Scene::Cook: Could not write the cooked scene {0}", cookedPath.string());
+            return;
+        }
+
+        file.write(buffer.data(), buffer.size());
     }
 
-    // Is possible that this function will be moved to the SceneTreePanel but for now it will stay here
-    void AddModelToTheSceneTree(Scene* scene, Ref<Model> model)
+    Ref<Scene> Scene::LoadCooked(const std::filesystem::path& path)
     {
-        static Entity parent;
+        ZoneScoped;
+
+        std::filesystem::path cookedPath = CacheManager::GetCookedScenePath(path);
+
+        MappedFile file;
+        if (!file.Open(cookedPath))
+            return nullptr;
+
+        CookedSceneHeader header;
+        if (!CookedScene::ReadHeader(file.GetData(), file.GetSize(), header))
+        {
+            COFFEE_CORE_INFO("Scene: Cooked scene {0} has an old format, loading from JSON", cookedPath.filename().string());
+            return nullptr;
+        }
+
+        if (header.sourceWriteTime != GetSourceWriteTime(path))
+            return nullptr;
+
+        Ref<Scene> scene = CreateRef<Scene>();
 
-        Entity modelEntity = scene->CreateEntity(model->GetName());
+        // The identifiers are kept, so the hierarchy links stay valid without remapping
+        if (!CookedScene::Instantiate(scene->m_Registry, file.GetData(), file.GetSize(), true))
+        {
+            COFFEE_CORE_WARN("Scene: Cooked scene {0} is out of date or corrupt, loading from JSON", cookedPath.filename().string());
+            return nullptr;
+        }
+
+        scene->m_FilePath = path;
+
+        COFFEE_INFO("Scene {0} loaded from the cooked scene ({1} entities)", path.filename().string(), header.entityCount);
+
+        return scene;
+    }
 
-        if((entt::entity)parent != entt::null)modelEntity.SetParent(parent);
-        modelEntity.GetComponent<TransformComponent>().SetLocalTransform(model->GetTransform());
+    // Is possible that this function will be moved to the SceneTreePanel but for now it will stay here
+    void AddModelToTheSceneTree(Scene* scene, Ref<Model> model)
+    {
+        ZoneScoped;
 
-        auto& meshes = model->GetMeshes();
-        bool hasMultipleMeshes = meshes.size() > 1;
+        // Iterative, the models of a large import are deep enough to overflow the stack
+        std::vector<std::pair<Model*, entt::entity>> pending = {{model.get(), entt::null}};
+        std::vector<entt::entity> children;
 
-        for(auto& mesh : meshes)
+        while (!pending.empty())
         {
-            Entity entity = hasMultipleMeshes ? scene->CreateEntity(mesh->GetName()) : modelEntity;
+            auto [current, parent] = pending.back();
+            pending.pop_back();
 
-            entity.AddComponent<MeshComponent>(mesh);
+            Entity modelEntity = scene->CreateEntity(current->GetName());
 
-            if(mesh->GetMaterial())
+            if (parent != entt::null)
+                modelEntity.SetParent(Entity(parent, scene));
+            modelEntity.GetComponent<TransformComponent>().SetLocalTransform(current->GetTransform());
+
+            auto& meshes = current->GetMeshes();
+            if (meshes.size() == 1)
             {
-                entity.AddComponent<MaterialComponent>(mesh->GetMaterial());
+                modelEntity.AddComponent<MeshComponent>(meshes[0]);
+                if (meshes[0]->GetMaterial())
+                    modelEntity.AddComponent<MaterialComponent>(meshes[0]->GetMaterial());
             }
-
-            if(hasMultipleMeshes)
+            else if (meshes.size() > 1)
             {
-                entity.SetParent(modelEntity);
+                children = scene->CreateEntities((uint32_t)meshes.size(), std::string(), modelEntity);
+                for (size_t i = 0; i < meshes.size(); ++i)
+                {
+                    Entity entity(children[i], scene);
+                    entity.GetComponent<TagComponent>().Tag = meshes[i]->GetName();
+                    entity.AddComponent<MeshComponent>(meshes[i]);
+
+                    if (meshes[i]->GetMaterial())
+                        entity.AddComponent<MaterialComponent>(meshes[i]->GetMaterial());
+                }
             }
-        }
 
-        for(auto& c : model->GetChildren())
-        {
-            parent = modelEntity;
-            AddModelToTheSceneTree(scene, c);
+            // Pushed in reverse so the children are created, and appended to their parent, in the model order
+            const auto& modelChildren = current->GetChildren();
+            for (auto it = modelChildren.rbegin(); it != modelChildren.rend(); ++it)
+                pending.push_back({it->get(), modelEntity});
         }
     }
 
@@ -1,14 +1,19 @@
 #pragma once
 
+#include "CoffeeEngine/Core/DataStructures/BVH.h"
 #include "CoffeeEngine/Core/DataStructures/Octree.h"
 #include "CoffeeEngine/Events/Event.h"
+#include "CoffeeEngine/Math/Ray.h"
 #include "CoffeeEngine/Renderer/EditorCamera.h"
 #include "CoffeeEngine/Scene/SceneTree.h"
+#include "CoffeeEngine/Scene/WorldPartition.h"
 #include "entt/entity/fwd.hpp"
 
 #include <entt/entt.hpp>
 #include <filesystem>
+#include <limits>
 #include <string>
+#include <vector>
 
 namespace Coffee {
 
@@ -18,7 +23,19 @@ namespace Coffee {
      */
 
     class Entity;
+    class EntityCommandBuffer;
     class Model;
+    struct RenderCommand;
+
+    /**
+     * @brief Spatial index used for the meshes present when the runtime starts.
+     * @ingroup scene
+     */
+    enum class SpatialIndexType
+    {
+        Octree, ///< Uniform subdivision, cheap to update.
+        BVH ///< SAH built hierarchy, tighter culling and ray queries for static geometry.
+    };
 
     /**
      * @brief Class representing a scene.
@@ -33,11 +50,9 @@ namespace Coffee {
         Scene();
 
         /**
-         * @brief Default destructor.
+         * @brief Destructor, destroys the script instances so their OnDestroy runs and their coroutines stop.
          */
-        ~Scene() = default;
-
-        //Scene(Ref<Scene> other);
+        ~Scene();
 
         /**
          * @brief Create an entity in the scene.
@@ -47,11 +62,27 @@ namespace Coffee {
         Entity CreateEntity(const std::string& name = std::string());
 
         /**
-         * @brief Destroy an entity in the scene.
+         * @brief Create entities in one batch, with the components of CreateEntity.
+         * @param count The number of entities.
+         * @param name The name of the entities.
+         * @param parent The parent of the entities, appended to its children in order, or entt::null.
+         * @return The created entities.
+         */
+        std::vector<entt::entity> CreateEntities(uint32_t count, const std::string& name = std::string(), entt::entity parent = entt::null);
+
+        /**
+         * @brief Destroy an entity in the scene and all its descendants.
          * @param entity The entity to destroy.
          */
         void DestroyEntity(Entity entity);
 
+        /**
+         * @brief Get the command buffer of the scene, the structural changes recorded in it are applied after the
+         * scripts update, once per simulation step at runtime.
+         * @return The command buffer.
+         */
+        EntityCommandBuffer& GetCommandBuffer() { return *m_CommandBuffer; }
+
         /**
          * @brief Initialize the scene.
          */
@@ -66,10 +97,18 @@ namespace Coffee {
         void OnUpdateEditor(EditorCamera& camera, float dt);
 
         /**
-         * @brief Update the scene in runtime mode.
+         * @brief Advance the simulation of the scene in runtime mode by one step: the transforms, the scripts and the
+         * structural changes they recorded.
+         * @param dt The fixed timestep.
+         */
+        void OnFixedUpdateRuntime(float dt);
+
+        /**
+         * @brief Render the scene in runtime mode, the transforms interpolated between the last two simulation steps.
          * @param dt The delta time.
+         * @param alpha The position of the frame between the last two simulation steps, 1 renders the last one.
          */
-        void OnUpdateRuntime(float dt);
+        void OnUpdateRuntime(float dt, float alpha = 1.0f);
 
         /**
          * @brief Handle an event in the scene.
@@ -83,6 +122,20 @@ namespace Coffee {
         void OnExitEditor();
         void OnExitRuntime();
 
+        /**
+         * @brief Find the closest mesh entity hit by a ray, testing the triangles of the meshes whose bounds are hit.
+         *
+         * The runtime spatial index is traversed when it is built. In editor mode a BVH of the meshes is built on the
+         * first ray cast after a mesh or a transform changed, the meshes move all the time but are picked rarely.
+         * It runs on the CPU only, so it also works without a renderer.
+         *
+         * @param ray The ray in world space.
+         * @param maxDistance The length of the ray.
+         * @param hitDistance If not null, receives the distance of the hit.
+         * @return The entity hit, or an invalid entity.
+         */
+        Entity Raycast(const Ray& ray, float maxDistance = std::numeric_limits<float>::max(), float* hitDistance = nullptr);
+
         template<typename... Components>
         auto GetAllEntitiesWithComponents()
         {
@@ -91,30 +144,146 @@ namespace Coffee {
 
         /**
          * @brief Load a scene from a file.
+         *
+         * The cooked binary version of the scene in the cache is used when it is up to date with the JSON file,
+         * otherwise the JSON file is parsed and cooked for the next load.
+         *
          * @param path The path to the file.
          * @return The loaded scene.
          */
         static Ref<Scene> Load(const std::filesystem::path& path);
 
         /**
-         * @brief Save a scene to a file.
+         * @brief Create a runtime copy of a scene in memory.
+         *
+         * The registry is cloned component by component keeping the entity identifiers, the hierarchy links
+         * are remapped to the new entities and the resources (meshes, materials...) are shared by reference.
+         *
+         * @param other The scene to copy.
+         * @return The copied scene.
+         */
+        static Ref<Scene> Copy(const Ref<Scene>& other);
+
+        /**
+         * @brief Open a world cooked with WorldPartition, its cells are streamed in around the camera.
+         * @param directory The directory of the world.
+         * @return The scene streaming the world, or nullptr if the world could not be opened.
+         */
+        static Ref<Scene> LoadWorld(const std::filesystem::path& directory);
+
+        /**
+         * @brief Get the world partition streaming cells into the scene.
+         * @return The world partition, or nullptr if the scene is not a streamed world.
+         */
+        WorldPartition* GetWorldPartition() { return m_WorldPartition.get(); }
+
+        /**
+         * @brief Get the spatial index of the meshes, built when the runtime starts.
+         * @return The octree of the scene.
+         */
+        Octree<entt::entity>& GetOctree() { return m_Octree; }
+
+        /**
+         * @brief Get the BVH of the static meshes, only built when the spatial index type is BVH.
+         * @return The BVH of the scene.
+         */
+        BVH<entt::entity>& GetBVH() { return m_BVH; }
+
+        SpatialIndexType GetSpatialIndexType() const { return m_SpatialIndexType; }
+
+        /**
+         * @brief Set the spatial index of the static meshes, applied the next time the runtime starts.
+         *
+         * With a BVH the octree is kept empty for the entities added later, such as the streamed world cells.
+         *
+         * @param type The spatial index type.
+         */
+        void SetSpatialIndexType(SpatialIndexType type) { m_SpatialIndexType = type; }
+
+        /**
+         * @brief Save a scene to a file, the JSON file and its cooked binary version.
          * @param path The path to the file.
          * @param scene The scene to save.
          */
         static void Save(const std::filesystem::path& path, Ref<Scene> scene);
 
         const std::filesystem::path& GetFilePath() { return m_FilePath; }
+    private:
+        /**
+         * @brief Write the cooked binary version of a scene to the cache.
+         * @param path The path to the JSON scene file the scene was saved to or loaded from.
+         * @param scene The scene to cook.
+         */
+        static void Cook(const std::filesystem::path& path, const Ref<Scene>& scene);
+
+        /**
+         * @brief Load the cooked binary version of a scene from the cache.
+         * @param path The path to the JSON scene file.
+         * @return The loaded scene or nullptr if there is no cooked scene or it is out of date.
+         */
+        static Ref<Scene> LoadCooked(const std::filesystem::path& path);
+
+        /**
+         * @brief What a mesh entity was inserted in the spatial index with, to find it again once it is destroyed.
+         */
+        struct SpatialIndexEntry
+        {
+            glm::mat4 Transform;
+            AABB Bounds;
+            int32_t BVHIndex = -1; ///< Index of the object in the BVH, -1 if it is in the octree.
+        };
+
+        /**
+         * @brief Extract the render commands of the meshes of the scene like a frame does, without submitting them.
+         * @param commands Receives the commands.
+         */
+        void ExtractRenderCommands(std::vector<RenderCommand>& commands);
+
+        /**
+         * @brief Insert a mesh entity in the octree with its current world transform.
+         * @param entity The entity, it must have a mesh.
+         */
+        void InsertIntoSpatialIndex(entt::entity entity);
+
+        /**
+         * @brief Rebuild the BVH from the static meshes still alive, when some of them were destroyed.
+         */
+        void RebuildBVH();
+
+        /**
+         * @brief Bring the spatial index up to date with the meshes added or moved since the last frame.
+         */
+        void UpdateSpatialIndex();
+
+        void OnMeshConstruct(entt::registry& registry, entt::entity entity);
+        void OnMeshDestroy(entt::registry& registry, entt::entity entity);
+        void OnSpatialIndexEntryDestroy(entt::registry& registry, entt::entity entity);
+
     private:
         entt::registry m_Registry;
         Scope<SceneTree> m_SceneTree;
-        Octree<Ref<Mesh>> m_Octree;
+        Octree<entt::entity> m_Octree;
+        BVH<entt::entity> m_BVH;
+        SpatialIndexType m_SpatialIndexType = SpatialIndexType::Octree;
+        bool m_BVHDirty = false;
+        bool m_IsRuntime = false; ///< Whether the runtime spatial index was built, the ray casts use it.
+        BVH<entt::entity> m_PickingBVH; ///< The editor ray cast index, built lazily.
+        bool m_PickingBVHDirty = true;
+        uint64_t m_PickingTransformVersion = 0; ///< The transform version the picking BVH was built with.
+        Scope<WorldPartition> m_WorldPartition;
+        Scope<EntityCommandBuffer> m_CommandBuffer;
 
         // Temporal: Scenes should be Resources and the Base Resource class already has a path variable.
         std::filesystem::path m_FilePath;
 
         friend class Entity;
+        friend class EntityCommandBuffer;
         friend class SceneTree;
         friend class SceneTreePanel;
+        friend class WorldPartition;
+        friend class ScriptSystem;
+        friend class SceneBenchmark;
+        friend class SpatialIndexCheck;
 
         //REMOVE PLEASE, THIS IS ONLY TO TEST THE OCTREE!!!!
         friend class EditorLayer;
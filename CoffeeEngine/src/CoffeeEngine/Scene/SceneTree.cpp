@@ -8,10 +8,31 @@
 
 namespace Coffee {
 
+    /**
+     * @brief Local transform of an entity at the start of the last simulation step, the rotation kept as a quaternion
+     * so the interpolation does not convert it every frame.
+     */
+    struct PreviousTransform
+    {
+        glm::vec3 Position;
+        glm::quat Rotation;
+        glm::vec3 Scale;
+    };
+
+    static glm::mat4 InterpolateLocalTransform(const PreviousTransform& previous, const TransformComponent& current, float alpha)
+    {
+        glm::vec3 position = glm::mix(previous.Position, current.Position, alpha);
+        glm::quat rotation = glm::slerp(previous.Rotation, glm::quat(glm::radians(current.Rotation)), alpha);
+        glm::vec3 scale = glm::mix(previous.Scale, current.Scale, alpha);
+
+        return glm::translate(glm::mat4(1.0f), position) * glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
+    }
+
     HierarchyComponent::HierarchyComponent(entt::entity parent)
     {
         m_Parent = parent;
         m_First = entt::null;
+        m_Last = entt::null;
         m_Next = entt::null;
         m_Prev = entt::null;
     }
@@ -19,89 +40,65 @@ namespace Coffee {
     {
         m_Parent = entt::null;
         m_First = entt::null;
+        m_Last = entt::null;
         m_Next = entt::null;
         m_Prev = entt::null;
     }
 
+    // Appends the entity after the last child of its parent
     void HierarchyComponent::OnConstruct(entt::registry& registry, entt::entity entity)
     {
         auto& hierarchy = registry.get<HierarchyComponent>(entity);
 
-        if(hierarchy.m_Parent != entt::null)
-        {
-            auto& parentHierarchy = registry.get<HierarchyComponent>(hierarchy.m_Parent);
+        if(hierarchy.m_Parent == entt::null)
+            return;
 
-            if(parentHierarchy.m_First == entt::null)
-            {
-                parentHierarchy.m_First = entity;
-            }
-            else
-            {
-                //Get the last child of the parent
-                auto lastEntity = parentHierarchy.m_First;
-                auto lastHierarchy = registry.try_get<HierarchyComponent>(lastEntity);
-                while(lastHierarchy != nullptr && lastHierarchy->m_Next != entt::null)
-                {
-                    auto nextEntity = lastHierarchy->m_Next;
-                    auto nextHierarchy = registry.try_get<HierarchyComponent>(nextEntity);
-
-                    if(nextHierarchy == nullptr)
-                    {
-                        break;
-                    }
-
-                    lastEntity = nextEntity;
-                    lastHierarchy = nextHierarchy;
-                }
-                if (lastEntity == entity)
-                {
-                    return;
-                }
-                lastHierarchy->m_Next = entity;
-                lastHierarchy->m_Prev = lastEntity;
-            }
-        }
-    }
+        auto* parentHierarchy = registry.try_get<HierarchyComponent>(hierarchy.m_Parent);
+        if(parentHierarchy == nullptr || parentHierarchy->m_Last == entity)
+            return;
 
-    void HierarchyComponent::OnDestroy(entt::registry& registry, entt::entity entity)
-    {
-        auto& hierarchy = registry.get<HierarchyComponent>(entity);
-        // if is the first child
-        if(hierarchy.m_Prev == entt::null || !registry.valid(hierarchy.m_Prev))
+        auto* lastHierarchy = parentHierarchy->m_Last != entt::null ? registry.try_get<HierarchyComponent>(parentHierarchy->m_Last) : nullptr;
+        if(lastHierarchy != nullptr)
         {
-            if(hierarchy.m_Parent != entt::null && registry.valid(hierarchy.m_Parent))
-            {
-                auto parent_hierarchy = registry.try_get<HierarchyComponent>(hierarchy.m_Parent);
-                if(parent_hierarchy != nullptr)
-                {
-                    parent_hierarchy->m_First = hierarchy.m_Next;
-                    if(hierarchy.m_Next != entt::null)
-                    {
-                        auto next_hierarchy = registry.try_get<HierarchyComponent>(hierarchy.m_Next);
-                        if(next_hierarchy != nullptr)
-                        {
-                            next_hierarchy->m_Prev = entt::null;
-                        }
-                    }
-                }
-            }
+            lastHierarchy->m_Next = entity;
+            hierarchy.m_Prev = parentHierarchy->m_Last;
         }
         else
         {
-            auto prev_hierarchy = registry.try_get<HierarchyComponent>(hierarchy.m_Prev);
-            if(prev_hierarchy != nullptr)
-            {
-                prev_hierarchy->m_Next = hierarchy.m_Next;
-            }
-            if(hierarchy.m_Next != entt::null)
-            {
-                auto next_hierarchy = registry.try_get<HierarchyComponent>(hierarchy.m_Next);
-                if(next_hierarchy != nullptr)
-                {
-                    next_hierarchy->m_Prev = hierarchy.m_Prev;
-                }
-            }
+            parentHierarchy->m_First = entity;
+            hierarchy.m_Prev = entt::null;
         }
+
+        hierarchy.m_Next = entt::null;
+        parentHierarchy->m_Last = entity;
+    }
+
+    // Unlinks the entity from its siblings and its parent, the links to entities already destroyed are skipped
+    void HierarchyComponent::OnDestroy(entt::registry& registry, entt::entity entity)
+    {
+        auto& hierarchy = registry.get<HierarchyComponent>(entity);
+
+        HierarchyComponent* parentHierarchy = nullptr;
+        if(hierarchy.m_Parent != entt::null && registry.valid(hierarchy.m_Parent))
+            parentHierarchy = registry.try_get<HierarchyComponent>(hierarchy.m_Parent);
+
+        HierarchyComponent* prevHierarchy = nullptr;
+        if(hierarchy.m_Prev != entt::null && registry.valid(hierarchy.m_Prev))
+            prevHierarchy = registry.try_get<HierarchyComponent>(hierarchy.m_Prev);
+
+        HierarchyComponent* nextHierarchy = nullptr;
+        if(hierarchy.m_Next != entt::null && registry.valid(hierarchy.m_Next))
+            nextHierarchy = registry.try_get<HierarchyComponent>(hierarchy.m_Next);
+
+        if(prevHierarchy != nullptr)
+            prevHierarchy->m_Next = hierarchy.m_Next;
+        else if(parentHierarchy != nullptr && parentHierarchy->m_First == entity)
+            parentHierarchy->m_First = hierarchy.m_Next;
+
+        if(nextHierarchy != nullptr)
+            nextHierarchy->m_Prev = hierarchy.m_Prev;
+        else if(parentHierarchy != nullptr && parentHierarchy->m_Last == entity)
+            parentHierarchy->m_Last = hierarchy.m_Prev;
     }
     void HierarchyComponent::OnUpdate(entt::registry& registry, entt::entity entity)
     {
@@ -127,6 +124,107 @@ namespace Coffee {
         }
     }
 
+    void HierarchyComponent::ReparentMany(entt::registry& registry, const std::vector<entt::entity>& entities, entt::entity parent)
+    {
+        ZoneScoped;
+
+        auto& storage = registry.storage<HierarchyComponent>();
+        HierarchyComponent* parentHierarchy = nullptr;
+        if(parent != entt::null)
+        {
+            if(!storage.contains(parent))
+                return;
+
+            parentHierarchy = &storage.get(parent);
+        }
+
+        // The entities are chained together first, the parent and its last child are only touched once at the end
+        entt::entity first = entt::null;
+        entt::entity last = entt::null;
+        for(auto entity : entities)
+        {
+            // An entity listed twice only moves to the end of the chain
+            if(!storage.contains(entity) || entity == parent || entity == last)
+                continue;
+
+            if(entity == first)
+                first = storage.get(entity).m_Next;
+
+            HierarchyComponent::OnDestroy(registry, entity);
+
+            auto& hierarchy = storage.get(entity);
+            hierarchy.m_Parent = parent;
+            hierarchy.m_Prev = last;
+            hierarchy.m_Next = entt::null;
+
+            if(last != entt::null)
+                storage.get(last).m_Next = entity;
+            else
+                first = entity;
+
+            last = entity;
+        }
+
+        if(parentHierarchy == nullptr || first == entt::null)
+            return;
+
+        storage.get(first).m_Prev = parentHierarchy->m_Last;
+        if(parentHierarchy->m_Last != entt::null)
+            storage.get(parentHierarchy->m_Last).m_Next = first;
+        else
+            parentHierarchy->m_First = first;
+
+        parentHierarchy->m_Last = last;
+    }
+
+    void HierarchyComponent::DestroySubtree(entt::registry& registry, entt::entity entity)
+    {
+        ZoneScoped;
+
+        auto& storage = registry.storage<HierarchyComponent>();
+        if(!storage.contains(entity))
+        {
+            registry.destroy(entity);
+            return;
+        }
+
+        // Only the root has links outside of the subtree
+        HierarchyComponent::OnDestroy(registry, entity);
+
+        // Breadth first, each entity is gathered after its parent
+        std::vector<entt::entity> subtree = {entity};
+        for(size_t i = 0; i < subtree.size(); ++i)
+        {
+            for(auto child = storage.get(subtree[i]).m_First; child != entt::null && storage.contains(child); child = storage.get(child).m_Next)
+                subtree.push_back(child);
+        }
+
+        // The links inside the subtree go away with it, so the hook does not need to unlink every entity
+        registry.on_destroy<HierarchyComponent>().disconnect<&HierarchyComponent::OnDestroy>();
+        registry.destroy(subtree.begin(), subtree.end());
+        registry.on_destroy<HierarchyComponent>().connect<&HierarchyComponent::OnDestroy>();
+    }
+
+    void HierarchyComponent::RebuildLinks(entt::registry& registry)
+    {
+        ZoneScoped;
+
+        auto view = registry.view<HierarchyComponent>();
+        for(auto entity : view)
+        {
+            auto& hierarchy = view.get<HierarchyComponent>(entity);
+
+            entt::entity prev = entt::null;
+            for(auto child = hierarchy.m_First; child != entt::null && view.contains(child); child = view.get<HierarchyComponent>(child).m_Next)
+            {
+                view.get<HierarchyComponent>(child).m_Prev = prev;
+                prev = child;
+            }
+
+            hierarchy.m_Last = prev;
+        }
+    }
+
     SceneTree::SceneTree(Scene* scene) : m_Context(scene)
     {
         auto& registry = m_Context->m_Registry;
@@ -135,8 +233,10 @@ namespace Coffee {
         registry.on_destroy<HierarchyComponent>().connect<&HierarchyComponent::OnDestroy>();
     }
 
-    void SceneTree::Update()
+    void SceneTree::Update(float alpha)
     {
+        ZoneScoped;
+
         auto& registry = m_Context->m_Registry;
         auto view = registry.view<HierarchyComponent>();
         for(auto entity : view)
@@ -145,12 +245,29 @@ namespace Coffee {
 
             if(hierarchy.m_Parent == entt::null)
             {
-                UpdateTransform(entity);
+                UpdateTransform(entity, alpha);
             }
         }
     }
 
-    void SceneTree::UpdateTransform(entt::entity entity)
+    void SceneTree::SaveTransforms()
+    {
+        ZoneScoped;
+
+        auto& registry = m_Context->m_Registry;
+        auto& transforms = registry.storage<TransformComponent>();
+        auto& previousTransforms = registry.storage<PreviousTransform>();
+
+        // Rebuilt every step, the destroyed entities leave with the registry and the created ones have no previous state
+        previousTransforms.clear();
+        previousTransforms.reserve(transforms.size());
+        for(auto [entity, transform] : transforms.each())
+        {
+            previousTransforms.emplace(entity, transform.Position, glm::quat(glm::radians(transform.Rotation)), transform.Scale);
+        }
+    }
+
+    void SceneTree::UpdateTransform(entt::entity entity, float alpha)
     {
         auto& registry = m_Context->m_Registry;
         
@@ -159,15 +276,27 @@ namespace Coffee {
 
         // Update the world transform of the entity
 
+        glm::mat4 parentTransform = glm::mat4(1.0f);
         if(hierarchyComponent.m_Parent != entt::null)
         {
-            auto& parentTransformComponent = registry.get<TransformComponent>(hierarchyComponent.m_Parent);
+            parentTransform = registry.get<TransformComponent>(hierarchyComponent.m_Parent).GetWorldTransform();
+        }
+
+        glm::mat4 previousWorld = transformComponent.GetWorldTransform();
 
-            transformComponent.SetWorldTransform(parentTransformComponent.GetWorldTransform());
+        const PreviousTransform* previous = alpha < 1.0f ? registry.try_get<PreviousTransform>(entity) : nullptr;
+        if(previous != nullptr)
+        {
+            transformComponent.SetWorldTransform(parentTransform, InterpolateLocalTransform(*previous, transformComponent, alpha));
         }
         else
         {
-            transformComponent.SetWorldTransform(glm::mat4(1.0f));
+            transformComponent.SetWorldTransform(parentTransform);
+        }
+
+        if(transformComponent.GetWorldTransform() != previousWorld)
+        {
+            m_TransformVersion++;
         }
 
         // Recursively update all the children
@@ -175,7 +304,7 @@ namespace Coffee {
         entt::entity child = hierarchyComponent.m_First;
         while(child != entt::null)
         {
-            UpdateTransform(child);
+            UpdateTransform(child, alpha);
             child = registry.get<HierarchyComponent>(child).m_Next;
         }
     }
@@ -4,6 +4,7 @@
 #include "entt/entity/fwd.hpp"
 #include <cereal/cereal.hpp>
 #include <entt/entt.hpp>
+#include <vector>
 
 namespace Coffee {
 
@@ -60,8 +61,31 @@ namespace Coffee {
          */
         static void Reparent(entt::registry& registry, entt::entity entity, entt::entity parent);
 
+        /**
+         * @brief Reparent entities to the same parent, appended in order with a single update of the parent.
+         * @param registry The entity registry.
+         * @param entities The entities to reparent.
+         * @param parent The new parent entity, or entt::null to move them to the root.
+         */
+        static void ReparentMany(entt::registry& registry, const std::vector<entt::entity>& entities, entt::entity parent);
+
+        /**
+         * @brief Destroy an entity and all its descendants, gathered without recursion and destroyed in one batch.
+         * @param registry The entity registry.
+         * @param entity The root of the subtree.
+         */
+        static void DestroySubtree(entt::registry& registry, entt::entity entity);
+
+        /**
+         * @brief Rebuild the previous and last child links from the first child and next sibling ones, for the
+         * hierarchies loaded from scene files, which do not store them.
+         * @param registry The entity registry.
+         */
+        static void RebuildLinks(entt::registry& registry);
+
         entt::entity m_Parent;
         entt::entity m_First;
+        entt::entity m_Last; ///< The last child, children are appended in constant time.
         entt::entity m_Next;
         entt::entity m_Prev;
 
@@ -107,17 +131,33 @@ namespace Coffee {
 
         /**
          * @brief Update the scene tree.
+         * @param alpha The interpolation from the local transforms saved by SaveTransforms to the current ones,
+         * 1 uses the current ones.
          */
-        void Update();
+        void Update(float alpha = 1.0f);
+
+        /**
+         * @brief Save the local transforms of every entity, the previous state the interpolated updates start from.
+         */
+        void SaveTransforms();
 
         /**
          * @brief Update the transform of an entity.
          * @param entity The entity to update.
+         * @param alpha The interpolation from the saved local transforms to the current ones.
+         */
+        void UpdateTransform(entt::entity entity, float alpha = 1.0f);
+
+        /**
+         * @brief Get a counter that changes every time a world transform changes, to tell if the data built from
+         * the world transforms is out of date.
+         * @return The transform version.
          */
-        void UpdateTransform(entt::entity entity);
+        uint64_t GetTransformVersion() const { return m_TransformVersion; }
 
     private:
         Scene* m_Context;
+        uint64_t m_TransformVersion = 0;
     };
 
     /** @} */ // end of scene group
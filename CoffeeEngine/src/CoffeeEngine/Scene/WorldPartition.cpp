@@ -0,0 +1,567 @@
+#include "WorldPartition.h"
+
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/Scene/Components.h"
+#include "CoffeeEngine/Scene/CookedScene.h"
+#include "CoffeeEngine/Scene/Entity.h"
+#include "CoffeeEngine/Scene/Scene.h"
+#include "CoffeeEngine/Scene/SceneTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <tracy/Tracy.hpp>
+
+namespace Coffee {
+
+    /**
+     * @brief Header of the world manifest, followed by the cells.
+     */
+    struct WorldManifestHeader
+    {
+        uint32_t magic = WorldPartition::Magic;
+        uint32_t version = WorldPartition::Version;
+        float cellSize = 0.0f;
+        uint32_t cellCount = 0;
+        AABB bounds;
+    };
+
+    static WorldPartitionStats s_Stats;
+
+    static std::vector<char> ReadFile(const std::filesystem::path& path)
+    {
+        ZoneScopedN("WorldPartition::ReadCell");
+
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return {};
+
+        std::vector<char> data((size_t)file.tellg());
+        file.seekg(0);
+        file.read(data.data(), data.size());
+        if (!file)
+            return {};
+
+        return data;
+    }
+
+    static AABB Merge(const AABB& a, const AABB& b)
+    {
+        return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+    }
+
+    static bool WriteCell(const std::filesystem::path& directory, WorldCell& cell, entt::registry& registry, const std::vector<entt::entity>& entities)
+    {
+        std::vector<char> data = CookedScene::Write(registry, entities, 0);
+
+        std::ofstream file(directory / ("Cell_" + std::to_string(cell.X) + "_" + std::to_string(cell.Z) + ".cscene"), std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        file.write(data.data(), data.size());
+
+        cell.EntityCount = (uint32_t)entities.size();
+        cell.DataSize = data.size();
+        return true;
+    }
+
+    static bool WriteManifest(const std::filesystem::path& directory, float cellSize, const std::vector<WorldCell>& cells)
+    {
+        WorldManifestHeader header;
+        header.cellSize = cellSize;
+        header.cellCount = (uint32_t)cells.size();
+        header.bounds = cells.empty() ? AABB() : cells[0].Bounds;
+        for (const WorldCell& cell : cells)
+        {
+            header.bounds = Merge(header.bounds, cell.Bounds);
+        }
+
+        std::ofstream file(directory / WorldPartition::ManifestName, std::ios::binary);
+        if (!file.is_open())
+        {
+            COFFEE_CORE_ERROR("WorldPartition: Could not write the manifest to {0}", directory.string());
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(cells.data()), cells.size() * sizeof(WorldCell));
+        return true;
+    }
+
+    WorldPartition::WorldPartition(Scene* scene) : m_Scene(scene)
+    {
+    }
+
+    WorldPartition::~WorldPartition()
+    {
+        for (CellState& state : m_States)
+        {
+            if (state.Reading.valid())
+                state.Reading.wait();
+        }
+    }
+
+    bool WorldPartition::Cook(const Ref<Scene>& scene, const std::filesystem::path& directory, float cellSize)
+    {
+        ZoneScoped;
+
+        auto& registry = scene->m_Registry;
+        scene->m_SceneTree->Update();
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        std::vector<WorldCell> cells;
+        std::vector<std::vector<entt::entity>> cellEntities;
+        std::unordered_map<uint64_t, uint32_t> cellIndices;
+
+        auto view = registry.view<HierarchyComponent, TransformComponent>();
+        for (auto root : view)
+        {
+            if (view.get<HierarchyComponent>(root).m_Parent != entt::null)
+                continue;
+
+            glm::vec3 position = view.get<TransformComponent>(root).GetWorldTransform()[3];
+            int32_t x = (int32_t)std::floor(position.x / cellSize);
+            int32_t z = (int32_t)std::floor(position.z / cellSize);
+
+            auto [it, inserted] = cellIndices.try_emplace(GetCellKey(x, z), (uint32_t)cells.size());
+            if (inserted)
+            {
+                WorldCell cell;
+                cell.X = x;
+                cell.Z = z;
+                cell.Bounds = AABB(position, position);
+                cells.push_back(cell);
+                cellEntities.emplace_back();
+            }
+
+            WorldCell& cell = cells[it->second];
+            std::vector<entt::entity>& entities = cellEntities[it->second];
+
+            // The whole subtree goes with its root, so the hierarchy links never cross cells
+            std::vector<entt::entity> stack = { root };
+            while (!stack.empty())
+            {
+                entt::entity entity = stack.back();
+                stack.pop_back();
+                entities.push_back(entity);
+
+                const glm::mat4& transform = registry.get<TransformComponent>(entity).GetWorldTransform();
+                if (auto* meshComponent = registry.try_get<MeshComponent>(entity); meshComponent && meshComponent->GetMesh())
+                {
+                    cell.Bounds = Merge(cell.Bounds, meshComponent->GetMesh()->GetAABB().CalculateTransformedAABB(transform));
+                }
+                else
+                {
+                    cell.Bounds = Merge(cell.Bounds, AABB(transform[3], transform[3]));
+                }
+
+                for (auto child = registry.get<HierarchyComponent>(entity).m_First; child != entt::null; child = registry.get<HierarchyComponent>(child).m_Next)
+                {
+                    stack.push_back(child);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < cells.size(); ++i)
+        {
+            if (!WriteCell(directory, cells[i], registry, cellEntities[i]))
+            {
+                COFFEE_CORE_ERROR("WorldPartition::Cook: Could not write the cells to {0}", directory.string());
+                return false;
+            }
+        }
+
+        COFFEE_CORE_INFO("WorldPartition: Cooked {0} cells to {1}", cells.size(), directory.string());
+
+        return WriteManifest(directory, cellSize, cells);
+    }
+
+    bool WorldPartition::GenerateTestWorld(const std::filesystem::path& directory, uint32_t entityCount, float cellSize, float spacing)
+    {
+        ZoneScoped;
+
+        Stopwatch stopwatch;
+        stopwatch.Start();
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        // Every entity shares the same mesh
+        MeshComponent meshComponent;
+        const AABB& meshAABB = meshComponent.GetMesh()->GetAABB();
+
+        uint32_t side = (uint32_t)std::ceil(std::sqrt((double)entityCount));
+        float halfExtent = side * spacing * 0.5f;
+        int32_t firstCell = (int32_t)std::floor(-halfExtent / cellSize);
+        int32_t lastCell = (int32_t)std::floor((halfExtent - spacing) / cellSize);
+
+        std::vector<WorldCell> cells;
+
+        for (int32_t cellZ = firstCell; cellZ <= lastCell; ++cellZ)
+        {
+            for (int32_t cellX = firstCell; cellX <= lastCell; ++cellX)
+            {
+                // A small scene per cell keeps the memory bounded whatever the size of the world
+                Scene cellScene;
+                std::vector<entt::entity> entities;
+
+                WorldCell cell;
+                cell.X = cellX;
+                cell.Z = cellZ;
+
+                uint32_t firstColumn = (uint32_t)std::clamp(std::ceil((cellX * cellSize + halfExtent) / spacing), 0.0f, (float)side);
+                uint32_t endColumn = (uint32_t)std::clamp(std::ceil(((cellX + 1) * cellSize + halfExtent) / spacing), 0.0f, (float)side);
+                uint32_t firstRow = (uint32_t)std::clamp(std::ceil((cellZ * cellSize + halfExtent) / spacing), 0.0f, (float)side);
+                uint32_t endRow = (uint32_t)std::clamp(std::ceil(((cellZ + 1) * cellSize + halfExtent) / spacing), 0.0f, (float)side);
+
+                for (uint32_t row = firstRow; row < endRow; ++row)
+                {
+                    for (uint32_t column = firstColumn; column < endColumn; ++column)
+                    {
+                        uint32_t index = row * side + column;
+                        if (index >= entityCount)
+                            continue;
+
+                        Entity entity = cellScene.CreateEntity("Entity " + std::to_string(index));
+                        entity.AddComponent<MeshComponent>(meshComponent.GetMesh());
+
+                        auto& transform = entity.GetComponent<TransformComponent>();
+                        transform.Position = { column * spacing - halfExtent, (index % 7) * 0.25f, row * spacing - halfExtent };
+                        transform.Rotation = { 0.0f, (float)(index % 360), 0.0f };
+
+                        AABB bounds = meshAABB.CalculateTransformedAABB(transform.GetLocalTransform());
+                        cell.Bounds = entities.empty() ? bounds : Merge(cell.Bounds, bounds);
+                        entities.push_back(entity);
+                    }
+                }
+
+                if (entities.empty())
+                    continue;
+
+                if (!WriteCell(directory, cell, cellScene.m_Registry, entities))
+                {
+                    COFFEE_CORE_ERROR("WorldPartition::GenerateTestWorld: Could not write the cells to {0}", directory.string());
+                    return false;
+                }
+
+                cells.push_back(cell);
+            }
+        }
+
+        if (!WriteManifest(directory, cellSize, cells))
+            return false;
+
+        stopwatch.Stop();
+        COFFEE_CORE_INFO("WorldPartition: Generated a test world of {0} entities in {1} cells in {2:.1f} s", entityCount, cells.size(), stopwatch.GetPreciseElapsedTime());
+
+        return true;
+    }
+
+    bool WorldPartition::Open(const std::filesystem::path& directory)
+    {
+        ZoneScoped;
+
+        UnloadAll();
+
+        std::ifstream file(directory / ManifestName, std::ios::binary);
+        if (!file.is_open())
+        {
+            COFFEE_CORE_ERROR("WorldPartition::Open: No world manifest in {0}", directory.string());
+            return false;
+        }
+
+        WorldManifestHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != Magic || header.version != Version)
+        {
+            COFFEE_CORE_ERROR("WorldPartition::Open: {0} is not a world manifest of version {1}, cook the world again", directory.string(), Version);
+            return false;
+        }
+
+        std::vector<WorldCell> cells(header.cellCount);
+        file.read(reinterpret_cast<char*>(cells.data()), cells.size() * sizeof(WorldCell));
+        if (!file)
+        {
+            COFFEE_CORE_ERROR("WorldPartition::Open: The world manifest in {0} is corrupt", directory.string());
+            return false;
+        }
+
+        m_Directory = directory;
+        m_CellSize = header.cellSize;
+        m_Bounds = header.bounds;
+        m_Cells = std::move(cells);
+        m_States = std::vector<CellState>(m_Cells.size());
+        m_ReadQueue.clear();
+
+        m_CellIndices.clear();
+        for (uint32_t i = 0; i < m_Cells.size(); ++i)
+        {
+            m_CellIndices[GetCellKey(m_Cells[i].X, m_Cells[i].Z)] = i;
+        }
+
+        m_Stats = WorldPartitionStats();
+        m_Stats.TotalCells = (uint32_t)m_Cells.size();
+
+        m_Clock.Reset();
+        m_Clock.Start();
+
+        // The spatial index has to hold the whole world, whatever part of it is resident
+        m_Scene->m_Octree.Reset(m_Bounds);
+
+        COFFEE_CORE_INFO("WorldPartition: Opened {0} ({1} cells)", directory.string(), m_Cells.size());
+
+        return true;
+    }
+
+    std::filesystem::path WorldPartition::GetCellPath(const WorldCell& cell) const
+    {
+        return m_Directory / ("Cell_" + std::to_string(cell.X) + "_" + std::to_string(cell.Z) + ".cscene");
+    }
+
+    float WorldPartition::GetDistance(const WorldCell& cell, const glm::vec3& position) const
+    {
+        glm::vec2 min = glm::vec2(cell.X, cell.Z) * m_CellSize;
+        glm::vec2 max = min + glm::vec2(m_CellSize);
+        glm::vec2 point = { position.x, position.z };
+
+        return glm::length(point - glm::clamp(point, min, max));
+    }
+
+    void WorldPartition::Update(const glm::vec3& viewPosition)
+    {
+        ZoneScoped;
+
+        if (m_Cells.empty())
+            return;
+
+        // Gather the cells whose chunk is in memory
+        for (uint32_t i = 0; i < m_States.size(); ++i)
+        {
+            CellState& state = m_States[i];
+            if (state.Status == CellState::CellStatus::Reading && state.Reading.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                state.Data = state.Reading.get();
+                state.Status = CellState::CellStatus::Read;
+                m_ReadQueue.push_back(i);
+            }
+        }
+
+        // Evict the cells out of the unload radius
+        float unloadRadius = m_StreamingRadius * m_UnloadFactor;
+        for (uint32_t i = 0; i < m_States.size(); ++i)
+        {
+            CellState::CellStatus status = m_States[i].Status;
+            if ((status == CellState::CellStatus::Read || status == CellState::CellStatus::Resident) && GetDistance(m_Cells[i], viewPosition) > unloadRadius)
+            {
+                Unload(i);
+            }
+        }
+
+        // Request the cells in the streaming radius, the closest first
+        uint32_t readingCount = 0;
+        for (const CellState& state : m_States)
+        {
+            readingCount += state.Status == CellState::CellStatus::Reading;
+        }
+
+        int32_t minX = (int32_t)std::floor((viewPosition.x - m_StreamingRadius) / m_CellSize);
+        int32_t maxX = (int32_t)std::floor((viewPosition.x + m_StreamingRadius) / m_CellSize);
+        int32_t minZ = (int32_t)std::floor((viewPosition.z - m_StreamingRadius) / m_CellSize);
+        int32_t maxZ = (int32_t)std::floor((viewPosition.z + m_StreamingRadius) / m_CellSize);
+
+        std::vector<std::pair<float, uint32_t>> requests;
+        for (int32_t z = minZ; z <= maxZ; ++z)
+        {
+            for (int32_t x = minX; x <= maxX; ++x)
+            {
+                auto it = m_CellIndices.find(GetCellKey(x, z));
+                if (it == m_CellIndices.end() || m_States[it->second].Status != CellState::CellStatus::Unloaded)
+                    continue;
+
+                float distance = GetDistance(m_Cells[it->second], viewPosition);
+                if (distance <= m_StreamingRadius)
+                    requests.emplace_back(distance, it->second);
+            }
+        }
+
+        std::sort(requests.begin(), requests.end());
+        for (auto& [distance, index] : requests)
+        {
+            if (readingCount >= m_MaxConcurrentReads)
+                break;
+
+            Request(index);
+            readingCount++;
+        }
+
+        // Merge a few of the read cells into the scene, instantiating them all at once would stall the frame
+        uint32_t instantiated = 0;
+        while (!m_ReadQueue.empty() && instantiated < m_MaxInstantiationsPerFrame)
+        {
+            uint32_t index = m_ReadQueue.front();
+            m_ReadQueue.erase(m_ReadQueue.begin());
+
+            if (m_States[index].Status != CellState::CellStatus::Read)
+                continue;
+
+            Instantiate(index);
+            instantiated++;
+        }
+
+        m_Stats.ResidentCells = 0;
+        m_Stats.LoadingCells = 0;
+        for (const CellState& state : m_States)
+        {
+            m_Stats.ResidentCells += state.Status == CellState::CellStatus::Resident;
+            m_Stats.LoadingCells += state.Status == CellState::CellStatus::Reading || state.Status == CellState::CellStatus::Read;
+        }
+
+        s_Stats = m_Stats;
+
+        TracyPlot("World Resident Cells", (int64_t)m_Stats.ResidentCells);
+        TracyPlot("World Resident Entities", (int64_t)m_Stats.ResidentEntities);
+    }
+
+    void WorldPartition::Request(uint32_t index)
+    {
+        CellState& state = m_States[index];
+        state.Status = CellState::CellStatus::Reading;
+        state.RequestTime = m_Clock.GetPreciseElapsedTime();
+        state.Reading = std::async(std::launch::async, ReadFile, GetCellPath(m_Cells[index]));
+    }
+
+    void WorldPartition::Instantiate(uint32_t index)
+    {
+        ZoneScoped;
+
+        CellState& state = m_States[index];
+        const WorldCell& cell = m_Cells[index];
+        auto& registry = m_Scene->m_Registry;
+
+        if (!CookedScene::Instantiate(registry, state.Data.data(), state.Data.size(), false, &state.Entities))
+        {
+            COFFEE_CORE_ERROR("WorldPartition: The chunk of the cell ({0}, {1}) is missing or corrupt", cell.X, cell.Z);
+            state.Data.clear();
+            state.Entities.clear();
+            // Marked resident so it is not requested again every frame, it is retried once it goes out of range
+            state.Status = CellState::CellStatus::Resident;
+            return;
+        }
+
+        for (auto entity : state.Entities)
+        {
+            if (registry.get<HierarchyComponent>(entity).m_Parent == entt::null)
+                m_Scene->m_SceneTree->UpdateTransform(entity);
+        }
+
+        for (auto entity : state.Entities)
+        {
+            if (auto* meshComponent = registry.try_get<MeshComponent>(entity); meshComponent && meshComponent->GetMesh())
+            {
+                m_Scene->InsertIntoSpatialIndex(entity);
+            }
+        }
+
+        double latency = (m_Clock.GetPreciseElapsedTime() - state.RequestTime) * 1000.0;
+
+        m_Stats.CellsLoaded++;
+        m_Stats.ResidentEntities += (uint32_t)state.Entities.size();
+        m_Stats.ResidentBytes += state.Data.size();
+        m_Stats.LastLoadLatency = latency;
+        m_Stats.MaxLoadLatency = std::max(m_Stats.MaxLoadLatency, latency);
+        m_Stats.AverageLoadLatency += (latency - m_Stats.AverageLoadLatency) / m_Stats.CellsLoaded;
+
+        state.Data = std::vector<char>();
+        state.Status = CellState::CellStatus::Resident;
+    }
+
+    void WorldPartition::Unload(uint32_t index)
+    {
+        ZoneScoped;
+
+        CellState& state = m_States[index];
+        auto& registry = m_Scene->m_Registry;
+
+        if (state.Status == CellState::CellStatus::Resident)
+        {
+            std::vector<entt::entity> entities;
+            entities.reserve(state.Entities.size());
+
+            // The entities may have been destroyed by the editor since they were loaded, the scene takes the
+            // meshes of the others out of the spatial index when they are destroyed
+            for (auto entity : state.Entities)
+            {
+                if (registry.valid(entity))
+                    entities.push_back(entity);
+            }
+
+            registry.destroy(entities.begin(), entities.end());
+
+            m_Stats.CellsUnloaded++;
+            m_Stats.ResidentEntities -= std::min(m_Stats.ResidentEntities, (uint32_t)state.Entities.size());
+            m_Stats.ResidentBytes -= std::min(m_Stats.ResidentBytes, m_Cells[index].DataSize);
+        }
+
+        state.Entities = std::vector<entt::entity>();
+        state.Data = std::vector<char>();
+        state.Status = CellState::CellStatus::Unloaded;
+    }
+
+    void WorldPartition::UnloadAll()
+    {
+        ZoneScoped;
+
+        for (uint32_t i = 0; i < m_States.size(); ++i)
+        {
+            CellState& state = m_States[i];
+            if (state.Reading.valid())
+                state.Reading.wait();
+
+            Unload(i);
+        }
+
+        m_ReadQueue.clear();
+    }
+
+    Scope<WorldPartition> WorldPartition::Clone(Scene* scene) const
+    {
+        Scope<WorldPartition> partition = CreateScope<WorldPartition>(scene);
+
+        partition->m_Directory = m_Directory;
+        partition->m_CellSize = m_CellSize;
+        partition->m_Bounds = m_Bounds;
+        partition->m_Cells = m_Cells;
+        partition->m_CellIndices = m_CellIndices;
+        partition->m_StreamingRadius = m_StreamingRadius;
+        partition->m_UnloadFactor = m_UnloadFactor;
+        partition->m_MaxConcurrentReads = m_MaxConcurrentReads;
+        partition->m_MaxInstantiationsPerFrame = m_MaxInstantiationsPerFrame;
+        partition->m_Stats = m_Stats;
+        partition->m_Stats.LoadingCells = 0;
+
+        partition->m_States = std::vector<CellState>(m_States.size());
+        for (size_t i = 0; i < m_States.size(); ++i)
+        {
+            if (m_States[i].Status == CellState::CellStatus::Resident)
+            {
+                partition->m_States[i].Status = CellState::CellStatus::Resident;
+                partition->m_States[i].Entities = m_States[i].Entities;
+            }
+        }
+
+        partition->m_Clock.Start();
+
+        scene->m_Octree.Reset(m_Bounds);
+
+        return partition;
+    }
+
+    const WorldPartitionStats& WorldPartition::GetStats()
+    {
+        return s_Stats;
+    }
+
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Core/Stopwatch.h"
+#include "CoffeeEngine/Math/BoundingBox.h"
+
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <filesystem>
+#include <future>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @defgroup scene Scene
+     * @{
+     */
+
+    class Scene;
+
+    /**
+     * @brief Structure containing the world partition streaming statistics.
+     * @ingroup scene
+     */
+    struct WorldPartitionStats
+    {
+        uint32_t TotalCells = 0; ///< Number of cells of the world.
+        uint32_t ResidentCells = 0; ///< Number of cells whose entities are in the registry.
+        uint32_t LoadingCells = 0; ///< Number of cells being read or waiting to be instantiated.
+        uint32_t ResidentEntities = 0; ///< Number of entities of the resident cells.
+        uint64_t ResidentBytes = 0; ///< Cooked size of the resident cells.
+        uint32_t CellsLoaded = 0; ///< Number of cells loaded since the world was opened.
+        uint32_t CellsUnloaded = 0; ///< Number of cells unloaded since the world was opened.
+        double LastLoadLatency = 0.0; ///< Time from the request to the instantiation of the last loaded cell, in milliseconds.
+        double AverageLoadLatency = 0.0; ///< Average load latency, in milliseconds.
+        double MaxLoadLatency = 0.0; ///< Maximum load latency, in milliseconds.
+    };
+
+    /**
+     * @brief Cell of the world grid, as stored in the world manifest.
+     * @ingroup scene
+     */
+    struct WorldCell
+    {
+        int32_t X = 0; ///< Coordinate of the cell along the X axis.
+        int32_t Z = 0; ///< Coordinate of the cell along the Z axis.
+        AABB Bounds; ///< Bounds of the entities of the cell.
+        uint32_t EntityCount = 0; ///< Number of entities of the cell.
+        uint64_t DataSize = 0; ///< Size of the cooked chunk of the cell.
+    };
+
+    /**
+     * @brief Streams the entities of a large world in and out of a scene by grid cells.
+     *
+     * The world is split on the XZ plane in cells of a fixed size, each one cooked as a separate chunk next to a
+     * manifest with the bounds of every cell. The cells within the streaming radius of the view are read by worker
+     * threads and instantiated on the main thread, a few per frame, merging their entities into the registry and
+     * the spatial index. The cells farther than the unload radius are evicted.
+     * @ingroup scene
+     */
+    class WorldPartition
+    {
+    public:
+        static constexpr uint32_t Magic = 0x444C5743; ///< "CWLD" in little endian.
+        static constexpr uint32_t Version = 2; ///< The current version of the manifest format, and of the cooked cells it lists.
+        static constexpr const char* ManifestName = "World.cworld"; ///< File name of the manifest in the world directory.
+
+        /**
+         * @brief Constructor for WorldPartition.
+         * @param scene The scene the cells are streamed into.
+         */
+        WorldPartition(Scene* scene);
+
+        /**
+         * @brief Waits for the cells being read, the resident entities are left in the scene.
+         */
+        ~WorldPartition();
+
+        /**
+         * @brief Splits a scene into cells and cooks them with the world manifest.
+         *
+         * Every root entity goes to the cell its position falls in, along with all its children.
+         *
+         * @param scene The scene to split.
+         * @param directory The directory to write the world to.
+         * @param cellSize The size of the cells.
+         * @return True if the world was written.
+         */
+        static bool Cook(const Ref<Scene>& scene, const std::filesystem::path& directory, float cellSize);
+
+        /**
+         * @brief Generates a test world: a square grid of meshes cooked cell by cell.
+         * @param directory The directory to write the world to.
+         * @param entityCount The number of entities of the world.
+         * @param cellSize The size of the cells.
+         * @param spacing The distance between two entities.
+         * @return True if the world was written.
+         */
+        static bool GenerateTestWorld(const std::filesystem::path& directory, uint32_t entityCount = 1000000, float cellSize = 64.0f, float spacing = 2.0f);
+
+        /**
+         * @brief Opens a cooked world, no cell is loaded until the next update.
+         * @param directory The directory of the world.
+         * @return True if the manifest was read.
+         */
+        bool Open(const std::filesystem::path& directory);
+
+        /**
+         * @brief Loads the cells around the view and unloads the far ones.
+         * @param viewPosition The position of the camera.
+         */
+        void Update(const glm::vec3& viewPosition);
+
+        /**
+         * @brief Unloads every cell, destroying their entities.
+         */
+        void UnloadAll();
+
+        /**
+         * @brief Creates a partition for a copy of the scene made with Scene::Copy.
+         *
+         * The copy keeps the entity identifiers, so the resident cells stay resident. The cells being loaded are not.
+         *
+         * @param scene The copied scene.
+         * @return The partition of the copied scene.
+         */
+        Scope<WorldPartition> Clone(Scene* scene) const;
+
+        float GetStreamingRadius() const { return m_StreamingRadius; }
+        void SetStreamingRadius(float radius) { m_StreamingRadius = radius; }
+
+        const AABB& GetBounds() const { return m_Bounds; }
+        const std::filesystem::path& GetDirectory() const { return m_Directory; }
+        const std::vector<WorldCell>& GetCells() const { return m_Cells; }
+
+        /**
+         * @brief Gets the streaming statistics of the last updated world partition.
+         * @return The statistics.
+         */
+        static const WorldPartitionStats& GetStats();
+
+    private:
+        /**
+         * @brief Streaming state of a cell.
+         */
+        struct CellState
+        {
+            enum class CellStatus
+            {
+                Unloaded, ///< The cell is not in memory.
+                Reading, ///< A worker is reading the chunk of the cell.
+                Read, ///< The chunk is in memory, waiting to be instantiated.
+                Resident ///< The entities of the cell are in the registry.
+            };
+
+            CellStatus Status = CellStatus::Unloaded;
+            std::future<std::vector<char>> Reading; ///< The chunk being read.
+            std::vector<char> Data; ///< The chunk waiting to be instantiated.
+            std::vector<entt::entity> Entities; ///< The entities of the resident cell.
+            double RequestTime = 0.0; ///< Time the cell was requested, in seconds.
+        };
+
+        static uint64_t GetCellKey(int32_t x, int32_t z) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z; }
+        std::filesystem::path GetCellPath(const WorldCell& cell) const;
+        float GetDistance(const WorldCell& cell, const glm::vec3& position) const;
+
+        void Request(uint32_t index);
+        void Instantiate(uint32_t index);
+        void Unload(uint32_t index);
+
+    private:
+        Scene* m_Scene;
+        std::filesystem::path m_Directory; ///< The directory of the opened world.
+        float m_CellSize = 0.0f;
+        AABB m_Bounds; ///< Bounds of the whole world.
+        std::vector<WorldCell> m_Cells;
+        std::vector<CellState> m_States; ///< Streaming state of each cell.
+        std::unordered_map<uint64_t, uint32_t> m_CellIndices; ///< Index of each cell by its coordinates.
+        std::vector<uint32_t> m_ReadQueue; ///< Cells read and waiting to be instantiated, in request order.
+
+        float m_StreamingRadius = 256.0f; ///< Cells closer than this are loaded.
+        float m_UnloadFactor = 1.25f; ///< Cells farther than the streaming radius times this are unloaded, so the edge cells do not thrash.
+        uint32_t m_MaxConcurrentReads = 4; ///< Maximum number of cells read at the same time.
+        uint32_t m_MaxInstantiationsPerFrame = 2; ///< Maximum number of cells instantiated each frame.
+
+        Stopwatch m_Clock; ///< Time since the world was opened, used to measure the load latency.
+        WorldPartitionStats m_Stats;
+    };
+
+    /** @} */ // end of scene group
+}
@@ -1,18 +1,34 @@
 #include "LuaBackend.h"
 
+#include "CoffeeEngine/Core/Hash.h"
 #include "CoffeeEngine/Core/Input.h"
 #include "CoffeeEngine/Core/KeyCodes.h"
 #include "CoffeeEngine/Core/Log.h"
 #include "CoffeeEngine/Core/MouseCodes.h"
+#include "CoffeeEngine/IO/CacheManager.h"
+#include "CoffeeEngine/Scene/ComponentRegistry.h"
 #include "CoffeeEngine/Scene/Components.h"
 #include "CoffeeEngine/Scene/Entity.h"
+#include "CoffeeEngine/Scene/EntityCommandBuffer.h"
+#include "CoffeeEngine/Scripting/Lua/LuaMath.h"
+#include "CoffeeEngine/Scripting/Lua/LuaMemory.h"
+#include "CoffeeEngine/Scripting/Lua/LuaScheduler.h"
+#include "CoffeeEngine/Scripting/Lua/LuaWorkerPool.h"
+#include "CoffeeEngine/Scripting/Script.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <tracy/Tracy.hpp>
 
 #define SOL_PRINT_ERRORS 1
 
 namespace Coffee {
 
-    sol::state LuaBackend::luaState;
+    sol::state LuaBackend::luaState(sol::default_at_panic, &LuaMemory::Allocate);
     std::unordered_map<std::string, sol::environment> LuaBackend::scriptEnvironments;
+    std::unordered_map<std::string, LuaScriptMetadata> LuaBackend::scriptMetadata;
+    std::unordered_map<std::string, LuaScriptChunk> LuaBackend::scriptChunks;
 
     void BindKeyCodesToLua(sol::state& lua, sol::table& inputTable)
     {
@@ -290,8 +306,43 @@ namespace Coffee {
         inputTable["mousecode"] = mouseCodeTable;
     }
 
+    /**
+     * @brief Functions of a scriptable component, instantiated for every type of the ComponentRegistry.
+     */
+    struct LuaComponentBinding
+    {
+        sol::object (*Add)(Entity& entity, lua_State* state); ///< Adds the component if missing and returns it.
+        sol::object (*Get)(Entity& entity, lua_State* state); ///< Returns a reference to the component, or nil.
+        bool (*Has)(Entity& entity);
+        void (*Remove)(Entity& entity);
+    };
+
+    static std::unordered_map<uint32_t, LuaComponentBinding> componentBindings;
+
+    // Scripts pass Component.Name, a precomputed identifier. A name string is still accepted and hashed, never compared
+    static const LuaComponentBinding& GetComponentBinding(const sol::object& component)
+    {
+        uint32_t id = 0;
+        if (component.get_type() == sol::type::number) {
+            id = component.as<uint32_t>();
+        } else if (component.get_type() == sol::type::string) {
+            id = GetComponentID(component.as<std::string_view>());
+        }
+
+        auto it = componentBindings.find(id);
+        if (it == componentBindings.end()) {
+            throw std::runtime_error("Unknown component type");
+        }
+        return it->second;
+    }
+
+    LuaBackend::~LuaBackend() {
+        LuaWorkerPool::Shutdown();
+    }
+
     void LuaBackend::Initialize() {
         luaState.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string, sol::lib::table);
+        LuaMemory::Configure(luaState.lua_state());
 
         # pragma region Bind Log Functions
         luaState.set_function("log", [](const std::string& message) {
@@ -333,70 +384,84 @@ namespace Coffee {
         # pragma endregion
 
         # pragma region Bind Timer Functions
+        LuaScheduler::Bind(luaState);
         # pragma endregion
 
         #pragma region Bind Entity Functions
 
+        // One binding per scriptable component of the registry, scripts pass the identifiers of the Component table
+        sol::table componentTable = luaState.create_table();
+        ComponentRegistry::ForEach([&componentTable]<typename Component>() {
+            using Info = ComponentInfo<Component>;
+            if constexpr (Info::Flags & ComponentFlags::Scriptable)
+            {
+                LuaComponentBinding binding;
+                binding.Add = [](Entity& entity, lua_State* state) {
+                    Component& component = entity.HasComponent<Component>() ? entity.GetComponent<Component>() : entity.AddComponent<Component>();
+                    return sol::make_object(state, &component);
+                };
+                binding.Get = [](Entity& entity, lua_State* state) {
+                    return entity.HasComponent<Component>() ? sol::make_object(state, &entity.GetComponent<Component>()) : sol::make_object(state, sol::lua_nil);
+                };
+                binding.Has = [](Entity& entity) { return entity.HasComponent<Component>(); };
+                binding.Remove = [](Entity& entity) {
+                    if (entity.HasComponent<Component>())
+                        entity.RemoveComponent<Component>();
+                };
+
+                if (!componentBindings.emplace(Info::ID, binding).second)
+                    COFFEE_CORE_ERROR("Lua: The identifier of {0} collides with another component", Info::Name);
+
+                componentTable[Info::Name] = Info::ID;
+            }
+        });
+        luaState["Component"] = componentTable;
+
         luaState.new_usertype<Entity>("Entity",
         sol::constructors<Entity(), Entity(entt::entity, Scene*)>(),
 
-        "AddComponent", [](Entity& self, const std::string& componentName) {
-            if (componentName == "TagComponent") {
-                self.AddComponent<TagComponent>();
-            } else if (componentName == "TransformComponent") {
-                self.AddComponent<TransformComponent>();
-            } else {
-                throw std::runtime_error("Unknown component type");
-            }
+        "AddComponent", [](Entity& self, const sol::object& component, sol::this_state state) {
+            return GetComponentBinding(component).Add(self, state);
         },
 
-/*        "GetComponent", [this](Entity& self, const std::string& componentName) -> sol::object {
-            if (componentName == "TagComponent") {
-                return sol::make_object(luaState, self.GetComponent<TagComponent>());
-            } else if (componentName == "TransformComponent") {
-                return sol::make_object(luaState, self.GetComponent<TransformComponent>());
-            } else {
-                throw std::runtime_error("Unknown component type");
-            }
-        },*/
-
-        "GetComponent", [this](Entity& self) -> sol::object {
-            return sol::make_object(luaState, self.GetComponent<TagComponent>());
+        "GetComponent", [](Entity& self, const sol::object& component, sol::this_state state) {
+            return GetComponentBinding(component).Get(self, state);
         },
 
-        "HasComponent", [](Entity& self, const std::string& componentName) -> bool {
-            if (componentName == "TagComponent") {
-                return self.HasComponent<TagComponent>();
-            } else if (componentName == "TransformComponent") {
-                return self.HasComponent<TransformComponent>();
-            } else {
-                throw std::runtime_error("Unknown component type");
-            }
+        "HasComponent", [](Entity& self, const sol::object& component) {
+            return GetComponentBinding(component).Has(self);
         },
 
-        "RemoveComponent", [](Entity& self, const std::string& componentName) {
-            if (componentName == "TagComponent") {
-                self.RemoveComponent<TagComponent>();
-            } else if (componentName == "TransformComponent") {
-                self.RemoveComponent<TransformComponent>();
-            } else {
-                throw std::runtime_error("Unknown component type");
-            }
+        "RemoveComponent", [](Entity& self, const sol::object& component) {
+            GetComponentBinding(component).Remove(self);
         },
 
         "SetParent", &Entity::SetParent,
-        "IsValid", [](Entity& self) { return static_cast<bool>(self); }
+        "IsValid", [](Entity& self) { return static_cast<bool>(self); },
+
+        // Deferred, the entity may be in the view the scripts are iterated from
+        "Destroy", [](Entity& self) { self.GetScene()->GetCommandBuffer().DestroyEntity(self); }
     );
 
         #pragma endregion
 
+        BindTypes(luaState);
+
+    }
+
+    void LuaBackend::BindTypes(sol::state& lua) {
+        # pragma region Bind Math Types
+        BindMathToLua(lua);
+        # pragma endregion
+
         # pragma region Bind Components Functions
-        luaState.new_usertype<TagComponent>("TagComponent",
+        lua.new_usertype<TagComponent>("TagComponent",
             sol::constructors<TagComponent(), TagComponent(const std::string&)>(),
             "tag", &TagComponent::Tag
         );
 
-        luaState.new_usertype<TransformComponent>("transform_component",
+        // The glm members are pushed as references into the registry storage, modified in place by the math methods
+        lua.new_usertype<TransformComponent>("transform_component",
             sol::constructors<TransformComponent(), TransformComponent(const glm::vec3&)>(),
             "position", &TransformComponent::Position,
             "rotation", &TransformComponent::Rotation,
@@ -407,24 +472,24 @@ namespace Coffee {
             "set_world_transform", &TransformComponent::SetWorldTransform
         );
 
-        luaState.new_usertype<CameraComponent>("camera_component",
+        lua.new_usertype<CameraComponent>("camera_component",
             sol::constructors<CameraComponent()>(),
             "camera", &CameraComponent::Camera
         );
 
-        luaState.new_usertype<MeshComponent>("mesh_component",
+        lua.new_usertype<MeshComponent>("mesh_component",
             sol::constructors<MeshComponent(), MeshComponent(Ref<Mesh>)>(),
             "mesh", &MeshComponent::mesh,
             "drawAABB", &MeshComponent::drawAABB,
             "get_mesh", &MeshComponent::GetMesh
         );
 
-        luaState.new_usertype<MaterialComponent>("material_component",
+        lua.new_usertype<MaterialComponent>("material_component",
             sol::constructors<MaterialComponent(), MaterialComponent(Ref<Material>)>(),
             "material", &MaterialComponent::material
         );
 
-        luaState.new_usertype<LightComponent>("light_component",
+        lua.new_usertype<LightComponent>("light_component",
             sol::constructors<LightComponent()>(),
             "color", &LightComponent::Color,
             "direction", &LightComponent::Direction,
@@ -436,7 +501,6 @@ namespace Coffee {
             "type", &LightComponent::type
         );
         # pragma endregion
-
     }
 
     void LuaBackend::ExecuteScript(const std::string& script) {
@@ -449,14 +513,216 @@ namespace Coffee {
         }
     }
 
+    static bool ReadScriptFile(const std::filesystem::path& filepath, std::string& source)
+    {
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file)
+            return false;
+
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        source = stream.str();
+        return true;
+    }
+
+    // The exported variables get their type from the value the script assigned, so they are resolved after executing it
+    static void ResolveVariableTypes(std::vector<LuaVariable>& variables, sol::environment& env)
+    {
+        for (LuaVariable& variable : variables)
+        {
+            if (variable.name != "header")
+                variable.type = env[variable.name].get_type();
+        }
+    }
+
+    /**
+     * @brief Header of a compiled script cache file.
+     */
+    struct LuaBytecodeHeader
+    {
+        static constexpr uint32_t Magic = 0x43424C43; ///< "CLBC" in little endian.
+        static constexpr uint32_t Version = 1;
+
+        uint32_t magic = Magic;
+        uint32_t version = Version;
+        uint64_t key = 0; ///< The source, path and Lua version hash, checked against the file name to detect collisions.
+        uint64_t bytecodeSize = 0;
+    };
+
+    static std::filesystem::path GetBytecodePath(uint64_t key)
+    {
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+        return CacheManager::GetScriptCachePath() / (std::string(name) + ".luac");
+    }
+
+    static bool LoadBytecode(uint64_t key, std::string& bytecode)
+    {
+        std::ifstream file(GetBytecodePath(key), std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        LuaBytecodeHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != LuaBytecodeHeader::Magic || header.version != LuaBytecodeHeader::Version ||
+            header.key != key || header.bytecodeSize == 0)
+        {
+            return false;
+        }
+
+        bytecode.resize(header.bytecodeSize);
+        file.read(bytecode.data(), bytecode.size());
+        return (bool)file;
+    }
+
+    static void SaveBytecode(uint64_t key, const std::string& bytecode)
+    {
+        LuaBytecodeHeader header;
+        header.key = key;
+        header.bytecodeSize = bytecode.size();
+
+        std::error_code error;
+        std::filesystem::create_directories(CacheManager::GetScriptCachePath(), error);
+
+        std::ofstream file(GetBytecodePath(key), std::ios::binary);
+        if (!file.is_open())
+        {
+            COFFEE_CORE_WARN("Lua: Could not write the compiled script to {0}", CacheManager::GetScriptCachePath().string());
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(bytecode.data(), bytecode.size());
+    }
+
+    static int WriteBytecode(lua_State*, const void* data, size_t size, void* userData)
+    {
+        static_cast<std::string*>(userData)->append(static_cast<const char*>(data), size);
+        return 0;
+    }
+
+    // Loads the main function of a script, from the compiled cache if the source did not change since it was written
+    static sol::protected_function LoadChunk(const std::string& source, const std::string& path, std::string& bytecode)
+    {
+        ZoneScoped;
+
+        lua_State* L = LuaBackend::luaState.lua_state();
+        const std::string chunkName = "@" + path;
+
+        // The debug information of the bytecode names the file, so the path is part of the key
+        const uint64_t key = Hash::String(source, Hash::String(path, Hash::String(LUA_RELEASE)));
+
+        if (LoadBytecode(key, bytecode))
+        {
+            if (luaL_loadbufferx(L, bytecode.data(), bytecode.size(), chunkName.c_str(), "b") == LUA_OK)
+                return sol::stack::pop<sol::protected_function>(L);
+
+            COFFEE_CORE_WARN("Lua: Compiled script {0} was rejected, compiling from source", GetBytecodePath(key).filename().string());
+            lua_pop(L, 1);
+        }
+
+        if (luaL_loadbufferx(L, source.data(), source.size(), chunkName.c_str(), "t") != LUA_OK)
+        {
+            COFFEE_CORE_ERROR("[Lua Error]: {0}", lua_tostring(L, -1));
+            lua_pop(L, 1);
+            return sol::protected_function();
+        }
+
+        bytecode.clear();
+        if (lua_dump(L, WriteBytecode, &bytecode, 0) == 0 && !bytecode.empty())
+            SaveBytecode(key, bytecode);
+
+        return sol::stack::pop<sol::protected_function>(L);
+    }
+
     void LuaBackend::ExecuteFile(const std::filesystem::path& filepath) {
-        try {
-            sol::environment env(luaState, sol::create, luaState.globals());
-            scriptEnvironments[filepath.string()] = env;
-            luaState.script_file(filepath.string(), env);
-        } catch (const sol::error& e) {
-            COFFEE_CORE_ERROR("[Lua Error]: {0}", e.what());
+        ZoneScoped;
+
+        std::string path = filepath.string();
+
+        std::error_code error;
+        std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(filepath, error);
+
+        // Already executed, the instances keep sharing its environment until the file changes
+        auto chunkIt = scriptChunks.find(path);
+        if (chunkIt != scriptChunks.end() && !error && chunkIt->second.writeTime == writeTime) {
+            return;
+        }
+
+        // The file is read once, for the exported variables and for the compiler
+        std::string source;
+        if (!ReadScriptFile(filepath, source)) {
+            COFFEE_CORE_ERROR("[Lua Error]: Could not open script file {0}", path);
+            return;
+        }
+
+        LuaScriptMetadata metadata;
+        metadata.writeTime = writeTime;
+        metadata.variables = ScanVariables(source);
+        metadata.parallel = source.find("--[[parallel]]") != std::string::npos;
+
+        // A broken script is kept too, so its instances do not compile it again one by one
+        LuaScriptChunk& scriptChunk = scriptChunks[path];
+        scriptChunk.writeTime = writeTime;
+        scriptChunk.memoryOwner = LuaMemory::RegisterOwner(path);
+
+        LuaMemoryScope memoryScope(scriptChunk.memoryOwner);
+
+        sol::environment env(luaState, sol::create, luaState.globals());
+        scriptEnvironments[path] = env;
+
+        std::string bytecode;
+        sol::protected_function chunk = LoadChunk(source, path, bytecode);
+
+        // The worker states load the compiled chunk instead of parsing the source again
+        scriptChunk.bytecode = metadata.parallel ? std::move(bytecode) : std::string();
+        if (chunk.valid()) {
+            sol::set_environment(env, chunk);
+
+            sol::protected_function_result result = chunk();
+            if (!result.valid()) {
+                sol::error e = result;
+                COFFEE_CORE_ERROR("[Lua Error]: {0}", e.what());
+            }
+
+            ResolveVariableTypes(metadata.variables, env);
+        }
+
+        scriptMetadata[path] = std::move(metadata);
+
+        if (!scriptChunk.instanceMetatable.valid()) {
+            scriptChunk.instanceMetatable = luaState.create_table();
+        }
+
+        // The existing instances see the functions and defaults of the reloaded file
+        scriptChunk.instanceMetatable[sol::meta_function::index] = env;
+    }
+
+    bool LuaBackend::IsParallel(const std::string& script) {
+        if (scriptChunks.find(script) == scriptChunks.end()) {
+            ScriptManager::ExecuteScriptFromFile(Script(script, ScriptingLanguage::Lua));
+        }
+
+        auto it = scriptMetadata.find(script);
+        return it != scriptMetadata.end() && it->second.parallel;
+    }
+
+    sol::table LuaBackend::CreateInstance(const std::string& script, const sol::object& entity) {
+        auto it = scriptChunks.find(script);
+        if (it == scriptChunks.end()) {
+            ScriptManager::ExecuteScriptFromFile(Script(script, ScriptingLanguage::Lua));
+            it = scriptChunks.find(script);
+            if (it == scriptChunks.end()) {
+                return sol::table();
+            }
         }
+
+        LuaMemoryScope memoryScope(it->second.memoryOwner);
+
+        sol::table instance = luaState.create_table(0, 1);
+        instance["entity"] = entity;
+        instance[sol::metatable_key] = it->second.instanceMetatable;
+        return instance;
     }
 
     void LuaBackend::RegisterFunction(const std::string& script, std::function<int()> func, const std::string& name) {
@@ -484,46 +750,131 @@ namespace Coffee {
         luaState[name] = variable;
     }
 
-    // This function will check all the variables from the script and map them to a cpp map so we can expose them in the editor
-    std::vector<LuaVariable> LuaBackend::MapVariables(const std::string& scriptPath) {
-        std::vector<LuaVariable> variables;
-        std::ifstream scriptFile(scriptPath);
-        std::string script((std::istreambuf_iterator<char>(scriptFile)), std::istreambuf_iterator<char>());
-
-        std::regex exportRegex(R"(--\[\[export\]\]\s+(\w+)\s*=\s*(.+))"); // --[[export]] variable = value
-        std::regex headerRegex(R"(--\s*\[\[header\]\]\s*(.+))"); // --[[header]] Esto es un header
-        std::regex combinedRegex(R"(--\[\[export\]\]\s+(\w+)\s*=\s*(.+)|--\s*\[\[header\]\]\s*(.+))");
-        std::smatch match;
-        std::string::const_iterator searchStart(script.cbegin());
-
-        auto it = scriptEnvironments.find(scriptPath);
-        if (it == scriptEnvironments.end()) {
-            COFFEE_CORE_ERROR("Script environment for {0} not found", scriptPath);
-            return variables;
-        }
+    static bool IsIdentifierChar(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
 
-        sol::environment& env = it->second;
+    static bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+    }
 
-        while (std::regex_search(searchStart, script.cend(), match, combinedRegex)) {
-            LuaVariable variable;
-            if (match[1].matched) {
-                variable.name = match[1];
-                variable.value = match[2];
-                variable.type = env[variable.name].get_type();
-            } else if (match[3].matched) {
-                variable.name = "header";
-                variable.value = match[3];
-                variable.type = sol::type::none;
+    static bool IsBlank(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    // Rest of the line from pos, without the surrounding whitespace
+    static std::string_view ReadLine(std::string_view source, size_t& pos)
+    {
+        while (pos < source.size() && IsBlank(source[pos]))
+            pos++;
+
+        size_t end = source.find('\n', pos);
+        if (end == std::string_view::npos)
+            end = source.size();
+
+        std::string_view line = source.substr(pos, end - pos);
+        while (!line.empty() && IsSpace(line.back()))
+            line.remove_suffix(1);
+
+        pos = end;
+        return line;
+    }
+
+    // Hand written scanner for the annotations, one pass over the source:
+    //   --[[export]] name = value
+    //   --[[header]] text
+    std::vector<LuaVariable> LuaBackend::ScanVariables(std::string_view source) {
+        constexpr std::string_view exportTag = "[[export]]";
+        constexpr std::string_view headerTag = "[[header]]";
+
+        std::vector<LuaVariable> variables;
+
+        size_t pos = 0;
+        while ((pos = source.find("--", pos)) != std::string_view::npos) {
+            size_t cursor = pos + 2;
+
+            if (source.substr(cursor, exportTag.size()) == exportTag) {
+                cursor += exportTag.size();
+
+                size_t nameStart = cursor;
+                while (cursor < source.size() && IsSpace(source[cursor]))
+                    cursor++;
+                if (cursor == nameStart) {
+                    pos++;
+                    continue;
+                }
+
+                nameStart = cursor;
+                while (cursor < source.size() && IsIdentifierChar(source[cursor]))
+                    cursor++;
+                std::string_view name = source.substr(nameStart, cursor - nameStart);
+
+                while (cursor < source.size() && IsBlank(source[cursor]))
+                    cursor++;
+                if (name.empty() || cursor >= source.size() || source[cursor] != '=') {
+                    pos++;
+                    continue;
+                }
+                cursor++;
+
+                std::string_view value = ReadLine(source, cursor);
+                if (value.empty()) {
+                    pos++;
+                    continue;
+                }
+
+                variables.push_back({std::string(name), std::string(value), sol::type::lua_nil});
+                pos = cursor;
+                continue;
             }
 
-            // Store the variable in the vector
-            variables.push_back(variable);
+            while (cursor < source.size() && IsSpace(source[cursor]))
+                cursor++;
 
-            // Move to the next match
-            searchStart = match.suffix().first;
+            if (source.substr(cursor, headerTag.size()) == headerTag) {
+                cursor += headerTag.size();
+
+                std::string_view text = ReadLine(source, cursor);
+                if (!text.empty()) {
+                    variables.push_back({"header", std::string(text), sol::type::none});
+                    pos = cursor;
+                    continue;
+                }
+            }
+
+            pos++;
         }
 
         return variables;
     }
 
+    // Called every frame by the inspector, only the write time of the file is checked
+    const std::vector<LuaVariable>& LuaBackend::MapVariables(const std::string& scriptPath) {
+        static const std::vector<LuaVariable> empty;
+
+        auto it = scriptMetadata.find(scriptPath);
+        auto envIt = scriptEnvironments.find(scriptPath);
+        if (it == scriptMetadata.end() || envIt == scriptEnvironments.end()) {
+            return empty;
+        }
+
+        LuaScriptMetadata& metadata = it->second;
+
+        std::error_code error;
+        std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(scriptPath, error);
+        if (!error && writeTime != metadata.writeTime) {
+            std::string source;
+            if (ReadScriptFile(scriptPath, source)) {
+                metadata.writeTime = writeTime;
+                metadata.variables = ScanVariables(source);
+                ResolveVariableTypes(metadata.variables, envIt->second);
+            }
+        }
+
+        return metadata.variables;
+    }
+
 } // namespace Coffee
\ No newline at end of file
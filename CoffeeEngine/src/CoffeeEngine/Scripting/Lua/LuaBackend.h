@@ -1,12 +1,14 @@
 #pragma once
 #include "CoffeeEngine/Scripting/IScriptingBackend.h"
 
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <sol/sol.hpp>
 #include <string>
-#include <fstream>
-#include <regex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace Coffee {
 
@@ -16,18 +18,92 @@ namespace Coffee {
         sol::type type;
     };
 
+    /**
+     * @brief Exported variables of a script file, parsed when the file is executed.
+     */
+    struct LuaScriptMetadata {
+        std::filesystem::file_time_type writeTime; ///< Write time of the file the variables were parsed from.
+        std::vector<LuaVariable> variables; ///< The exported variables and headers, in file order.
+        bool parallel = false; ///< Whether the file has a --[[parallel]] line, its instances then run in the LuaWorkerPool.
+    };
+
+    /**
+     * @brief Shared state of an executed script file, the instance tables of the entities point to it.
+     */
+    struct LuaScriptChunk {
+        std::filesystem::file_time_type writeTime; ///< Write time of the file when it was executed.
+        sol::table instanceMetatable; ///< Metatable of the instance tables, its __index is the environment of the script.
+        uint32_t memoryOwner = 0; ///< The LuaMemory owner the allocations of the script are accounted to.
+        std::string bytecode; ///< The compiled chunk of a parallel script, loaded by the worker states.
+    };
+
     class LuaBackend : public IScriptingBackend {
 
         public:
+            ~LuaBackend() override;
+
             void Initialize() override;
+
+            /**
+             * @brief Registers the math and component usertypes, shared by the main state and the worker states.
+             * @param lua The Lua state.
+             */
+            static void BindTypes(sol::state& lua);
             void ExecuteScript(const std::string& script) override;
+
+            /**
+             * @brief Compiles and executes a script file in its own environment, shared by every entity using it.
+             *
+             * The file is executed again only if its write time changed. The compiled chunk is cached as bytecode
+             * in CacheManager::GetScriptCachePath(), keyed by the source, so the next run skips the parser.
+             *
+             * @param filepath The path of the script file.
+             */
             void ExecuteFile(const std::filesystem::path& filepath) override;
             void RegisterFunction(const std::string& script, std::function<int()> func, const std::string& name) override;
             void BindFunction(const std::string& script, const std::string& name, std::function<int()>& func) override;
             void RegisterVariable(const std::string& name, void* variable) override;
-            static std::vector<LuaVariable> MapVariables(const std::string& script);
+
+            /**
+             * @brief Gets the variables exported with --[[export]] and the --[[header]] separators of a script file.
+             *
+             * The variables are parsed when the file is executed and parsed again only if the file write time changed.
+             *
+             * @param script The path of the script file.
+             * @return The exported variables, empty if the script was not executed.
+             */
+            static const std::vector<LuaVariable>& MapVariables(const std::string& script);
+
+            /**
+             * @brief Parses the exported variables and headers of a script source, without executing it.
+             * @param source The source of the script.
+             * @return The exported variables, their type is not resolved.
+             */
+            static std::vector<LuaVariable> ScanVariables(std::string_view source);
+
+            /**
+             * @brief Creates the instance table of an entity running a script file.
+             *
+             * The table only holds the entity and the values the entity sets, the rest is read from the shared
+             * environment of the script. The file is executed the first time one of its instances is created.
+             *
+             * @param script The path of the script file.
+             * @param entity The entity handle, stored as the entity field of the instance.
+             * @return The instance table, invalid if the file could not be read.
+             */
+            static sol::table CreateInstance(const std::string& script, const sol::object& entity);
+
+            /**
+             * @brief Gets whether a script file is marked --[[parallel]], executing it the first time.
+             * @param script The path of the script file.
+             * @return True if the instances of the script run in the LuaWorkerPool.
+             */
+            static bool IsParallel(const std::string& script);
+
             static sol::state luaState;
             static std::unordered_map<std::string, sol::environment> scriptEnvironments;
+            static std::unordered_map<std::string, LuaScriptMetadata> scriptMetadata;
+            static std::unordered_map<std::string, LuaScriptChunk> scriptChunks;
     };
 
 } // namespace Coffee
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "LuaMath.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/string_cast.hpp>
+#include <string>
+
+namespace Coffee {
+
+    // The element accessors index the columns directly, sol turns the exception into a Lua error
+    static void CheckMatrixIndex(int column, int row)
+    {
+        if (column < 0 || column > 3 || row < 0 || row > 3)
+            throw sol::error("mat4 index (" + std::to_string(column) + ", " + std::to_string(row) + ") out of range, columns and rows go from 0 to 3");
+    }
+
+    // Methods shared by the vector types, the in place ones return nothing so calling them never allocates
+    template<typename Vector>
+    static void BindVectorFunctions(sol::usertype<Vector>& type)
+    {
+        type[sol::meta_function::addition] = [](const Vector& a, const Vector& b) { return a + b; };
+        type[sol::meta_function::subtraction] = [](const Vector& a, const Vector& b) { return a - b; };
+        type[sol::meta_function::multiplication] = sol::overload(
+            [](const Vector& a, const Vector& b) { return a * b; },
+            [](const Vector& a, float s) { return a * s; },
+            [](float s, const Vector& a) { return s * a; });
+        type[sol::meta_function::division] = sol::overload(
+            [](const Vector& a, const Vector& b) { return a / b; },
+            [](const Vector& a, float s) { return a / s; });
+        type[sol::meta_function::unary_minus] = [](const Vector& a) { return -a; };
+        type[sol::meta_function::equal_to] = [](const Vector& a, const Vector& b) { return a == b; };
+        type[sol::meta_function::to_string] = [](const Vector& a) { return glm::to_string(a); };
+
+        type["length"] = [](const Vector& a) { return glm::length(a); };
+        type["distance"] = [](const Vector& a, const Vector& b) { return glm::distance(a, b); };
+        type["dot"] = [](const Vector& a, const Vector& b) { return glm::dot(a, b); };
+        type["normalized"] = [](const Vector& a) { return glm::normalize(a); };
+        type["lerp"] = [](const Vector& a, const Vector& b, float t) { return glm::mix(a, b, t); };
+        type["clone"] = [](const Vector& a) { return a; };
+
+        type["copy"] = [](Vector& self, const Vector& other) { self = other; };
+        type["add_inplace"] = [](Vector& self, const Vector& other) { self += other; };
+        type["sub_inplace"] = [](Vector& self, const Vector& other) { self -= other; };
+        type["mul_inplace"] = sol::overload(
+            [](Vector& self, const Vector& other) { self *= other; },
+            [](Vector& self, float s) { self *= s; });
+        type["add_scaled_inplace"] = [](Vector& self, const Vector& other, float s) { self += other * s; };
+        type["lerp_inplace"] = [](Vector& self, const Vector& other, float t) { self = glm::mix(self, other, t); };
+        type["normalize_inplace"] = [](Vector& self) {
+            float length = glm::length(self);
+            if (length > 0.0f)
+                self /= length;
+        };
+    }
+
+    void BindMathToLua(sol::state& lua)
+    {
+        sol::usertype<glm::vec2> vec2Type = lua.new_usertype<glm::vec2>("vec2",
+            sol::call_constructor, sol::constructors<glm::vec2(), glm::vec2(float), glm::vec2(float, float)>(),
+            "x", &glm::vec2::x,
+            "y", &glm::vec2::y,
+            "set", [](glm::vec2& self, float x, float y) { self = {x, y}; }
+        );
+        BindVectorFunctions(vec2Type);
+
+        sol::usertype<glm::vec3> vec3Type = lua.new_usertype<glm::vec3>("vec3",
+            sol::call_constructor, sol::constructors<glm::vec3(), glm::vec3(float), glm::vec3(float, float, float)>(),
+            "x", &glm::vec3::x,
+            "y", &glm::vec3::y,
+            "z", &glm::vec3::z,
+            "set", [](glm::vec3& self, float x, float y, float z) { self = {x, y, z}; },
+            "cross", [](const glm::vec3& a, const glm::vec3& b) { return glm::cross(a, b); }
+        );
+        BindVectorFunctions(vec3Type);
+
+        sol::usertype<glm::vec4> vec4Type = lua.new_usertype<glm::vec4>("vec4",
+            sol::call_constructor, sol::constructors<glm::vec4(), glm::vec4(float), glm::vec4(float, float, float, float), glm::vec4(const glm::vec3&, float)>(),
+            "x", &glm::vec4::x,
+            "y", &glm::vec4::y,
+            "z", &glm::vec4::z,
+            "w", &glm::vec4::w,
+            "set", [](glm::vec4& self, float x, float y, float z, float w) { self = {x, y, z, w}; }
+        );
+        BindVectorFunctions(vec4Type);
+
+        lua.new_usertype<glm::quat>("quat",
+            sol::call_constructor, sol::constructors<glm::quat(), glm::quat(float, float, float, float), glm::quat(const glm::vec3&)>(),
+            "x", &glm::quat::x,
+            "y", &glm::quat::y,
+            "z", &glm::quat::z,
+            "w", &glm::quat::w,
+            sol::meta_function::multiplication, sol::overload(
+                [](const glm::quat& a, const glm::quat& b) { return a * b; },
+                [](const glm::quat& q, const glm::vec3& v) { return q * v; }),
+            sol::meta_function::equal_to, [](const glm::quat& a, const glm::quat& b) { return a == b; },
+            sol::meta_function::to_string, [](const glm::quat& q) { return glm::to_string(q); },
+            "from_euler", [](const glm::vec3& radians) { return glm::quat(radians); },
+            "angle_axis", [](float radians, const glm::vec3& axis) { return glm::angleAxis(radians, axis); },
+            "euler", [](const glm::quat& q) { return glm::eulerAngles(q); },
+            "normalized", [](const glm::quat& q) { return glm::normalize(q); },
+            "inverse", [](const glm::quat& q) { return glm::inverse(q); },
+            "slerp", [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); },
+            "to_mat4", [](const glm::quat& q) { return glm::mat4_cast(q); },
+            "rotate", [](const glm::quat& q, const glm::vec3& v) { return q * v; },
+            "rotate_inplace", [](const glm::quat& q, glm::vec3& v) { v = q * v; },
+            "mul_inplace", [](glm::quat& self, const glm::quat& other) { self = self * other; },
+            "normalize_inplace", [](glm::quat& self) { self = glm::normalize(self); }
+        );
+
+        lua.new_usertype<glm::mat4>("mat4",
+            sol::call_constructor, sol::factories(
+                []() { return glm::mat4(1.0f); },
+                [](float diagonal) { return glm::mat4(diagonal); }),
+            sol::meta_function::multiplication, sol::overload(
+                [](const glm::mat4& a, const glm::mat4& b) { return a * b; },
+                [](const glm::mat4& m, const glm::vec4& v) { return m * v; }),
+            sol::meta_function::equal_to, [](const glm::mat4& a, const glm::mat4& b) { return a == b; },
+            sol::meta_function::to_string, [](const glm::mat4& m) { return glm::to_string(m); },
+            "get", [](const glm::mat4& m, int column, int row) { CheckMatrixIndex(column, row); return m[column][row]; },
+            "set", [](glm::mat4& m, int column, int row, float value) { CheckMatrixIndex(column, row); m[column][row] = value; },
+            "translation", [](const glm::mat4& m) { return glm::vec3(m[3]); },
+            "inverse", [](const glm::mat4& m) { return glm::inverse(m); },
+            "transpose", [](const glm::mat4& m) { return glm::transpose(m); },
+            "transform_point", [](const glm::mat4& m, const glm::vec3& p) { return glm::vec3(m * glm::vec4(p, 1.0f)); },
+            "transform_direction", [](const glm::mat4& m, const glm::vec3& d) { return glm::vec3(m * glm::vec4(d, 0.0f)); },
+            "translate", [](const glm::vec3& v) { return glm::translate(glm::mat4(1.0f), v); },
+            "scale", [](const glm::vec3& v) { return glm::scale(glm::mat4(1.0f), v); },
+            "copy", [](glm::mat4& self, const glm::mat4& other) { self = other; },
+            "mul_inplace", [](glm::mat4& self, const glm::mat4& other) { self = self * other; }
+        );
+    }
+
+}
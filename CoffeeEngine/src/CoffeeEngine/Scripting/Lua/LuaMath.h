@@ -0,0 +1,22 @@
+#pragma once
+
+#include <sol/sol.hpp>
+
+namespace Coffee {
+
+    /**
+     * @brief Registers the vec2, vec3, vec4, quat and mat4 usertypes.
+     *
+     * The usertypes wrap the glm types directly, so a component member such as transform.position is a reference
+     * into the registry storage and not a copy. The operator metamethods return new values, while the *_inplace
+     * methods modify the value they are called on and allocate nothing, which is what per frame code should use:
+     *
+     * @code
+     * transform.position:add_scaled_inplace(self.velocity, dt)
+     * @endcode
+     *
+     * @param lua The Lua state.
+     */
+    void BindMathToLua(sol::state& lua);
+
+}
@@ -0,0 +1,186 @@
+#include "LuaMemory.h"
+
+#include "CoffeeEngine/Core/Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <sol/sol.hpp>
+#include <tracy/Tracy.hpp>
+
+namespace Coffee {
+
+    uint32_t LuaMemory::s_Owner = LuaMemory::EngineOwner;
+    LuaGCSettings LuaMemory::s_Settings;
+    bool LuaMemory::s_SettingsChanged = false;
+    LuaMemoryStats LuaMemory::s_Stats;
+
+    /**
+     * @brief Prefix of every Lua block, keeps the blocks handed to Lua aligned.
+     */
+    struct alignas(std::max_align_t) LuaBlockHeader
+    {
+        uint32_t owner;
+    };
+
+    // The state allocates while it is constructed, before the statics of this file would be, so the owners are built on first use
+    std::deque<LuaMemoryOwner>& LuaMemory::Owners()
+    {
+        static std::deque<LuaMemoryOwner> owners = { LuaMemoryOwner{"Lua"} };
+        return owners;
+    }
+
+    const std::deque<LuaMemoryOwner>& LuaMemory::GetOwners()
+    {
+        return Owners();
+    }
+
+    uint32_t LuaMemory::RegisterOwner(const std::string& name)
+    {
+        std::deque<LuaMemoryOwner>& owners = Owners();
+        for (uint32_t i = 0; i < owners.size(); ++i)
+        {
+            if (owners[i].Name == name)
+                return i;
+        }
+
+        owners.push_back(LuaMemoryOwner{name});
+        return (uint32_t)owners.size() - 1;
+    }
+
+    void* LuaMemory::Allocate(void* userData, void* block, size_t oldSize, size_t newSize)
+    {
+        std::deque<LuaMemoryOwner>& owners = Owners();
+
+        if (newSize == 0)
+        {
+            if (block)
+            {
+                LuaBlockHeader* header = static_cast<LuaBlockHeader*>(block) - 1;
+                LuaMemoryOwner& owner = owners[header->owner];
+                owner.Bytes -= oldSize;
+                s_Stats.HeapBytes -= oldSize;
+
+                TracyFreeN(block, owner.Name.c_str());
+                std::free(header);
+            }
+            return nullptr;
+        }
+
+        // Without a block the old size is the type of the new object, not a size
+        uint32_t ownerIndex = s_Owner < owners.size() ? s_Owner : EngineOwner;
+        size_t previousSize = 0;
+        LuaBlockHeader* previous = nullptr;
+        if (block)
+        {
+            previous = static_cast<LuaBlockHeader*>(block) - 1;
+            ownerIndex = previous->owner;
+            previousSize = oldSize;
+        }
+
+        // On failure Lua keeps the old block and runs an emergency collection
+        LuaBlockHeader* header = static_cast<LuaBlockHeader*>(std::realloc(previous, sizeof(LuaBlockHeader) + newSize));
+        if (!header)
+            return nullptr;
+
+        header->owner = ownerIndex;
+        void* result = header + 1;
+
+        LuaMemoryOwner& owner = owners[ownerIndex];
+        owner.Bytes += newSize - previousSize;
+        owner.PeakBytes = std::max(owner.PeakBytes, owner.Bytes);
+        s_Stats.HeapBytes += newSize - previousSize;
+        s_Stats.PeakBytes = std::max(s_Stats.PeakBytes, s_Stats.HeapBytes);
+
+        if (block)
+        {
+            TracyFreeN(block, owner.Name.c_str());
+        }
+        else
+        {
+            s_Stats.FrameAllocations++;
+            s_Stats.TotalAllocations++;
+        }
+        TracyAllocN(result, newSize, owner.Name.c_str());
+
+        return result;
+    }
+
+    void LuaMemory::SetSettings(const LuaGCSettings& settings)
+    {
+        s_Settings = settings;
+        s_SettingsChanged = true;
+    }
+
+    void LuaMemory::Configure(lua_State* state)
+    {
+        // The collector only runs in Step, never in the middle of a script update
+        lua_gc(state, LUA_GCSTOP, 0);
+
+#if LUA_VERSION_NUM >= 504
+        if (s_Settings.Mode == LuaGCMode::Generational)
+        {
+            lua_gc(state, LUA_GCGEN, 0, 0);
+        }
+        else
+        {
+            lua_gc(state, LUA_GCINC, s_Settings.Pause, s_Settings.StepMultiplier, 0);
+        }
+#else
+        lua_gc(state, LUA_GCSETPAUSE, s_Settings.Pause);
+        lua_gc(state, LUA_GCSETSTEPMUL, s_Settings.StepMultiplier);
+#endif
+
+        s_SettingsChanged = false;
+    }
+
+    void LuaMemory::Step(lua_State* state)
+    {
+        ZoneScoped;
+
+        if (s_SettingsChanged)
+            Configure(state);
+
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = [&start]() {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        // Safety net for a budget too small for the allocation rate, better one pause than running out of memory
+        uint64_t forcedLimit = (uint64_t)(std::max(s_Stats.CycleBytes, (uint64_t)1024 * 1024) * s_Settings.ForcedGrowth);
+        if (s_Stats.HeapBytes > forcedLimit)
+        {
+            lua_gc(state, LUA_GCCOLLECT, 0);
+            s_Stats.ForcedCollections++;
+            s_Stats.CompletedCycles++;
+            s_Stats.CycleBytes = s_Stats.HeapBytes;
+        }
+        else if (s_Settings.Mode == LuaGCMode::Generational)
+        {
+            // A step is a minor collection, it cannot be split
+            lua_gc(state, LUA_GCSTEP, 0);
+            s_Stats.CycleBytes = s_Stats.HeapBytes;
+        }
+        else
+        {
+            do
+            {
+                if (lua_gc(state, LUA_GCSTEP, s_Settings.StepSize))
+                {
+                    s_Stats.CompletedCycles++;
+                    s_Stats.CycleBytes = s_Stats.HeapBytes;
+                    break;
+                }
+            } while (elapsed() < s_Settings.Budget);
+        }
+
+        s_Stats.GCTime = elapsed();
+
+        TracyPlot("Lua Heap (KB)", (int64_t)(s_Stats.HeapBytes / 1024));
+        TracyPlot("Lua GC (ms)", s_Stats.GCTime);
+        TracyPlot("Lua Allocations", (int64_t)s_Stats.FrameAllocations);
+
+        s_Stats.FrameAllocations = 0;
+    }
+
+}
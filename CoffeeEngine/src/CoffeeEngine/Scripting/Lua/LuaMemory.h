@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+struct lua_State;
+
+namespace Coffee {
+
+    /**
+     * @brief Garbage collector modes of the Lua state.
+     */
+    enum class LuaGCMode
+    {
+        Incremental, ///< Stepped in small slices until the frame budget is spent.
+        Generational ///< One minor collection per frame, cheap when most objects die young.
+    };
+
+    /**
+     * @brief Garbage collector configuration of the Lua state.
+     */
+    struct LuaGCSettings
+    {
+        LuaGCMode Mode = LuaGCMode::Incremental;
+        double Budget = 1.0; ///< Time the collector can take each frame, in milliseconds.
+        int StepSize = 8; ///< Work of each incremental step, in kilobytes.
+        int Pause = 200; ///< Incremental pause, in percent of the heap after the last cycle.
+        int StepMultiplier = 100; ///< Incremental speed, in percent of the allocation speed.
+        float ForcedGrowth = 4.0f; ///< A full collection is forced when the heap grows past this factor of the heap after the last cycle.
+    };
+
+    /**
+     * @brief Memory attributed to a script file, or to the engine bindings for the first owner.
+     */
+    struct LuaMemoryOwner
+    {
+        std::string Name; ///< The script path, also the name of its Tracy memory pool.
+        uint64_t Bytes = 0; ///< Live bytes allocated while the script was running.
+        uint64_t PeakBytes = 0; ///< Maximum of the live bytes.
+    };
+
+    /**
+     * @brief Structure containing the Lua memory and garbage collector statistics.
+     */
+    struct LuaMemoryStats
+    {
+        uint64_t HeapBytes = 0; ///< Live bytes of the Lua heap.
+        uint64_t PeakBytes = 0; ///< Maximum of the heap size.
+        uint64_t CycleBytes = 0; ///< Heap size after the last completed cycle.
+        uint64_t FrameAllocations = 0; ///< Number of allocations since the previous collector step.
+        uint64_t TotalAllocations = 0; ///< Number of allocations since the state was created.
+        double GCTime = 0.0; ///< Time of the last collector step, in milliseconds.
+        uint32_t CompletedCycles = 0; ///< Number of completed collection cycles.
+        uint32_t ForcedCollections = 0; ///< Number of full collections forced because the budget did not keep up.
+    };
+
+    /**
+     * @brief Allocator and garbage collector control of the Lua state.
+     *
+     * Every block carries the owner that allocated it, the script running at the time, so the live bytes are
+     * accounted per script file and reported to Tracy as one memory pool per script. The automatic collector is
+     * stopped: it only runs in Step, once per frame, under a millisecond budget.
+     */
+    class LuaMemory
+    {
+    public:
+        static constexpr uint32_t EngineOwner = 0; ///< The owner of the allocations made outside of any script.
+
+        /**
+         * @brief The lua_Alloc function of the Lua state.
+         */
+        static void* Allocate(void* userData, void* block, size_t oldSize, size_t newSize);
+
+        /**
+         * @brief Gets the owner of a script file, created the first time.
+         * @param name The path of the script file.
+         * @return The owner identifier.
+         */
+        static uint32_t RegisterOwner(const std::string& name);
+
+        static void SetOwner(uint32_t owner) { s_Owner = owner; }
+        static uint32_t GetOwner() { return s_Owner; }
+
+        /**
+         * @brief Applies the collector settings and stops the automatic collector.
+         * @param state The Lua state.
+         */
+        static void Configure(lua_State* state);
+
+        /**
+         * @brief Runs the collector for at most the frame budget.
+         * @param state The Lua state.
+         */
+        static void Step(lua_State* state);
+
+        /**
+         * @brief Sets the collector settings, applied on the next step.
+         * @param settings The settings.
+         */
+        static void SetSettings(const LuaGCSettings& settings);
+        static const LuaGCSettings& GetSettings() { return s_Settings; }
+
+        static const LuaMemoryStats& GetStats() { return s_Stats; }
+        static const std::deque<LuaMemoryOwner>& GetOwners();
+
+    private:
+        static std::deque<LuaMemoryOwner>& Owners();
+
+    private:
+        static uint32_t s_Owner; ///< The owner of the next allocations.
+        static LuaGCSettings s_Settings;
+        static bool s_SettingsChanged;
+        static LuaMemoryStats s_Stats;
+    };
+
+    /**
+     * @brief Attributes the Lua allocations to an owner for the lifetime of the scope.
+     */
+    class LuaMemoryScope
+    {
+    public:
+        LuaMemoryScope(uint32_t owner) : m_Previous(LuaMemory::GetOwner()) { LuaMemory::SetOwner(owner); }
+        ~LuaMemoryScope() { LuaMemory::SetOwner(m_Previous); }
+
+    private:
+        uint32_t m_Previous;
+    };
+
+}
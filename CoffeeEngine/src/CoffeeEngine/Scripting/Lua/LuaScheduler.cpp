@@ -0,0 +1,354 @@
+#include "LuaScheduler.h"
+
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/Scripting/Lua/LuaMemory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <tracy/Tracy.hpp>
+
+namespace Coffee {
+
+    lua_State* LuaScheduler::s_State = nullptr;
+    std::vector<LuaScheduler::Coroutine> LuaScheduler::s_Coroutines;
+    std::vector<uint32_t> LuaScheduler::s_FreeCoroutines;
+    std::unordered_map<const void*, std::vector<uint32_t>> LuaScheduler::s_OwnerCoroutines;
+    std::unordered_map<std::string, std::vector<uint64_t>> LuaScheduler::s_Events;
+    std::vector<uint64_t> LuaScheduler::s_Ready;
+    LuaTimingWheel LuaScheduler::s_TimeWheel;
+    LuaTimingWheel LuaScheduler::s_FrameWheel;
+    uint64_t LuaScheduler::s_Running = 0;
+    const void* LuaScheduler::s_Owner = nullptr;
+    uint32_t LuaScheduler::s_MemoryOwner = LuaMemory::EngineOwner;
+    double LuaScheduler::s_Time = 0.0;
+    LuaSchedulerStats LuaScheduler::s_Stats;
+
+    void LuaTimingWheel::Schedule(uint64_t tick, uint64_t handle)
+    {
+        if (tick <= m_Tick)
+            tick = m_Tick + 1;
+
+        m_Slots[tick % SlotCount].push_back({tick, handle});
+        m_Count++;
+    }
+
+    void LuaTimingWheel::Advance(uint64_t tick, std::vector<uint64_t>& due)
+    {
+        if (tick <= m_Tick)
+            return;
+
+        // Past a revolution every slot is visited once
+        uint64_t steps = std::min<uint64_t>(tick - m_Tick, SlotCount);
+        for (uint64_t step = 1; step <= steps; ++step)
+        {
+            std::vector<Entry>& slot = m_Slots[(m_Tick + step) % SlotCount];
+            for (size_t i = 0; i < slot.size();)
+            {
+                if (slot[i].Tick <= tick)
+                {
+                    due.push_back(slot[i].Handle);
+                    slot[i] = slot.back();
+                    slot.pop_back();
+                    m_Count--;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+
+        m_Tick = tick;
+    }
+
+    void LuaScheduler::Bind(sol::state& lua)
+    {
+        s_State = lua.lua_state();
+
+        sol::table coffeeTable = lua.create_named_table("coffee");
+        coffeeTable["start"] = &LuaStart;
+        coffeeTable["stop"] = &LuaStop;
+        coffeeTable["wait"] = &LuaWait;
+        coffeeTable["wait_frames"] = &LuaWaitFrames;
+        coffeeTable["wait_event"] = &LuaWaitEvent;
+        coffeeTable["signal"] = &LuaSignal;
+    }
+
+    // Handles pack the generation over the index, so a handle of a released coroutine never finds the next one
+    LuaScheduler::Coroutine* LuaScheduler::Find(uint64_t handle)
+    {
+        uint32_t index = (uint32_t)handle;
+        if (index >= s_Coroutines.size())
+            return nullptr;
+
+        Coroutine& coroutine = s_Coroutines[index];
+        if (coroutine.Generation != (uint32_t)(handle >> 32) || !coroutine.State || coroutine.Stopped)
+            return nullptr;
+
+        return &coroutine;
+    }
+
+    // A running coroutine stopped by its own script still waits, it is released once it yields
+    LuaScheduler::Coroutine* LuaScheduler::GetRunning(lua_State* state)
+    {
+        uint32_t index = (uint32_t)s_Running;
+        if (s_Running == 0 || index >= s_Coroutines.size())
+            return nullptr;
+
+        Coroutine& coroutine = s_Coroutines[index];
+        return coroutine.Generation == (uint32_t)(s_Running >> 32) && coroutine.State == state ? &coroutine : nullptr;
+    }
+
+    uint64_t LuaScheduler::Start(lua_State* thread, int reference, int argCount)
+    {
+        uint32_t index;
+        if (!s_FreeCoroutines.empty())
+        {
+            index = s_FreeCoroutines.back();
+            s_FreeCoroutines.pop_back();
+        }
+        else
+        {
+            index = (uint32_t)s_Coroutines.size();
+            s_Coroutines.emplace_back();
+        }
+
+        Coroutine& coroutine = s_Coroutines[index];
+        coroutine.State = thread;
+        coroutine.Reference = reference;
+
+        // Started from a coroutine, it belongs to the owner of that one
+        if (Coroutine* running = Find(s_Running))
+        {
+            coroutine.Owner = running->Owner;
+            coroutine.MemoryOwner = running->MemoryOwner;
+        }
+        else
+        {
+            coroutine.Owner = s_Owner;
+            coroutine.MemoryOwner = s_MemoryOwner;
+        }
+
+        if (coroutine.Owner)
+            s_OwnerCoroutines[coroutine.Owner].push_back(index);
+
+        uint64_t handle = ((uint64_t)coroutine.Generation << 32) | index;
+        Resume(handle, argCount);
+        return handle;
+    }
+
+    bool LuaScheduler::Resume(uint64_t handle, int argCount)
+    {
+        Coroutine* coroutine = Find(handle);
+        if (!coroutine)
+            return false;
+
+        uint32_t index = (uint32_t)handle;
+        lua_State* state = coroutine->State;
+        coroutine->Waiting = false;
+        coroutine->Resuming = true;
+
+        uint64_t previous = s_Running;
+        s_Running = handle;
+
+        int resultCount = 0;
+        int status;
+        {
+            LuaMemoryScope memoryScope(coroutine->MemoryOwner);
+#if LUA_VERSION_NUM >= 504
+            status = lua_resume(state, nullptr, argCount, &resultCount);
+#else
+            status = lua_resume(state, nullptr, argCount);
+            resultCount = lua_gettop(state);
+#endif
+        }
+
+        s_Running = previous;
+
+        // The coroutine may have started others and moved
+        Coroutine& resumed = s_Coroutines[index];
+        resumed.Resuming = false;
+
+        if (status == LUA_YIELD)
+        {
+            lua_pop(state, resultCount);
+
+            if (resumed.Stopped)
+            {
+                Release(index);
+            }
+            else if (!resumed.Waiting)
+            {
+                // A plain yield waits for the next update
+                s_FrameWheel.Schedule(s_FrameWheel.GetTick() + 1, handle);
+            }
+            return true;
+        }
+
+        if (status != LUA_OK)
+        {
+            const char* message = lua_tostring(state, -1);
+            luaL_traceback(state, state, message ? message : "error object is not a string", 0);
+            COFFEE_CORE_ERROR("[Lua Error]: {0}", lua_tostring(state, -1));
+        }
+
+        Release(index);
+        return true;
+    }
+
+    void LuaScheduler::Release(uint32_t index)
+    {
+        Coroutine& coroutine = s_Coroutines[index];
+        if (coroutine.Resuming)
+        {
+            coroutine.Stopped = true;
+            return;
+        }
+
+        luaL_unref(s_State, LUA_REGISTRYINDEX, coroutine.Reference);
+
+        if (coroutine.Owner)
+        {
+            auto it = s_OwnerCoroutines.find(coroutine.Owner);
+            if (it != s_OwnerCoroutines.end())
+            {
+                std::vector<uint32_t>& owned = it->second;
+                owned.erase(std::remove(owned.begin(), owned.end(), index), owned.end());
+                if (owned.empty())
+                    s_OwnerCoroutines.erase(it);
+            }
+        }
+
+        // The wheel and event entries of the coroutine are left behind, the new generation makes them stale
+        coroutine.State = nullptr;
+        coroutine.Reference = LUA_NOREF;
+        coroutine.Owner = nullptr;
+        coroutine.Generation++;
+        coroutine.Waiting = false;
+        coroutine.Stopped = false;
+        s_FreeCoroutines.push_back(index);
+    }
+
+    void LuaScheduler::StopOwner(const void* owner)
+    {
+        auto it = s_OwnerCoroutines.find(owner);
+        if (it == s_OwnerCoroutines.end())
+            return;
+
+        // Releasing edits the list
+        std::vector<uint32_t> owned = it->second;
+        for (uint32_t index : owned)
+            Release(index);
+    }
+
+    void LuaScheduler::Signal(const std::string& name)
+    {
+        auto it = s_Events.find(name);
+        if (it == s_Events.end())
+            return;
+
+        s_Ready.insert(s_Ready.end(), it->second.begin(), it->second.end());
+        s_Events.erase(it);
+    }
+
+    void LuaScheduler::Update(float dt)
+    {
+        ZoneScoped;
+
+        auto start = std::chrono::steady_clock::now();
+
+        s_Time += dt;
+
+        // Reused every update, the resumed coroutines schedule into the wheels and not into this list
+        static std::vector<uint64_t> due;
+        due.clear();
+
+        s_FrameWheel.Advance(s_FrameWheel.GetTick() + 1, due);
+        s_TimeWheel.Advance((uint64_t)(s_Time / TimeResolution), due);
+        due.insert(due.end(), s_Ready.begin(), s_Ready.end());
+        s_Ready.clear();
+
+        LuaSchedulerStats stats;
+        for (uint64_t handle : due)
+        {
+            if (Resume(handle, 0))
+                stats.ResumedCount++;
+        }
+
+        stats.CoroutineCount = (uint32_t)(s_Coroutines.size() - s_FreeCoroutines.size());
+        stats.TimerCount = s_TimeWheel.GetCount() + s_FrameWheel.GetCount();
+        stats.ResumeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        s_Stats = stats;
+
+        TracyPlot("Lua Coroutines", (int64_t)stats.CoroutineCount);
+        TracyPlot("Lua Coroutines Resumed", (int64_t)stats.ResumedCount);
+    }
+
+    int LuaScheduler::LuaStart(lua_State* state)
+    {
+        luaL_checktype(state, 1, LUA_TFUNCTION);
+        int argCount = lua_gettop(state) - 1;
+
+        lua_State* thread = lua_newthread(state);
+        int reference = luaL_ref(state, LUA_REGISTRYINDEX);
+
+        // The function and its arguments are the whole stack
+        lua_xmove(state, thread, argCount + 1);
+
+        lua_pushinteger(state, (lua_Integer)Start(thread, reference, argCount));
+        return 1;
+    }
+
+    int LuaScheduler::LuaStop(lua_State* state)
+    {
+        uint64_t handle = (uint64_t)luaL_checkinteger(state, 1);
+        if (Find(handle))
+            Release((uint32_t)handle);
+        return 0;
+    }
+
+    int LuaScheduler::LuaWait(lua_State* state)
+    {
+        double seconds = luaL_checknumber(state, 1);
+        Coroutine* coroutine = GetRunning(state);
+        if (!coroutine)
+            return luaL_error(state, "coffee.wait can only be called from a coroutine started with coffee.start");
+
+        // Rounded up, a coroutine never resumes before its time
+        s_TimeWheel.Schedule((uint64_t)std::ceil((s_Time + std::max(seconds, 0.0)) / TimeResolution), s_Running);
+        coroutine->Waiting = true;
+        return lua_yield(state, 0);
+    }
+
+    int LuaScheduler::LuaWaitFrames(lua_State* state)
+    {
+        lua_Integer frames = luaL_optinteger(state, 1, 1);
+        Coroutine* coroutine = GetRunning(state);
+        if (!coroutine)
+            return luaL_error(state, "coffee.wait_frames can only be called from a coroutine started with coffee.start");
+
+        s_FrameWheel.Schedule(s_FrameWheel.GetTick() + (uint64_t)std::max<lua_Integer>(frames, 1), s_Running);
+        coroutine->Waiting = true;
+        return lua_yield(state, 0);
+    }
+
+    int LuaScheduler::LuaWaitEvent(lua_State* state)
+    {
+        const char* name = luaL_checkstring(state, 1);
+        Coroutine* coroutine = GetRunning(state);
+        if (!coroutine)
+            return luaL_error(state, "coffee.wait_event can only be called from a coroutine started with coffee.start");
+
+        s_Events[name].push_back(s_Running);
+        coroutine->Waiting = true;
+        return lua_yield(state, 0);
+    }
+
+    int LuaScheduler::LuaSignal(lua_State* state)
+    {
+        Signal(luaL_checkstring(state, 1));
+        return 0;
+    }
+
+}
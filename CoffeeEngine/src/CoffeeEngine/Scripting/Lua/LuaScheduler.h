@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdint>
+#include <sol/sol.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @brief Structure containing the coroutine statistics of the last update.
+     */
+    struct LuaSchedulerStats
+    {
+        uint32_t CoroutineCount = 0; ///< Number of live coroutines.
+        uint32_t ResumedCount = 0; ///< Number of coroutines resumed by the last update.
+        uint32_t TimerCount = 0; ///< Number of pending wait and wait_frames entries, stopped coroutines included until they are due.
+        double ResumeTime = 0.0; ///< Time spent in the last update, in milliseconds.
+    };
+
+    /**
+     * @brief Hashed timing wheel, entries are stored in the slot of their tick and only the slots between the
+     * previous and the current tick are visited on each advance.
+     *
+     * Entries further than a revolution away stay in their slot and are skipped until they are due, so the
+     * cost of a waiting entry is one check per revolution instead of one per frame.
+     */
+    class LuaTimingWheel
+    {
+    public:
+        static constexpr uint32_t SlotCount = 256;
+
+        /**
+         * @brief Adds an entry, an entry due at or before the current tick is due on the next advance.
+         * @param tick The tick the entry is due at.
+         * @param handle The coroutine handle.
+         */
+        void Schedule(uint64_t tick, uint64_t handle);
+
+        /**
+         * @brief Moves the wheel to a tick and collects the entries due.
+         * @param tick The new current tick, ticks only move forward.
+         * @param due The collected coroutine handles.
+         */
+        void Advance(uint64_t tick, std::vector<uint64_t>& due);
+
+        uint64_t GetTick() const { return m_Tick; }
+        uint32_t GetCount() const { return m_Count; }
+
+    private:
+        struct Entry
+        {
+            uint64_t Tick;
+            uint64_t Handle;
+        };
+
+        std::vector<Entry> m_Slots[SlotCount];
+        uint64_t m_Tick = 0;
+        uint32_t m_Count = 0;
+    };
+
+    /**
+     * @brief Engine side coroutines of the Lua scripts.
+     *
+     * A script starts a coroutine with coffee.start(function, ...), which runs until its first wait. The waits
+     * yield and register the coroutine in the structure it waits on, and Update only resumes the coroutines that
+     * are due, so a script waiting costs nothing per frame:
+     *
+     * @code
+     * function OnCreate(self)
+     *     coffee.start(function()
+     *         while true do
+     *             coffee.wait_event("door_opened")
+     *             coffee.wait(0.5)
+     *             log("closing")
+     *         end
+     *     end)
+     * end
+     * @endcode
+     *
+     * - coffee.wait(seconds) resumes after the time elapsed, through a timing wheel of TimeResolution ticks.
+     * - coffee.wait_frames(frames) resumes after a number of updates, through a timing wheel of frames.
+     * - coffee.wait_event(name) resumes on the update after coffee.signal(name) or Signal.
+     *
+     * A coroutine belongs to the script instance that was running when it was started, StopOwner stops them
+     * when the instance is destroyed.
+     */
+    class LuaScheduler
+    {
+    public:
+        static constexpr double TimeResolution = 0.005; ///< Length of a tick of the time wheel, in seconds.
+
+        /**
+         * @brief Registers the coffee table and its coroutine functions.
+         * @param lua The Lua state.
+         */
+        static void Bind(sol::state& lua);
+
+        /**
+         * @brief Advances the scheduler time and frame and resumes the coroutines that are due.
+         * @param dt The frame time, in seconds.
+         */
+        static void Update(float dt);
+
+        /**
+         * @brief Wakes the coroutines waiting on an event, they are resumed on the next update.
+         * @param name The event name.
+         */
+        static void Signal(const std::string& name);
+
+        /**
+         * @brief Sets the owner of the coroutines started from now on, the instance table of the running script.
+         * @param owner The owner, nullptr for none.
+         * @param memoryOwner The LuaMemory owner the coroutines allocations are accounted to.
+         */
+        static void SetOwner(const void* owner, uint32_t memoryOwner) { s_Owner = owner; s_MemoryOwner = memoryOwner; }
+        static const void* GetOwner() { return s_Owner; }
+        static uint32_t GetMemoryOwner() { return s_MemoryOwner; }
+
+        /**
+         * @brief Stops every coroutine of an owner, a running one stops at its next yield.
+         * @param owner The owner.
+         */
+        static void StopOwner(const void* owner);
+
+        static const LuaSchedulerStats& GetStats() { return s_Stats; }
+
+    private:
+        struct Coroutine
+        {
+            lua_State* State = nullptr; ///< The thread of the coroutine.
+            int Reference = LUA_NOREF; ///< Registry reference keeping the thread alive.
+            const void* Owner = nullptr;
+            uint32_t MemoryOwner = 0;
+            uint32_t Generation = 1;
+            bool Waiting = false; ///< Set by the wait functions before they yield.
+            bool Resuming = false;
+            bool Stopped = false; ///< Stopped while it was resuming, released once it yields.
+        };
+
+        static uint64_t Start(lua_State* thread, int reference, int argCount);
+        static bool Resume(uint64_t handle, int argCount);
+        static void Release(uint32_t index);
+        static Coroutine* Find(uint64_t handle);
+        static Coroutine* GetRunning(lua_State* state);
+
+        static int LuaStart(lua_State* state);
+        static int LuaStop(lua_State* state);
+        static int LuaWait(lua_State* state);
+        static int LuaWaitFrames(lua_State* state);
+        static int LuaWaitEvent(lua_State* state);
+        static int LuaSignal(lua_State* state);
+
+    private:
+        static lua_State* s_State; ///< The main state, owner of the registry references.
+        static std::vector<Coroutine> s_Coroutines;
+        static std::vector<uint32_t> s_FreeCoroutines;
+        static std::unordered_map<const void*, std::vector<uint32_t>> s_OwnerCoroutines;
+        static std::unordered_map<std::string, std::vector<uint64_t>> s_Events;
+        static std::vector<uint64_t> s_Ready; ///< Coroutines woken by an event, resumed on the next update.
+        static LuaTimingWheel s_TimeWheel;
+        static LuaTimingWheel s_FrameWheel;
+        static uint64_t s_Running; ///< Handle of the coroutine being resumed, 0 outside of them.
+        static const void* s_Owner;
+        static uint32_t s_MemoryOwner;
+        static double s_Time; ///< Sum of the frame times, in seconds.
+        static LuaSchedulerStats s_Stats;
+    };
+
+    /**
+     * @brief Sets the owner of the coroutines started for the lifetime of the scope.
+     */
+    class LuaCoroutineOwnerScope
+    {
+    public:
+        LuaCoroutineOwnerScope(const void* owner, uint32_t memoryOwner)
+            : m_PreviousOwner(LuaScheduler::GetOwner()), m_PreviousMemoryOwner(LuaScheduler::GetMemoryOwner())
+        {
+            LuaScheduler::SetOwner(owner, memoryOwner);
+        }
+        ~LuaCoroutineOwnerScope() { LuaScheduler::SetOwner(m_PreviousOwner, m_PreviousMemoryOwner); }
+
+    private:
+        const void* m_PreviousOwner;
+        uint32_t m_PreviousMemoryOwner;
+    };
+
+}
@@ -0,0 +1,499 @@
+#include "LuaWorkerPool.h"
+
+#include "CoffeeEngine/Core/Base.h"
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/Scene/ComponentRegistry.h"
+#include "CoffeeEngine/Scene/EntityCommandBuffer.h"
+#include "CoffeeEngine/Scene/Scene.h"
+#include "CoffeeEngine/Scripting/Lua/LuaBackend.h"
+#include "CoffeeEngine/Scripting/ScriptSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <tracy/Tracy.hpp>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Coffee {
+
+    /**
+     * @brief Component writes recorded by a worker, one list per type of the component list.
+     */
+    template<typename List>
+    struct LuaComponentWrites;
+
+    template<typename... Components>
+    struct LuaComponentWrites<ComponentList<Components...>>
+    {
+        std::tuple<std::vector<std::pair<entt::entity, Components>>...> Writes;
+
+        template<typename Component>
+        std::vector<std::pair<entt::entity, Component>>& Get()
+        {
+            return std::get<std::vector<std::pair<entt::entity, Component>>>(Writes);
+        }
+
+        /**
+         * @brief Applies the writes type by type, in the order they were recorded within a type.
+         * @param registry The registry.
+         * @return The number of writes.
+         */
+        uint32_t Apply(entt::registry& registry)
+        {
+            uint32_t count = 0;
+            (ApplyType<Components>(registry, count), ...);
+            return count;
+        }
+
+        template<typename Component>
+        void ApplyType(entt::registry& registry, uint32_t& count)
+        {
+            std::vector<std::pair<entt::entity, Component>>& writes = Get<Component>();
+            for (auto& [entity, component] : writes)
+            {
+                if (registry.valid(entity))
+                    registry.emplace_or_replace<Component>(entity, std::move(component));
+            }
+            count += (uint32_t)writes.size();
+            writes.clear();
+        }
+    };
+
+    using LuaWorkerWrites = LuaComponentWrites<ComponentRegistry>;
+
+    /**
+     * @brief The entity of a parallel script, it only reads the registry and records its writes.
+     */
+    struct LuaWorkerEntity
+    {
+        entt::registry* Registry = nullptr;
+        entt::entity Handle = entt::null;
+    };
+
+    /**
+     * @brief Functions of a scriptable component in the worker states, instantiated for every type of the ComponentRegistry.
+     */
+    struct LuaWorkerBinding
+    {
+        sol::object (*Get)(const LuaWorkerEntity& entity, lua_State* state); ///< Returns a copy of the component, or nil.
+        bool (*Has)(const LuaWorkerEntity& entity);
+        void (*Set)(const LuaWorkerEntity& entity, const sol::object& value); ///< Records a write of the component.
+    };
+
+    /**
+     * @brief Compiled script executed in the state of a worker.
+     */
+    struct LuaWorkerScript
+    {
+        std::filesystem::file_time_type WriteTime; ///< Write time of the file the main state compiled.
+        sol::table InstanceMetatable; ///< Metatable of the instance tables, its __index is the environment of the script.
+    };
+
+    struct LuaWorker
+    {
+        sol::state State;
+        std::unordered_map<std::string, LuaWorkerScript> Scripts;
+        std::vector<entt::entity> Entities; ///< The instances to update this frame.
+        LuaWorkerWrites Writes;
+        double Time = 0.0; ///< Duration of the last update, in milliseconds.
+        std::thread Thread;
+    };
+
+    struct LuaWorkerPoolData
+    {
+        std::vector<Scope<LuaWorker>> Workers;
+        uint32_t WorkerCount = 1; ///< Workers the new instances are spread over.
+
+        std::mutex Mutex;
+        std::condition_variable WorkAvailable;
+        std::condition_variable WorkDone;
+        uint64_t Frame = 0; ///< Incremented to start an update.
+        uint32_t Pending = 0; ///< Workers that did not finish the update yet.
+        entt::storage_for_t<ScriptInstance>* Instances = nullptr;
+        double Time = 0.0;
+        bool Running = false;
+    };
+
+    /**
+     * @brief What the entity functions of the current thread write to, none outside of a worker update.
+     */
+    struct LuaWorkerContext
+    {
+        LuaWorkerWrites* Writes = nullptr;
+    };
+
+    static LuaWorkerPoolData* s_Data = nullptr;
+    static LuaWorkerStats s_Stats;
+    static std::unordered_map<uint32_t, LuaWorkerBinding> s_Bindings; ///< Filled before the threads start, only read afterwards.
+    static thread_local LuaWorkerContext s_Context;
+
+    static double GetElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static const LuaWorkerBinding& GetWorkerBinding(const sol::object& component)
+    {
+        uint32_t id = 0;
+        if (component.get_type() == sol::type::number)
+            id = component.as<uint32_t>();
+        else if (component.get_type() == sol::type::string)
+            id = GetComponentID(component.as<std::string_view>());
+
+        auto it = s_Bindings.find(id);
+        if (it == s_Bindings.end())
+            throw std::runtime_error("Unknown component type");
+        return it->second;
+    }
+
+    static void BindWorkerState(sol::state& lua)
+    {
+        lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string, sol::lib::table);
+
+        lua.set_function("log", [](const std::string& message) {
+            COFFEE_CORE_INFO("{0}", message);
+        });
+
+        lua.set_function("log_warning", [](const std::string& message) {
+            COFFEE_CORE_WARN("{0}", message);
+        });
+
+        lua.set_function("log_error", [](const std::string& message) {
+            COFFEE_CORE_ERROR("{0}", message);
+        });
+
+        LuaBackend::BindTypes(lua);
+
+        sol::table componentTable = lua.create_table();
+        ComponentRegistry::ForEach([&componentTable]<typename Component>() {
+            using Info = ComponentInfo<Component>;
+            if constexpr (Info::Flags & ComponentFlags::Scriptable)
+                componentTable[Info::Name] = Info::ID;
+        });
+        lua["Component"] = componentTable;
+
+        // The registry is only read through its const interface, which never creates a storage
+        lua.new_usertype<LuaWorkerEntity>("Entity",
+            sol::no_constructor,
+            "GetComponent", [](const LuaWorkerEntity& self, const sol::object& component, sol::this_state state) {
+                return GetWorkerBinding(component).Get(self, state);
+            },
+            "HasComponent", [](const LuaWorkerEntity& self, const sol::object& component) {
+                return GetWorkerBinding(component).Has(self);
+            },
+            "SetComponent", [](const LuaWorkerEntity& self, const sol::object& component, const sol::object& value) {
+                GetWorkerBinding(component).Set(self, value);
+            },
+            "IsValid", [](const LuaWorkerEntity& self) {
+                return std::as_const(*self.Registry).valid(self.Handle);
+            },
+            // Recorded by the worker thread, the scene destroys the entity after the scripts update
+            "Destroy", [](const LuaWorkerEntity& self) {
+                std::as_const(*self.Registry).ctx().get<Scene*>()->GetCommandBuffer().DestroyEntity(self.Handle);
+            }
+        );
+    }
+
+    static void UpdateWorker(LuaWorker& worker, entt::storage_for_t<ScriptInstance>& instances, double time)
+    {
+        ZoneScopedN("LuaWorkerPool::Worker");
+
+        auto start = std::chrono::steady_clock::now();
+        s_Context.Writes = &worker.Writes;
+
+        for (entt::entity entity : worker.Entities)
+        {
+            // Each worker only touches the instances of its own entities
+            ScriptInstance& instance = instances.get(entity);
+
+            float dt = (float)(time - instance.LastUpdate);
+            instance.LastUpdate = time;
+
+            auto scriptStart = std::chrono::steady_clock::now();
+            sol::protected_function_result result = instance.OnUpdate(instance.Self, dt);
+            instance.LastTime = GetElapsedMilliseconds(scriptStart);
+            instance.AverageTime += (instance.LastTime - instance.AverageTime) * 0.1;
+
+            if (!result.valid())
+            {
+                sol::error error = result;
+                COFFEE_CORE_ERROR("[Lua Error]: {0}, the script of entity {1} is disabled", error.what(), (uint32_t)entity);
+                instance.Enabled = false;
+            }
+        }
+
+        s_Context.Writes = nullptr;
+        worker.Time = GetElapsedMilliseconds(start);
+    }
+
+    static void WorkerThread(uint32_t index)
+    {
+        std::unique_lock lock(s_Data->Mutex);
+        uint64_t frame = s_Data->Frame;
+
+        while (true)
+        {
+            s_Data->WorkAvailable.wait(lock, [&frame] { return !s_Data->Running || s_Data->Frame != frame; });
+
+            if (!s_Data->Running)
+                return;
+
+            frame = s_Data->Frame;
+
+            LuaWorker& worker = *s_Data->Workers[index];
+            if (worker.Entities.empty())
+                continue;
+
+            lock.unlock();
+            UpdateWorker(worker, *s_Data->Instances, s_Data->Time);
+            lock.lock();
+
+            if (--s_Data->Pending == 0)
+                s_Data->WorkDone.notify_all();
+        }
+    }
+
+    void LuaWorkerPool::Init()
+    {
+        ZoneScoped;
+
+        if (s_Data)
+            return;
+
+        ComponentRegistry::ForEach([]<typename Component>() {
+            using Info = ComponentInfo<Component>;
+            if constexpr (Info::Flags & ComponentFlags::Scriptable)
+            {
+                LuaWorkerBinding binding;
+                binding.Get = [](const LuaWorkerEntity& entity, lua_State* state) {
+                    const Component* component = std::as_const(*entity.Registry).try_get<Component>(entity.Handle);
+                    return component ? sol::make_object(state, *component) : sol::make_object(state, sol::lua_nil);
+                };
+                binding.Has = [](const LuaWorkerEntity& entity) {
+                    return std::as_const(*entity.Registry).all_of<Component>(entity.Handle);
+                };
+                binding.Set = [](const LuaWorkerEntity& entity, const sol::object& value) {
+                    if (!value.is<Component>())
+                        throw std::runtime_error("SetComponent: the value is not a " + std::string(Info::Name));
+
+                    // Outside of a worker update, OnCreate for instance, the write is applied right away
+                    if (s_Context.Writes)
+                        s_Context.Writes->template Get<Component>().emplace_back(entity.Handle, value.as<const Component&>());
+                    else
+                        entity.Registry->emplace_or_replace<Component>(entity.Handle, value.as<const Component&>());
+                };
+                s_Bindings.emplace(Info::ID, binding);
+            }
+        });
+
+        s_Data = new LuaWorkerPoolData();
+
+        // The main thread waits during the update, so it does not need a core of its own
+        uint32_t workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        s_Data->WorkerCount = workerCount;
+
+        for (uint32_t i = 0; i < workerCount; ++i)
+        {
+            Scope<LuaWorker> worker = CreateScope<LuaWorker>();
+            BindWorkerState(worker->State);
+            s_Data->Workers.push_back(std::move(worker));
+        }
+
+        s_Data->Running = true;
+        for (uint32_t i = 0; i < workerCount; ++i)
+        {
+            s_Data->Workers[i]->Thread = std::thread(WorkerThread, i);
+        }
+    }
+
+    void LuaWorkerPool::Shutdown()
+    {
+        ZoneScoped;
+
+        if (!s_Data || !s_Data->Running)
+            return;
+
+        {
+            std::lock_guard lock(s_Data->Mutex);
+            s_Data->Running = false;
+        }
+        s_Data->WorkAvailable.notify_all();
+
+        for (Scope<LuaWorker>& worker : s_Data->Workers)
+        {
+            worker->Thread.join();
+        }
+    }
+
+    void LuaWorkerPool::SetWorkerCount(uint32_t count)
+    {
+        Init();
+        s_Data->WorkerCount = std::clamp(count, 1u, (uint32_t)s_Data->Workers.size());
+    }
+
+    uint32_t LuaWorkerPool::GetWorkerCount()
+    {
+        return s_Data ? s_Data->WorkerCount : 0;
+    }
+
+    uint32_t LuaWorkerPool::GetMaxWorkerCount()
+    {
+        return s_Data ? (uint32_t)s_Data->Workers.size() : std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    const LuaWorkerStats& LuaWorkerPool::GetStats()
+    {
+        return s_Stats;
+    }
+
+    sol::table LuaWorkerPool::CreateInstance(const std::string& script, entt::registry& registry, entt::entity entity, uint32_t& worker)
+    {
+        ZoneScoped;
+
+        Init();
+
+        auto chunkIt = LuaBackend::scriptChunks.find(script);
+        if (chunkIt == LuaBackend::scriptChunks.end() || chunkIt->second.bytecode.empty())
+        {
+            COFFEE_CORE_ERROR("LuaWorkerPool: The parallel script {0} has no compiled chunk", script);
+            return sol::table();
+        }
+
+        const LuaScriptChunk& chunk = chunkIt->second;
+
+        worker = entt::to_entity(entity) % s_Data->WorkerCount;
+        LuaWorker& luaWorker = *s_Data->Workers[worker];
+
+        // Executed again when the main state executed a newer version of the file
+        LuaWorkerScript& workerScript = luaWorker.Scripts[script];
+        if (!workerScript.InstanceMetatable.valid() || workerScript.WriteTime != chunk.writeTime)
+        {
+            workerScript.WriteTime = chunk.writeTime;
+
+            lua_State* L = luaWorker.State.lua_state();
+            sol::environment env(luaWorker.State, sol::create, luaWorker.State.globals());
+
+            const std::string chunkName = "@" + script;
+            if (luaL_loadbufferx(L, chunk.bytecode.data(), chunk.bytecode.size(), chunkName.c_str(), "b") != LUA_OK)
+            {
+                COFFEE_CORE_ERROR("[Lua Error]: {0}", lua_tostring(L, -1));
+                lua_pop(L, 1);
+            }
+            else
+            {
+                sol::protected_function main = sol::stack::pop<sol::protected_function>(L);
+                sol::set_environment(env, main);
+
+                sol::protected_function_result result = main();
+                if (!result.valid())
+                {
+                    sol::error error = result;
+                    COFFEE_CORE_ERROR("[Lua Error]: {0}", error.what());
+                }
+            }
+
+            if (!workerScript.InstanceMetatable.valid())
+                workerScript.InstanceMetatable = luaWorker.State.create_table();
+
+            workerScript.InstanceMetatable[sol::meta_function::index] = env;
+        }
+
+        sol::table instance = luaWorker.State.create_table(0, 1);
+        instance["entity"] = LuaWorkerEntity{&registry, entity};
+        instance[sol::metatable_key] = workerScript.InstanceMetatable;
+        return instance;
+    }
+
+    void LuaWorkerPool::Update(entt::registry& registry, double time)
+    {
+        ZoneScoped;
+
+        LuaWorkerStats stats;
+        if (!s_Data)
+        {
+            s_Stats = stats;
+            return;
+        }
+
+        stats.WorkerCount = s_Data->WorkerCount;
+
+        auto& instances = registry.storage<ScriptInstance>();
+        for (Scope<LuaWorker>& worker : s_Data->Workers)
+        {
+            worker->Entities.clear();
+            worker->Time = 0.0;
+        }
+
+        for (auto [entity, instance] : instances.each())
+        {
+            if (instance.Worker < s_Data->Workers.size() && instance.Enabled && instance.OnUpdate.valid())
+                s_Data->Workers[instance.Worker]->Entities.push_back(entity);
+        }
+
+        uint32_t pending = 0;
+        for (Scope<LuaWorker>& worker : s_Data->Workers)
+        {
+            if (!worker->Entities.empty())
+            {
+                pending++;
+                stats.ScriptCount += (uint32_t)worker->Entities.size();
+            }
+        }
+
+        if (pending == 0)
+        {
+            s_Stats = stats;
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (s_Data->Running)
+        {
+            {
+                std::lock_guard lock(s_Data->Mutex);
+                s_Data->Instances = &instances;
+                s_Data->Time = time;
+                s_Data->Pending = pending;
+                s_Data->Frame++;
+            }
+            s_Data->WorkAvailable.notify_all();
+
+            ZoneScopedN("LuaWorkerPool::Wait");
+            std::unique_lock lock(s_Data->Mutex);
+            s_Data->WorkDone.wait(lock, [] { return s_Data->Pending == 0; });
+        }
+        else
+        {
+            // After Shutdown the remaining instances are updated on the calling thread
+            for (Scope<LuaWorker>& worker : s_Data->Workers)
+            {
+                if (!worker->Entities.empty())
+                    UpdateWorker(*worker, instances, time);
+            }
+        }
+
+        stats.UpdateTime = GetElapsedMilliseconds(start);
+
+        // Sync point, the workers are idle and the main thread owns the registry again
+        auto applyStart = std::chrono::steady_clock::now();
+        for (Scope<LuaWorker>& worker : s_Data->Workers)
+        {
+            stats.SlowestWorkerTime = std::max(stats.SlowestWorkerTime, worker->Time);
+            stats.WriteCount += worker->Writes.Apply(registry);
+        }
+        stats.ApplyTime = GetElapsedMilliseconds(applyStart);
+
+        s_Stats = stats;
+
+        TracyPlot("Parallel Scripts (ms)", stats.UpdateTime);
+        TracyPlot("Parallel Script Writes", (int64_t)stats.WriteCount);
+    }
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <sol/sol.hpp>
+#include <string>
+
+namespace Coffee {
+
+    /**
+     * @brief Structure containing the statistics of the last parallel script update.
+     */
+    struct LuaWorkerStats
+    {
+        uint32_t WorkerCount = 0; ///< Number of worker states new parallel instances are spread over.
+        uint32_t ScriptCount = 0; ///< Number of parallel scripts updated.
+        uint32_t WriteCount = 0; ///< Number of component writes applied at the sync point.
+        double UpdateTime = 0.0; ///< Time the main thread waited for the workers, in milliseconds.
+        double SlowestWorkerTime = 0.0; ///< Time of the slowest worker, in milliseconds.
+        double ApplyTime = 0.0; ///< Time spent applying the component writes, in milliseconds.
+    };
+
+    /**
+     * @brief Worker threads running the scripts marked parallel safe, each with its own Lua state.
+     *
+     * A script opts in with a --[[parallel]] line. Each of its instances is created in the state of one worker,
+     * picked from the entity index, and updated by the thread of that worker while the main thread waits. The
+     * worker states only have the log functions, the math and component types and a restricted entity:
+     *
+     * - self.entity:GetComponent(Component.X) returns a copy of the component, or nil.
+     * - self.entity:HasComponent(Component.X).
+     * - self.entity:SetComponent(Component.X, value) records a write of the whole component.
+     * - self.entity:Destroy() records the destruction in the EntityCommandBuffer of the scene.
+     *
+     * The writes are recorded per worker and applied by the main thread once every worker is done, one component
+     * type after the other, so the registry is only read while the workers run. Scripts that need the rest of the
+     * engine, coroutines included, stay on the main state.
+     */
+    class LuaWorkerPool
+    {
+    public:
+        /**
+         * @brief Creates the worker states and threads, one per core but the main one.
+         */
+        static void Init();
+
+        /**
+         * @brief Stops the worker threads. The states are kept, the script instances may still reference them.
+         */
+        static void Shutdown();
+
+        /**
+         * @brief Sets the number of workers the new parallel instances are spread over.
+         * @param count The count, clamped between 1 and the number of worker states.
+         */
+        static void SetWorkerCount(uint32_t count);
+        static uint32_t GetWorkerCount();
+        static uint32_t GetMaxWorkerCount();
+
+        /**
+         * @brief Creates the instance table of an entity in the state of its worker, executing the compiled script
+         * there the first time.
+         * @param script The path of the script file, already executed by the main state.
+         * @param registry The registry of the entity, read by the entity functions of the script.
+         * @param entity The entity.
+         * @param worker Set to the index of the worker the instance belongs to.
+         * @return The instance table, invalid if the script has no compiled chunk.
+         */
+        static sol::table CreateInstance(const std::string& script, entt::registry& registry, entt::entity entity, uint32_t& worker);
+
+        /**
+         * @brief Updates the parallel scripts of a registry and applies their writes.
+         * @param registry The registry.
+         * @param time The script time, the scripts receive the time elapsed since their last update.
+         */
+        static void Update(entt::registry& registry, double time);
+
+        static const LuaWorkerStats& GetStats();
+    };
+
+}
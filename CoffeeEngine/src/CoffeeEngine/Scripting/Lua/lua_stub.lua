@@ -289,8 +289,72 @@ input = {
     end
 }
 
--- Timer functions
--- Add timer functions here if any
+-- Timer functions, the waits can only be called from a coroutine started with coffee.start
+coffee = {
+    start = function(func, ...)
+        -- Runs func as a coroutine until its first wait, returns its handle
+        return 0
+    end,
+    stop = function(handle)
+        -- Implementation here
+    end,
+    wait = function(seconds)
+        -- Implementation here
+    end,
+    wait_frames = function(frames)
+        -- Implementation here
+    end,
+    wait_event = function(name)
+        -- Implementation here
+    end,
+    signal = function(name)
+        -- Implementation here
+    end
+}
+
+-- Math stubs, the *_inplace methods modify the value and allocate nothing
+vec2 = {
+    x = 0.0, y = 0.0,
+    set = function(self, x, y) end,
+    add_inplace = function(self, other) end,
+    sub_inplace = function(self, other) end,
+    mul_inplace = function(self, other) end,
+    add_scaled_inplace = function(self, other, scale) end,
+    normalize_inplace = function(self) end
+}
+
+vec3 = {
+    x = 0.0, y = 0.0, z = 0.0,
+    set = function(self, x, y, z) end,
+    length = function(self) return 0.0 end,
+    dot = function(self, other) return 0.0 end,
+    cross = function(self, other) return vec3 end,
+    normalized = function(self) return vec3 end,
+    add_inplace = function(self, other) end,
+    sub_inplace = function(self, other) end,
+    mul_inplace = function(self, other) end,
+    add_scaled_inplace = function(self, other, scale) end,
+    lerp_inplace = function(self, other, t) end,
+    normalize_inplace = function(self) end
+}
+
+vec4 = {
+    x = 0.0, y = 0.0, z = 0.0, w = 1.0
+}
+
+quat = {
+    x = 0.0, y = 0.0, z = 0.0, w = 1.0,
+    from_euler = function(radians) return quat end,
+    angle_axis = function(radians, axis) return quat end,
+    rotate = function(self, vector) return vec3 end,
+    rotate_inplace = function(self, vector) end
+}
+
+mat4 = {
+    translate = function(vector) return mat4 end,
+    scale = function(vector) return mat4 end,
+    transform_point = function(self, point) return vec3 end
+}
 
 -- Component stubs
 TagComponent = {
@@ -345,20 +409,35 @@ LightComponent = {
     type = 0
 }
 
+-- Component identifiers, precomputed hashes of the component names
+Component = {
+    TagComponent = 0,
+    TransformComponent = 0,
+    CameraComponent = 0,
+    MeshComponent = 0,
+    MaterialComponent = 0,
+    LightComponent = 0
+}
+
 -- Entity functions
 Entity = {
-    AddComponent = function(self, componentName)
+    AddComponent = function(self, component)
         -- Implementation here
+        return {}
     end,
-    GetComponent = function(self, componentName)
+    GetComponent = function(self, component)
         -- Implementation here
         return {}
     end,
-    HasComponent = function(self, componentName)
+    HasComponent = function(self, component)
         -- Implementation here
         return false
     end,
-    RemoveComponent = function(self, componentName)
+    RemoveComponent = function(self, component)
+        -- Implementation here
+    end,
+    -- Only in --[[parallel]] scripts, writes a copy of the component back at the end of the update
+    SetComponent = function(self, component, value)
         -- Implementation here
     end,
     SetParent = function(self, parent)
@@ -367,5 +446,9 @@ Entity = {
     IsValid = function(self)
         -- Implementation here
         return true
+    end,
+    -- Destroys the entity and its children once the scripts of the frame are done
+    Destroy = function(self)
+        -- Implementation here
     end
 }
\ No newline at end of file
@@ -3,3 +3,18 @@
 //
 
 #include "Script.h"
+
+#include "CoffeeEngine/Scripting/ScriptSystem.h"
+
+namespace Coffee
+{
+    void ScriptComponent::OnConstruct(entt::registry& registry, entt::entity entity)
+    {
+        ScriptSystem::CreateInstance(registry, entity);
+    }
+
+    void ScriptComponent::OnDestroy(entt::registry& registry, entt::entity entity)
+    {
+        ScriptSystem::DestroyInstance(registry, entity);
+    }
+}
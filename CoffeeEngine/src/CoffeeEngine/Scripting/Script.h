@@ -3,7 +3,6 @@
 #include "CoffeeEngine/Scripting/ScriptManager.h"
 #include <entt/entity/registry.hpp>
 
-#include <functional>
 #include <filesystem>
 
 namespace Coffee
@@ -14,10 +13,6 @@ namespace Coffee
         Script(const std::filesystem::path& filepath, ScriptingLanguage language)
             : m_Language(language), m_Path(filepath) {}
 
-        std::function<int()> OnCreate;
-        std::function<int()> OnUpdate;
-        std::function<int()> OnDestroy;
-
         const std::filesystem::path& GetPath() const { return m_Path; }
         const ScriptingLanguage& GetLanguage() const { return m_Language; }
 
@@ -31,31 +26,18 @@ namespace Coffee
         Script script;
 
         ScriptComponent() = default;
-        ScriptComponent(const std::filesystem::path& filepath, ScriptingLanguage language, entt::registry& registry)
-            : script(filepath, language)
-        {
-            registry.on_construct<ScriptComponent>().connect<&ScriptComponent::OnConstruct>();
-            registry.on_destroy<ScriptComponent>().connect<&ScriptComponent::OnDestroy>();
-        }
         ScriptComponent(const Script& script)
             : script(script) {}
 
-        static void OnConstruct(entt::registry& registry, entt::entity entity)
-        {
-            auto& scriptComponent = registry.get<ScriptComponent>(entity);
-            
-            ScriptManager::ExecuteScriptFromFile(scriptComponent.script);
-            ScriptManager::BindFunction(scriptComponent.script.GetPath().string(), "OnCreate", scriptComponent.script.OnCreate);
-            ScriptManager::BindFunction(scriptComponent.script.GetPath().string(), "OnUpdate", scriptComponent.script.OnUpdate);
-            ScriptManager::BindFunction(scriptComponent.script.GetPath().string(), "OnDestroy", scriptComponent.script.OnDestroy);
-
-            scriptComponent.script.OnCreate();
-        }
-
-        static void OnDestroy(entt::registry& registry, entt::entity entity)
-        {
-            auto& scriptComponent = registry.get<ScriptComponent>(entity);
-            scriptComponent.script.OnDestroy();
-        }
+        /**
+         * @brief Creates the script instance of the entity, see ScriptSystem::CreateInstance.
+         */
+        static void OnConstruct(entt::registry& registry, entt::entity entity);
+
+        /**
+         * @brief Destroys the script instance of the entity, see ScriptSystem::DestroyInstance. Connected by the scene
+         * to the destruction of the component, so it also runs when the entity is destroyed.
+         */
+        static void OnDestroy(entt::registry& registry, entt::entity entity);
     };
 }
\ No newline at end of file
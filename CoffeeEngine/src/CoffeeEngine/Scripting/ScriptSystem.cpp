@@ -0,0 +1,529 @@
+#include "ScriptSystem.h"
+
+#include "CoffeeEngine/Core/Log.h"
+#include "CoffeeEngine/IO/CacheManager.h"
+#include "CoffeeEngine/Scene/Entity.h"
+#include "CoffeeEngine/Scene/Scene.h"
+#include "CoffeeEngine/Scripting/Lua/LuaBackend.h"
+#include "CoffeeEngine/Scripting/Lua/LuaMemory.h"
+#include "CoffeeEngine/Scripting/Lua/LuaScheduler.h"
+#include "CoffeeEngine/Scripting/Lua/LuaWorkerPool.h"
+#include "CoffeeEngine/Scripting/Script.h"
+
+#include <chrono>
+#include <fstream>
+#include <tracy/Tracy.hpp>
+#include <unordered_map>
+
+namespace Coffee {
+
+    double ScriptSystem::s_Budget = 8.0;
+    double ScriptSystem::s_Time = 0.0;
+    size_t ScriptSystem::s_Cursor = 0;
+    ScriptSystemStats ScriptSystem::s_Stats;
+
+    static double GetElapsedMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    ScriptInstance ScriptSystem::MakeInstance(Scene* scene, entt::entity entity, const Script& script)
+    {
+        ScriptInstance instance;
+
+        if (script.GetLanguage() != ScriptingLanguage::Lua)
+            return instance;
+
+        const std::string path = script.GetPath().string();
+
+        // Compiles and executes the script the first time, afterwards it only allocates the instance table
+        if (LuaBackend::IsParallel(path))
+            instance.Self = LuaWorkerPool::CreateInstance(path, scene->m_Registry, entity, instance.Worker);
+        else
+            instance.Self = LuaBackend::CreateInstance(path, sol::make_object(LuaBackend::luaState, Entity(entity, scene)));
+
+        if (!instance.Self.valid())
+            return instance;
+
+        instance.MemoryOwner = LuaBackend::scriptChunks[path].memoryOwner;
+
+        sol::object onUpdate = instance.Self["OnUpdate"];
+        if (onUpdate.get_type() == sol::type::function)
+            instance.OnUpdate = onUpdate.as<sol::protected_function>();
+
+        return instance;
+    }
+
+    void ScriptSystem::CallOnCreate(ScriptInstance& instance, entt::entity entity)
+    {
+        if (!instance.Self.valid())
+            return;
+
+        sol::object onCreate = instance.Self["OnCreate"];
+        if (onCreate.get_type() != sol::type::function)
+            return;
+
+        LuaMemoryScope memoryScope(instance.MemoryOwner);
+        LuaCoroutineOwnerScope coroutineScope(instance.Self.pointer(), instance.MemoryOwner);
+        sol::protected_function_result result = onCreate.as<sol::protected_function>()(instance.Self);
+        if (!result.valid())
+        {
+            sol::error error = result;
+            COFFEE_CORE_ERROR("[Lua Error]: {0}, the script of entity {1} is disabled", error.what(), (uint32_t)entity);
+            instance.Enabled = false;
+        }
+    }
+
+    void ScriptSystem::CreateInstances(Scene* scene, entt::registry& registry, float dt)
+    {
+        auto view = registry.view<ScriptComponent>(entt::exclude<ScriptInstance>);
+        if (view.size_hint() == 0)
+            return;
+
+        std::vector<entt::entity> entities(view.begin(), view.end());
+        for (entt::entity entity : entities)
+        {
+            ScriptInstance instance = MakeInstance(scene, entity, registry.get<ScriptComponent>(entity).script);
+            instance.LastUpdate = s_Time - dt;
+
+            CallOnCreate(registry.emplace<ScriptInstance>(entity, std::move(instance)), entity);
+        }
+    }
+
+    void ScriptSystem::CreateInstance(entt::registry& registry, entt::entity entity)
+    {
+        Scene** scene = registry.ctx().find<Scene*>();
+        if (!scene)
+        {
+            COFFEE_CORE_ERROR("ScriptSystem: The registry of entity {0} has no scene", (uint32_t)entity);
+            return;
+        }
+
+        ScriptInstance instance = MakeInstance(*scene, entity, registry.get<ScriptComponent>(entity).script);
+        instance.LastUpdate = s_Time;
+
+        CallOnCreate(registry.emplace_or_replace<ScriptInstance>(entity, std::move(instance)), entity);
+    }
+
+    void ScriptSystem::DestroyInstance(entt::registry& registry, entt::entity entity)
+    {
+        registry.remove<ScriptInstance>(entity);
+    }
+
+    void ScriptSystem::OnInstanceDestroy(entt::registry& registry, entt::entity entity)
+    {
+        ScriptInstance* instance = &registry.get<ScriptInstance>(entity);
+
+        if (instance->Self.valid())
+        {
+            sol::object onDestroy = instance->Self["OnDestroy"];
+            if (onDestroy.get_type() == sol::type::function)
+            {
+                LuaMemoryScope memoryScope(instance->MemoryOwner);
+                sol::protected_function_result result = onDestroy.as<sol::protected_function>()(instance->Self);
+                if (!result.valid())
+                {
+                    sol::error error = result;
+                    COFFEE_CORE_ERROR("[Lua Error]: {0}", error.what());
+                }
+            }
+
+            // After OnDestroy, which could have started some
+            LuaScheduler::StopOwner(instance->Self.pointer());
+        }
+    }
+
+    void ScriptSystem::DestroyInstances(entt::registry& registry)
+    {
+        ZoneScoped;
+
+        auto& storage = registry.storage<ScriptInstance>();
+        std::vector<entt::entity> entities(storage.data(), storage.data() + storage.size());
+        for (entt::entity entity : entities)
+            DestroyInstance(registry, entity);
+    }
+
+    // Values are copied to the play instances, even in the same Lua state, so the play never writes to the editor
+    // tables. Only the plain values and the tables of them are kept, the tables lose their metatable. A table
+    // reached twice is copied once, so the shared and cyclic ones stay shared and cyclic in the copy.
+    static sol::object CopyValue(const sol::object& value, lua_State* state, std::unordered_map<const void*, sol::table>& tables)
+    {
+        switch (value.get_type())
+        {
+        case sol::type::number: {
+            lua_State* source = value.lua_state();
+            value.push();
+            sol::object copy = lua_isinteger(source, -1) ? sol::make_object(state, lua_tointeger(source, -1))
+                                                         : sol::make_object(state, lua_tonumber(source, -1));
+            lua_pop(source, 1);
+            return copy;
+        }
+        case sol::type::boolean:
+            return sol::make_object(state, value.as<bool>());
+        case sol::type::string:
+            return sol::make_object(state, value.as<std::string>());
+        case sol::type::table: {
+            if (auto it = tables.find(value.pointer()); it != tables.end())
+                return sol::object(it->second);
+
+            sol::table copy = sol::state_view(state).create_table();
+            tables.emplace(value.pointer(), copy);
+
+            value.as<sol::table>().for_each([state, &copy, &tables](const sol::object& key, const sol::object& element) {
+                sol::object keyCopy = CopyValue(key, state, tables);
+                if (keyCopy.get_type() != sol::type::lua_nil)
+                    copy.raw_set(keyCopy, CopyValue(element, state, tables));
+            });
+
+            return sol::object(copy);
+        }
+        default:
+            return sol::make_object(state, sol::lua_nil);
+        }
+    }
+
+    void ScriptSystem::CopyInstances(Scene* scene, entt::registry& dst, entt::registry& src, const std::vector<entt::entity>& entityMap)
+    {
+        ZoneScoped;
+
+        for (auto [srcEntity, srcInstance] : src.storage<ScriptInstance>().each())
+        {
+            entt::entity entity = entityMap[entt::to_entity(srcEntity)];
+            if (!dst.all_of<ScriptComponent>(entity))
+                continue;
+
+            ScriptInstance instance = MakeInstance(scene, entity, dst.get<ScriptComponent>(entity).script);
+            instance.LastUpdate = s_Time;
+
+            if (instance.Self.valid() && srcInstance.Self.valid())
+            {
+                // Raw iteration, only the values set on the instance and not the shared defaults
+                lua_State* state = instance.Self.lua_state();
+                std::unordered_map<const void*, sol::table> tables;
+                srcInstance.Self.for_each([&instance, state, &tables](const sol::object& key, const sol::object& value) {
+                    if (key.is<std::string>() && key.as<std::string>() == "entity")
+                        return;
+
+                    sol::object keyCopy = CopyValue(key, state, tables);
+                    if (keyCopy.get_type() != sol::type::lua_nil)
+                        instance.Self.raw_set(keyCopy, CopyValue(value, state, tables));
+                });
+            }
+
+            CallOnCreate(dst.emplace_or_replace<ScriptInstance>(entity, std::move(instance)), entity);
+        }
+    }
+
+    void ScriptSystem::OnUpdate(Scene* scene, entt::registry& registry, float dt)
+    {
+        ZoneScoped;
+
+        s_Time += dt;
+        CreateInstances(scene, registry, dt);
+
+        // Only the coroutines that are due, the waiting ones cost nothing
+        LuaScheduler::Update(dt);
+
+        auto& storage = registry.storage<ScriptInstance>();
+        size_t count = storage.size();
+
+        ScriptSystemStats stats;
+        stats.ScriptCount = (uint32_t)count;
+
+        if (count == 0)
+        {
+            s_Stats = stats;
+            return;
+        }
+
+        // Copy the entities, a script may create or destroy scripted entities while it runs
+        std::vector<entt::entity> entities(storage.data(), storage.data() + count);
+        if (s_Cursor >= count)
+            s_Cursor = 0;
+
+        auto updateStart = std::chrono::steady_clock::now();
+        size_t updated = 0;
+        bool ranScript = false;
+
+        // The parallel scripts first, their writes are applied before the main state scripts read the components
+        LuaWorkerPool::Update(registry, s_Time);
+
+        // The budget only covers the main state scripts, the parallel ones run outside of it
+        auto frameStart = std::chrono::steady_clock::now();
+
+        for (; updated < count; ++updated)
+        {
+            entt::entity entity = entities[(s_Cursor + updated) % count];
+            if (!storage.contains(entity))
+                continue;
+
+            ScriptInstance& instance = storage.get(entity);
+            if (!instance.Enabled || !instance.OnUpdate.valid() || instance.Worker != ScriptInstance::MainState)
+                continue;
+
+            auto scriptStart = std::chrono::steady_clock::now();
+
+            // At least one script runs every step, so the round robin makes progress whatever the budget
+            if (ranScript && s_Budget > 0.0 && GetElapsedMilliseconds(frameStart, scriptStart) > s_Budget)
+                break;
+            ranScript = true;
+
+            float scriptDt = (float)(s_Time - instance.LastUpdate);
+            instance.LastUpdate = s_Time;
+
+            LuaMemory::SetOwner(instance.MemoryOwner);
+            LuaScheduler::SetOwner(instance.Self.pointer(), instance.MemoryOwner);
+            sol::protected_function_result result = instance.OnUpdate(instance.Self, scriptDt);
+            LuaScheduler::SetOwner(nullptr, LuaMemory::EngineOwner);
+            LuaMemory::SetOwner(LuaMemory::EngineOwner);
+
+            auto scriptEnd = std::chrono::steady_clock::now();
+
+            // The instance may have moved if the script added scripted entities
+            ScriptInstance& updatedInstance = storage.get(entity);
+            updatedInstance.LastTime = GetElapsedMilliseconds(scriptStart, scriptEnd);
+            updatedInstance.AverageTime += (updatedInstance.LastTime - updatedInstance.AverageTime) * 0.1;
+
+            if (!result.valid())
+            {
+                sol::error error = result;
+                COFFEE_CORE_ERROR("[Lua Error]: {0}, the script of entity {1} is disabled", error.what(), (uint32_t)entity);
+                updatedInstance.Enabled = false;
+            }
+        }
+
+        stats.UpdatedCount = (uint32_t)updated;
+        stats.SkippedCount = (uint32_t)(count - updated);
+        stats.UpdateTime = GetElapsedMilliseconds(updateStart, std::chrono::steady_clock::now());
+
+        // Next frame starts with the scripts that were skipped
+        s_Cursor = (s_Cursor + updated) % count;
+
+        for (auto [entity, instance] : storage.each())
+        {
+            if (!instance.Enabled)
+                stats.ErrorCount++;
+
+            if (instance.AverageTime > stats.SlowestTime)
+            {
+                stats.SlowestTime = instance.AverageTime;
+                stats.SlowestEntity = entity;
+            }
+        }
+
+        s_Stats = stats;
+
+        TracyPlot("Script Update (ms)", stats.UpdateTime);
+        TracyPlot("Scripts Skipped", (int64_t)stats.SkippedCount);
+    }
+
+    ScriptBenchmarkResult ScriptSystem::RunBenchmark(const std::string& name, const char* source, uint32_t entityCount, uint32_t frameCount)
+    {
+        ZoneScoped;
+
+        std::filesystem::path scriptPath = CacheManager::GetCachePath() / (name + ".lua");
+        std::filesystem::create_directories(scriptPath.parent_path());
+        {
+            std::ofstream file(scriptPath);
+            file << source;
+        }
+
+        Ref<Scene> scene = CreateRef<Scene>();
+        Script script(scriptPath, ScriptingLanguage::Lua);
+        ScriptManager::ExecuteScriptFromFile(script);
+
+        for (uint32_t i = 0; i < entityCount; ++i)
+        {
+            Entity entity = scene->CreateEntity("Scripted Entity");
+            entity.AddComponent<ScriptComponent>(script);
+        }
+
+        double previousBudget = s_Budget;
+        s_Budget = 0.0;
+        s_Cursor = 0;
+
+        ScriptBenchmarkResult result;
+
+        // The file was executed above, creating the instances only allocates their tables
+        auto createStart = std::chrono::steady_clock::now();
+        CreateInstances(scene.get(), scene->m_Registry, 0.0f);
+        result.CreateTime = GetElapsedMilliseconds(createStart, std::chrono::steady_clock::now());
+
+        uint64_t allocationsStart = LuaMemory::GetStats().TotalAllocations;
+
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            OnUpdate(scene.get(), scene->m_Registry, 1.0f / 60.0f);
+
+            double frameTime = s_Stats.UpdateTime + LuaScheduler::GetStats().ResumeTime;
+            result.AverageTime += frameTime;
+            result.MaxTime = std::max(result.MaxTime, frameTime);
+        }
+
+        s_Budget = previousBudget;
+
+        if (frameCount > 0)
+        {
+            result.AverageTime /= frameCount;
+            result.AllocationsPerFrame = (double)(LuaMemory::GetStats().TotalAllocations - allocationsStart) / frameCount;
+        }
+
+        COFFEE_CORE_INFO("{0}: {1} instances created in {2:.3f} ms", name, entityCount, result.CreateTime);
+        COFFEE_CORE_INFO("{0}: {1} entities, {2} frames, {3:.3f} ms per frame on average, {4:.3f} ms at most, {5:.1f} ns per script",
+                         name, entityCount, frameCount, result.AverageTime, result.MaxTime, entityCount > 0 ? result.AverageTime * 1e6 / entityCount : 0.0);
+        COFFEE_CORE_INFO("{0}: {1:.0f} Lua allocations per frame, {2:.2f} per script", name, result.AllocationsPerFrame,
+                         entityCount > 0 ? result.AllocationsPerFrame / entityCount : 0.0);
+
+        // Destroy the instances while the script is still known, then forget the script
+        scene.reset();
+        LuaBackend::scriptEnvironments.erase(scriptPath.string());
+        LuaBackend::scriptMetadata.erase(scriptPath.string());
+        LuaBackend::scriptChunks.erase(scriptPath.string());
+
+        return result;
+    }
+
+    double ScriptSystem::Benchmark(uint32_t entityCount, uint32_t frameCount)
+    {
+        // A typical small script: read the arguments, touch the entity and do a bit of math
+        static constexpr const char* benchmarkScript = R"(
+--[[export]] speed = 2.0
+
+function OnUpdate(self, dt)
+    local angle = self.speed * dt
+    local x = math.cos(angle) * 0.5
+    local y = math.sin(angle) * 0.5
+    return x + y
+end
+)";
+
+        return RunBenchmark("ScriptBenchmark", benchmarkScript, entityCount, frameCount).AverageTime;
+    }
+
+    double ScriptSystem::BenchmarkTransforms(uint32_t entityCount, uint32_t frameCount)
+    {
+        // Spin and move written with the operators, every operation returns a new value
+        static constexpr const char* operatorScript = R"(
+function OnUpdate(self, dt)
+    local transform = self.entity:GetComponent(Component.TransformComponent)
+    transform.rotation = transform.rotation + vec3(0.0, 90.0, 0.0) * dt
+    transform.position = transform.position + vec3(0.0, 0.0, 1.0) * dt
+end
+)";
+
+        // The same with the in place methods on the component references, the vectors are created once
+        static constexpr const char* inPlaceScript = R"(
+function OnCreate(self)
+    self.spin = vec3(0.0, 90.0, 0.0)
+    self.velocity = vec3(0.0, 0.0, 1.0)
+end
+
+function OnUpdate(self, dt)
+    local transform = self.entity:GetComponent(Component.TransformComponent)
+    transform.rotation:add_scaled_inplace(self.spin, dt)
+    transform.position:add_scaled_inplace(self.velocity, dt)
+end
+)";
+
+        ScriptBenchmarkResult operators = RunBenchmark("TransformBenchmarkOperators", operatorScript, entityCount, frameCount);
+        ScriptBenchmarkResult inPlace = RunBenchmark("TransformBenchmarkInPlace", inPlaceScript, entityCount, frameCount);
+
+        COFFEE_CORE_INFO("Transform benchmark: {0:.2f} allocations per script with operators, {1:.2f} in place",
+                         entityCount > 0 ? operators.AllocationsPerFrame / entityCount : 0.0,
+                         entityCount > 0 ? inPlace.AllocationsPerFrame / entityCount : 0.0);
+
+        return inPlace.AllocationsPerFrame;
+    }
+
+    double ScriptSystem::BenchmarkCoroutines(uint32_t entityCount, uint32_t frameCount)
+    {
+        // Mostly idle scripts polling a timer in OnUpdate, every script runs every frame
+        static constexpr const char* pollingScript = R"(
+--[[export]] interval = 1.0
+
+function OnCreate(self)
+    self.elapsed = math.random() * self.interval
+    self.ticks = 0
+end
+
+function OnUpdate(self, dt)
+    self.elapsed = self.elapsed + dt
+    if self.elapsed >= self.interval then
+        self.elapsed = self.elapsed - self.interval
+        self.ticks = self.ticks + 1
+    end
+end
+)";
+
+        // The same with a coroutine waiting on the scheduler, only the scripts that are due run
+        static constexpr const char* coroutineScript = R"(
+--[[export]] interval = 1.0
+
+function OnCreate(self)
+    self.ticks = 0
+    coffee.start(function()
+        coffee.wait(math.random() * self.interval)
+        while true do
+            self.ticks = self.ticks + 1
+            coffee.wait(self.interval)
+        end
+    end)
+end
+)";
+
+        ScriptBenchmarkResult polling = RunBenchmark("CoroutineBenchmarkPolling", pollingScript, entityCount, frameCount);
+        ScriptBenchmarkResult coroutines = RunBenchmark("CoroutineBenchmarkWaiting", coroutineScript, entityCount, frameCount);
+
+        COFFEE_CORE_INFO("Coroutine benchmark: {0:.3f} ms per frame polling, {1:.3f} ms with coroutines",
+                         polling.AverageTime, coroutines.AverageTime);
+
+        return coroutines.AverageTime;
+    }
+
+    double ScriptSystem::BenchmarkParallel(uint32_t entityCount, uint32_t frameCount)
+    {
+        // Reads its transform, does a bit of math and writes the transform back through the worker
+        static constexpr const char* parallelScript = R"(
+--[[parallel]]
+--[[export]] speed = 2.0
+
+function OnCreate(self)
+    self.time = 0.0
+end
+
+function OnUpdate(self, dt)
+    self.time = self.time + dt
+
+    local wave = 0.0
+    for i = 1, 16 do
+        wave = wave + math.sin(self.time * self.speed * i) / i
+    end
+
+    local transform = self.entity:GetComponent(Component.TransformComponent)
+    transform.rotation.y = transform.rotation.y + 90.0 * self.speed * dt
+    transform.position.y = wave
+    self.entity:SetComponent(Component.TransformComponent, transform)
+end
+)";
+
+        LuaWorkerPool::Init();
+        uint32_t previousCount = LuaWorkerPool::GetWorkerCount();
+        uint32_t workerCount = LuaWorkerPool::GetMaxWorkerCount();
+
+        // The worker of an instance is picked when it is created, so each run creates its own scene
+        LuaWorkerPool::SetWorkerCount(1);
+        ScriptBenchmarkResult single = RunBenchmark("ParallelBenchmarkSingle", parallelScript, entityCount, frameCount);
+
+        LuaWorkerPool::SetWorkerCount(workerCount);
+        ScriptBenchmarkResult parallel = RunBenchmark("ParallelBenchmark", parallelScript, entityCount, frameCount);
+
+        LuaWorkerPool::SetWorkerCount(previousCount);
+
+        COFFEE_CORE_INFO("Parallel benchmark: {0:.3f} ms per frame with 1 worker, {1:.3f} ms with {2} workers ({3:.2f}x)",
+                         single.AverageTime, parallel.AverageTime, workerCount,
+                         parallel.AverageTime > 0.0 ? single.AverageTime / parallel.AverageTime : 0.0);
+
+        return parallel.AverageTime;
+    }
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <sol/sol.hpp>
+#include <string>
+#include <vector>
+
+namespace Coffee {
+
+    class Scene;
+    class Script;
+
+    /**
+     * @brief Runtime state of the script of an entity, created with the ScriptComponent or the first time the script is updated.
+     *
+     * It lives in the registry next to the ScriptComponent and is not serialized. Scene::Copy copies the instance
+     * table values, so the values edited in the inspector are the ones the runtime scene starts with.
+     */
+    struct ScriptInstance
+    {
+        static constexpr uint32_t MainState = UINT32_MAX; ///< The Worker of the instances living in the main Lua state.
+
+        sol::protected_function OnUpdate; ///< The OnUpdate function of the script, invalid if it has none.
+        sol::table Self; ///< The instance table passed as first argument, its metatable indexes the shared script environment.
+        uint32_t MemoryOwner = 0; ///< The LuaMemory owner of the script file, its allocations are accounted to it.
+        uint32_t Worker = MainState; ///< The LuaWorkerPool worker whose state holds the instance of a parallel script.
+        double LastUpdate = 0.0; ///< Script time of the last update, the next one receives the time elapsed since, skipped frames included.
+        double LastTime = 0.0; ///< Duration of the last update, in milliseconds.
+        double AverageTime = 0.0; ///< Moving average of the update duration, in milliseconds.
+        bool Enabled = true; ///< Cleared when the script raises an error, so a broken script does not spam the log.
+    };
+
+    /**
+     * @brief Structure containing the script update statistics of the last frame.
+     */
+    struct ScriptSystemStats
+    {
+        uint32_t ScriptCount = 0; ///< Number of script instances.
+        uint32_t UpdatedCount = 0; ///< Number of scripts updated this frame.
+        uint32_t SkippedCount = 0; ///< Number of scripts left for the next frame because the budget was spent.
+        uint32_t ErrorCount = 0; ///< Number of scripts disabled by an error.
+        double UpdateTime = 0.0; ///< Time spent in the script updates, in milliseconds.
+        double SlowestTime = 0.0; ///< Average update time of the slowest script, in milliseconds.
+        entt::entity SlowestEntity = entt::null; ///< The entity of the slowest script.
+    };
+
+    /**
+     * @brief Structure containing the results of a script benchmark.
+     */
+    struct ScriptBenchmarkResult
+    {
+        double CreateTime = 0.0; ///< Time to create every script instance, in milliseconds.
+        double AverageTime = 0.0; ///< Average time of a frame of updates, in milliseconds.
+        double MaxTime = 0.0; ///< Longest frame of updates, in milliseconds.
+        double AllocationsPerFrame = 0.0; ///< Average number of Lua allocations of a frame of updates.
+    };
+
+    /**
+     * @brief Updates the Lua scripts of a scene.
+     *
+     * Every entity gets its own instance table, holding the entity handle in self.entity and the values it sets,
+     * while the functions and the exported defaults are read from the environment of the script through the
+     * metatable. A script file is compiled and executed once however many entities use it.
+     *
+     * The OnUpdate function of every script is cached as a protected function and called with the instance table and
+     * the delta time as arguments, OnUpdate(self, dt). The updates run under a per frame time budget: once it is spent
+     * the remaining scripts are left for the next frame, which starts with them and passes them the accumulated time.
+     *
+     * The coroutines the scripts start with coffee.start are resumed by the LuaScheduler before the updates and
+     * belong to the instance that started them.
+     *
+     * The instances of the scripts marked --[[parallel]] live in the states of the LuaWorkerPool and are updated by
+     * its threads first, outside of the budget, then the main state scripts run with the parallel writes applied.
+     */
+    class ScriptSystem
+    {
+    public:
+        /**
+         * @brief Updates the scripts of a scene.
+         * @param scene The scene the entities belong to.
+         * @param registry The registry of the scene.
+         * @param dt The delta time.
+         */
+        static void OnUpdate(Scene* scene, entt::registry& registry, float dt);
+
+        /**
+         * @brief Creates the script instance of an entity and calls OnCreate(self), connected to the ScriptComponent construction.
+         * @param registry The registry of the entity, its scene is looked up in the registry context.
+         * @param entity The entity with the ScriptComponent.
+         */
+        static void CreateInstance(entt::registry& registry, entt::entity entity);
+
+        /**
+         * @brief Removes the script instance of an entity, connected to the ScriptComponent destruction.
+         * @param registry The registry of the entity.
+         * @param entity The entity with the ScriptComponent.
+         */
+        static void DestroyInstance(entt::registry& registry, entt::entity entity);
+
+        /**
+         * @brief Calls OnDestroy(self) and stops the coroutines of a script instance, connected to the ScriptInstance
+         * destruction so it runs whichever of the component or the instance an entity destruction removes first.
+         * @param registry The registry of the entity.
+         * @param entity The entity with the ScriptInstance.
+         */
+        static void OnInstanceDestroy(entt::registry& registry, entt::entity entity);
+
+        /**
+         * @brief Destroys every script instance of a registry, called when its scene is destroyed.
+         * @param registry The registry.
+         */
+        static void DestroyInstances(entt::registry& registry);
+
+        /**
+         * @brief Creates the script instances of a copied scene from the ones of the source scene.
+         *
+         * The plain values set in the source instance tables are copied, the nested tables deeply, so the copies
+         * share no table with the source instances. Other values (functions, userdata...) are not copied.
+         *
+         * @param scene The copied scene.
+         * @param dst The registry of the copied scene.
+         * @param src The registry of the source scene.
+         * @param entityMap The copied entity of each source entity, by entity index.
+         */
+        static void CopyInstances(Scene* scene, entt::registry& dst, entt::registry& src, const std::vector<entt::entity>& entityMap);
+
+        /**
+         * @brief Sets the time the script updates can take each frame.
+         * @param budget The budget in milliseconds, 0 for no limit.
+         */
+        static void SetBudget(double budget) { s_Budget = budget; }
+        static double GetBudget() { return s_Budget; }
+
+        static const ScriptSystemStats& GetStats() { return s_Stats; }
+
+        /**
+         * @brief Runs a scene of scripted entities for a number of frames and logs the update times.
+         * @param entityCount The number of scripted entities.
+         * @param frameCount The number of frames to update.
+         * @return The average time of a frame of updates, in milliseconds.
+         */
+        static double Benchmark(uint32_t entityCount = 10000, uint32_t frameCount = 100);
+
+        /**
+         * @brief Runs a spin and move script on transformed entities, once written with the vector operators and
+         * once with the in place methods, and logs the Lua allocations of each.
+         * @param entityCount The number of scripted entities.
+         * @param frameCount The number of frames to update.
+         * @return The average number of Lua allocations of a frame with the in place methods.
+         */
+        static double BenchmarkTransforms(uint32_t entityCount = 1000, uint32_t frameCount = 100);
+
+        /**
+         * @brief Runs mostly idle scripts ticking once per interval, once polling a timer in OnUpdate and once
+         * waiting in a coroutine, and logs the frame times of each.
+         * @param entityCount The number of scripted entities.
+         * @param frameCount The number of frames to update.
+         * @return The average time of a frame with the coroutines, in milliseconds.
+         */
+        static double BenchmarkCoroutines(uint32_t entityCount = 10000, uint32_t frameCount = 100);
+
+        /**
+         * @brief Runs a parallel script on transformed entities, once with a single worker and once spread over every
+         * worker, and logs the frame times of each.
+         * @param entityCount The number of scripted entities.
+         * @param frameCount The number of frames to update.
+         * @return The average time of a frame with every worker, in milliseconds.
+         */
+        static double BenchmarkParallel(uint32_t entityCount = 20000, uint32_t frameCount = 100);
+
+    private:
+        static void CreateInstances(Scene* scene, entt::registry& registry, float dt);
+        static ScriptBenchmarkResult RunBenchmark(const std::string& name, const char* source, uint32_t entityCount, uint32_t frameCount);
+        static ScriptInstance MakeInstance(Scene* scene, entt::entity entity, const Script& script);
+        static void CallOnCreate(ScriptInstance& instance, entt::entity entity);
+
+    private:
+        static double s_Budget; ///< Per frame budget in milliseconds.
+        static double s_Time; ///< Sum of the delta times of every update, in seconds.
+        static size_t s_Cursor; ///< Index of the first script to update next frame.
+        static ScriptSystemStats s_Stats;
+    };
+
+}